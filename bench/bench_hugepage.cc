@@ -0,0 +1,56 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include "bench_utils.h"
+#include "libshmlite/container/shm_array.hpp"
+
+// 比较 4KiB 页和大页下 ShmArray 的随机访问速度，数组越大 TLB 缺失的影响越明显
+// 用法：bench_hugepage [元素数量] [访问次数]
+
+static double RandomAccess(shmlite::ShmArray<long> &arr, long accesses, long &sum) {
+  const size_t n = arr.Size();
+  std::mt19937_64 rng(42);
+  double start = shmlite::bench::NowSeconds();
+  for (long i = 0; i < accesses; ++i) {
+    sum += arr[rng() % n];
+  }
+  return shmlite::bench::NowSeconds() - start;
+}
+
+static void Run(const char *label, const std::string &name, long count, long accesses,
+                const shmlite::ShmHandleOptions &options) {
+  shmlite::ShmHandle::UnLink(name, options);
+  {
+    shmlite::ShmArray<long> arr(name, count, options);
+    if (!arr.IsValid()) {
+      std::printf("%-24s unavailable\n", label);
+      return;
+    }
+    for (long i = 0; i < count; ++i) {
+      arr[i] = i;
+    }
+    long sum = 0;
+    double t = RandomAccess(arr, accesses, sum);
+    std::printf("%-24s %10.2f ns/access (checksum %ld)\n", label, t * 1e9 / accesses, sum);
+  }
+  shmlite::ShmHandle::UnLink(name, options);
+}
+
+int main(int argc, char **argv) {
+  const long count = shmlite::bench::ArgOr(argc, argv, 1, 64L << 20);
+  const long accesses = shmlite::bench::ArgOr(argc, argv, 2, 20000000);
+
+  shmlite::ShmHandleOptions base;
+  Run("4KiB pages", "bench_hugepage_4k", count, accesses, base);
+
+  shmlite::ShmHandleOptions huge;
+  huge.page_size = shmlite::SHM_PAGE_HUGE_2M;
+  huge.thp_fallback = false;
+  Run("2MiB hugetlbfs", "bench_hugepage_2m", count, accesses, huge);
+
+  shmlite::ShmHandleOptions thp;
+  thp.page_size = shmlite::SHM_PAGE_HUGE_2M;
+  thp.hugetlbfs_dir = "/nonexistent-hugetlbfs"; /* 强制使用透明大页 */
+  Run("2MiB transparent", "bench_hugepage_thp", count, accesses, thp);
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include <sched.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bench_utils.h"
+#include "libshmlite/container/shm_replicated_array.hpp"
+
+// 测量跨 NUMA 节点读取共享内存的带宽：内存分别绑定在每个节点上，读者分别运行在每个节点上，
+// 最后测量每个节点读取本地副本的 ShmReplicatedArray
+// 用法：bench_numa [元素数量] [读取轮数]
+
+/**
+ * @brief 把调用者绑定到节点的 CPU 上，之后 fork 出来的子进程会继承
+ */
+static bool PinToNode(int node) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : shmlite::NumaNodeCpus(node)) {
+    CPU_SET(cpu, &set);
+  }
+  return CPU_COUNT(&set) > 0 && sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+template <typename F>
+static long SumAll(size_t n, F get) {
+  long sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    sum += get(i);
+  }
+  return sum;
+}
+
+int main(int argc, char **argv) {
+  const long count = shmlite::bench::ArgOr(argc, argv, 1, 16L << 20);
+  const long rounds = shmlite::bench::ArgOr(argc, argv, 2, 5);
+  const double bytes = static_cast<double>(count) * sizeof(long) * rounds;
+  std::vector<int> nodes = shmlite::NumaOnlineNodes();
+  cpu_set_t original;
+  sched_getaffinity(0, sizeof(original), &original);
+
+  for (int mem_node : nodes) {
+    shmlite::ShmHandleOptions options;
+    options.numa_policy = shmlite::SHM_NUMA_BIND;
+    options.numa_node = mem_node;
+    std::string name = "bench_numa" + std::to_string(mem_node);
+    shmlite::ShmHandle::UnLink(name);
+    shmlite::ShmArray<long> arr(name, count, options);
+    if (!arr.IsValid()) {
+      return 1;
+    }
+    arr.Fill(1);
+    const long *data = &arr[0];
+    for (int reader_node : nodes) {
+      if (!PinToNode(reader_node)) {
+        continue;
+      }
+      double t = shmlite::bench::RunProcesses(1, [&](int) {
+        long sum = 0;
+        for (long r = 0; r < rounds; ++r) {
+          sum += SumAll(count, [&](size_t i) { return data[i]; });
+        }
+        if (sum != count * rounds) {
+          std::printf("checksum mismatch\n");
+        }
+      });
+      std::printf("memory node %d, reader node %d: %8.2f GB/s\n", mem_node, reader_node,
+                  bytes / t / 1e9);
+    }
+    sched_setaffinity(0, sizeof(original), &original);
+    shmlite::ShmHandle::UnLink(name);
+  }
+
+  shmlite::ShmReplicatedArray<long>::UnLink("bench_numa_rep");
+  {
+    shmlite::ShmReplicatedArray<long> rep("bench_numa_rep", count);
+    rep.Fill(1);
+    for (int reader_node : nodes) {
+      if (!PinToNode(reader_node)) {
+        continue;
+      }
+      double t = shmlite::bench::RunProcesses(1, [&](int) {
+        rep.Rebind();
+        const long *data = &rep[0];
+        long sum = 0;
+        for (long r = 0; r < rounds; ++r) {
+          sum += SumAll(count, [&](size_t i) { return data[i]; });
+        }
+        if (sum != count * rounds) {
+          std::printf("checksum mismatch\n");
+        }
+      });
+      std::printf("replicated, reader node %d:    %8.2f GB/s\n", reader_node, bytes / t / 1e9);
+    }
+    sched_setaffinity(0, sizeof(original), &original);
+  }
+  shmlite::ShmReplicatedArray<long>::UnLink("bench_numa_rep");
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "bench_utils.h"
+#include "libshmlite/container/shm_array.hpp"
+
+// 对比 ShmArray 批量操作在不同指令集级别下的吞吐量，"loop" 为逐个元素操作的原始实现
+// 用法：bench_shmarray [元素个数] [重复次数]
+
+namespace {
+
+const char *kLevelNames[] = {"scalar", "sse2", "avx2"};
+
+template <typename Fn>
+void Report(const char *op, const char *impl, size_t bytes, long repeat, Fn fn) {
+  fn(); /* 预热，同时触发缺页 */
+  double start = shmlite::bench::NowSeconds();
+  for (long r = 0; r < repeat; ++r) {
+    fn();
+  }
+  double elapsed = shmlite::bench::NowSeconds() - start;
+  std::printf("%-10s %-8s %12.2f\n", op, impl, bytes * repeat / elapsed / 1e9);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const size_t n = shmlite::bench::ArgOr(argc, argv, 1, 1 << 22);
+  const long repeat = shmlite::bench::ArgOr(argc, argv, 2, 20);
+  const size_t bytes = n * sizeof(int32_t);
+  shmlite::ShmHandle::UnLink("bench_array");
+  shmlite::ShmArray<int32_t> arr("bench_array", n);
+  if (!arr.IsValid()) {
+    return 1;
+  }
+  volatile int64_t sink = 0;
+  std::printf("%-10s %-8s %12s\n", "op", "impl", "GB/s");
+
+  Report("fill", "loop", bytes, repeat, [&] {
+    for (size_t i = 0; i < n; ++i) {
+      arr[i] = 42;
+    }
+  });
+  Report("find", "loop", bytes, repeat, [&] {
+    size_t pos = 0;
+    while (pos < n && arr[pos] != -1) {
+      ++pos;
+    }
+    sink = sink + pos;
+  });
+  Report("sum", "loop", bytes, repeat, [&] {
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+      sum += arr[i];
+    }
+    sink = sink + sum;
+  });
+  Report("max", "loop", bytes, repeat, [&] {
+    int32_t result = arr[0];
+    for (size_t i = 1; i < n; ++i) {
+      result = std::max(result, arr[i]);
+    }
+    sink = sink + result;
+  });
+
+  shmlite::SimdLevel detected = shmlite::DetectSimdLevel();
+  for (int level = shmlite::SIMD_SCALAR; level <= detected; ++level) {
+    shmlite::SetSimdLevel(static_cast<shmlite::SimdLevel>(level));
+    const char *name = kLevelNames[level];
+    Report("fill", name, bytes, repeat, [&] { arr.Fill(42); });
+    Report("find", name, bytes, repeat, [&] { sink = sink + arr.Find(-1); });
+    Report("count", name, bytes, repeat, [&] { sink = sink + arr.Count(42); });
+    Report("sum", name, bytes, repeat, [&] { sink = sink + arr.Sum(); });
+    Report("max", name, bytes, repeat, [&] { sink = sink + arr.Max(); });
+  }
+  /* 强制使用非临时存储，对比超过缓存大小的填充 */
+  size_t threshold = shmlite::GetNonTemporalThreshold();
+  shmlite::SetNonTemporalThreshold(1);
+  Report("fill", "nt", bytes, repeat, [&] { arr.Fill(42); });
+  shmlite::SetNonTemporalThreshold(threshold);
+  Report("copyto", "memcpy", bytes, repeat, [&] {
+    static std::vector<int32_t> out(n);
+    arr.CopyTo(out.data(), n);
+    sink = sink + out[n / 2];
+  });
+  shmlite::ShmHandle::UnLink("bench_array");
+  return 0;
+}
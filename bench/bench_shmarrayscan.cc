@@ -0,0 +1,80 @@
+#include <cstdio>
+#include <numeric>
+#include "bench_utils.h"
+#include "libshmlite/container/shm_array.hpp"
+
+// 对比不同访问方式顺序扫描 ShmArray 的吞吐量：带检查的 operator[]/At 与
+// 不检查的 UncheckedAt、迭代器、视图和裸指针。以 -O3 编译，观察编译器能否自动向量化；
+// 求和按 uint32_t 回绕，避免类型扩展妨碍向量化
+// 用法：bench_shmarrayscan [元素个数] [重复次数]
+
+namespace {
+
+template <typename Fn>
+void Report(const char *impl, size_t bytes, long repeat, Fn fn) {
+  volatile uint32_t sink = fn(); /* 预热，同时触发缺页 */
+  double start = shmlite::bench::NowSeconds();
+  for (long r = 0; r < repeat; ++r) {
+    sink = sink + fn();
+  }
+  double elapsed = shmlite::bench::NowSeconds() - start;
+  std::printf("%-14s %12.2f\n", impl, bytes * repeat / elapsed / 1e9);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const size_t n = shmlite::bench::ArgOr(argc, argv, 1, 1 << 16);
+  const long repeat = shmlite::bench::ArgOr(argc, argv, 2, 10000);
+  const size_t bytes = n * sizeof(uint32_t);
+  shmlite::ShmHandle::UnLink("bench_array_scan");
+  shmlite::ShmArray<uint32_t> arr("bench_array_scan", n);
+  if (!arr.IsValid()) {
+    return 1;
+  }
+  std::iota(arr.begin(), arr.end(), 0);
+  std::printf("%-14s %12s\n", "access", "GB/s");
+
+  Report("operator[]", bytes, repeat, [&] {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+      sum += arr[i];
+    }
+    return sum;
+  });
+  Report("At", bytes, repeat, [&] {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+      sum += arr.At(i);
+    }
+    return sum;
+  });
+  Report("UncheckedAt", bytes, repeat, [&] {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+      sum += arr.UncheckedAt(i);
+    }
+    return sum;
+  });
+  Report("range-for", bytes, repeat, [&] {
+    uint32_t sum = 0;
+    for (uint32_t v : arr) {
+      sum += v;
+    }
+    return sum;
+  });
+  Report("View", bytes, repeat, [&] {
+    shmlite::ShmSpan<const uint32_t> view = static_cast<const shmlite::ShmArray<uint32_t> &>(arr).View();
+    return std::accumulate(view.begin(), view.end(), uint32_t(0));
+  });
+  Report("Data", bytes, repeat, [&] {
+    const uint32_t *data = arr.Data();
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+      sum += data[i];
+    }
+    return sum;
+  });
+  shmlite::ShmHandle::UnLink("bench_array_scan");
+  return 0;
+}
@@ -0,0 +1,67 @@
+#include <sys/mman.h>
+#include <atomic>
+#include <cstdio>
+#include "bench_utils.h"
+#include "libshmlite/container/shm_broadcast_ring.hpp"
+
+// 一个写者向 1~64 个读者广播消息，统计写者的发布速度、每个读者完整收到的消息数和被套圈的次数
+// 用法：bench_shmbroadcastring [消息数量] [消息长度（字节）]
+
+int main(int argc, char **argv) {
+  const long count = shmlite::bench::ArgOr(argc, argv, 1, 1000000);
+  const long size = shmlite::bench::ArgOr(argc, argv, 2, 64);
+  shmlite::ShmHandle::UnLink("bench_bcast");
+  shmlite::ShmBroadcastRing ring("bench_bcast", 4 << 20);
+  if (!ring.IsValid() || static_cast<size_t>(size) > ring.MaxMessageSize() ||
+      size < static_cast<long>(sizeof(long))) {
+    return 1;
+  }
+  /* 所有读者收到的消息总数和被套圈的次数，以及写者发布的耗时（纳秒） */
+  auto *stats = static_cast<std::atomic<long> *>(mmap(nullptr, sizeof(std::atomic<long>) * 3,
+                                                       PROT_READ | PROT_WRITE,
+                                                       MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+  std::printf("%-8s %14s %14s %14s\n", "readers", "publish Mmsg/s", "recv/reader", "laps/reader");
+  for (int readers = 1; readers <= 64; readers *= 2) {
+    stats[0] = 0;
+    stats[1] = 0;
+    stats[2] = 0;
+    const uint64_t total = ring.Published() + count;
+    /* 在 fork 之前创建读者，保证所有读者都从第一条消息开始 */
+    shmlite::ShmBroadcastReader base(ring);
+    shmlite::bench::RunProcesses(readers + 1, [&](int i) {
+      if (i == readers) {
+        char buf[4096] = {0};
+        double start = shmlite::bench::NowSeconds();
+        for (long n = 0; n < count; ++n) {
+          *reinterpret_cast<long *>(buf) = n;
+          ring.Publish(buf, size);
+        }
+        stats[2] = static_cast<long>((shmlite::bench::NowSeconds() - start) * 1e9);
+        return;
+      }
+      shmlite::ShmBroadcastReader reader(base);
+      long received = 0, laps = 0, sum = 0;
+      for (;;) {
+        shmlite::ShmBroadcastMessage msg{};
+        bool done = ring.Published() == total;
+        auto status = reader.Poll(msg);
+        if (status == shmlite::ShmBroadcastReader::OK) {
+          sum += *static_cast<const long *>(msg.data);
+          received += reader.Validate(msg);
+        } else if (status == shmlite::ShmBroadcastReader::LAPPED) {
+          ++laps;
+        } else if (done) {
+          break;
+        }
+      }
+      stats[0].fetch_add(received);
+      stats[1].fetch_add(laps + (sum == -1));
+    });
+    std::printf("%-8d %14.2f %14.0f %14.0f\n", readers, count * 1e3 / stats[2].load(),
+                stats[0].load() / static_cast<double>(readers),
+                stats[1].load() / static_cast<double>(readers));
+  }
+  munmap(stats, sizeof(std::atomic<long>) * 3);
+  shmlite::ShmHandle::UnLink("bench_bcast");
+  return 0;
+}
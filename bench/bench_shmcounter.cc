@@ -0,0 +1,41 @@
+#include <cstdio>
+#include "bench_utils.h"
+#include "libshmlite/shm_counter.hpp"
+
+// 对比分片计数和单个原子变量（等价于对 GET_LONG 做 __atomic_fetch_add）在不同进程数下的吞吐量
+// 用法：bench_shmcounter [每个进程的增加次数] [最大进程数]
+
+int main(int argc, char **argv) {
+  const long loops = shmlite::bench::ArgOr(argc, argv, 1, 2000000);
+  const long max_procs = shmlite::bench::ArgOr(argc, argv, 2, sysconf(_SC_NPROCESSORS_ONLN));
+  shmlite::ShmHandle::UnLink("bench_counter");
+  shmlite::ShmCounter<> sharded("bench_counter");
+  shmlite::ShmCounter<> atomic("bench_counter", shmlite::SHM_COUNTER_ATOMIC);
+  if (!sharded.IsValid()) {
+    return 1;
+  }
+  std::printf("%-8s %-10s %14s\n", "procs", "mode", "Mincr/s");
+  for (long procs = 1; procs <= max_procs; procs *= 2) {
+    sharded.Reset();
+    double t_sharded = shmlite::bench::RunProcesses(procs, [&](int) {
+      for (long n = 0; n < loops; ++n) {
+        sharded.Increment();
+      }
+    });
+    long total_sharded = sharded.Load();
+    sharded.Reset();
+    double t_atomic = shmlite::bench::RunProcesses(procs, [&](int) {
+      for (long n = 0; n < loops; ++n) {
+        atomic.Increment();
+      }
+    });
+    long total_atomic = atomic.Load();
+    if (total_sharded != procs * loops || total_atomic != procs * loops) {
+      std::printf("count mismatch: %ld %ld\n", total_sharded, total_atomic);
+    }
+    std::printf("%-8ld %-10s %14.2f\n", procs, "sharded", procs * loops / t_sharded / 1e6);
+    std::printf("%-8ld %-10s %14.2f\n", procs, "atomic", procs * loops / t_atomic / 1e6);
+  }
+  shmlite::ShmHandle::UnLink("bench_counter");
+  return 0;
+}
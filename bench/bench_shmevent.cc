@@ -0,0 +1,62 @@
+#include <atomic>
+#include <cstdio>
+#include "bench_utils.h"
+#include "libshmlite/shm_event.h"
+#include "libshmlite/shm_handle.h"
+#include "libshmlite/shm_lock.h"
+
+// 两个进程乒乓传递一个值，对比 ShmEvent 与用 ShmLock::Wait/Post 充当事件的往返延迟，
+// 以及没有等待者时 ShmEvent::NotifyOne 的开销
+// 用法：bench_shmevent [往返次数]
+
+struct Shared {
+  shmlite::ShmEvent ping_event;
+  shmlite::ShmEvent pong_event;
+  std::atomic<long> ping;
+  std::atomic<long> pong;
+};
+
+int main(int argc, char **argv) {
+  const long rounds = shmlite::bench::ArgOr(argc, argv, 1, 100000);
+  shmlite::ShmHandle shm("bench_shmevent", sizeof(Shared), shmlite::ShmHandle::CREAT_RDWR, true);
+  shmlite::ShmLock ping_sem("bench_shmevent_ping", 0, true);
+  shmlite::ShmLock pong_sem("bench_shmevent_pong", 0, true);
+  if (!shm.IsValid() || !ping_sem.IsValid() || !pong_sem.IsValid()) {
+    return 1;
+  }
+  auto *shared = static_cast<Shared *>(shm.Ptr());
+
+  double t_event = shmlite::bench::RunProcesses(2, [&](int i) {
+    for (long n = 1; n <= rounds; ++n) {
+      if (i == 0) {
+        shared->ping.store(n);
+        shared->ping_event.NotifyOne();
+        shared->pong_event.Wait([&] { return shared->pong.load() == n; });
+      } else {
+        shared->ping_event.Wait([&] { return shared->ping.load() == n; });
+        shared->pong.store(n);
+        shared->pong_event.NotifyOne();
+      }
+    }
+  });
+  double t_sem = shmlite::bench::RunProcesses(2, [&](int i) {
+    for (long n = 1; n <= rounds; ++n) {
+      if (i == 0) {
+        ping_sem.Post();
+        pong_sem.Wait();
+      } else {
+        ping_sem.Wait();
+        pong_sem.Post();
+      }
+    }
+  });
+  double start = shmlite::bench::NowSeconds();
+  for (long n = 0; n < rounds * 10; ++n) {
+    shared->ping_event.NotifyOne();
+  }
+  double t_notify = shmlite::bench::NowSeconds() - start;
+  std::printf("%-28s %10.2f us/roundtrip\n", "ShmEvent ping-pong", t_event * 1e6 / rounds);
+  std::printf("%-28s %10.2f us/roundtrip\n", "ShmLock ping-pong", t_sem * 1e6 / rounds);
+  std::printf("%-28s %10.2f ns/op\n", "NotifyOne without waiters", t_notify * 1e9 / rounds / 10);
+  return 0;
+}
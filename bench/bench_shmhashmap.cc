@@ -0,0 +1,59 @@
+#include <cstdio>
+#include "bench_utils.h"
+#include "libshmlite/container/shm_hash_map.hpp"
+
+// ShmHashMap 的 put/get 吞吐量，以及 1 个写进程下多个读进程的查找吞吐量
+// 用法：bench_shmhashmap [元素数量] [读进程数量]
+
+int main(int argc, char **argv) {
+  const long count = shmlite::bench::ArgOr(argc, argv, 1, 10000000);
+  const long readers = shmlite::bench::ArgOr(argc, argv, 2, 4);
+  shmlite::ShmHandle::UnLink("bench_hashmap");
+  shmlite::ShmHashMap<uint64_t, uint64_t> map("bench_hashmap", count);
+  if (!map.IsValid()) {
+    return 1;
+  }
+
+  double start = shmlite::bench::NowSeconds();
+  for (long i = 0; i < count; ++i) {
+    map.Put(i, i);
+  }
+  double t_put = shmlite::bench::NowSeconds() - start;
+
+  uint64_t v = 0, hits = 0;
+  start = shmlite::bench::NowSeconds();
+  for (long i = 0; i < count; ++i) {
+    hits += map.Find(i, v);
+  }
+  double t_get = shmlite::bench::NowSeconds() - start;
+
+  start = shmlite::bench::NowSeconds();
+  for (long i = count; i < 2 * count; ++i) {
+    hits += map.Find(i, v);
+  }
+  double t_miss = shmlite::bench::NowSeconds() - start;
+
+  std::printf("entries = %ld, buckets = %zu, hits = %lu\n", count, map.BucketCount(), hits);
+  std::printf("%-22s %12.2f Mops/s\n", "put", count / t_put / 1e6);
+  std::printf("%-22s %12.2f Mops/s\n", "get (hit)", count / t_get / 1e6);
+  std::printf("%-22s %12.2f Mops/s\n", "get (miss)", count / t_miss / 1e6);
+
+  /* 序号0的进程持续写，其它进程随机读 */
+  double elapsed = shmlite::bench::RunProcesses(readers + 1, [&](int idx) {
+    uint64_t x = idx * 0x9e3779b97f4a7c15ULL + 1, out = 0;
+    for (long i = 0; i < count; ++i) {
+      x ^= x << 13;
+      x ^= x >> 7;
+      x ^= x << 17;
+      if (idx == 0) {
+        map.Put(x % count, i);
+      } else {
+        map.Find(x % count, out);
+      }
+    }
+  });
+  std::printf("%-22s %12.2f Mops/s (1 writer + %ld readers)\n", "mixed",
+              count * (readers + 1) / elapsed / 1e6, readers);
+  shmlite::ShmHandle::UnLink("bench_hashmap");
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <cstdio>
+#include <vector>
+#include "bench_utils.h"
+#include "libshmlite/shm_heap.h"
+
+// ShmHeap 的分配吞吐量和碎片率：随机大小的对象反复分配和释放
+// 用法：bench_shmheap [操作次数] [存活对象数量]
+
+/**
+ * @brief 简单的xorshift随机数
+ *
+ */
+static uint64_t NextRand(uint64_t &x) {
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return x;
+}
+
+int main(int argc, char **argv) {
+  const long ops = shmlite::bench::ArgOr(argc, argv, 1, 5000000);
+  const long live = shmlite::bench::ArgOr(argc, argv, 2, 100000);
+  const size_t heap_size = 1UL << 30;
+  shmlite::ShmHandle::UnLink("bench_heap");
+  shmlite::ShmHeap heap("bench_heap", heap_size);
+  if (!heap.IsValid()) {
+    return 1;
+  }
+
+  std::vector<uint64_t> offsets(live, shmlite::kShmNullOffset);
+  std::vector<size_t> sizes(live, 0);
+  size_t requested = 0;
+  uint64_t x = 88172645463325252ULL;
+  double start = shmlite::bench::NowSeconds();
+  for (long i = 0; i < ops; ++i) {
+    size_t slot = NextRand(x) % live;
+    if (offsets[slot] != shmlite::kShmNullOffset) {
+      heap.Deallocate(offsets[slot]);
+      requested -= sizes[slot];
+    }
+    /* 大部分是小对象，少量大对象 */
+    size_t size = NextRand(x) % 100 == 0 ? NextRand(x) % (256 * 1024) : 8 + NextRand(x) % 512;
+    offsets[slot] = heap.Allocate(size);
+    sizes[slot] = offsets[slot] == shmlite::kShmNullOffset ? 0 : size;
+    requested += sizes[slot];
+  }
+  double elapsed = shmlite::bench::NowSeconds() - start;
+
+  shmlite::ShmHeapStats stats = heap.Stats();
+  size_t chunk_bytes = stats.chunks_in_use * shmlite::kShmHeapChunkSize;
+  std::printf("alloc+free:      %.2f Mops/s (%.1f ns/op)\n", ops / elapsed / 1e6,
+              elapsed * 1e9 / ops);
+  std::printf("live requested:  %zu bytes\n", requested);
+  std::printf("used bytes:      %zu bytes (internal fragmentation %.1f%%)\n", stats.used_bytes,
+              100.0 * (1 - static_cast<double>(requested) / stats.used_bytes));
+  std::printf("chunks in use:   %zu / %zu (%.1f%% of chunk bytes hold live data)\n",
+              stats.chunks_in_use, stats.chunk_count, 100.0 * requested / chunk_bytes);
+  for (uint64_t off : offsets) {
+    heap.Deallocate(off);
+  }
+  shmlite::ShmHandle::UnLink("bench_heap");
+  return 0;
+}
@@ -0,0 +1,36 @@
+#include <cstdio>
+#include "bench_utils.h"
+#include "libshmlite/container/shm_mpmc_queue.hpp"
+
+// ShmMpmcQueue 的扩展性测试：N 个生产者进程和 N 个消费者进程，N 从 1 到 32
+// 用法：bench_shmmpmcqueue [消息总数] [队列容量]
+
+int main(int argc, char **argv) {
+  const long count = shmlite::bench::ArgOr(argc, argv, 1, 4000000);
+  const long capacity = shmlite::bench::ArgOr(argc, argv, 2, 4096);
+  shmlite::ShmHandle::UnLink("bench_mpmcqueue");
+  shmlite::ShmMpmcQueue<uint64_t> queue("bench_mpmcqueue", capacity);
+  if (!queue.IsValid()) {
+    return 1;
+  }
+
+  std::printf("%-10s %-10s %12s\n", "producers", "consumers", "Mmsgs/s");
+  for (int n : {1, 2, 4, 8, 16, 32}) {
+    const long per_proc = count / n;
+    double elapsed = shmlite::bench::RunProcesses(2 * n, [&](int idx) {
+      uint64_t v = 0;
+      if (idx < n) {
+        for (long i = 0; i < per_proc; ++i) {
+          queue.Push(i);
+        }
+      } else {
+        for (long i = 0; i < per_proc; ++i) {
+          queue.Pop(v);
+        }
+      }
+    });
+    std::printf("%-10d %-10d %12.2f\n", n, n, per_proc * n / elapsed / 1e6);
+  }
+  shmlite::ShmHandle::UnLink("bench_mpmcqueue");
+  return 0;
+}
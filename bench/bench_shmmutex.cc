@@ -0,0 +1,60 @@
+#include <cstdio>
+#include "bench_utils.h"
+#include "libshmlite/shm_handle.h"
+#include "libshmlite/shm_lock.h"
+#include "libshmlite/shm_mutex.h"
+
+// 对比 ShmMutex、ShmRobustMutex 与 ShmLock::Wait/Post 在 1、4、16 个进程竞争下的加解锁开销
+// 用法：bench_shmmutex [每个进程的循环次数]
+
+struct Shared {
+  shmlite::ShmMutex mtx;
+  shmlite::ShmRobustMutex robust_mtx;
+  volatile long counter;
+};
+
+int main(int argc, char **argv) {
+  long loops = shmlite::bench::ArgOr(argc, argv, 1, 200000);
+  shmlite::ShmHandle shm("bench_shmmutex", sizeof(Shared), shmlite::ShmHandle::CREAT_RDWR, true);
+  if (!shm.IsValid()) {
+    return 1;
+  }
+  auto *shared = reinterpret_cast<Shared *>(shm.Ptr());
+  shmlite::ShmLock lock("bench_shmmutex", 1, true);
+
+  std::printf("%-8s %-10s %12s %12s\n", "procs", "lock", "ns/op", "Mops/s");
+  for (int procs : {1, 4, 16}) {
+    shared->counter = 0;
+    double t_mutex = shmlite::bench::RunProcesses(procs, [&](int) {
+      for (long i = 0; i < loops; ++i) {
+        shared->mtx.Lock();
+        shared->counter = shared->counter + 1;
+        shared->mtx.Unlock();
+      }
+    });
+    shared->counter = 0;
+    double t_robust = shmlite::bench::RunProcesses(procs, [&](int) {
+      for (long i = 0; i < loops; ++i) {
+        shared->robust_mtx.Lock();
+        shared->counter = shared->counter + 1;
+        shared->robust_mtx.Unlock();
+      }
+    });
+    shared->counter = 0;
+    double t_sem = shmlite::bench::RunProcesses(procs, [&](int) {
+      for (long i = 0; i < loops; ++i) {
+        lock.Wait();
+        shared->counter = shared->counter + 1;
+        lock.Post();
+      }
+    });
+    double ops = static_cast<double>(loops) * procs;
+    std::printf("%-8d %-10s %12.1f %12.2f\n", procs, "ShmMutex", t_mutex * 1e9 / ops,
+                ops / t_mutex / 1e6);
+    std::printf("%-8d %-10s %12.1f %12.2f\n", procs, "Robust", t_robust * 1e9 / ops,
+                ops / t_robust / 1e6);
+    std::printf("%-8d %-10s %12.1f %12.2f\n", procs, "ShmLock", t_sem * 1e9 / ops,
+                ops / t_sem / 1e6);
+  }
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "bench_utils.h"
+#include "libshmlite/shm_handle.h"
+#include "libshmlite/shm_offset_ptr.hpp"
+
+// 比较普通指针和 shm_offset_ptr 在链表遍历和数组扫描中的速度
+// 用法：bench_shmoffsetptr [节点数量] [遍历轮数]
+
+struct RawNode {
+  RawNode *next;
+  long value;
+};
+
+struct OffsetNode {
+  shmlite::shm_offset_ptr<OffsetNode> next;
+  long value;
+};
+
+template <typename NodeT, typename F>
+static double Traverse(NodeT *head, long rounds, long &sum, F next) {
+  double start = shmlite::bench::NowSeconds();
+  for (long r = 0; r < rounds; ++r) {
+    for (NodeT *n = head; n != nullptr; n = next(n)) {
+      sum += n->value;
+    }
+  }
+  return shmlite::bench::NowSeconds() - start;
+}
+
+int main(int argc, char **argv) {
+  const long count = shmlite::bench::ArgOr(argc, argv, 1, 1000000);
+  const long rounds = shmlite::bench::ArgOr(argc, argv, 2, 20);
+  shmlite::ShmHandle::UnLink("bench_offsetptr");
+  shmlite::ShmHandle shm("bench_offsetptr", (sizeof(RawNode) + sizeof(OffsetNode)) * count,
+                         shmlite::ShmHandle::CREAT_RDWR, true);
+  if (!shm.IsValid()) {
+    return 1;
+  }
+  auto *raw = reinterpret_cast<RawNode *>(shm.Ptr());
+  auto *off = reinterpret_cast<OffsetNode *>(raw + count);
+
+  /* 两个链表使用相同的随机顺序 */
+  std::vector<long> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937_64(42));
+  for (long i = 0; i < count; ++i) {
+    long cur = order[i];
+    raw[cur].value = off[cur].value = cur;
+    raw[cur].next = i + 1 < count ? &raw[order[i + 1]] : nullptr;
+    off[cur].next = i + 1 < count ? &off[order[i + 1]] : nullptr;
+  }
+
+  long sum_raw = 0, sum_off = 0;
+  double t_raw = Traverse(&raw[order[0]], rounds, sum_raw, [](RawNode *n) { return n->next; });
+  double t_off =
+      Traverse(&off[order[0]], rounds, sum_off, [](OffsetNode *n) { return n->next.get(); });
+  std::printf("%-28s %10.2f ns/node\n", "list traverse (raw ptr)", t_raw * 1e9 / count / rounds);
+  std::printf("%-28s %10.2f ns/node\n", "list traverse (offset ptr)", t_off * 1e9 / count / rounds);
+
+  /* 通过 shm_offset_ptr 顺序扫描 */
+  shmlite::shm_offset_ptr<OffsetNode> begin(off);
+  double start = shmlite::bench::NowSeconds();
+  for (long r = 0; r < rounds; ++r) {
+    for (long i = 0; i < count; ++i) {
+      sum_off += begin[i].value;
+    }
+  }
+  double t_scan_off = shmlite::bench::NowSeconds() - start;
+  start = shmlite::bench::NowSeconds();
+  for (long r = 0; r < rounds; ++r) {
+    for (long i = 0; i < count; ++i) {
+      sum_raw += off[i].value;
+    }
+  }
+  double t_scan_raw = shmlite::bench::NowSeconds() - start;
+  std::printf("%-28s %10.2f ns/elem\n", "array scan (raw ptr)", t_scan_raw * 1e9 / count / rounds);
+  std::printf("%-28s %10.2f ns/elem\n", "array scan (offset ptr)",
+              t_scan_off * 1e9 / count / rounds);
+  std::printf("checksum %ld %ld\n", sum_raw, sum_off);
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include <dirent.h>
+#include <sys/resource.h>
+#include <cstdio>
+#include <string>
+#include "bench_utils.h"
+#include "libshmlite/shm_pool.hpp"
+
+// 比较 ShmPool 每个变量一个共享内存对象的模式和聚合模式的启动耗时、RSS 和文件描述符数量
+// 用法：bench_shmpool [变量数量]
+
+/**
+ * @brief 统计当前进程打开的文件描述符数量
+ *
+ */
+static long CountFds() {
+  long n = 0;
+  DIR *dir = opendir("/proc/self/fd");
+  if (dir == nullptr) {
+    return -1;
+  }
+  while (readdir(dir) != nullptr) {
+    ++n;
+  }
+  closedir(dir);
+  return n - 2;
+}
+
+/**
+ * @brief 读取当前进程的常驻内存大小
+ *
+ * @return 常驻内存大小，单位（KiB）
+ */
+static long RssKb() {
+  long pages = 0, resident = 0;
+  FILE *fp = std::fopen("/proc/self/statm", "r");
+  if (fp == nullptr) {
+    return -1;
+  }
+  if (std::fscanf(fp, "%ld %ld", &pages, &resident) != 2) {
+    resident = -1;
+  }
+  std::fclose(fp);
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/**
+ * @brief 在子进程中获取所有变量并打印统计
+ *
+ */
+static void RunMode(const char *mode, long count, bool arena) {
+  shmlite::bench::RunProcesses(1, [&](int) {
+    long rss_before = RssKb();
+    double start = shmlite::bench::NowSeconds();
+    if (arena && !shmlite::ShmPool::UseArena("bench_pool_arena", 64 * count + (4 << 20), count)) {
+      _exit(1);
+    }
+    for (long i = 0; i < count; ++i) {
+      int *v = GET_INT_DEFAULT("bench_pool_" + std::to_string(i), 0);
+      if (v == nullptr) {
+        std::printf("%-12s failed at variable %ld (fds = %ld)\n", mode, i, CountFds());
+        std::fflush(stdout);
+        _exit(1);
+      }
+      ++*v;
+    }
+    double elapsed = shmlite::bench::NowSeconds() - start;
+    std::printf("%-12s %10.2f ms %10ld KiB %10ld fds\n", mode, elapsed * 1e3, RssKb() - rss_before,
+                CountFds());
+    std::fflush(stdout);
+    _exit(0);
+  });
+}
+
+int main(int argc, char **argv) {
+  const long count = shmlite::bench::ArgOr(argc, argv, 1, 20000);
+  /* 每个变量一个共享内存对象时需要大量的文件描述符 */
+  struct rlimit lim;
+  getrlimit(RLIMIT_NOFILE, &lim);
+  lim.rlim_cur = lim.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &lim);
+
+  std::printf("%-12s %13s %14s %14s\n", "mode", "startup", "rss", "open");
+  RunMode("per-variable", count, false);
+  RunMode("arena", count, true);
+
+  for (long i = 0; i < count; ++i) {
+    shmlite::ShmHandle::UnLink("bench_pool_" + std::to_string(i));
+  }
+  shmlite::ShmHandle::UnLink("bench_pool_arena");
+  shmlite::ShmHandle::UnLink("bench_pool_arena.dir");
+  return 0;
+}
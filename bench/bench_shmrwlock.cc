@@ -0,0 +1,76 @@
+#include <atomic>
+#include <cstdio>
+#include "bench_utils.h"
+#include "libshmlite/shm_handle.h"
+#include "libshmlite/shm_lock.h"
+#include "libshmlite/shm_rwlock.h"
+
+// 1 个写者和 N 个读者同时访问一块数据，对比 ShmRwLock（两种偏好）与 ShmLock 下读者和写者的吞吐量
+// 用法：bench_shmrwlock [每个读者的读取次数] [写者两次写入之间的间隔（微秒）]
+
+struct Shared {
+  shmlite::ShmRwLock rwlock;
+  long values[16];
+  std::atomic<int> readers_done;
+  std::atomic<long> writes;
+};
+
+int main(int argc, char **argv) {
+  const long loops = shmlite::bench::ArgOr(argc, argv, 1, 500000);
+  const long interval_us = shmlite::bench::ArgOr(argc, argv, 2, 100);
+  shmlite::ShmHandle shm("bench_shmrwlock", sizeof(Shared), shmlite::ShmHandle::CREAT_RDWR, true);
+  shmlite::ShmLock sem("bench_shmrwlock", 1, true);
+  if (!shm.IsValid() || !sem.IsValid()) {
+    return 1;
+  }
+  auto *shared = static_cast<Shared *>(shm.Ptr());
+
+  std::printf("%-8s %-14s %14s %10s\n", "readers", "lock", "Mreads/s", "writes");
+  for (int readers : {1, 2, 4, 8, 16}) {
+    for (int kind = 0; kind < 3; ++kind) {
+      const char *label = kind == 0 ? "rw/writer" : kind == 1 ? "rw/reader" : "ShmLock";
+      shared->rwlock.SetPreference(kind == 1 ? shmlite::SHM_RWLOCK_PREFER_READER
+                                             : shmlite::SHM_RWLOCK_PREFER_WRITER);
+      shared->readers_done = 0;
+      shared->writes = 0;
+      double t = shmlite::bench::RunProcesses(readers + 1, [&](int i) {
+        if (i == readers) {
+          /* 写者：直到所有读者完成 */
+          while (shared->readers_done.load() < readers) {
+            if (kind == 2) {
+              sem.Wait();
+            } else {
+              shared->rwlock.WriteLock();
+            }
+            for (long &v : shared->values) {
+              ++v;
+            }
+            if (kind == 2) {
+              sem.Post();
+            } else {
+              shared->rwlock.WriteUnlock();
+            }
+            shared->writes.fetch_add(1);
+            usleep(interval_us);
+          }
+          return;
+        }
+        long sum = 0;
+        for (long n = 0; n < loops; ++n) {
+          if (kind == 2) {
+            sem.Wait();
+            sum += shared->values[n & 15];
+            sem.Post();
+          } else {
+            shmlite::ShmReadGuard guard(shared->rwlock);
+            sum += shared->values[n & 15];
+          }
+        }
+        shared->readers_done.fetch_add(1 + (sum == -1));
+      });
+      std::printf("%-8d %-14s %14.2f %10ld\n", readers, label, readers * loops / t / 1e6,
+                  shared->writes.load());
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <cstdio>
+#include "bench_utils.h"
+#include "libshmlite/shm_lock.h"
+#include "libshmlite/shm_seq_var.hpp"
+
+// 对比 ShmSeqVar 与 ShmLock 保护的 128 字节快照在 1、4、16 个读者进程轮询下的读取开销，
+// 同时有一个写者进程不断更新
+// 用法：bench_shmseqvar [每个读者的读取次数]
+
+struct Snapshot {
+  long values[16];
+};
+
+int main(int argc, char **argv) {
+  const long loops = shmlite::bench::ArgOr(argc, argv, 1, 1000000);
+  shmlite::ShmHandle::UnLink("bench_seqvar");
+  shmlite::ShmSeqVar<Snapshot> var("bench_seqvar");
+  shmlite::ShmHandle shm("bench_seqvar_locked", sizeof(Snapshot) + sizeof(long),
+                         shmlite::ShmHandle::CREAT_RDWR, true);
+  shmlite::ShmLock lock("bench_seqvar", 1, true);
+  if (!var.IsValid() || !shm.IsValid() || !lock.IsValid()) {
+    return 1;
+  }
+  auto *locked = reinterpret_cast<Snapshot *>(shm.Ptr());
+  auto *stop = reinterpret_cast<volatile long *>(locked + 1);
+
+  std::printf("%-8s %-10s %12s\n", "readers", "sync", "ns/read");
+  for (int readers : {1, 4, 16}) {
+    *stop = 0;
+    double t_seq = shmlite::bench::RunProcesses(readers + 1, [&](int i) {
+      if (i == readers) {
+        for (long n = 0; *stop < readers; ++n) {
+          var.Update([n](Snapshot &s) { s.values[n & 15] = n; });
+          usleep(10);
+        }
+        return;
+      }
+      long sum = 0;
+      for (long n = 0; n < loops; ++n) {
+        sum += var.Load().values[n & 15];
+      }
+      __sync_fetch_and_add(stop, 1);
+      if (sum == -1) {
+        std::printf("unreachable\n");
+      }
+    });
+    *stop = 0;
+    double t_lock = shmlite::bench::RunProcesses(readers + 1, [&](int i) {
+      if (i == readers) {
+        for (long n = 0; *stop < readers; ++n) {
+          lock.Wait();
+          locked->values[n & 15] = n;
+          lock.Post();
+          usleep(10);
+        }
+        return;
+      }
+      long sum = 0;
+      for (long n = 0; n < loops; ++n) {
+        lock.Wait();
+        Snapshot s = *locked;
+        lock.Post();
+        sum += s.values[n & 15];
+      }
+      __sync_fetch_and_add(stop, 1);
+      if (sum == -1) {
+        std::printf("unreachable\n");
+      }
+    });
+    std::printf("%-8d %-10s %12.2f\n", readers, "seqlock", t_seq * 1e9 / loops);
+    std::printf("%-8d %-10s %12.2f\n", readers, "ShmLock", t_lock * 1e9 / loops);
+  }
+  shmlite::ShmHandle::UnLink("bench_seqvar");
+  return 0;
+}
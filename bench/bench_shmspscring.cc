@@ -0,0 +1,45 @@
+#include <cstdio>
+#include <vector>
+#include "bench_utils.h"
+#include "libshmlite/container/shm_spsc_ring.hpp"
+
+// 生产者和消费者位于两个进程，测量 ShmSpscRing 逐个和批量读写的吞吐量
+// 用法：bench_shmspscring [消息数量] [批量大小]
+
+struct Tick {
+  uint64_t seq;
+  double price;
+};
+
+int main(int argc, char **argv) {
+  const long count = shmlite::bench::ArgOr(argc, argv, 1, 100000000);
+  const long batch = shmlite::bench::ArgOr(argc, argv, 2, 64);
+  std::printf("%-10s %12s %12s\n", "batch", "Mmsgs/s", "ns/msg");
+  for (long n : {1L, batch}) {
+    /* 每一轮使用新的队列，子进程从 fork 时复制的对象开始，缓存的读写位置与共享的一致 */
+    shmlite::ShmHandle::UnLink("bench_spscring");
+    shmlite::ShmSpscRing<Tick> ring("bench_spscring", 1 << 16);
+    if (!ring.IsValid()) {
+      return 1;
+    }
+    double elapsed = shmlite::bench::RunProcesses(2, [&](int idx) {
+      std::vector<Tick> buf(n);
+      if (idx == 0) {
+        for (long sent = 0; sent < count;) {
+          size_t want = std::min<long>(n, count - sent);
+          for (size_t i = 0; i < want; ++i) {
+            buf[i].seq = sent + i;
+          }
+          sent += ring.TryPush(buf.data(), want);
+        }
+      } else {
+        for (long recv = 0; recv < count;) {
+          recv += ring.TryPop(buf.data(), n);
+        }
+      }
+    });
+    std::printf("%-10ld %12.2f %12.2f\n", n, count / elapsed / 1e6, elapsed * 1e9 / count);
+  }
+  shmlite::ShmHandle::UnLink("bench_spscring");
+  return 0;
+}
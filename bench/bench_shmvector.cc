@@ -0,0 +1,71 @@
+#include <cstdio>
+#include "bench_utils.h"
+#include "libshmlite/container/shm_array.hpp"
+#include "libshmlite/container/shm_vector.hpp"
+
+// 对比按需增长的 ShmVector 与按最坏情况预先分配的 ShmArray 的追加吞吐量和内存占用
+// 用法：bench_shmvector [追加的记录数] [预先分配的倍数]
+
+struct Record {
+  uint64_t ts;
+  uint64_t key;
+  double value;
+  uint64_t flags;
+};
+
+int main(int argc, char **argv) {
+  const long records = shmlite::bench::ArgOr(argc, argv, 1, 5000000);
+  const long worst_factor = shmlite::bench::ArgOr(argc, argv, 2, 4);
+  shmlite::ShmVector<Record>::UnLink("bench_vector");
+  shmlite::ShmHandle::UnLink("bench_vector_array");
+  std::printf("%-18s %14s %12s %10s\n", "mode", "Mrecords/s", "MiB", "remaps");
+
+  {
+    shmlite::ShmVector<Record> vec("bench_vector");
+    if (!vec.IsValid()) {
+      return 1;
+    }
+    double start = shmlite::bench::NowSeconds();
+    for (long i = 0; i < records; ++i) {
+      vec.PushBack(Record{static_cast<uint64_t>(i), static_cast<uint64_t>(i), 1.0, 0});
+    }
+    double elapsed = shmlite::bench::NowSeconds() - start;
+    std::printf("%-18s %14.2f %12.1f %10lu\n", "vector push", records / elapsed / 1e6,
+                vec.Capacity() * sizeof(Record) / 1048576.0, vec.Generation());
+  }
+  shmlite::ShmVector<Record>::UnLink("bench_vector");
+
+  {
+    shmlite::ShmVector<Record> vec("bench_vector");
+    const long batch = 256;
+    Record buf[batch];
+    double start = shmlite::bench::NowSeconds();
+    for (long i = 0; i < records; i += batch) {
+      for (long j = 0; j < batch; ++j) {
+        buf[j] = Record{static_cast<uint64_t>(i + j), static_cast<uint64_t>(i + j), 1.0, 0};
+      }
+      vec.Append(buf, batch);
+    }
+    double elapsed = shmlite::bench::NowSeconds() - start;
+    std::printf("%-18s %14.2f %12.1f %10lu\n", "vector append256", records / elapsed / 1e6,
+                vec.Capacity() * sizeof(Record) / 1048576.0, vec.Generation());
+  }
+  shmlite::ShmVector<Record>::UnLink("bench_vector");
+
+  {
+    /* 按最坏情况预先分配，只有写过的页才真正占用内存，但地址空间和 /dev/shm 配额按最坏情况计算 */
+    shmlite::ShmArray<Record> arr("bench_vector_array", records * worst_factor);
+    if (!arr.IsValid()) {
+      return 1;
+    }
+    double start = shmlite::bench::NowSeconds();
+    for (long i = 0; i < records; ++i) {
+      arr[i] = Record{static_cast<uint64_t>(i), static_cast<uint64_t>(i), 1.0, 0};
+    }
+    double elapsed = shmlite::bench::NowSeconds() - start;
+    std::printf("%-18s %14.2f %12.1f %10d\n", "array presized", records / elapsed / 1e6,
+                arr.Size() * sizeof(Record) / 1048576.0, 0);
+  }
+  shmlite::ShmHandle::UnLink("bench_vector_array");
+  return 0;
+}
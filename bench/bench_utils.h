@@ -0,0 +1,83 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+namespace shmlite {
+namespace bench {
+
+/**
+ * @brief 获取单调时钟的当前时间
+ *
+ * @return 当前时间，单位（秒）
+ */
+inline double NowSeconds() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * @brief 从命令行参数中读取一个整数，没有提供时使用默认值
+ *
+ * @param argc 参数个数
+ * @param argv 参数列表
+ * @param idx 参数位置
+ * @param default_value 默认值
+ * @return 参数值
+ */
+inline long ArgOr(int argc, char **argv, int idx, long default_value) {
+  return argc > idx ? std::strtol(argv[idx], nullptr, 10) : default_value;
+}
+
+/**
+ * @brief fork 出 n 个子进程同时执行 fn(i)，所有子进程就绪后才开始计时
+ *
+ * @param n 子进程数量
+ * @param fn 子进程执行的函数，参数为子进程的序号
+ * @return 从放行到所有子进程退出的耗时，单位（秒）；出错时返回负数
+ */
+inline double RunProcesses(int n, const std::function<void(int)> &fn) {
+  /* 匿名共享映射在 fork 之后仍然共享，用作启动屏障 */
+  void *mem = mmap(nullptr, sizeof(std::atomic<int>) * 2, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    return -1;
+  }
+  auto *ready = new (mem) std::atomic<int>(0);
+  auto *go = new (ready + 1) std::atomic<int>(0);
+  std::fflush(stdout); /* 避免缓冲区中的内容被子进程重复输出 */
+  for (int i = 0; i < n; ++i) {
+    pid_t pid = fork();
+    if (pid == -1) {
+      std::perror("fork");
+      return -1;
+    }
+    if (pid == 0) {
+      ready->fetch_add(1);
+      while (go->load(std::memory_order_acquire) == 0) {
+      }
+      fn(i);
+      _exit(0);
+    }
+  }
+  while (ready->load() != n) {
+    usleep(100);
+  }
+  double start = NowSeconds();
+  go->store(1, std::memory_order_release);
+  for (int i = 0; i < n; ++i) {
+    wait(nullptr);
+  }
+  double elapsed = NowSeconds() - start;
+  munmap(mem, sizeof(std::atomic<int>) * 2);
+  return elapsed;
+}
+
+}  // namespace bench
+}  // namespace shmlite
@@ -50,6 +50,8 @@
 
 namespace shmlite {
 
+constexpr size_t kCacheLineSize = 64; /**< CPU缓存行的大小，用于避免伪共享 */
+
 /**
  * @brief 公共类，带有名字属性的类的父类
  *
@@ -102,5 +104,19 @@ std::string ConcatStringLimited(const std::string& prefix, const std::string& su
  */
 std::string ConcatStringLimited(const char* prefix, const std::string& suffix, size_t max_len);
 
+/**
+ * @brief 向上取整到2的幂次
+ *
+ * @param n 需要取整的数
+ * @return 不小于n的最小的2的幂次，n为0时返回1
+ */
+inline size_t RoundUpPowerOfTwo(size_t n) {
+  size_t res = 1;
+  while (res < n) {
+    res <<= 1;
+  }
+  return res;
+}
+
 
 } // namespace shmlite
\ No newline at end of file
@@ -1,15 +1,19 @@
 #pragma once
 
+#include <algorithm>
 #include <cstring>
+#include <functional>
 #include <memory>
+#include <stdexcept>
 #include <type_traits>
 
 #include "../shm_handle.h"
+#include "../shm_segment.h"
+#include "../simd_utils.h"
+#include "shm_span.hpp"
 
 namespace shmlite {
 
-constexpr size_t kSizeLen = sizeof(size_t);
-
 /**
 template<typename T>
 void FillArray(T* first, const T& value, size_t n) {
@@ -26,17 +30,17 @@ void FillArray<char>(char* first, const char& value, size_t n) {
  */
 
 /**
- * @brief 以特定内容填充整个char数组，底层使用memset。
+ * @brief 以特定内容填充整个数组，可以平凡拷贝的类型使用向量化的 SimdFill
  *
+ * @tparam T 数组的参数类型
  * @param first 开始填充的首地址
  * @param value 填充的内容
  * @param n 数量
  */
 template <typename T>
 auto FillArray(T *first, const T &value, size_t n) ->
-    typename std::enable_if<std::is_same<T, char>::value, char *>::type {
-  const char tmp = value;
-  memset(first, tmp, n);
+    typename std::enable_if<std::is_trivially_copyable<T>::value, T *>::type {
+  SimdFill(first, &value, sizeof(T), n);
   return first + n;
 }
 
@@ -50,20 +54,134 @@ auto FillArray(T *first, const T &value, size_t n) ->
  */
 template <typename T>
 auto FillArray(T *first, const T &value, size_t n) ->
-    typename std::enable_if<!std::is_same<T, char>::value, T *>::type {
+    typename std::enable_if<!std::is_trivially_copyable<T>::value, T *>::type {
   for (size_t pos = 0; pos < n; ++pos) {
     *(first + pos) = value;
   }
   return first + n;
 }
 
+/**
+ * @brief 判断类型是否可以按字节比较相等，可以的话查找和计数使用向量化的实现
+ *
+ * 浮点数的 == 与按字节比较不同（NaN、+0/-0），不在此列。
+ */
+template <typename T>
+struct IsBitwiseComparable
+    : std::integral_constant<bool, (std::is_integral<T>::value || std::is_enum<T>::value ||
+                                    std::is_pointer<T>::value) &&
+                                       (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 ||
+                                        sizeof(T) == 8)> {};
+
+/**
+ * @brief 查找第一个等于 value 的元素
+ *
+ * @return size_t 元素的下标，找不到时返回 n
+ */
+template <typename T>
+auto FindArray(const T *first, size_t n, const T &value) ->
+    typename std::enable_if<IsBitwiseComparable<T>::value, size_t>::type {
+  return SimdFind(first, n, &value, sizeof(T));
+}
+
+template <typename T>
+auto FindArray(const T *first, size_t n, const T &value) ->
+    typename std::enable_if<!IsBitwiseComparable<T>::value, size_t>::type {
+  return std::find(first, first + n, value) - first;
+}
+
+/**
+ * @brief 统计等于 value 的元素个数
+ *
+ */
+template <typename T>
+auto CountArray(const T *first, size_t n, const T &value) ->
+    typename std::enable_if<IsBitwiseComparable<T>::value, size_t>::type {
+  return SimdCount(first, n, &value, sizeof(T));
+}
+
+template <typename T>
+auto CountArray(const T *first, size_t n, const T &value) ->
+    typename std::enable_if<!IsBitwiseComparable<T>::value, size_t>::type {
+  return std::count(first, first + n, value);
+}
+
+/**
+ * @brief 求和结果的类型：整数使用 64 位累加，浮点数至少使用 double 累加
+ *
+ */
+template <typename T, bool = std::is_floating_point<T>::value>
+struct ShmSumTraits {
+  using type = typename std::conditional<std::is_signed<T>::value, int64_t, uint64_t>::type;
+};
+
+template <typename T>
+struct ShmSumTraits<T, true> {
+  using type = typename std::common_type<T, double>::type;
+};
+
+template <typename T>
+using ShmSumType = typename ShmSumTraits<T>::type;
+
+/**
+ * @name 归约，int32_t、int64_t、float、double 使用向量化的实现，其它算术类型逐个计算
+ * @{
+ */
+template <typename T>
+ShmSumType<T> SumArray(const T *first, size_t n) {
+  ShmSumType<T> sum = 0;
+  for (size_t pos = 0; pos < n; ++pos) {
+    sum += first[pos];
+  }
+  return sum;
+}
+
+template <typename T>
+T MinArray(const T *first, size_t n) {
+  return *std::min_element(first, first + n);
+}
+
+template <typename T>
+T MaxArray(const T *first, size_t n) {
+  return *std::max_element(first, first + n);
+}
+
+inline int64_t SumArray(const int32_t *first, size_t n) { return SimdSum(first, n); }
+inline int64_t SumArray(const int64_t *first, size_t n) { return SimdSum(first, n); }
+inline double SumArray(const float *first, size_t n) { return SimdSum(first, n); }
+inline double SumArray(const double *first, size_t n) { return SimdSum(first, n); }
+inline int32_t MinArray(const int32_t *first, size_t n) { return SimdMin(first, n); }
+inline int64_t MinArray(const int64_t *first, size_t n) { return SimdMin(first, n); }
+inline float MinArray(const float *first, size_t n) { return SimdMin(first, n); }
+inline double MinArray(const double *first, size_t n) { return SimdMin(first, n); }
+inline int32_t MaxArray(const int32_t *first, size_t n) { return SimdMax(first, n); }
+inline int64_t MaxArray(const int64_t *first, size_t n) { return SimdMax(first, n); }
+inline float MaxArray(const float *first, size_t n) { return SimdMax(first, n); }
+inline double MaxArray(const double *first, size_t n) { return SimdMax(first, n); }
+/** @} */
+
+/**
+ * @brief 抛出越界异常，放在冷路径上，避免检查的代码内联进调用者的循环
+ *
+ * @param pos 开始的索引
+ * @param n 元素个数，为 0 时表示单个元素的索引越界
+ * @param size 数组的大小
+ */
+[[noreturn]] __attribute__((noinline, cold)) inline void ThrowShmArrayOutOfRange(size_t pos,
+                                                                                   size_t n,
+                                                                                   size_t size) {
+  std::string msg = n == 0 ? "index " + std::to_string(pos)
+                           : "range [" + std::to_string(pos) + ", " + std::to_string(pos + n) + ")";
+  throw std::out_of_range(msg + " is out of range (size = " + std::to_string(size) + ")");
+}
+
 /**
  * @brief 检测 ShmArray 是否有效
  *
  */
 #define SHMARRAY_CHECK_VALID()                                            \
   do {                                                                    \
-    if (!handle_->IsValid()) {                                            \
+    if (data_ == nullptr) {                                               \
       std::string msg = "ShmArray '" + handle_->GetName() + "' invalid."; \
       throw std::runtime_error(msg);                                      \
     }                                                                     \
@@ -74,70 +192,97 @@ auto FillArray(T *first, const T &value, size_t n) ->
  *
  * @param pos 索引
  */
-#define SHMARRAY_CHECK_POS(pos)                                                        \
-  do {                                                                                 \
-    if (pos >= size_) {                                                                \
-      std::string msg = "index " + std::to_string(pos) + " is out of range (size = " + \
-                        std::to_string(size_) + ")";                                   \
-      throw std::out_of_range(msg);                                                    \
-    }                                                                                  \
-    SHMARRAY_CHECK_VALID();                                                            \
+#define SHMARRAY_CHECK_POS(pos)               \
+  do {                                        \
+    if (pos >= size_) {                       \
+      ThrowShmArrayOutOfRange(pos, 0, size_); \
+    }                                         \
+    SHMARRAY_CHECK_VALID();                   \
   } while (0)
 
-#define SHMARRAY_CAST_PTR(Type) \
-  reinterpret_cast<Type *>(reinterpret_cast<uintptr_t>(handle_->Ptr()) + sizeof(size_t))
+/**
+ * @brief 检查从 pos 开始的 n 个元素是否越界
+ *
+ * @param pos 开始的索引
+ * @param n 元素个数
+ */
+#define SHMARRAY_CHECK_RANGE(pos, n)          \
+  do {                                        \
+    if (pos > size_ || n > size_ - pos) {     \
+      ThrowShmArrayOutOfRange(pos, n, size_); \
+    }                                         \
+    SHMARRAY_CHECK_VALID();                   \
+  } while (0)
 
 /**
  * @brief 共享内存数组
  *
+ * operator[] 和 At 会检查越界；begin()/end()、Data()、View() 和 UncheckedAt 不做任何检查，
+ * 访问的就是裸指针，适合热点上的扫描循环。
+ *
  * @tparam T 数组存放的数据类型
  */
 template <typename T>
 class ShmArray {
  public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using iterator = T *;
+  using const_iterator = const T *;
+
   /**
    * @brief 构造一个 ShmArray 对象
    *
    * @param name 数组对象名字
    * @param size 数组大小
    */
-  ShmArray(const std::string &name, size_t size) : size_(size) {
-    size_t alloc_size = kSizeLen + sizeof(T) * size;
-    handle_ = std::make_shared<ShmHandle>(name, alloc_size, ShmHandle::CREAT_RDWR);
-#ifdef DEV_DEBUG
-    SIMPLE_DEBUG("ShmArray [" << name << "] alloc_size = " << alloc_size << ", size = " << size);
-#endif
-    /* 多分配了sizeof(size_t)的空间来存放该定长数组的大小 */
-    if (handle_->IsValid()) {
-      size_t *ptr = reinterpret_cast<size_t *>(handle_->Ptr());
-      *ptr = size;
-    } else {
-      SIMPLE_ERROR("Can not allocate shm array of desired size " << size);
-      size_ = 0;
-    }
+  ShmArray(const std::string &name, size_t size) : ShmArray(name, size, ShmHandleOptions()) {}
+
+  /**
+   * @brief 以指定的共享内存选项构造一个 ShmArray 对象，例如使用大页
+   *
+   * @param name 数组对象名字
+   * @param size 数组大小
+   * @param options 底层共享内存的选项，参考 @ref ShmHandleOptions "ShmHandleOptions"
+   */
+  ShmArray(const std::string &name, size_t size, const ShmHandleOptions &options) : size_(size) {
+    Open(name, options, nullptr);
   }
 
   /**
-   * @brief 构造 ShmArray 对象，并使用默认值填充数组
+   * @brief 构造 ShmArray 对象，数组由本对象创建时使用默认值填充
+   *
+   * 已经存在的数组不会被重新填充；多个进程同时构造时只有一个进程填充，其它进程等待填充完成。
    *
-   * @param name
-   * @param size
-   * @param value
+   * @param name 数组对象名字
+   * @param size 数组大小
+   * @param value 填充的默认值
    */
   ShmArray(const std::string &name, size_t size, const T &value) : size_(size) {
-    size_t alloc_size = kSizeLen + sizeof(T) * size;
-    handle_ = std::make_shared<ShmHandle>(name, alloc_size, ShmHandle::CREAT_RDWR);
-#ifdef DEV_DEBUG
-    SIMPLE_DEBUG("ShmArray [" << name << "] alloc_size = " << alloc_size << ", size = " << size);
-#endif
-    if (handle_->IsValid()) {
-      size_t *ptr = reinterpret_cast<size_t *>(handle_->Ptr());
-      *ptr = size;
-      Fill(value);
-    } else {
-      SIMPLE_ERROR("Can not allocate shm array of desired size " << size);
-      size_ = 0;
-    }
+    Open(name, ShmHandleOptions(),
+         [&value](T *first, size_t n) { FillArray<T>(first, value, n); });
+  }
+
+  /**
+   * @brief 构造 ShmArray 对象，数组由本对象创建时调用 init 初始化
+   *
+   * init 在所有进程中只会执行一次，执行完成之前其它进程的构造函数会阻塞等待，
+   * 因此构造完成之后数组总是已经初始化好的。
+   *
+   * @param name 数组对象名字
+   * @param size 数组大小
+   * @param init 初始化函数，参数为首地址和元素个数，不能抛出异常
+   * @param options 底层共享内存的选项，参考 @ref ShmHandleOptions "ShmHandleOptions"
+   */
+  ShmArray(const std::string &name, size_t size, const std::function<void(T *, size_t)> &init,
+           const ShmHandleOptions &options = ShmHandleOptions())
+      : size_(size) {
+    Open(name, options, init);
   }
 
   ShmArray(const ShmArray &other) = delete;
@@ -154,8 +299,7 @@ class ShmArray {
    */
   T &operator[](size_t pos) {
     SHMARRAY_CHECK_POS(pos);
-    T *start = SHMARRAY_CAST_PTR(T);
-    return *(start + pos);
+    return data_[pos];
   }
 
   /**
@@ -166,8 +310,7 @@ class ShmArray {
    */
   const T &operator[](size_t pos) const {
     SHMARRAY_CHECK_POS(pos);
-    const T *start = SHMARRAY_CAST_PTR(const T);
-    return *(start + pos);
+    return data_[pos];
   }
 
   /**
@@ -186,6 +329,57 @@ class ShmArray {
    */
   const T &At(size_t pos) const { return this->operator[](pos); }
 
+  /**
+   * @brief 按照数组索引访问元素，不检查越界和有效性
+   *
+   * @param pos 索引位置，必须小于 Size()
+   * @return T& 数组中的元素
+   */
+  T &UncheckedAt(size_t pos) { return data_[pos]; }
+
+  /**
+   * @brief 按照数组索引访问元素，不检查越界和有效性
+   *
+   * @param pos 索引位置，必须小于 Size()
+   * @return const T& 数组中的元素
+   */
+  const T &UncheckedAt(size_t pos) const { return data_[pos]; }
+
+  /**
+   * @brief 获取数组的首地址，数组无效时为 nullptr
+   *
+   * @return T* 首地址
+   */
+  T *Data() { return data_; }
+
+  /**
+   * @brief 获取数组的首地址，数组无效时为 nullptr
+   *
+   * @return const T* 首地址
+   */
+  const T *Data() const { return data_; }
+
+  /**
+   * @brief 获取整个数组的视图
+   *
+   * @return ShmSpan<T> 视图
+   */
+  ShmSpan<T> View() { return ShmSpan<T>(data_, size_); }
+
+  /**
+   * @brief 获取整个数组的只读视图
+   *
+   * @return ShmSpan<const T> 视图
+   */
+  ShmSpan<const T> View() const { return ShmSpan<const T>(data_, size_); }
+
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+  const_iterator cbegin() const { return data_; }
+  const_iterator cend() const { return data_ + size_; }
+
   /**
    * @brief 以特定的内容填充整个数组空间
    *
@@ -193,9 +387,92 @@ class ShmArray {
    */
   void Fill(const T &value) {
     SHMARRAY_CHECK_VALID();
-    /* 计算出数组开始的首地址，并且将指针类型转换为对应的类型　*/
-    T *start = SHMARRAY_CAST_PTR(T);
-    FillArray<T>(start, value, size_);
+    FillArray<T>(data_, value, size_);
+  }
+
+  /**
+   * @brief 从 src 拷贝 n 个元素到数组中从 pos 开始的位置
+   *
+   * @param src 源地址
+   * @param n 元素个数
+   * @param pos 数组中开始的位置
+   */
+  void CopyFrom(const T *src, size_t n, size_t pos = 0) {
+    static_assert(std::is_trivially_copyable<T>::value, "CopyFrom requires trivially copyable T");
+    SHMARRAY_CHECK_RANGE(pos, n);
+    memcpy(data_ + pos, src, n * sizeof(T));
+  }
+
+  /**
+   * @brief 把数组中从 pos 开始的 n 个元素拷贝到 dst
+   *
+   * @param dst 目的地址
+   * @param n 元素个数
+   * @param pos 数组中开始的位置
+   */
+  void CopyTo(T *dst, size_t n, size_t pos = 0) const {
+    static_assert(std::is_trivially_copyable<T>::value, "CopyTo requires trivially copyable T");
+    SHMARRAY_CHECK_RANGE(pos, n);
+    memcpy(dst, data_ + pos, n * sizeof(T));
+  }
+
+  /**
+   * @brief 从 pos 开始查找第一个等于 value 的元素
+   *
+   * @param value 查找的元素
+   * @param pos 开始查找的位置
+   * @return size_t 元素的下标，找不到时返回 Size()
+   */
+  size_t Find(const T &value, size_t pos = 0) const {
+    SHMARRAY_CHECK_VALID();
+    if (pos >= size_) {
+      return size_;
+    }
+    return pos + FindArray<T>(data_ + pos, size_ - pos, value);
+  }
+
+  /**
+   * @brief 统计等于 value 的元素个数
+   *
+   * @param value 统计的元素
+   * @return size_t 元素个数
+   */
+  size_t Count(const T &value) const {
+    SHMARRAY_CHECK_VALID();
+    return CountArray<T>(data_, size_, value);
+  }
+
+  /**
+   * @brief 求所有元素的和，参考 @ref ShmSumType "ShmSumType"
+   *
+   * @return ShmSumType<T> 所有元素的和
+   */
+  ShmSumType<T> Sum() const {
+    static_assert(std::is_arithmetic<T>::value, "Sum requires arithmetic T");
+    SHMARRAY_CHECK_VALID();
+    return SumArray(data_, size_);
+  }
+
+  /**
+   * @brief 求所有元素中的最小值，数组为空时抛出 std::out_of_range
+   *
+   * @return T 最小值
+   */
+  T Min() const {
+    static_assert(std::is_arithmetic<T>::value, "Min requires arithmetic T");
+    SHMARRAY_CHECK_POS(0);
+    return MinArray(data_, size_);
+  }
+
+  /**
+   * @brief 求所有元素中的最大值，数组为空时抛出 std::out_of_range
+   *
+   * @return T 最大值
+   */
+  T Max() const {
+    static_assert(std::is_arithmetic<T>::value, "Max requires arithmetic T");
+    SHMARRAY_CHECK_POS(0);
+    return MaxArray(data_, size_);
   }
 
   /**
@@ -211,11 +488,85 @@ class ShmArray {
    * @return true 有效
    * @return false 无效
    */
-  bool IsValid() const { return handle_->IsValid(); }
+  bool IsValid() const { return data_ != nullptr; }
+
+  /**
+   * @brief 数组是否由本对象创建并初始化
+   *
+   * @return true 由本对象创建
+   * @return false 打开的是已经存在的数组
+   */
+  bool IsCreator() const { return created_; }
+
+  /**
+   * @brief 数组映射在文件上（SHM_BACKING_FILE）时，把修改过的元素写回文件
+   *
+   * @param wait 为 true 时等待数据落盘，否则只发起回写
+   * @return true 成功，不是文件映射时什么都不做
+   * @return false 失败
+   */
+  bool Flush(bool wait = true) { return IsValid() && handle_->Flush(wait); }
+
+  /**
+   * @brief 只把从 pos 开始的 n 个元素写回文件，参考 Flush
+   *
+   * @param pos 开始的位置
+   * @param n 元素个数，超出数组的部分会被截掉
+   * @param wait 为 true 时等待数据落盘，否则只发起回写
+   * @return true 成功
+   * @return false 失败
+   */
+  bool FlushRange(size_t pos, size_t n, bool wait = true) {
+    if (!IsValid() || pos >= size_) {
+      return IsValid();
+    }
+    n = std::min(n, size_ - pos);
+    return handle_->FlushRange(sizeof(ShmSegmentHeader) + pos * sizeof(T), n * sizeof(T), wait);
+  }
 
  private:
+  /**
+   * @brief 打开底层的共享内存并校验段头部，只在构造时执行一次，之后的访问不再检查
+   *
+   * @param name 数组对象名字
+   * @param options 底层共享内存的选项
+   * @param init 数组由本对象创建时的初始化函数，可以为空
+   * @return true 成功
+   * @return false 分配失败，或者已经存在的数组与 T、size_ 不一致
+   */
+  bool Open(const std::string &name, const ShmHandleOptions &options,
+            const std::function<void(T *, size_t)> &init) {
+    size_t alloc_size = SegmentAllocSize<T>(size_);
+    handle_ = std::make_shared<ShmHandle>(name, alloc_size, ShmHandle::CREAT_RDWR, options);
+#ifdef DEV_DEBUG
+    SIMPLE_DEBUG("ShmArray [" << name << "] alloc_size = " << alloc_size << ", size = " << size_);
+#endif
+    if (!handle_->IsValid()) {
+      SIMPLE_ERROR("Can not allocate shm array of desired size " << size_);
+      size_ = 0;
+      return false;
+    }
+    /* 段的开头是公共头部，记录了元素类型和个数 */
+    ShmSegmentHeader *header = static_cast<ShmSegmentHeader *>(handle_->Ptr());
+    ShmSegmentInitializer segment_init;
+    if (init) {
+      size_t n = size_;
+      segment_init = [&init, n](void *data) { init(static_cast<T *>(data), n); };
+    }
+    ShmSegmentStatus status = AttachSegment(header, MakeSegmentLayout<T>(size_), name, segment_init);
+    if (!IsSegmentUsable(status)) {
+      size_ = 0;
+      return false;
+    }
+    created_ = status == SHM_SEGMENT_CREATED;
+    data_ = SegmentData<T>(header);
+    return true;
+  }
+
   size_t size_;                       /**< 数组的大小 */
   std::shared_ptr<ShmHandle> handle_; /**< 底层的 ShmHandle 对象指针 */
+  T *data_ = nullptr;                 /**< 数组的首地址，位于段头部之后 */
+  bool created_ = false;              /**< 数组是否由本对象创建并初始化 */
 };
 
 }  // namespace shmlite
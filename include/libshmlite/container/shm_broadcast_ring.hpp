@@ -0,0 +1,337 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+#include "../shm_handle.h"
+#include "../shm_segment.h"
+
+namespace shmlite {
+
+/**
+ * @brief ShmBroadcastRing 位于段头部之后的控制信息
+ *
+ * 所有位置都是单调递增的字节位置，只由写者修改。全零即为空队列的状态。
+ * 数据区的大小记录在段头部的元素个数中。
+ */
+struct BroadcastRingHeader {
+  /**
+   * @brief 写者可能正在覆盖的区域的末尾，写者在修改数据之前先推进它。
+   * 字节位置 pos 的数据在 write_begin > pos + capacity 时已经被覆盖
+   */
+  alignas(kCacheLineSize) std::atomic<uint64_t> write_begin;
+  std::atomic<uint64_t> write_end; /**< 已经发布的数据的末尾，读者可以读到这里 */
+  std::atomic<uint64_t> next_seq;  /**< 下一条消息的序号 */
+};
+
+/**
+ * @brief ShmBroadcastRing 中每条消息之前的记录头
+ *
+ */
+struct BroadcastRecord {
+  uint64_t seq;  /**< 消息的序号 */
+  uint32_t size; /**< 消息的长度，kPaddingSize 表示跳到数据区开头 */
+  uint32_t reserved;
+};
+
+/**
+ * @brief 读者读到的一条消息，data 直接指向共享内存中的数据，没有拷贝
+ *
+ */
+struct ShmBroadcastMessage {
+  const void *data; /**< 消息内容 */
+  uint32_t size;    /**< 消息长度，单位（字节） */
+  uint64_t seq;     /**< 消息的序号 */
+  uint64_t pos;     /**< 消息在队列中的位置，用于 Validate */
+};
+
+/**
+ * @brief 共享内存中的单写者多读者广播环形队列
+ *
+ * 写者发布变长消息，永远不会因为读者而阻塞，写满之后直接覆盖最旧的消息。
+ * 每个读者（@ref ShmBroadcastReader "ShmBroadcastReader"）在自己的进程内保存读位置，
+ * 以各自的速度读取，互相之间没有影响，也不写任何共享内存。
+ *
+ * 读者拿到的消息直接指向共享内存，使用完之后需要调用 Validate 确认消息在使用期间没有被写者覆盖；
+ * 读者落后超过一圈时会被检测到，并且通过消息的序号得知丢失了多少条消息。
+ *
+ * 同一时刻只能有一个进程调用 Publish。
+ */
+class ShmBroadcastRing {
+ public:
+  static constexpr uint32_t kPaddingSize = 0xffffffffu; /**< 填充记录的长度标记 */
+  static constexpr size_t kAlign = sizeof(BroadcastRecord); /**< 记录的对齐大小 */
+
+  /**
+   * @brief 构造一个 ShmBroadcastRing 对象
+   *
+   * @param name 队列对象名字
+   * @param capacity 数据区的大小，单位（字节），会向上取整到2的幂次，
+   * 打开已经存在的队列时必须与创建时一致
+   */
+  ShmBroadcastRing(const std::string &name, size_t capacity)
+      : capacity_(RoundUpPowerOfTwo(std::max<size_t>(capacity, 4 * kAlign))),
+        mask_(capacity_ - 1) {
+    size_t alloc_size = sizeof(ShmSegmentHeader) + sizeof(BroadcastRingHeader) + capacity_;
+    handle_ = std::make_shared<ShmHandle>(name, alloc_size, ShmHandle::CREAT_RDWR);
+#ifdef DEV_DEBUG
+    SIMPLE_DEBUG("ShmBroadcastRing [" << name << "] alloc_size = " << alloc_size
+                                      << ", capacity = " << capacity_);
+#endif
+    if (!handle_->IsValid()) {
+      SIMPLE_ERROR("Can not allocate shm broadcast ring of desired capacity " << capacity_);
+      capacity_ = 0;
+      return;
+    }
+    /* 数据区的大小决定了消息的位置，只在创建时写入段头部，之后打开时校验 */
+    ShmSegmentHeader *segment = static_cast<ShmSegmentHeader *>(handle_->Ptr());
+    ShmSegmentLayout layout{ShmTypeHash<ShmBroadcastRing>(), 1, capacity_};
+    if (!IsSegmentUsable(AttachSegment(segment, layout, name))) {
+      capacity_ = 0;
+      return;
+    }
+    header_ = SegmentData<BroadcastRingHeader>(segment);
+    data_ = reinterpret_cast<char *>(header_ + 1);
+  }
+
+  LIBSHMLITE_NO_COPYABLE(ShmBroadcastRing)
+
+  /**
+   * @brief 发布一条消息，只能由写者调用，不会阻塞
+   *
+   * @param data 消息内容
+   * @param size 消息长度，不能超过 MaxMessageSize()
+   * @return true 发布成功
+   * @return false 消息太长
+   */
+  bool Publish(const void *data, size_t size) {
+    void *buf = Claim(size);
+    if (buf == nullptr) {
+      return false;
+    }
+    memcpy(buf, data, size);
+    Commit();
+    return true;
+  }
+
+  /**
+   * @brief 在队列中预留一条消息的空间，写者直接在共享内存中填写内容，之后调用 Commit 发布
+   *
+   * 调用 Commit 之前不能再次调用 Claim 或 Publish。
+   *
+   * @param size 消息长度，不能超过 MaxMessageSize()
+   * @return void* 消息内容的地址，消息太长时返回 nullptr
+   */
+  void *Claim(size_t size) {
+    if (size > MaxMessageSize()) {
+      return nullptr;
+    }
+    uint64_t pos = header_->write_end.load(std::memory_order_relaxed);
+    size_t len = RecordLen(size);
+    size_t remaining = capacity_ - (pos & mask_);
+    size_t padding = remaining < len ? remaining : 0;
+    /* 先宣告将要覆盖的区域，再修改数据 */
+    header_->write_begin.store(pos + padding + len, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    if (padding != 0) {
+      BroadcastRecord *pad = RecordAt(pos);
+      pad->seq = 0;
+      pad->size = kPaddingSize;
+      pos += padding;
+    }
+    BroadcastRecord *rec = RecordAt(pos);
+    rec->seq = header_->next_seq.load(std::memory_order_relaxed);
+    rec->size = static_cast<uint32_t>(size);
+    claimed_end_ = pos + len;
+    return rec + 1;
+  }
+
+  /**
+   * @brief 发布 Claim 预留的消息
+   *
+   */
+  void Commit() {
+    header_->write_end.store(claimed_end_, std::memory_order_release);
+    /* 在 write_end 之后更新，读到 Published() 的进程一定也能读到这些消息 */
+    header_->next_seq.store(header_->next_seq.load(std::memory_order_relaxed) + 1,
+                            std::memory_order_release);
+  }
+
+  /**
+   * @brief 获取单条消息的最大长度，为数据区大小的四分之一
+   *
+   * @return size_t 最大长度，单位（字节）
+   */
+  size_t MaxMessageSize() const { return capacity_ / 4 - kAlign; }
+
+  /**
+   * @brief 获取已经发布的消息数量
+   *
+   * @return uint64_t 消息数量
+   */
+  uint64_t Published() const { return header_->next_seq.load(std::memory_order_acquire); }
+
+  /**
+   * @brief 获取数据区的大小
+   *
+   * @return size_t 数据区的大小，单位（字节）
+   */
+  size_t Capacity() const { return capacity_; }
+
+  /**
+   * @brief 检测队列是否有效
+   *
+   * @return true 有效
+   * @return false 无效，或者与已经存在的队列的数据区大小不一致
+   */
+  bool IsValid() const { return header_ != nullptr; }
+
+ private:
+  friend class ShmBroadcastReader;
+
+  static size_t RecordLen(size_t size) {
+    return sizeof(BroadcastRecord) + (size + kAlign - 1) / kAlign * kAlign;
+  }
+
+  BroadcastRecord *RecordAt(uint64_t pos) const {
+    return reinterpret_cast<BroadcastRecord *>(data_ + (pos & mask_));
+  }
+
+  size_t capacity_;                    /**< 数据区的大小 */
+  size_t mask_;                        /**< capacity_ - 1 */
+  std::shared_ptr<ShmHandle> handle_;  /**< 底层的 ShmHandle 对象指针 */
+  BroadcastRingHeader *header_ = nullptr; /**< 段头部之后的控制信息 */
+  char *data_ = nullptr;               /**< 数据区 */
+  uint64_t claimed_end_ = 0;           /**< Claim 预留的消息的末尾 */
+};
+
+/**
+ * @brief ShmBroadcastRing 的读者，读位置保存在进程内
+ *
+ */
+class ShmBroadcastReader {
+ public:
+  /**
+   * @brief 读取结果
+   *
+   */
+  enum ReadStatus {
+    OK = 0, /**< 读到一条消息 */
+    EMPTY,  /**< 没有新的消息 */
+    LAPPED, /**< 落后超过一圈，已经跳到最新的位置，跳过的消息在之后的 Poll 中计入 Lost() */
+  };
+
+  /**
+   * @brief 构造一个读者，从下一条发布的消息开始读取
+   *
+   * @param ring 读取的队列，生命周期必须长于读者
+   */
+  explicit ShmBroadcastReader(const ShmBroadcastRing &ring) : ring_(ring) { SkipToLatest(); }
+
+  /**
+   * @brief 读取下一条消息，不会阻塞
+   *
+   * @param msg 读到的消息，直接指向共享内存，使用完之后需要 Validate
+   * @return ReadStatus 读取结果
+   */
+  ReadStatus Poll(ShmBroadcastMessage &msg) {
+    const BroadcastRingHeader *header = ring_.header_;
+    for (;;) {
+      if (cursor_ == header->write_end.load(std::memory_order_acquire)) {
+        if (lapped_) {
+          CountSkipped();
+        }
+        return EMPTY;
+      }
+      const BroadcastRecord *rec = ring_.RecordAt(cursor_);
+      BroadcastRecord copy;
+      memcpy(&copy, rec, sizeof(copy));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (Overwritten(cursor_)) {
+        /* 跳过的消息在下一次读到消息时通过序号的差值计入丢失 */
+        cursor_ = header->write_end.load(std::memory_order_acquire);
+        lapped_ = synced_;
+        return LAPPED;
+      }
+      if (copy.size == ShmBroadcastRing::kPaddingSize) {
+        cursor_ += ring_.capacity_ - (cursor_ & ring_.mask_);
+        continue;
+      }
+      msg.data = rec + 1;
+      msg.size = copy.size;
+      msg.seq = copy.seq;
+      msg.pos = cursor_;
+      cursor_ += ShmBroadcastRing::RecordLen(copy.size);
+      if (synced_ && copy.seq > next_seq_) {
+        lost_ += copy.seq - next_seq_;
+      }
+      next_seq_ = copy.seq + 1;
+      synced_ = true;
+      lapped_ = false;
+      return OK;
+    }
+  }
+
+  /**
+   * @brief 确认读到的消息在使用期间没有被写者覆盖
+   *
+   * @param msg Poll 读到的消息
+   * @return true 消息内容完整
+   * @return false 消息已被覆盖，期间读到的内容不可信
+   */
+  bool Validate(const ShmBroadcastMessage &msg) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return !Overwritten(msg.pos);
+  }
+
+  /**
+   * @brief 跳到最新的位置，之前未读的消息不计入丢失
+   *
+   */
+  void SkipToLatest() {
+    cursor_ = ring_.header_->write_end.load(std::memory_order_acquire);
+    synced_ = false;
+    lapped_ = false;
+  }
+
+  /**
+   * @brief 获取因为落后超过一圈而丢失的消息数量，根据读到的消息序号之间的空缺计算
+   *
+   * 落后之后如果没有新的消息，追上写者（Poll 返回 EMPTY）时根据已经发布的消息数量计入。
+   *
+   * @return uint64_t 丢失的消息数量
+   */
+  uint64_t Lost() const { return lost_; }
+
+ private:
+  bool Overwritten(uint64_t pos) const {
+    return ring_.header_->write_begin.load(std::memory_order_relaxed) > pos + ring_.capacity_;
+  }
+
+  /**
+   * @brief 落后之后追上了写者，把跳过的消息计入丢失
+   *
+   * 写者先更新 write_end 再更新 next_seq，因此先读 next_seq 之后 write_end 依然等于读位置时，
+   * 序号小于 next_seq 的消息都在读位置之前，其中没有读到的都已经被跳过。恰好正在发布的一条
+   * 消息可能也在读位置之前，它会在读到下一条消息时通过序号的空缺计入。
+   */
+  void CountSkipped() {
+    uint64_t published = ring_.header_->next_seq.load(std::memory_order_acquire);
+    if (cursor_ == ring_.header_->write_end.load(std::memory_order_acquire) &&
+        published > next_seq_) {
+      lost_ += published - next_seq_;
+      next_seq_ = published;
+    }
+  }
+
+  const ShmBroadcastRing &ring_; /**< 读取的队列 */
+  uint64_t cursor_ = 0;          /**< 读位置 */
+  uint64_t next_seq_ = 0;        /**< 期望读到的下一条消息的序号 */
+  uint64_t lost_ = 0;            /**< 丢失的消息数量 */
+  bool synced_ = false;          /**< next_seq_ 是否有效 */
+  bool lapped_ = false;          /**< 落后之后还没有读到消息 */
+};
+
+}  // namespace shmlite
@@ -0,0 +1,509 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../shm_handle.h"
+#include "../shm_mutex.h"
+#include "../shm_segment.h"
+
+namespace shmlite {
+
+/**
+ * @brief ShmHashMap 位于段头部之后的控制信息，除 capacity 外全零即为空表的状态
+ *
+ * 桶的数量记录在段头部的元素个数中。
+ */
+struct HashMapHeader {
+  ShmMutex write_lock;                 /**< 写者之间互斥的锁，读者不需要获取 */
+  uint64_t capacity;                   /**< 最多能存放的元素个数，创建时写入 */
+  std::atomic<uint64_t> size;          /**< 有效元素的数量 */
+  std::atomic<uint64_t> tombstones;    /**< 已删除但未被复用的桶的数量 */
+  std::atomic<uint32_t> generation;    /**< 整理墓碑时为奇数，读者据此重试 */
+  uint64_t compact_cursor;             /**< 增量整理墓碑时下一次开始检查的桶 */
+};
+
+/**
+ * @brief 对哈希值进行二次混淆，避免整数的恒等哈希在线性探测下产生聚集
+ *
+ * @param h 原始哈希值
+ * @return 混淆后的哈希值
+ */
+inline uint64_t MixHash(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/**
+ * @brief 共享内存中的定长开放寻址哈希表
+ *
+ * 所有的桶都放在同一块共享内存中，使用线性探测解决冲突，删除时留下墓碑。墓碑超过桶数量的
+ * 1/16 之后，每次删除都在写锁下从上次的位置继续检查一小段桶，把其中含有墓碑的连续非空段
+ * 原地重新放置，清除墓碑。墓碑因此保持在桶数量的 1/8 以内，探测长度不会随着插入删除的次数增长；
+ * 每次整理只影响一段连续的非空桶，读者最多等待这一段被重新放置，时间与最长探测长度同阶。
+ *
+ * 每个桶带有一个序号组成 seqlock：写者（通过 @ref HashMapHeader::write_lock "write_lock"
+ * 互斥）修改桶之前将序号加一变为奇数，修改完成后再加一变为偶数；读者只读取序号，
+ * 在读到的前后两次序号相同且为偶数时才认为读到的内容一致。因此任意多个读者进程可以
+ * 同时查找而不需要获取任何锁，也不会写共享的缓存行。整理墓碑时元素会在桶之间移动，
+ * 读者额外通过 @ref HashMapHeader::generation "generation" 发现并重试。
+ *
+ * 由于使用了 Hash 计算桶的位置，所有访问同一个表的进程必须使用相同的 Hash 实现。
+ *
+ * @tparam K 键的类型，必须可以平凡拷贝
+ * @tparam V 值的类型，必须可以平凡拷贝
+ * @tparam Hash 哈希函数
+ * @tparam KeyEqual 键的比较函数
+ */
+template <typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class ShmHashMap {
+  static_assert(std::is_trivially_copyable<K>::value, "ShmHashMap requires trivially copyable K");
+  static_assert(std::is_trivially_copyable<V>::value, "ShmHashMap requires trivially copyable V");
+
+  static constexpr uint32_t kEmpty = 0;      /**< 空桶 */
+  static constexpr uint32_t kOccupied = 1;   /**< 存有元素 */
+  static constexpr uint32_t kDeleted = 2;    /**< 墓碑 */
+  static constexpr size_t kCompactStep = 64; /**< 每次增量整理墓碑时至少检查的桶数 */
+
+  /**
+   * @brief 哈希表中的桶
+   *
+   */
+  struct Bucket {
+    std::atomic<uint32_t> seq;   /**< seqlock 序号，奇数表示正在被修改 */
+    std::atomic<uint32_t> state; /**< 桶的状态 */
+    K key;                       /**< 键 */
+    V value;                     /**< 值 */
+  };
+
+ public:
+  /**
+   * @brief 构造一个 ShmHashMap 对象
+   *
+   * @param name 哈希表对象名字
+   * @param capacity 最多能存放的元素个数，桶的数量会按照 0.75 的装载因子向上取整到2的幂次，
+   * 打开已经存在的哈希表时必须与创建时一致
+   */
+  ShmHashMap(const std::string &name, size_t capacity)
+      : capacity_(capacity), bucket_count_(RoundUpPowerOfTwo(capacity + capacity / 3 + 1)),
+        mask_(bucket_count_ - 1) {
+    size_t alloc_size =
+        sizeof(ShmSegmentHeader) + sizeof(HashMapHeader) + sizeof(Bucket) * bucket_count_;
+    handle_ = std::make_shared<ShmHandle>(name, alloc_size, ShmHandle::CREAT_RDWR);
+#ifdef DEV_DEBUG
+    SIMPLE_DEBUG("ShmHashMap [" << name << "] alloc_size = " << alloc_size
+                                << ", buckets = " << bucket_count_);
+#endif
+    if (!handle_->IsValid()) {
+      SIMPLE_ERROR("Can not allocate shm hash map of desired capacity " << capacity);
+      capacity_ = 0;
+      return;
+    }
+    /* 桶的数量和容量只在创建时写入一次，之后打开时校验 */
+    ShmSegmentHeader *segment = static_cast<ShmSegmentHeader *>(handle_->Ptr());
+    ShmSegmentLayout layout{ShmTypeHash<ShmHashMap>(), sizeof(Bucket), bucket_count_};
+    auto init = [capacity](void *data) { static_cast<HashMapHeader *>(data)->capacity = capacity; };
+    if (!IsSegmentUsable(AttachSegment(segment, layout, name, init))) {
+      capacity_ = 0;
+      return;
+    }
+    HashMapHeader *header = SegmentData<HashMapHeader>(segment);
+    if (header->capacity != capacity_) {
+      SIMPLE_ERROR("Shm hash map " << name << " has capacity " << header->capacity
+                                   << ", requested " << capacity_);
+      capacity_ = 0;
+      return;
+    }
+    header_ = header;
+    buckets_ = reinterpret_cast<Bucket *>(header_ + 1);
+  }
+
+  ShmHashMap(const ShmHashMap &other) = delete;
+
+  ~ShmHashMap() = default;
+
+  ShmHashMap &operator=(const ShmHashMap &other) = delete;
+
+  /**
+   * @brief 查找键对应的值，不需要获取锁
+   *
+   * @param key 键
+   * @param value 找到时存放对应的值
+   * @return true 找到
+   * @return false 不存在
+   */
+  bool Find(const K &key, V &value) const {
+    for (;;) {
+      uint32_t generation = header_->generation.load(std::memory_order_acquire);
+      if (generation & 1) {
+        CpuRelax();
+        continue;
+      }
+      V cur_value;
+      bool found = Probe(key, cur_value);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (header_->generation.load(std::memory_order_relaxed) == generation) {
+        if (found) {
+          value = cur_value;
+        }
+        return found;
+      }
+    }
+  }
+
+  /**
+   * @brief 检查键是否存在，不需要获取锁
+   *
+   * @param key 键
+   * @return true 存在
+   * @return false 不存在
+   */
+  bool Contains(const K &key) const {
+    V value;
+    return Find(key, value);
+  }
+
+  /**
+   * @brief 插入或者更新键值对
+   *
+   * @param key 键
+   * @param value 值
+   * @return true 插入或更新成功
+   * @return false 元素数量已经达到容量上限
+   */
+  bool Put(const K &key, const V &value) {
+    ShmMutexGuard guard(header_->write_lock);
+    return PutLocked(key, value);
+  }
+
+  /**
+   * @brief 键不存在时插入 make(value) 生成的值，键已经存在时返回已有的值
+   *
+   * make 在写锁的保护下调用，多个进程同时对同一个键调用时只会有一个进程的 make 生效。
+   * make 的签名为 bool(V &)，返回 false 表示生成失败，此时不会插入。
+   *
+   * @param key 键
+   * @param make 生成值的函数
+   * @param value 存放最终的值
+   * @return true 成功
+   * @return false 键不存在，且元素数量已经达到容量上限或者 make 失败
+   */
+  template <typename F>
+  bool FindOrInsert(const K &key, F &&make, V &value) {
+    ShmMutexGuard guard(header_->write_lock);
+    if (FindLocked(key, value)) {
+      return true;
+    }
+    if (header_->size.load(std::memory_order_relaxed) >= capacity_) {
+      return false;
+    }
+    if (!make(value)) {
+      return false;
+    }
+    return PutLocked(key, value);
+  }
+
+  /**
+   * @brief 删除键值对
+   *
+   * @param key 键
+   * @return true 删除成功
+   * @return false 键不存在
+   */
+  bool Erase(const K &key) {
+    ShmMutexGuard guard(header_->write_lock);
+    size_t idx = BucketIndex(key);
+    for (size_t probe = 0; probe < bucket_count_; ++probe) {
+      Bucket &bucket = buckets_[idx];
+      uint32_t state = bucket.state.load(std::memory_order_relaxed);
+      if (state == kEmpty) {
+        return false;
+      }
+      if (state == kOccupied && equal_(bucket.key, key)) {
+        WriteBucket(bucket, kDeleted, bucket.key, bucket.value);
+        header_->size.fetch_sub(1, std::memory_order_relaxed);
+        if (header_->tombstones.fetch_add(1, std::memory_order_relaxed) + 1 > bucket_count_ / 16) {
+          CompactStepLocked();
+        }
+        return true;
+      }
+      idx = (idx + 1) & mask_;
+    }
+    return false;
+  }
+
+  /**
+   * @brief 获取元素数量
+   *
+   * @return size_t 元素数量
+   */
+  size_t Size() const { return header_->size.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief 获取最多能存放的元素数量
+   *
+   * @return size_t 容量
+   */
+  size_t Capacity() const { return capacity_; }
+
+  /**
+   * @brief 获取桶的数量
+   *
+   * @return size_t 桶的数量
+   */
+  size_t BucketCount() const { return bucket_count_; }
+
+  /**
+   * @brief 获取墓碑的数量
+   *
+   * @return size_t 墓碑的数量
+   */
+  size_t Tombstones() const { return header_->tombstones.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief 获取最长的连续非空桶的长度，即任意一次查找最多需要探测的桶数，用于诊断
+   *
+   * 需要遍历所有的桶，并发修改时只是一个近似值。
+   *
+   * @return size_t 最长探测长度
+   */
+  size_t MaxProbeLength() const {
+    size_t longest = 0;
+    size_t run = 0;
+    /* 遍历两圈，跨越数组末尾的连续段也能被完整统计 */
+    for (size_t i = 0; i < 2 * bucket_count_ && run < bucket_count_; ++i) {
+      if (buckets_[i & mask_].state.load(std::memory_order_relaxed) == kEmpty) {
+        run = 0;
+      } else {
+        longest = std::max(longest, ++run);
+      }
+    }
+    return longest;
+  }
+
+  /**
+   * @brief 检测共享内存哈希表是否有效
+   *
+   * @return true 有效
+   * @return false 无效，或者与已经存在的哈希表的类型、容量不一致
+   */
+  bool IsValid() const { return header_ != nullptr; }
+
+ private:
+  /**
+   * @brief 计算键所在的起始桶
+   *
+   * @param key 键
+   * @return size_t 桶的下标
+   */
+  size_t BucketIndex(const K &key) const {
+    return static_cast<size_t>(MixHash(static_cast<uint64_t>(hash_(key)))) & mask_;
+  }
+
+  /**
+   * @brief 在 seqlock 的保护下读出一个桶的一致快照
+   *
+   */
+  static void ReadBucket(const Bucket &bucket, uint32_t &state, K &key, V &value) {
+    for (;;) {
+      uint32_t seq1 = bucket.seq.load(std::memory_order_acquire);
+      if (seq1 & 1) {
+        CpuRelax();
+        continue;
+      }
+      state = bucket.state.load(std::memory_order_relaxed);
+      memcpy(&key, &bucket.key, sizeof(K));
+      memcpy(&value, &bucket.value, sizeof(V));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (bucket.seq.load(std::memory_order_relaxed) == seq1) {
+        return;
+      }
+    }
+  }
+
+  /**
+   * @brief 在 seqlock 的保护下修改一个桶，调用者必须持有写锁
+   *
+   */
+  static void WriteBucket(Bucket &bucket, uint32_t state, const K &key, const V &value) {
+    uint32_t seq = bucket.seq.load(std::memory_order_relaxed);
+    bucket.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bucket.state.store(state, std::memory_order_relaxed);
+    memmove(&bucket.key, &key, sizeof(K));
+    memmove(&bucket.value, &value, sizeof(V));
+    bucket.seq.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief 不加锁地探测键，读到的每个桶都是一致的，但整理墓碑时可能漏掉被移动的元素
+   *
+   */
+  bool Probe(const K &key, V &value) const {
+    size_t idx = BucketIndex(key);
+    for (size_t probe = 0; probe < bucket_count_; ++probe) {
+      const Bucket &bucket = buckets_[idx];
+      uint32_t state;
+      K cur_key;
+      ReadBucket(bucket, state, cur_key, value);
+      if (state == kEmpty) {
+        return false;
+      }
+      if (state == kOccupied && equal_(cur_key, key)) {
+        return true;
+      }
+      idx = (idx + 1) & mask_;
+    }
+    return false;
+  }
+
+  /**
+   * @brief 持有写锁时增量地清除墓碑：从上次的位置继续检查至少 kCompactStep 个桶
+   *
+   * 只在空桶之后开始处理，每次处理一段完整的连续非空桶，段中的元素不会被移出这一段。
+   */
+  void CompactStepLocked() {
+    size_t idx = header_->compact_cursor & mask_;
+    size_t scanned = 0;
+    /* 当前位置可能在某一段的中间，先跳到下一个空桶 */
+    while (scanned < bucket_count_ &&
+           buckets_[idx].state.load(std::memory_order_relaxed) != kEmpty) {
+      idx = (idx + 1) & mask_;
+      ++scanned;
+    }
+    while (scanned < kCompactStep && scanned < bucket_count_) {
+      size_t start = (idx + 1) & mask_;
+      size_t len = 0;
+      size_t tombstones = 0;
+      while (len < bucket_count_) {
+        uint32_t state = buckets_[(start + len) & mask_].state.load(std::memory_order_relaxed);
+        if (state == kEmpty) {
+          break;
+        }
+        tombstones += state == kDeleted;
+        ++len;
+      }
+      if (tombstones != 0) {
+        RebuildRunLocked(start, len, tombstones);
+      }
+      idx = (start + len) & mask_;
+      scanned += len + 1;
+    }
+    header_->compact_cursor = idx;
+  }
+
+  /**
+   * @brief 持有写锁时重新放置从 start 开始的 len 个连续非空桶中的元素，清除其中的墓碑
+   *
+   * 段前面是空桶，段中每个元素的起始桶都在段内，按原来的顺序重新放置时不会超出原来的位置。
+   * 期间 generation 为奇数，并发的读者会等待完成后重新查找。
+   */
+  void RebuildRunLocked(size_t start, size_t len, size_t tombstones) {
+    std::vector<std::pair<K, V>> items;
+    items.reserve(len - tombstones);
+    for (size_t i = 0; i < len; ++i) {
+      const Bucket &bucket = buckets_[(start + i) & mask_];
+      if (bucket.state.load(std::memory_order_relaxed) == kOccupied) {
+        items.emplace_back(bucket.key, bucket.value);
+      }
+    }
+    uint32_t generation = header_->generation.load(std::memory_order_relaxed);
+    header_->generation.store(generation + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < len; ++i) {
+      Bucket &bucket = buckets_[(start + i) & mask_];
+      WriteBucket(bucket, kEmpty, bucket.key, bucket.value);
+    }
+    for (const auto &item : items) {
+      size_t idx = BucketIndex(item.first);
+      while (buckets_[idx].state.load(std::memory_order_relaxed) != kEmpty) {
+        idx = (idx + 1) & mask_;
+      }
+      WriteBucket(buckets_[idx], kOccupied, item.first, item.second);
+    }
+    header_->tombstones.fetch_sub(tombstones, std::memory_order_relaxed);
+    header_->generation.store(generation + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief 持有写锁时查找键
+   *
+   */
+  bool FindLocked(const K &key, V &value) const {
+    size_t idx = BucketIndex(key);
+    for (size_t probe = 0; probe < bucket_count_; ++probe) {
+      const Bucket &bucket = buckets_[idx];
+      uint32_t state = bucket.state.load(std::memory_order_relaxed);
+      if (state == kEmpty) {
+        return false;
+      }
+      if (state == kOccupied && equal_(bucket.key, key)) {
+        value = bucket.value;
+        return true;
+      }
+      idx = (idx + 1) & mask_;
+    }
+    return false;
+  }
+
+  /**
+   * @brief 持有写锁时插入或更新
+   *
+   * @param key 键
+   * @param value 值
+   * @return true 成功
+   * @return false 容量不足
+   */
+  bool PutLocked(const K &key, const V &value) {
+    size_t idx = BucketIndex(key);
+    size_t target = bucket_count_;
+    for (size_t probe = 0; probe < bucket_count_; ++probe) {
+      Bucket &bucket = buckets_[idx];
+      uint32_t state = bucket.state.load(std::memory_order_relaxed);
+      if (state == kEmpty) {
+        if (target == bucket_count_) {
+          target = idx;
+        }
+        break;
+      }
+      if (state == kDeleted) {
+        if (target == bucket_count_) {
+          target = idx; /* 记录第一个墓碑，键不存在时复用它 */
+        }
+      } else if (equal_(bucket.key, key)) {
+        WriteBucket(bucket, kOccupied, key, value);
+        return true;
+      }
+      idx = (idx + 1) & mask_;
+    }
+    if (target == bucket_count_ || header_->size.load(std::memory_order_relaxed) >= capacity_) {
+      return false;
+    }
+    if (buckets_[target].state.load(std::memory_order_relaxed) == kDeleted) {
+      header_->tombstones.fetch_sub(1, std::memory_order_relaxed);
+    }
+    WriteBucket(buckets_[target], kOccupied, key, value);
+    header_->size.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  size_t capacity_;                   /**< 最多能存放的元素数量 */
+  size_t bucket_count_;               /**< 桶的数量 */
+  size_t mask_;                       /**< 计算下标用的掩码 */
+  HashMapHeader *header_ = nullptr;   /**< 段头部之后的控制信息 */
+  Bucket *buckets_ = nullptr;         /**< 桶数组的首地址 */
+  Hash hash_;                         /**< 哈希函数 */
+  KeyEqual equal_;                    /**< 键的比较函数 */
+  std::shared_ptr<ShmHandle> handle_; /**< 底层的 ShmHandle 对象指针 */
+};
+
+}  // namespace shmlite
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
+#include "../shm_event.h"
+#include "../shm_handle.h"
+#include "../shm_segment.h"
+
+namespace shmlite {
+
+/**
+ * @brief ShmMpmcQueue 位于段头部之后的控制信息，全零即为空队列的状态
+ *
+ * 队列容量记录在段头部的元素个数中。
+ */
+struct MpmcQueueHeader {
+  alignas(kCacheLineSize) std::atomic<uint64_t> enqueue_pos;  /**< 生产者的写位置 */
+  alignas(kCacheLineSize) std::atomic<uint64_t> dequeue_pos;  /**< 消费者的读位置 */
+  alignas(kCacheLineSize) ShmEvent not_empty;                 /**< 消费者等待的事件 */
+  alignas(kCacheLineSize) ShmEvent not_full;                  /**< 生产者等待的事件 */
+};
+
+/**
+ * @brief 共享内存中的多生产者多消费者有界无锁队列
+ *
+ * 采用 Vyukov 的每槽序号算法：每个槽位带有一个序号，生产者和消费者各自通过 CAS
+ * 抢占位置，再根据槽位序号判断槽位是否可写/可读，不需要全局锁。
+ *
+ * 槽位序号以相对值存放（逻辑序号减去槽位下标），因此全零的共享内存就是合法的空队列，
+ * 创建时只需要通过段头部记录元素类型和容量，之后打开的进程校验一致后才能使用。
+ *
+ * 阻塞版本的 Push/Pop 在 @ref ShmEvent "ShmEvent" 上等待：先短暂自旋，然后在 futex 上睡眠；
+ * 对端只有在存在等待者时才会调用 FUTEX_WAKE。
+ *
+ * @tparam T 队列存放的数据类型，必须可以平凡拷贝
+ */
+template <typename T>
+class ShmMpmcQueue {
+  static_assert(std::is_trivially_copyable<T>::value, "ShmMpmcQueue requires trivially copyable T");
+
+  /**
+   * @brief 队列中的槽位
+   *
+   */
+  struct Cell {
+    std::atomic<uint64_t> seq; /**< 槽位的相对序号 */
+    T data;                    /**< 存放的元素 */
+  };
+
+ public:
+  /**
+   * @brief 构造一个 ShmMpmcQueue 对象
+   *
+   * @param name 队列对象名字
+   * @param capacity 队列容量，会向上取整到2的幂次，打开已经存在的队列时必须与创建时一致
+   */
+  ShmMpmcQueue(const std::string &name, size_t capacity)
+      : capacity_(RoundUpPowerOfTwo(capacity)), mask_(capacity_ - 1) {
+    size_t alloc_size =
+        sizeof(ShmSegmentHeader) + sizeof(MpmcQueueHeader) + sizeof(Cell) * capacity_;
+    handle_ = std::make_shared<ShmHandle>(name, alloc_size, ShmHandle::CREAT_RDWR);
+#ifdef DEV_DEBUG
+    SIMPLE_DEBUG("ShmMpmcQueue [" << name << "] alloc_size = " << alloc_size
+                                  << ", capacity = " << capacity_);
+#endif
+    if (!handle_->IsValid()) {
+      SIMPLE_ERROR("Can not allocate shm mpmc queue of desired capacity " << capacity_);
+      capacity_ = 0;
+      return;
+    }
+    ShmSegmentHeader *segment = static_cast<ShmSegmentHeader *>(handle_->Ptr());
+    ShmSegmentLayout layout{ShmTypeHash<ShmMpmcQueue<T>>(), sizeof(Cell), capacity_};
+    if (!IsSegmentUsable(AttachSegment(segment, layout, name))) {
+      capacity_ = 0;
+      return;
+    }
+    header_ = SegmentData<MpmcQueueHeader>(segment);
+    cells_ = reinterpret_cast<Cell *>(header_ + 1);
+  }
+
+  ShmMpmcQueue(const ShmMpmcQueue &other) = delete;
+
+  ~ShmMpmcQueue() = default;
+
+  ShmMpmcQueue &operator=(const ShmMpmcQueue &other) = delete;
+
+  /**
+   * @brief 尝试放入一个元素，不会阻塞
+   *
+   * @param item 放入的元素
+   * @return true 放入成功
+   * @return false 队列已满
+   */
+  bool TryPush(const T &item) {
+    uint64_t pos = header_->enqueue_pos.load(std::memory_order_relaxed);
+    Cell *cell;
+    uint64_t base;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      base = pos & ~static_cast<uint64_t>(mask_);
+      int64_t diff = static_cast<int64_t>(cell->seq.load(std::memory_order_acquire) - base);
+      if (diff == 0) {
+        if (header_->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; /* 槽位还没有被消费，队列已满 */
+      } else {
+        pos = header_->enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = item;
+    cell->seq.store(base + 1, std::memory_order_release);
+    header_->not_empty.NotifyOne();
+    return true;
+  }
+
+  /**
+   * @brief 尝试取出一个元素，不会阻塞
+   *
+   * @param item 取出的元素
+   * @return true 取出成功
+   * @return false 队列为空
+   */
+  bool TryPop(T &item) {
+    uint64_t pos = header_->dequeue_pos.load(std::memory_order_relaxed);
+    Cell *cell;
+    uint64_t base;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      base = pos & ~static_cast<uint64_t>(mask_);
+      int64_t diff = static_cast<int64_t>(cell->seq.load(std::memory_order_acquire) - (base + 1));
+      if (diff == 0) {
+        if (header_->dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; /* 槽位还没有被写入，队列为空 */
+      } else {
+        pos = header_->dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    item = cell->data;
+    cell->seq.store(base + capacity_, std::memory_order_release);
+    header_->not_full.NotifyOne();
+    return true;
+  }
+
+  /**
+   * @brief 放入一个元素，队列已满时在futex上等待
+   *
+   * @param item 放入的元素
+   */
+  void Push(const T &item) {
+    if (!TryPush(item)) {
+      header_->not_full.Wait([&] { return TryPush(item); });
+    }
+  }
+
+  /**
+   * @brief 取出一个元素，队列为空时在futex上等待
+   *
+   * @param item 取出的元素
+   */
+  void Pop(T &item) {
+    if (!TryPop(item)) {
+      header_->not_empty.Wait([&] { return TryPop(item); });
+    }
+  }
+
+  /**
+   * @brief 获取队列中的元素数量，并发读写时只是一个近似值
+   *
+   * @return size_t 元素数量
+   */
+  size_t Size() const {
+    uint64_t deq = header_->dequeue_pos.load(std::memory_order_acquire);
+    uint64_t enq = header_->enqueue_pos.load(std::memory_order_acquire);
+    return enq > deq ? enq - deq : 0;
+  }
+
+  /**
+   * @brief 获取队列的容量
+   *
+   * @return size_t 队列容量
+   */
+  size_t Capacity() const { return capacity_; }
+
+  /**
+   * @brief 检测共享内存队列是否有效
+   *
+   * @return true 有效
+   * @return false 无效，或者与已经存在的队列的类型、容量不一致
+   */
+  bool IsValid() const { return header_ != nullptr; }
+
+ private:
+  size_t capacity_;                   /**< 队列的容量 */
+  size_t mask_;                       /**< 计算下标用的掩码 */
+  MpmcQueueHeader *header_ = nullptr; /**< 段头部之后的控制信息 */
+  Cell *cells_ = nullptr;             /**< 槽位数组的首地址 */
+  std::shared_ptr<ShmHandle> handle_; /**< 底层的 ShmHandle 对象指针 */
+};
+
+}  // namespace shmlite
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../numa_utils.h"
+#include "shm_array.hpp"
+
+namespace shmlite {
+
+/**
+ * @brief 按 NUMA 节点复制的只读为主的共享内存数组
+ *
+ * 每个在线的 NUMA 节点上都有一份绑定在该节点内存上的 ShmArray 副本（名字为 name.node<id>），
+ * 读取时访问调用者所在节点的副本，写入时依次更新所有副本。
+ *
+ * 写入不是原子地同时作用于所有副本，写入过程中不同节点的读者可能短暂地看到不同的值；
+ * 多个写者之间需要调用者自行互斥。
+ *
+ * @tparam T 数组存放的数据类型
+ */
+template <typename T>
+class ShmReplicatedArray {
+ public:
+  /**
+   * @brief 构造一个 ShmReplicatedArray 对象
+   *
+   * @param name 数组对象名字
+   * @param size 数组大小
+   */
+  ShmReplicatedArray(const std::string &name, size_t size)
+      : name_(name), nodes_(NumaOnlineNodes()) {
+    for (int node : nodes_) {
+      ShmHandleOptions options;
+      options.numa_policy = SHM_NUMA_BIND;
+      options.numa_node = node;
+      replicas_.emplace_back(new ShmArray<T>(ReplicaName(name, node), size, options));
+    }
+    Rebind();
+  }
+
+  LIBSHMLITE_NO_COPYABLE(ShmReplicatedArray)
+
+  /**
+   * @brief 删除系统中该数组的所有副本
+   *
+   * @param name 数组对象名字
+   * @return true 所有副本都删除成功
+   * @return false 有副本删除失败
+   */
+  static bool UnLink(const std::string &name) {
+    bool ok = true;
+    for (int node : NumaOnlineNodes()) {
+      ok = ShmHandle::UnLink(ReplicaName(name, node)) && ok;
+    }
+    return ok;
+  }
+
+  /**
+   * @brief 重新确定调用者所在的节点，进程被迁移到其它节点之后调用
+   *
+   */
+  void Rebind() {
+    int current = CurrentNumaNode();
+    local_ = 0;
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+      if (nodes_[i] == current) {
+        local_ = i;
+        break;
+      }
+    }
+  }
+
+  /**
+   * @brief 从本节点的副本中读取元素
+   *
+   * @param pos 索引位置
+   * @return const T& 数组中的元素
+   */
+  const T &operator[](size_t pos) const {
+    const ShmArray<T> &local = *replicas_[local_];
+    return local[pos];
+  }
+
+  /**
+   * @brief 从本节点的副本中读取元素
+   *
+   * @param pos 索引位置
+   * @return const T& 数组中的元素
+   */
+  const T &At(size_t pos) const { return this->operator[](pos); }
+
+  /**
+   * @brief 修改元素，所有副本都会被更新
+   *
+   * @param pos 索引位置
+   * @param value 新的值
+   */
+  void Set(size_t pos, const T &value) {
+    for (auto &replica : replicas_) {
+      (*replica)[pos] = value;
+    }
+  }
+
+  /**
+   * @brief 以特定的内容填充所有副本
+   *
+   * @param value 填充的内容
+   */
+  void Fill(const T &value) {
+    for (auto &replica : replicas_) {
+      replica->Fill(value);
+    }
+  }
+
+  /**
+   * @brief 获取某个副本
+   *
+   * @param idx 副本的序号，范围为 [0, ReplicaCount())
+   * @return const ShmArray<T>& 副本
+   */
+  const ShmArray<T> &Replica(size_t idx) const { return *replicas_.at(idx); }
+
+  /**
+   * @brief 获取副本的数量，即在线的 NUMA 节点数量
+   *
+   * @return size_t 副本数量
+   */
+  size_t ReplicaCount() const { return replicas_.size(); }
+
+  /**
+   * @brief 获取读取时使用的副本所在的节点
+   *
+   * @return int 节点编号
+   */
+  int LocalNode() const { return nodes_[local_]; }
+
+  /**
+   * @brief 获取数组的元素容量大小
+   *
+   * @return size_t 数组容量大小
+   */
+  size_t Size() const { return replicas_[0]->Size(); }
+
+  /**
+   * @brief 检测所有副本是否都有效
+   *
+   * @return true 有效
+   * @return false 无效
+   */
+  bool IsValid() const {
+    for (auto &replica : replicas_) {
+      if (!replica->IsValid()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  static std::string ReplicaName(const std::string &name, int node) {
+    return name + ".node" + std::to_string(node);
+  }
+
+  std::string name_;                                   /**< 数组对象名字 */
+  std::vector<int> nodes_;                             /**< 每个副本所在的节点 */
+  std::vector<std::unique_ptr<ShmArray<T>>> replicas_; /**< 每个节点一份的副本 */
+  size_t local_ = 0;                                   /**< 本节点副本的序号 */
+};
+
+}  // namespace shmlite
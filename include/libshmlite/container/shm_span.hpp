@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+namespace shmlite {
+
+/**
+ * @brief 一段连续元素的视图，不拥有内存，相当于 C++20 的 std::span
+ *
+ * 访问不做任何检查，迭代器就是裸指针，可以直接用于 range-for、<algorithm>，
+ * 编译器也能对其上的循环自动向量化。视图的有效期不能超过它所引用的容器。
+ *
+ * @tparam T 元素类型，只读视图使用 const T
+ */
+template <typename T>
+class ShmSpan {
+ public:
+  using element_type = T;
+  using value_type = typename std::remove_cv<T>::type;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using pointer = T *;
+  using reference = T &;
+  using iterator = T *;
+
+  ShmSpan() = default;
+
+  /**
+   * @brief 构造一个视图
+   *
+   * @param data 首地址
+   * @param size 元素个数
+   */
+  ShmSpan(T *data, size_t size) : data_(data), size_(size) {}
+
+  /**
+   * @brief 从可写视图构造只读视图
+   *
+   */
+  template <typename U,
+            typename = typename std::enable_if<std::is_convertible<U (*)[], T (*)[]>::value>::type>
+  ShmSpan(const ShmSpan<U> &other) : data_(other.Data()), size_(other.Size()) {}
+
+  /**
+   * @brief 按照索引访问元素，不检查越界
+   *
+   * @param pos 索引位置
+   * @return T& 元素
+   */
+  T &operator[](size_t pos) const { return data_[pos]; }
+
+  /**
+   * @brief 获取首地址
+   *
+   * @return T* 首地址
+   */
+  T *Data() const { return data_; }
+
+  /**
+   * @brief 获取元素个数
+   *
+   * @return size_t 元素个数
+   */
+  size_t Size() const { return size_; }
+
+  /**
+   * @brief 是否为空
+   *
+   * @return true 为空
+   * @return false 不为空
+   */
+  bool Empty() const { return size_ == 0; }
+
+  /**
+   * @brief 获取从 pos 开始的最多 n 个元素的子视图，超出的部分会被截掉
+   *
+   * @param pos 开始的位置
+   * @param n 元素个数
+   * @return ShmSpan 子视图
+   */
+  ShmSpan Subspan(size_t pos, size_t n = static_cast<size_t>(-1)) const {
+    pos = std::min(pos, size_);
+    return ShmSpan(data_ + pos, std::min(n, size_ - pos));
+  }
+
+  iterator begin() const { return data_; }
+  iterator end() const { return data_ + size_; }
+
+ private:
+  T *data_ = nullptr; /**< 首地址 */
+  size_t size_ = 0;   /**< 元素个数 */
+};
+
+}  // namespace shmlite
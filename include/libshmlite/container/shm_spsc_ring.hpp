@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "../shm_handle.h"
+#include "../shm_segment.h"
+
+namespace shmlite {
+
+/**
+ * @brief ShmSpscRing 位于段头部之后的控制信息
+ *
+ * head 和 tail 分别只由消费者和生产者写入，放在不同的缓存行上避免伪共享。
+ * 全零即为空队列的状态。队列容量记录在段头部的元素个数中。
+ */
+struct SpscRingHeader {
+  alignas(kCacheLineSize) std::atomic<uint64_t> head; /**< 消费者的读位置，单调递增 */
+  alignas(kCacheLineSize) std::atomic<uint64_t> tail; /**< 生产者的写位置，单调递增 */
+};
+
+/**
+ * @brief 共享内存中的单生产者单消费者无锁环形队列
+ *
+ * 数据路径上没有锁也没有系统调用，生产者和消费者之间只通过 acquire/release
+ * 语义的原子变量同步。同一时刻只能有一个进程调用 TryPush，一个进程调用 TryPop。
+ *
+ * @tparam T 队列存放的数据类型，必须可以平凡拷贝
+ */
+template <typename T>
+class ShmSpscRing {
+  static_assert(std::is_trivially_copyable<T>::value, "ShmSpscRing requires trivially copyable T");
+
+ public:
+  /**
+   * @brief 构造一个 ShmSpscRing 对象
+   *
+   * @param name 队列对象名字
+   * @param capacity 队列容量，会向上取整到2的幂次，打开已经存在的队列时必须与创建时一致
+   */
+  ShmSpscRing(const std::string &name, size_t capacity)
+      : capacity_(RoundUpPowerOfTwo(capacity)), mask_(capacity_ - 1) {
+    size_t alloc_size = sizeof(ShmSegmentHeader) + sizeof(SpscRingHeader) + sizeof(T) * capacity_;
+    handle_ = std::make_shared<ShmHandle>(name, alloc_size, ShmHandle::CREAT_RDWR);
+#ifdef DEV_DEBUG
+    SIMPLE_DEBUG("ShmSpscRing [" << name << "] alloc_size = " << alloc_size
+                                 << ", capacity = " << capacity_);
+#endif
+    if (!handle_->IsValid()) {
+      SIMPLE_ERROR("Can not allocate shm spsc ring of desired capacity " << capacity_);
+      capacity_ = 0;
+      return;
+    }
+    /* 容量只在创建时写入段头部一次，之后打开时校验，不一致的队列不能使用 */
+    ShmSegmentHeader *segment = static_cast<ShmSegmentHeader *>(handle_->Ptr());
+    ShmSegmentLayout layout{ShmTypeHash<ShmSpscRing<T>>(), sizeof(T), capacity_};
+    if (!IsSegmentUsable(AttachSegment(segment, layout, name))) {
+      capacity_ = 0;
+      return;
+    }
+    header_ = SegmentData<SpscRingHeader>(segment);
+    slots_ = reinterpret_cast<T *>(header_ + 1);
+    cached_head_ = header_->head.load(std::memory_order_acquire);
+    cached_tail_ = header_->tail.load(std::memory_order_acquire);
+  }
+
+  ShmSpscRing(const ShmSpscRing &other) = delete;
+
+  ~ShmSpscRing() = default;
+
+  ShmSpscRing &operator=(const ShmSpscRing &other) = delete;
+
+  /**
+   * @brief 放入一个元素，只能由生产者调用
+   *
+   * @param item 放入的元素
+   * @return true 放入成功
+   * @return false 队列已满
+   */
+  bool TryPush(const T &item) { return TryPush(&item, 1) == 1; }
+
+  /**
+   * @brief 批量放入元素，只能由生产者调用
+   *
+   * @param items 需要放入的元素的首地址
+   * @param n 需要放入的元素数量
+   * @return size_t 实际放入的元素数量，队列空间不足时小于n
+   */
+  size_t TryPush(const T *items, size_t n) {
+    uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    uint64_t used = tail - cached_head_;
+    size_t free_slots = used <= capacity_ ? capacity_ - used : 0;
+    if (free_slots < n) {
+      /* 本地缓存的消费者位置不够用了（或者已经过期），才去读取共享的 head */
+      cached_head_ = header_->head.load(std::memory_order_acquire);
+      free_slots = capacity_ - (tail - cached_head_);
+    }
+    n = std::min(n, free_slots);
+    if (n == 0) {
+      return 0;
+    }
+    size_t pos = tail & mask_;
+    size_t first = std::min(n, capacity_ - pos);
+    memcpy(slots_ + pos, items, sizeof(T) * first);
+    memcpy(slots_, items + first, sizeof(T) * (n - first));
+    header_->tail.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  /**
+   * @brief 取出一个元素，只能由消费者调用
+   *
+   * @param item 取出的元素
+   * @return true 取出成功
+   * @return false 队列为空
+   */
+  bool TryPop(T &item) { return TryPop(&item, 1) == 1; }
+
+  /**
+   * @brief 批量取出元素，只能由消费者调用
+   *
+   * @param items 存放取出的元素的首地址
+   * @param n 最多取出的元素数量
+   * @return size_t 实际取出的元素数量
+   */
+  size_t TryPop(T *items, size_t n) {
+    uint64_t head = header_->head.load(std::memory_order_relaxed);
+    uint64_t cached = cached_tail_ - head;
+    size_t avail = cached <= capacity_ ? cached : 0;
+    if (avail < n) {
+      /* 本地缓存的生产者位置不够用了（或者已经落后于 head），才去读取共享的 tail */
+      cached_tail_ = header_->tail.load(std::memory_order_acquire);
+      avail = cached_tail_ - head;
+    }
+    n = std::min(n, avail);
+    if (n == 0) {
+      return 0;
+    }
+    size_t pos = head & mask_;
+    size_t first = std::min(n, capacity_ - pos);
+    memcpy(items, slots_ + pos, sizeof(T) * first);
+    memcpy(items + first, slots_, sizeof(T) * (n - first));
+    header_->head.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  /**
+   * @brief 获取队列中的元素数量，并发读写时只是一个近似值
+   *
+   * @return size_t 元素数量
+   */
+  size_t Size() const {
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    uint64_t tail = header_->tail.load(std::memory_order_acquire);
+    return tail - head;
+  }
+
+  /**
+   * @brief 获取队列的容量
+   *
+   * @return size_t 队列容量
+   */
+  size_t Capacity() const { return capacity_; }
+
+  /**
+   * @brief 检测共享内存队列是否有效
+   *
+   * @return true 有效
+   * @return false 无效，或者与已经存在的队列的类型、容量不一致
+   */
+  bool IsValid() const { return header_ != nullptr; }
+
+ private:
+  size_t capacity_;                   /**< 队列的容量 */
+  size_t mask_;                       /**< 计算下标用的掩码 */
+  SpscRingHeader *header_ = nullptr;  /**< 段头部之后的控制信息 */
+  T *slots_ = nullptr;                /**< 存放元素的首地址 */
+  uint64_t cached_head_ = 0;          /**< 生产者本地缓存的消费者位置 */
+  uint64_t cached_tail_ = 0;          /**< 消费者本地缓存的生产者位置 */
+  std::shared_ptr<ShmHandle> handle_; /**< 底层的 ShmHandle 对象指针 */
+};
+
+}  // namespace shmlite
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "../shm_handle.h"
+#include "../shm_mutex.h"
+
+namespace shmlite {
+
+constexpr const char *kShmVectorDataSuffix = ".data"; /**< 数据段的名字后缀 */
+constexpr size_t kShmVectorMinBytes = 4096;           /**< 数据段的最小大小，单位（字节） */
+
+/**
+ * @brief ShmVector 的控制信息，单独放在一个共享内存中，大小固定
+ *
+ * 扩容时先 ftruncate 数据段，再发布 capacity，最后增加 generation；读者只需要比较
+ * generation 就能发现本进程的映射已经过期。全零即为未初始化的空数组。
+ */
+struct ShmVectorHeader {
+  alignas(kCacheLineSize) std::atomic<uint64_t> generation; /**< 每次扩容加一 */
+  std::atomic<uint64_t> capacity;                           /**< 数据段能容纳的元素个数 */
+  alignas(kCacheLineSize) ShmMutex mutex; /**< 写者之间的互斥锁，同时保护扩容 */
+  std::atomic<uint64_t> size;             /**< 已发布的元素个数 */
+};
+
+/**
+ * @brief 可以增长的共享内存数组
+ *
+ * 元素存放在名为 name + ".data" 的共享内存中，容量不足时按两倍 ftruncate 扩容，
+ * 其它进程通过控制信息中的 generation 发现扩容，在访问到新的位置时才用 mremap 重新映射，
+ * 扩容不需要暂停任何读者：数据段只会增大，读者旧的映射始终有效。
+ *
+ * 写者（PushBack/Append/Reserve/Clear）之间通过 ShmMutex 互斥，可以位于不同进程；
+ * 读者不加锁，能看到 [0, Size()) 中的所有元素。重新映射后地址可能改变，之前得到的
+ * 引用和 Data() 指针全部失效，因此同一个 ShmVector 对象不能同时在多个线程中使用。
+ *
+ * @tparam T 数组存放的数据类型，必须可以平凡拷贝
+ */
+template <typename T>
+class ShmVector {
+  static_assert(std::is_trivially_copyable<T>::value, "ShmVector requires trivially copyable T");
+
+ public:
+  /**
+   * @brief 删除系统中的 ShmVector
+   *
+   * @param name 数组对象名字
+   * @return true 删除成功
+   * @return false 删除失败
+   */
+  static bool UnLink(const std::string &name) {
+    bool data_removed = ShmHandle::UnLink(name + kShmVectorDataSuffix);
+    return ShmHandle::UnLink(name) && data_removed;
+  }
+
+  /**
+   * @brief 构造一个 ShmVector 对象，已经存在时直接使用，不会改变其中的内容
+   *
+   * @param name 数组对象名字
+   * @param capacity 至少预留的容量
+   */
+  explicit ShmVector(const std::string &name, size_t capacity = 0) {
+    header_handle_ =
+        std::make_shared<ShmHandle>(name, sizeof(ShmVectorHeader), ShmHandle::CREAT_RDWR);
+    if (!header_handle_->IsValid()) {
+      SIMPLE_ERROR("Can not allocate shm vector header " << name);
+      return;
+    }
+    header_ = reinterpret_cast<ShmVectorHeader *>(header_handle_->Ptr());
+    ShmMutexGuard guard(header_->mutex);
+    uint64_t shared_capacity = header_->capacity.load(std::memory_order_relaxed);
+    if (shared_capacity == 0) {
+      shared_capacity = std::max<uint64_t>(capacity, MinCapacity());
+    }
+    /* 在锁内打开，此时数据段的大小正好是 shared_capacity 个元素，不会被截断 */
+    data_handle_ = std::make_shared<ShmHandle>(name + kShmVectorDataSuffix,
+                                               shared_capacity * sizeof(T), ShmHandle::CREAT_RDWR);
+#ifdef DEV_DEBUG
+    SIMPLE_DEBUG("ShmVector [" << name << "] capacity = " << shared_capacity);
+#endif
+    if (!data_handle_->IsValid()) {
+      SIMPLE_ERROR("Can not allocate shm vector of desired capacity " << shared_capacity);
+      return;
+    }
+    header_->capacity.store(shared_capacity, std::memory_order_release);
+    data_ = static_cast<T *>(data_handle_->Ptr());
+    capacity_ = shared_capacity;
+    generation_ = header_->generation.load(std::memory_order_acquire);
+    ReserveLocked(capacity);
+  }
+
+  ShmVector(const ShmVector &other) = delete;
+
+  ~ShmVector() = default;
+
+  ShmVector &operator=(const ShmVector &other) = delete;
+
+  /**
+   * @brief 在末尾追加一个元素，容量不足时扩容
+   *
+   * @param value 追加的元素
+   * @return true 成功
+   * @return false 扩容失败
+   */
+  bool PushBack(const T &value) { return Append(&value, 1); }
+
+  /**
+   * @brief 在末尾批量追加元素，只加一次锁、发布一次
+   *
+   * @param items 追加的元素
+   * @param n 元素个数
+   * @return true 成功
+   * @return false 扩容失败，没有追加任何元素
+   */
+  bool Append(const T *items, size_t n) {
+    ShmMutexGuard guard(header_->mutex);
+    uint64_t size = header_->size.load(std::memory_order_relaxed);
+    if (!ReserveLocked(size + n)) {
+      return false;
+    }
+    memcpy(data_ + size, items, n * sizeof(T));
+    header_->size.store(size + n, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief 预留至少 n 个元素的容量
+   *
+   * @param n 元素个数
+   * @return true 成功
+   * @return false 扩容失败
+   */
+  bool Reserve(size_t n) {
+    ShmMutexGuard guard(header_->mutex);
+    return ReserveLocked(n);
+  }
+
+  /**
+   * @brief 清空所有元素，容量不变
+   *
+   */
+  void Clear() {
+    ShmMutexGuard guard(header_->mutex);
+    header_->size.store(0, std::memory_order_release);
+  }
+
+  /**
+   * @brief 如果其它进程扩容了数组，重新映射本进程的数据段
+   *
+   * 访问超出本进程映射范围的元素时会自动调用，一般不需要手动调用。
+   *
+   * @return true 映射已经是最新的
+   * @return false 重新映射失败
+   */
+  bool Refresh() const {
+    uint64_t generation = header_->generation.load(std::memory_order_acquire);
+    if (generation == generation_) {
+      return true;
+    }
+    uint64_t capacity = header_->capacity.load(std::memory_order_acquire);
+    if (!data_handle_->Remap(capacity * sizeof(T))) {
+      return false;
+    }
+    data_ = static_cast<T *>(data_handle_->Ptr());
+    capacity_ = capacity;
+    generation_ = generation;
+    return true;
+  }
+
+  /**
+   * @brief 按照数组索引访问元素
+   *
+   * @param pos 索引位置
+   * @return T& 数组中的元素
+   */
+  T &operator[](size_t pos) {
+    CheckPos(pos);
+    return data_[pos];
+  }
+
+  /**
+   * @brief 按照数组索引访问元素
+   *
+   * @param pos 索引位置
+   * @return const T& 数组中的元素
+   */
+  const T &operator[](size_t pos) const {
+    CheckPos(pos);
+    return data_[pos];
+  }
+
+  /**
+   * @brief 按照数组索引访问元素
+   *
+   * @param pos 索引位置
+   * @return T& 数组中的元素
+   */
+  T &At(size_t pos) { return this->operator[](pos); }
+
+  /**
+   * @brief 按照数组索引访问元素
+   *
+   * @param pos 索引位置
+   * @return const T& 数组中的元素
+   */
+  const T &At(size_t pos) const { return this->operator[](pos); }
+
+  /**
+   * @brief 获取本进程映射的首地址，Refresh 或扩容之后失效
+   *
+   * @return T* 首地址
+   */
+  T *Data() const { return data_; }
+
+  /**
+   * @brief 获取已发布的元素个数
+   *
+   * @return size_t 元素个数
+   */
+  size_t Size() const { return header_->size.load(std::memory_order_acquire); }
+
+  /**
+   * @brief 获取所有进程共享的容量
+   *
+   * @return size_t 容量
+   */
+  size_t Capacity() const { return header_->capacity.load(std::memory_order_acquire); }
+
+  /**
+   * @brief 获取本进程映射的数据段能容纳的元素个数
+   *
+   * @return size_t 容量
+   */
+  size_t MappedCapacity() const { return capacity_; }
+
+  /**
+   * @brief 获取扩容的次数
+   *
+   * @return uint64_t 扩容的次数
+   */
+  uint64_t Generation() const { return header_->generation.load(std::memory_order_acquire); }
+
+  /**
+   * @brief 检测共享内存数组是否有效
+   *
+   * @return true 有效
+   * @return false 无效
+   */
+  bool IsValid() const { return data_ != nullptr; }
+
+ private:
+  /**
+   * @brief 数据段的最小容量
+   *
+   * @return uint64_t 元素个数
+   */
+  static constexpr uint64_t MinCapacity() {
+    return sizeof(T) >= kShmVectorMinBytes ? 1 : kShmVectorMinBytes / sizeof(T);
+  }
+
+  /**
+   * @brief 在持有写锁时预留至少 n 个元素的容量，不足时按两倍扩容
+   *
+   * @param n 元素个数
+   * @return true 成功
+   * @return false 扩容失败
+   */
+  bool ReserveLocked(uint64_t n) {
+    if (n <= capacity_) {
+      return true;
+    }
+    uint64_t shared_capacity = header_->capacity.load(std::memory_order_relaxed);
+    if (n <= shared_capacity) {
+      return Refresh(); /* 其它进程已经扩容 */
+    }
+    uint64_t new_capacity = std::max(n, shared_capacity * 2);
+    if (!data_handle_->Resize(new_capacity * sizeof(T))) {
+      SIMPLE_ERROR("Can not grow shm vector " << header_handle_->GetName() << " to "
+                                              << new_capacity);
+      return false;
+    }
+    /* 数据段的大小已经生效之后才发布新的容量 */
+    header_->capacity.store(new_capacity, std::memory_order_release);
+    generation_ = header_->generation.fetch_add(1, std::memory_order_release) + 1;
+    data_ = static_cast<T *>(data_handle_->Ptr());
+    capacity_ = new_capacity;
+    return true;
+  }
+
+  /**
+   * @brief 检查索引是否越界，超出本进程的映射时重新映射
+   *
+   * @param pos 索引
+   */
+  void CheckPos(size_t pos) const {
+    size_t size = Size();
+    if (pos >= size) {
+      std::string msg = "index " + std::to_string(pos) + " is out of range (size = " +
+                        std::to_string(size) + ")";
+      throw std::out_of_range(msg);
+    }
+    /* size 在 capacity 之后发布，看到了 size 就一定能看到足够大的 capacity */
+    if (pos >= capacity_ && !Refresh()) {
+      throw std::runtime_error("ShmVector '" + header_handle_->GetName() + "' can not remap.");
+    }
+  }
+
+  std::shared_ptr<ShmHandle> header_handle_; /**< 控制信息所在的 ShmHandle */
+  std::shared_ptr<ShmHandle> data_handle_;   /**< 数据段所在的 ShmHandle */
+  ShmVectorHeader *header_ = nullptr;        /**< 控制信息 */
+  mutable T *data_ = nullptr;                /**< 本进程映射的数据段首地址 */
+  mutable uint64_t capacity_ = 0;            /**< 本进程映射的数据段能容纳的元素个数 */
+  mutable uint64_t generation_ = 0;          /**< 本进程映射对应的 generation */
+};
+
+}  // namespace shmlite
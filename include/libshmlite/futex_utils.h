@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+namespace shmlite {
+
+/**
+ * @brief 自旋等待时提示CPU当前处于忙等状态，降低功耗并避免流水线惩罚
+ *
+ */
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+/**
+ * @brief 在32位的字上进行 FUTEX_WAIT 等待。
+ *
+ * 不使用 FUTEX_PRIVATE_FLAG，因此 addr 可以位于多个进程共享的内存中。
+ *
+ * @param addr 等待的地址
+ * @param expected 期望值，如果调用时 *addr != expected 则立即返回
+ * @param timeout 相对超时时间，nullptr 表示一直等待
+ * @return 0 被唤醒；-1 出错，errno 为 EAGAIN（值不匹配）、ETIMEDOUT（超时）或 EINTR
+ */
+int FutexWait(std::atomic<uint32_t> *addr, uint32_t expected,
+              const struct timespec *timeout = nullptr);
+
+/**
+ * @brief 在32位的字上进行 FUTEX_WAKE 唤醒
+ *
+ * @param addr 唤醒的地址
+ * @param count 最多唤醒的等待者数量
+ * @return 被唤醒的等待者数量；-1 出错
+ */
+int FutexWake(std::atomic<uint32_t> *addr, int count);
+
+}  // namespace shmlite
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace shmlite {
+
+/**
+ * @brief 共享内存的 NUMA 内存分配策略
+ *
+ */
+enum ShmNumaPolicy {
+  SHM_NUMA_DEFAULT = 0, /**< 系统默认策略，页分配在首次访问它的进程所在的节点 */
+  SHM_NUMA_BIND,        /**< 绑定到指定的节点 */
+  SHM_NUMA_INTERLEAVE,  /**< 在所有在线节点间按页交错分配 */
+  SHM_NUMA_LOCAL,       /**< 绑定到创建者打开时所在的节点，无论之后由谁首次访问 */
+};
+
+/**
+ * @brief 解析 /sys 中形如 "0-3,8,10-11" 的列表
+ *
+ * @param list 列表字符串
+ * @return std::vector<int> 列表中的所有编号
+ */
+std::vector<int> ParseIdList(const std::string &list);
+
+/**
+ * @brief 获取所有在线的 NUMA 节点编号
+ *
+ * @return std::vector<int> 节点编号，没有 NUMA 信息时返回 {0}
+ */
+std::vector<int> NumaOnlineNodes();
+
+/**
+ * @brief 获取 NUMA 节点上的所有 CPU 编号
+ *
+ * @param node 节点编号
+ * @return std::vector<int> CPU 编号，节点不存在时为空
+ */
+std::vector<int> NumaNodeCpus(int node);
+
+/**
+ * @brief 获取调用者当前运行在哪个 NUMA 节点上
+ *
+ * @return int 节点编号，获取失败时返回 0
+ */
+int CurrentNumaNode();
+
+/**
+ * @brief 为一段映射设置 NUMA 内存分配策略（mbind）
+ *
+ * 对共享内存设置的策略保存在共享内存对象上，对所有映射了它的进程生效，但只影响之后才分配的页。
+ *
+ * @param addr 映射的地址，必须按页对齐
+ * @param size 映射的大小
+ * @param policy 分配策略
+ * @param node SHM_NUMA_BIND 时绑定的节点；SHM_NUMA_LOCAL 时忽略，绑定到调用者当前所在的节点，
+ * 调用者没有绑定 CPU 时这只是调用那一刻的节点
+ * @return 0 成功；-1 出错，错误码在 errno 中
+ */
+int NumaBind(void *addr, size_t size, ShmNumaPolicy policy, int node);
+
+}  // namespace shmlite
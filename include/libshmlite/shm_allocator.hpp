@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+#include "shm_heap.h"
+#include "shm_offset_ptr.hpp"
+
+namespace shmlite {
+
+/**
+ * @brief 从 ShmHeap 中分配内存的 STL 分配器，指针类型为 shm_offset_ptr
+ *
+ * 分配器只保存一个指向共享的 @ref ShmHeapArena "ShmHeapArena" 的 shm_offset_ptr，
+ * 因此容器对象本身也可以放在同一个堆里，被任意进程访问。std::vector 等支持
+ * 自定义指针类型的容器可以直接使用，例如：
+ *
+ * @code
+ * using ShmIntVector = std::vector<int, shmlite::ShmAllocator<int>>;
+ * void *mem = heap.ToPtr(heap.Allocate(sizeof(ShmIntVector)));
+ * auto *vec = new (mem) ShmIntVector(shmlite::ShmAllocator<int>(heap));
+ * @endcode
+ *
+ * 分配和释放直接操作共享的堆（不使用 ShmHeap 的进程本地缓存），多个进程同时修改
+ * 同一个容器时仍然需要调用者自己加锁。
+ *
+ * @tparam T 分配的元素类型
+ */
+template <typename T>
+class ShmAllocator {
+ public:
+  using value_type = T;
+  using pointer = shm_offset_ptr<T>;
+  using const_pointer = shm_offset_ptr<const T>;
+  using void_pointer = shm_offset_ptr<void>;
+  using const_void_pointer = shm_offset_ptr<const void>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  template <typename U>
+  struct rebind {
+    using other = ShmAllocator<U>;
+  };
+
+  /**
+   * @brief 从 ShmHeap 构造分配器
+   *
+   * @param heap 共享内存堆
+   */
+  explicit ShmAllocator(const ShmHeap &heap) noexcept : arena_(heap.Arena()) {}
+
+  /**
+   * @brief 从共享的堆控制信息构造分配器
+   *
+   * @param arena 共享的堆控制信息
+   */
+  explicit ShmAllocator(ShmHeapArena *arena) noexcept : arena_(arena) {}
+
+  ShmAllocator(const ShmAllocator &other) noexcept : arena_(other.arena_) {}
+
+  template <typename U>
+  ShmAllocator(const ShmAllocator<U> &other) noexcept : arena_(other.Arena()) {}
+
+  ShmAllocator &operator=(const ShmAllocator &other) noexcept {
+    arena_ = other.arena_;
+    return *this;
+  }
+
+  /**
+   * @brief 分配 n 个元素的空间
+   *
+   * @param n 元素数量
+   * @return pointer 分配得到的指针
+   * @throw std::bad_alloc 堆空间不足
+   */
+  pointer allocate(size_type n) {
+    uint64_t offset = arena_->Allocate(n * sizeof(T));
+    if (offset == kShmNullOffset) {
+      throw std::bad_alloc();
+    }
+    return pointer(static_cast<T *>(arena_->ToPtr(offset)));
+  }
+
+  /**
+   * @brief 释放 allocate 分配的空间
+   *
+   * @param p allocate 返回的指针
+   * @param n 元素数量
+   */
+  void deallocate(pointer p, size_type n) noexcept { arena_->Deallocate(arena_->ToOffset(p.get())); }
+
+  /**
+   * @brief 获取共享的堆控制信息
+   *
+   * @return ShmHeapArena* 堆控制信息
+   */
+  ShmHeapArena *Arena() const noexcept { return arena_.get(); }
+
+  friend bool operator==(const ShmAllocator &a, const ShmAllocator &b) noexcept {
+    return a.arena_ == b.arena_;
+  }
+
+  friend bool operator!=(const ShmAllocator &a, const ShmAllocator &b) noexcept {
+    return a.arena_ != b.arena_;
+  }
+
+ private:
+  shm_offset_ptr<ShmHeapArena> arena_; /**< 共享的堆控制信息 */
+};
+
+}  // namespace shmlite
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <sched.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "common_utils.h"
+#include "shm_handle.h"
+
+namespace shmlite {
+
+/**
+ * @brief ShmCounter 的计数方式
+ *
+ */
+enum ShmCounterMode {
+  SHM_COUNTER_SHARDED = 0, /**< 按 CPU 分片计数，读取时求和，适用于高频计数 */
+  SHM_COUNTER_ATOMIC,      /**< 所有进程在同一个槽上原子计数，适用于低频计数，读取仍对所有槽求和 */
+};
+
+/**
+ * @brief 计数器的一个槽，独占一个缓存行
+ *
+ * @tparam T 计数的类型
+ */
+template <typename T>
+struct alignas(kCacheLineSize) ShmCounterSlot {
+  std::atomic<T> value; /**< 该槽上的计数 */
+};
+
+/**
+ * @brief 多进程共享的计数器
+ *
+ * 共享内存中按机器的 CPU 数量（向上取整到2的幂次）放置若干个独占缓存行的槽。分片模式下，
+ * 每次增加只修改当前 CPU 对应的槽（通过 sched_getcpu 获取，glibc 2.35 起由 rseq 提供，
+ * 不需要系统调用），多个核心之间不会争抢同一个缓存行；读取时对所有槽求和。
+ * 原子模式下只使用第一个槽。
+ *
+ * 两种模式的内存布局相同，读取时总是对所有槽求和，因此不同进程以不同模式打开同一个计数器
+ * 也能得到正确的结果。
+ *
+ * @tparam T 计数的类型，必须是整数
+ */
+template <typename T = int64_t>
+class ShmCounter {
+  static_assert(std::is_integral<T>::value, "ShmCounter requires an integral T");
+
+ public:
+  /**
+   * @brief 打开或创建一个计数器，第一次创建时为 0
+   *
+   * @param name 计数器的名字
+   * @param mode 计数方式
+   */
+  explicit ShmCounter(const std::string &name, ShmCounterMode mode = SHM_COUNTER_SHARDED)
+      : slot_count_(SlotCountOf()),
+        mode_(mode),
+        handle_(std::make_shared<ShmHandle>(name, sizeof(ShmCounterSlot<T>) * slot_count_,
+                                            ShmHandle::CREAT_RDWR)),
+        slots_(handle_->IsValid() ? static_cast<ShmCounterSlot<T> *>(handle_->Ptr()) : nullptr) {}
+
+  LIBSHMLITE_NO_COPYABLE(ShmCounter)
+
+  /**
+   * @brief 增加计数
+   *
+   * @param delta 增加的值，可以为负数
+   */
+  void Add(T delta) { slots_[SlotIndex()].value.fetch_add(delta, std::memory_order_relaxed); }
+
+  /**
+   * @brief 计数加一
+   *
+   */
+  void Increment() { Add(1); }
+
+  /**
+   * @brief 读取当前的计数
+   *
+   * 分片模式下对所有槽求和，与同时进行的增加之间没有一致的快照，结果介于读取开始和结束时的值之间。
+   *
+   * @return T 计数
+   */
+  T Load() const {
+    T sum = 0;
+    for (size_t i = 0; i < slot_count_; ++i) {
+      sum += slots_[i].value.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  /**
+   * @brief 将计数清零，与同时进行的增加之间不是原子的
+   *
+   */
+  void Reset() {
+    for (size_t i = 0; i < slot_count_; ++i) {
+      slots_[i].value.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief 获取槽的数量
+   *
+   * @return size_t 槽的数量
+   */
+  size_t SlotCount() const { return slot_count_; }
+
+  /**
+   * @brief 获取计数方式
+   *
+   * @return ShmCounterMode 计数方式
+   */
+  ShmCounterMode Mode() const { return mode_; }
+
+  /**
+   * @brief 检测计数器是否可用
+   *
+   * @return true 可用
+   * @return false 不可用
+   */
+  bool IsValid() const { return slots_ != nullptr; }
+
+ private:
+  /**
+   * @brief 槽的数量，同一台机器上的所有进程得到相同的值
+   *
+   */
+  static size_t SlotCountOf() {
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    return RoundUpPowerOfTwo(cpus > 0 ? static_cast<size_t>(cpus) : 1);
+  }
+
+  /**
+   * @brief 本次增加使用的槽
+   *
+   */
+  size_t SlotIndex() const {
+    if (mode_ == SHM_COUNTER_ATOMIC) {
+      return 0;
+    }
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : static_cast<size_t>(cpu) & (slot_count_ - 1);
+  }
+
+  size_t slot_count_;                 /**< 槽的数量，为2的幂次 */
+  ShmCounterMode mode_;               /**< 计数方式 */
+  std::shared_ptr<ShmHandle> handle_; /**< 底层的 ShmHandle 对象指针 */
+  ShmCounterSlot<T> *slots_;          /**< 所有的槽 */
+};
+
+}  // namespace shmlite
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+#include "common_utils.h"
+#include "futex_utils.h"
+#include "shm_mutex.h"
+
+namespace shmlite {
+
+/**
+ * @brief 放置在共享内存中的事件，用于等待共享数据发生变化
+ *
+ * 等待者给出一个检查条件的函数，条件不满足时先短暂自旋，然后通过 FUTEX_WAIT 睡眠；
+ * 修改共享数据的一方在修改完成后调用 NotifyOne/NotifyAll。没有等待者时 Notify 只是一次
+ * 内存屏障加一次读取，不会进入内核。
+ *
+ * 等待者先登记、读取futex字、再检查条件，通知者先修改数据、再检查是否有等待者，
+ * 因此不会丢失唤醒。
+ *
+ * 与 ShmMutex 一样，全零的字节即为可用状态，可以直接 reinterpret_cast 共享内存使用。
+ */
+class ShmEvent {
+ public:
+  ShmEvent() = default;
+
+  LIBSHMLITE_NO_COPYABLE(ShmEvent)
+
+  /**
+   * @brief 等待直到 pred() 返回 true
+   *
+   * @tparam Pred 检查条件的函数，签名为 bool()
+   * @param pred 检查条件的函数
+   */
+  template <typename Pred>
+  void Wait(Pred pred) {
+    WaitFor(pred, nullptr);
+  }
+
+  /**
+   * @brief 等待直到 pred() 返回 true 或者超时
+   *
+   * @tparam Pred 检查条件的函数，签名为 bool()
+   * @param pred 检查条件的函数
+   * @param timeout 相对超时时间，nullptr 表示一直等待
+   * @return true 条件满足
+   * @return false 超时
+   */
+  template <typename Pred>
+  bool WaitFor(Pred pred, const struct timespec *timeout) {
+    for (int i = 0, spin = SpinLimit(); i < spin; ++i) {
+      if (pred()) {
+        return true;
+      }
+      CpuRelax();
+    }
+    struct timespec deadline{};
+    if (timeout != nullptr) {
+      deadline = DeadlineAfter(*timeout);
+    }
+    for (;;) {
+      uint32_t seq = Enter();
+      /* 登记为等待者之后再检查一次，避免丢失唤醒 */
+      if (pred()) {
+        Leave();
+        return true;
+      }
+      bool woken = Sleep(seq, timeout != nullptr ? &deadline : nullptr);
+      Leave();
+      if (pred()) {
+        return true;
+      }
+      if (!woken) {
+        return false;
+      }
+    }
+  }
+
+  /**
+   * @brief 唤醒一个等待者，没有等待者时不进行系统调用
+   *
+   */
+  inline void NotifyOne() { Notify(1); }
+
+  /**
+   * @brief 唤醒所有等待者，没有等待者时不进行系统调用
+   *
+   */
+  inline void NotifyAll() { Notify(INT32_MAX); }
+
+  /**
+   * @brief 获取当前睡眠中（或即将睡眠）的等待者数量，仅用于调试
+   *
+   * @return uint32_t 等待者数量
+   */
+  inline uint32_t Waiters() const { return waiters_.load(std::memory_order_relaxed); }
+
+ private:
+  friend class ShmCondition;
+
+  /**
+   * @brief 进入futex等待前的自旋次数，只有一个在线CPU时自旋没有意义，直接睡眠
+   *
+   */
+  static int SpinLimit();
+
+  /**
+   * @brief 登记为等待者
+   *
+   * @return uint32_t 登记时的futex字，作为 Sleep 的期望值
+   */
+  inline uint32_t Enter() {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    return word_.load(std::memory_order_seq_cst);
+  }
+
+  /**
+   * @brief 取消等待者的登记
+   *
+   */
+  inline void Leave() { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+
+  /**
+   * @brief 有等待者时修改futex字并唤醒
+   *
+   * @param count 最多唤醒的等待者数量
+   */
+  inline void Notify(int count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) > 0) {
+      word_.fetch_add(1, std::memory_order_seq_cst);
+      FutexWake(&word_, count);
+    }
+  }
+
+  /**
+   * @brief 在futex字上睡眠，直到被唤醒、futex字不等于 seq 或者到达截止时间
+   *
+   * @param seq 期望的futex字
+   * @param deadline CLOCK_MONOTONIC 下的截止时间，nullptr 表示一直等待
+   * @return true 被唤醒或者futex字已经改变（包括虚假唤醒）
+   * @return false 到达截止时间
+   */
+  bool Sleep(uint32_t seq, const struct timespec *deadline);
+
+  /**
+   * @brief 计算从现在开始经过 timeout 之后的 CLOCK_MONOTONIC 时间
+   *
+   */
+  static struct timespec DeadlineAfter(const struct timespec &timeout);
+
+  std::atomic<uint32_t> word_{0};    /**< futex字，每次有等待者时的通知加一 */
+  std::atomic<uint32_t> waiters_{0}; /**< 等待者数量 */
+};
+
+static_assert(sizeof(ShmEvent) == 8, "ShmEvent layout must stay stable across processes");
+
+/**
+ * @brief 放置在共享内存中的条件变量，与 ShmMutex 配合使用
+ *
+ * 用法与 std::condition_variable 相同：持有 ShmMutex 时检查条件，条件不满足就调用 Wait，
+ * Wait 会原子地释放锁并睡眠，返回前重新获取锁。可能发生虚假唤醒，建议使用带条件的版本。
+ *
+ * 全零的字节即为可用状态。
+ */
+class ShmCondition {
+ public:
+  ShmCondition() = default;
+
+  LIBSHMLITE_NO_COPYABLE(ShmCondition)
+
+  /**
+   * @brief 释放锁并等待通知，返回时重新持有锁
+   *
+   * @param mutex 调用者持有的锁
+   */
+  void Wait(ShmMutex &mutex) { WaitFor(mutex, nullptr); }
+
+  /**
+   * @brief 释放锁并等待通知或者超时，返回时重新持有锁
+   *
+   * @param mutex 调用者持有的锁
+   * @param timeout 相对超时时间，nullptr 表示一直等待
+   * @return true 被唤醒（可能是虚假唤醒）
+   * @return false 超时
+   */
+  bool WaitFor(ShmMutex &mutex, const struct timespec *timeout) {
+    struct timespec deadline{};
+    if (timeout != nullptr) {
+      deadline = ShmEvent::DeadlineAfter(*timeout);
+    }
+    return WaitUntil(mutex, timeout != nullptr ? &deadline : nullptr);
+  }
+
+  /**
+   * @brief 等待直到 pred() 返回 true，pred 在持有锁时调用
+   *
+   * @tparam Pred 检查条件的函数，签名为 bool()
+   * @param mutex 调用者持有的锁
+   * @param pred 检查条件的函数
+   */
+  template <typename Pred>
+  void Wait(ShmMutex &mutex, Pred pred) {
+    while (!pred()) {
+      Wait(mutex);
+    }
+  }
+
+  /**
+   * @brief 等待直到 pred() 返回 true 或者超时，pred 在持有锁时调用
+   *
+   * @tparam Pred 检查条件的函数，签名为 bool()
+   * @param mutex 调用者持有的锁
+   * @param pred 检查条件的函数
+   * @param timeout 相对超时时间，nullptr 表示一直等待
+   * @return true 条件满足
+   * @return false 超时且条件依然不满足
+   */
+  template <typename Pred>
+  bool WaitFor(ShmMutex &mutex, Pred pred, const struct timespec *timeout) {
+    struct timespec deadline{};
+    if (timeout != nullptr) {
+      deadline = ShmEvent::DeadlineAfter(*timeout);
+    }
+    while (!pred()) {
+      if (!WaitUntil(mutex, timeout != nullptr ? &deadline : nullptr)) {
+        return pred();
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief 唤醒一个等待者，没有等待者时不进行系统调用
+   *
+   */
+  inline void NotifyOne() { event_.NotifyOne(); }
+
+  /**
+   * @brief 唤醒所有等待者，没有等待者时不进行系统调用
+   *
+   */
+  inline void NotifyAll() { event_.NotifyAll(); }
+
+ private:
+  /**
+   * @brief 释放锁并睡眠直到被唤醒或者到达截止时间，返回时重新持有锁
+   *
+   */
+  bool WaitUntil(ShmMutex &mutex, const struct timespec *deadline) {
+    /* 持有锁时登记，通知者修改条件之后一定能看到这个等待者 */
+    uint32_t seq = event_.Enter();
+    mutex.Unlock();
+    bool woken = event_.Sleep(seq, deadline);
+    event_.Leave();
+    mutex.Lock();
+    return woken;
+  }
+
+  ShmEvent event_; /**< 底层的事件 */
+};
+
+static_assert(sizeof(ShmCondition) == 8, "ShmCondition layout must stay stable across processes");
+
+}  // namespace shmlite
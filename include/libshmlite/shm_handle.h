@@ -3,17 +3,142 @@
 #include <dirent.h> // for macro NAME_MAX
 #include <fcntl.h>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include "common_utils.h"
+#include "numa_utils.h"
 
 namespace shmlite {
 
 constexpr const char *kShmNamePrefix =
     "/lsmlh-"; /**< 共享内存名字的前缀，必须以/开头。libshmlitehandle 缩写为 lsmlh */
+constexpr const char *kHugetlbfsDir = "/dev/hugepages"; /**< hugetlbfs 默认的挂载点 */
+constexpr size_t kShmMaxReceivedFds = 8; /**< ReceiveFd 最多接收的描述符个数，多出的被内核丢弃 */
+
+/**
+ * @brief 共享内存使用的页大小
+ *
+ */
+enum ShmPageSize {
+  SHM_PAGE_DEFAULT = 0,  /**< 系统默认的页（通常为4KiB） */
+  SHM_PAGE_HUGE_2M = 21, /**< 2MiB 大页，取值为页大小以2为底的对数 */
+  SHM_PAGE_HUGE_1G = 30, /**< 1GiB 大页 */
+};
+
+/**
+ * @brief 映射后预先触发缺页的方式，避免首次访问时在关键路径上发生缺页中断
+ *
+ */
+enum ShmPrefault {
+  SHM_PREFAULT_NONE = 0,       /**< 不预取，首次访问时缺页 */
+  SHM_PREFAULT_POPULATE,       /**< mmap 时使用 MAP_POPULATE 建立页表 */
+  SHM_PREFAULT_WILLNEED,       /**< madvise(MADV_WILLNEED)，只把页读入内存，不建立页表 */
+  SHM_PREFAULT_POPULATE_WRITE, /**< madvise(MADV_POPULATE_WRITE)，建立可写的页表，需要 Linux 5.14 */
+};
+
+/**
+ * @brief 将共享内存锁定在物理内存中的方式
+ *
+ */
+enum ShmMemLock {
+  SHM_MEMLOCK_NONE = 0, /**< 不锁定 */
+  SHM_MEMLOCK_ALL,      /**< mlock 锁定整个映射，同时会预取所有的页 */
+  SHM_MEMLOCK_ON_FAULT, /**< mlock2(MLOCK_ONFAULT)，只锁定已经访问过的页 */
+};
+
+/**
+ * @brief 共享内存的来源
+ *
+ */
+enum ShmBacking {
+  SHM_BACKING_POSIX = 0, /**< shm_open 打开 /dev/shm 中的命名共享内存 */
+  /**
+   * memfd_create 创建的匿名共享内存，没有全局的名字，最后一个文件描述符关闭时自动释放；
+   * 通过 SendTo/ReceiveFd 在进程间传递，支持 Seal
+   */
+  SHM_BACKING_MEMFD,
+  /**
+   * 映射 file_dir 中的普通文件（或者 DAX 文件系统上的文件），数据在进程和机器重启之后依然存在，
+   * 可以大于物理内存，访问时按需换入；写入何时落盘由 flush_policy 决定。file_dir 必须显式给出
+   */
+  SHM_BACKING_FILE,
+};
+
+/**
+ * @brief 文件映射的刷新策略，只对 SHM_BACKING_FILE 的可写映射有效。任何策略下都可以调用
+ * ShmHandle::Flush 或 ShmHandle::FlushRange 按需刷新
+ *
+ */
+enum ShmFlushPolicy {
+  SHM_FLUSH_NONE = 0, /**< 不主动刷新，由内核在后台回写（通常在 30 秒之内） */
+  SHM_FLUSH_ASYNC,    /**< 关闭时发起整个文件的回写，不等待完成 */
+  SHM_FLUSH_SYNC,     /**< 关闭时 msync(MS_SYNC)，等待数据落盘 */
+  /**
+   * 后台线程每隔 flush_interval_ms 毫秒 msync(MS_SYNC) 一次，关闭时也刷新一次。线程不会被 fork
+   * 复制，fork 出的子进程中继承的 ShmHandle 不再周期刷新，只在关闭时刷新
+   */
+  SHM_FLUSH_PERIODIC,
+};
+
+/**
+ * @brief memfd 共享内存的封印（seal），一旦加上就不能再去掉
+ *
+ */
+enum ShmSeal {
+  SHM_SEAL_SHRINK = F_SEAL_SHRINK, /**< 不能再缩小 */
+  SHM_SEAL_GROW = F_SEAL_GROW,     /**< 不能再增大 */
+  SHM_SEAL_WRITE = F_SEAL_WRITE,   /**< 内容不能再修改，接收者无需防御性拷贝 */
+  SHM_SEAL_SEAL = F_SEAL_SEAL,     /**< 不能再添加新的封印 */
+  SHM_SEAL_ALL = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL, /**< 完全不可变 */
+};
+
+/**
+ * @brief 创建 ShmHandle 时的可选项
+ *
+ */
+struct ShmHandleOptions {
+  ShmBacking backing = SHM_BACKING_POSIX; /**< 共享内存的来源 */
+  /**
+   * @brief 页大小。使用大页时，共享内存放在 hugetlbfs 中的同名文件里（memfd 时使用
+   * MFD_HUGETLB），大小会自动向上取整到页大小
+   */
+  ShmPageSize page_size = SHM_PAGE_DEFAULT;
+  /**
+   * @brief 大页不可用（hugetlbfs 未挂载或大页预留不足）时，是否回退为普通共享内存 +
+   * madvise(MADV_HUGEPAGE) 使用透明大页
+   *
+   * 回退之后同名的普通共享内存就决定了这块内存的位置：之后以相同选项打开的进程即使大页已经可用，
+   * 也会打开这块普通共享内存，而不是在 hugetlbfs 中另建一块；反过来，hugetlbfs 中已有同名文件
+   * 时不会回退。为 false 时遇到已经回退的共享内存直接失败。
+   */
+  bool thp_fallback = true;
+  std::string hugetlbfs_dir = kHugetlbfsDir; /**< hugetlbfs 的挂载点 */
+  ShmPrefault prefault = SHM_PREFAULT_NONE;  /**< 预取方式，失败时只打印警告 */
+  ShmMemLock mem_lock = SHM_MEMLOCK_NONE;    /**< 锁定方式，受 RLIMIT_MEMLOCK 限制 */
+  /**
+   * @brief NUMA 分配策略，在任何页被访问之前设置，对所有映射了该共享内存的进程生效
+   */
+  ShmNumaPolicy numa_policy = SHM_NUMA_DEFAULT;
+  int numa_node = 0; /**< SHM_NUMA_BIND 时绑定的节点 */
+  /**
+   * @brief SHM_BACKING_FILE 时文件所在的目录，必须是绝对路径：相对路径取决于各个进程的工作目录，
+   * 共享同一个名字的进程可能映射到不同的文件
+   */
+  std::string file_dir;
+  ShmFlushPolicy flush_policy = SHM_FLUSH_NONE; /**< SHM_BACKING_FILE 时的刷新策略 */
+  int flush_interval_ms = 1000; /**< SHM_FLUSH_PERIODIC 的刷新间隔，单位（毫秒） */
+  /**
+   * @brief 文件位于 DAX 文件系统（持久内存）上时使用 MAP_SYNC 映射，缺页时文件的元数据已经持久化，
+   * 不支持时回退为普通映射并打印警告
+   */
+  bool map_sync = false;
+};
+
+class ShmFlusher; /**< 文件映射的后台刷新线程，定义在 shm_handle.cc 中 */
 
 /**
  * @brief 对POSIX API下的共享内存操作的封装。
@@ -40,6 +165,17 @@ public:
    */
   static bool UnLink(const std::string &shm_name);
 
+  /**
+   * @brief 删除系统中以指定选项创建的共享内存，使用大页时删除 hugetlbfs 中的文件，
+   * 文件映射时删除 file_dir 中的文件
+   *
+   * @param shm_name 共享内存的名称
+   * @param options 创建时使用的选项
+   * @return true 删除成功
+   * @return false 删除失败
+   */
+  static bool UnLink(const std::string &shm_name, const ShmHandleOptions &options);
+
   LIBSHMLITE_NO_COPYABLE(ShmHandle)
 
   /**
@@ -58,17 +194,36 @@ public:
   /**
    * @brief 创建一个 ShmHandle 对象。
    *
+   * 新创建的共享内存会被调整到 size；已经存在的共享内存不会被改变大小，
+   * 大小与 size 不一致时得到无效的对象。需要改变大小时显式调用 Resize。
+   *
    * @param name        对象的名称。
-   * @param size        需要的共享内存的大小，单位（字节）。
+   * @param size        需要的共享内存的大小，单位（字节）。为 0 时打开已经存在的共享内存，大小取其当前大小
    * @param flags       打开共享内存的标志。参考@ref OpenFlags "OpenFlags"
    * @param auto_unlink 析构的时候是否同时 shm_unlink 掉这块共享内存
    */
   ShmHandle(std::string name, size_t size, OpenFlags flags,
             bool auto_unlink = false);
 
+  /**
+   * @brief 以指定的选项创建一个 ShmHandle 对象。
+   *
+   * @param name        对象的名称。
+   * @param size        需要的共享内存的大小，单位（字节）。
+   * @param flags       打开共享内存的标志。参考@ref OpenFlags "OpenFlags"
+   * @param options     可选项，参考 @ref ShmHandleOptions "ShmHandleOptions"
+   * @param auto_unlink 析构的时候是否同时删除掉这块共享内存
+   */
+  ShmHandle(std::string name, size_t size, OpenFlags flags, const ShmHandleOptions &options,
+            bool auto_unlink = false);
+
   /**
    * @brief 创建一个 ShmHandle 对象，如果该共享内存不存在，则指定共享内存的初始值。
    *
+   * 只有通过 O_EXCL 真正创建了共享内存的对象才会写入初始值，已经存在的内容不会被覆盖。
+   * 其它进程可能在初始值写完之前就打开了共享内存，需要等待初始化完成的场景应使用带段头部的
+   * ShmArray 或 ShmPool，参考 AttachSegment。
+   *
    * @param name        对象的名称。
    * @param value       共享内存的初始化的值，指向一块内存
    * @param size        初始值的大小，单位（字节）。
@@ -77,11 +232,32 @@ public:
   ShmHandle(std::string name, void *value, size_t size,
             bool auto_unlink = false);
 
+  /**
+   * @brief 从文件描述符创建 ShmHandle，通常是通过 ReceiveFd 收到的 memfd
+   *
+   * 接管该文件描述符，析构时关闭。大小为文件当前的大小；已经加了 SHM_SEAL_WRITE 时总是只读映射。
+   *
+   * @param fd    文件描述符，为 -1 时得到无效的对象
+   * @param name  对象的名称，只用于日志
+   * @param flags 映射的方式，READ_ONLY 或 READ_WRITE
+   */
+  ShmHandle(int fd, std::string name, OpenFlags flags);
+
+  /**
+   * @brief 从 UNIX 域套接字接收一个通过 SendTo 发送的文件描述符（SCM_RIGHTS）
+   *
+   * 对端一次发送了多个描述符时只返回第一个，其余的立即关闭，不会泄漏到本进程中。
+   *
+   * @param socket 套接字
+   * @return int 收到的文件描述符（带 FD_CLOEXEC），失败时返回 -1
+   */
+  static int ReceiveFd(int socket);
+
   /**
    * @brief 析构 ShmHandle 对象
    *
    * 析构函数中将共享内存归还，并根据 @ref ShmHandle::auto_unlink_
-   * "ShmHandle::auto_unlink_" 标记决定是否unlink掉这块共享内存
+   * "ShmHandle::auto_unlink_" 标记决定是否unlink掉这块共享内存。文件映射按照刷新策略在解除映射之前刷新
    */
   ~ShmHandle();
 
@@ -107,6 +283,141 @@ public:
    */
   inline size_t GetSize() const { return size_; }
 
+  /**
+   * @brief 获取实际映射的大小，使用大页时为 GetSize() 向上取整到页大小
+   *
+   * @return size_t 映射的大小
+   */
+  inline size_t GetMappedSize() const { return mapped_size_; }
+
+  /**
+   * @brief 获取实际使用的页大小
+   *
+   * @return ShmPageSize 使用 hugetlbfs 时为对应的大页，否则为 SHM_PAGE_DEFAULT
+   */
+  inline ShmPageSize GetPageSize() const { return page_size_; }
+
+  /**
+   * @brief 获取预取或锁定之后驻留在内存中的页数（以系统页为单位），由 mincore 统计
+   *
+   * 只说明页已经分配并位于页缓存中，不说明本进程的页表已经建立：例如 MADV_WILLNEED
+   * 打开其它进程写过的段时所有页都驻留，但首次访问仍然会发生（次要）缺页。首次访问
+   * 实际免去的缺页次数需要通过 getrusage 的 ru_minflt 测量，参考 bench_prefault。
+   *
+   * @return size_t 驻留的页数，没有预取和锁定时为 0
+   */
+  inline size_t GetResidentPages() const { return resident_pages_; }
+
+  /**
+   * @brief 共享内存是否已经通过 mlock 锁定在物理内存中
+   *
+   * @return true 已锁定
+   * @return false 未锁定
+   */
+  inline bool IsMemLocked() const { return mem_locked_; }
+
+  /**
+   * @brief 共享内存是否由本对象创建（O_EXCL 创建成功，或者是 memfd）
+   *
+   * @return true 由本对象创建
+   * @return false 打开的是已经存在的共享内存
+   */
+  inline bool IsCreator() const { return created_; }
+
+  /**
+   * @brief 获取成功设置的 NUMA 分配策略
+   *
+   * @return ShmNumaPolicy 设置失败或者没有设置时为 SHM_NUMA_DEFAULT
+   */
+  inline ShmNumaPolicy GetNumaPolicy() const { return numa_policy_; }
+
+  /**
+   * @brief 获取共享内存的来源
+   *
+   * @return ShmBacking 共享内存的来源
+   */
+  inline ShmBacking GetBacking() const { return backing_; }
+
+  /**
+   * @brief 本进程的映射是否只读
+   *
+   * @return true 只读
+   * @return false 可写
+   */
+  inline bool IsReadOnly() const { return (prot_ & PROT_WRITE) == 0; }
+
+  /**
+   * @brief 获取文件映射的刷新策略
+   *
+   * @return ShmFlushPolicy 刷新策略，不是文件映射时为 SHM_FLUSH_NONE
+   */
+  inline ShmFlushPolicy GetFlushPolicy() const { return flush_policy_; }
+
+  /**
+   * @brief 文件映射是否使用了 MAP_SYNC
+   *
+   * @return true 使用了 MAP_SYNC
+   * @return false 没有使用
+   */
+  inline bool IsMapSync() const { return map_sync_; }
+
+  /**
+   * @brief 获取底层文件的路径
+   *
+   * @return const std::string& 文件映射或 hugetlbfs 中的文件路径，POSIX 共享内存和 memfd 时为空
+   */
+  inline const std::string &GetPath() const { return path_; }
+
+  /**
+   * @brief 把文件映射中修改过的数据写回文件
+   *
+   * @param wait 为 true 时 msync(MS_SYNC) 等待数据落盘，否则只发起回写
+   * @return true 成功，不是文件映射时什么都不做
+   * @return false 失败
+   */
+  bool Flush(bool wait = true) { return FlushRange(0, size_, wait); }
+
+  /**
+   * @brief 把文件映射中 [offset, offset + len) 范围内修改过的数据写回文件，只刷新真正被修改的部分
+   *
+   * @param offset 起始偏移，单位（字节），不需要页对齐
+   * @param len 长度，单位（字节）
+   * @param wait 为 true 时 msync(MS_SYNC) 等待数据落盘，否则只发起回写
+   * @return true 成功，不是文件映射时什么都不做
+   * @return false 失败
+   */
+  bool FlushRange(size_t offset, size_t len, bool wait = true);
+
+  /**
+   * @brief 给 memfd 共享内存加上封印
+   *
+   * 存在可写的共享映射时内核不允许加 SHM_SEAL_WRITE，因此本进程会重新只读映射，
+   * 地址可能改变；其它进程的可写映射需要先行解除。
+   *
+   * @param seals ShmSeal 的组合
+   * @return true 成功
+   * @return false 失败，例如不是 memfd 或者已经加了 SHM_SEAL_SEAL
+   */
+  bool Seal(int seals);
+
+  /**
+   * @brief 获取已经加上的封印
+   *
+   * @return int ShmSeal 的组合，失败时返回 -1；不支持封印的 POSIX 共享内存总是带有 SHM_SEAL_SEAL
+   */
+  int GetSeals() const;
+
+  /**
+   * @brief 通过 UNIX 域套接字把文件描述符发送给另一个进程（SCM_RIGHTS）
+   *
+   * 接收方用 ReceiveFd 和 ShmHandle(fd, name, flags) 映射同一块内存，数据本身不经过套接字。
+   *
+   * @param socket 已连接的 UNIX 域套接字
+   * @return true 发送成功
+   * @return false 发送失败
+   */
+  bool SendTo(int socket) const;
+
   /**
    * @brief
    * 检查该共享内存对象是否能够使用，本质是在检查是否得到有效的文件描述符并且共享内存的地址也是有效的
@@ -123,11 +434,103 @@ public:
    */
   inline void *Ptr() const { return ptr_; }
 
+  /**
+   * @brief 调整共享内存的大小（ftruncate），并重新映射
+   *
+   * 重新映射之后地址可能改变，之前通过 Ptr() 得到的指针全部失效。缩小时其它进程访问
+   * 被截掉的部分会收到 SIGBUS，因此多进程共享时只应该增大。
+   *
+   * @param new_size 新的大小，单位（字节）。使用大页时向上取整到页大小
+   * @return true 成功
+   * @return false 失败，原来的映射保持不变
+   */
+  bool Resize(size_t new_size);
+
+  /**
+   * @brief 按照新的大小重新映射，不改变共享内存本身的大小
+   *
+   * 用于其它进程 Resize 之后让本进程的映射跟上。使用 mremap 实现，地址可能改变。
+   *
+   * @param new_size 新的映射大小，单位（字节），不能超过共享内存当前的大小
+   * @return true 成功
+   * @return false 失败，原来的映射保持不变
+   */
+  bool Remap(size_t new_size);
+
 private:
+  /**
+   * @brief 打开并映射共享内存
+   *
+   * @param oflags  打开共享内存的标志
+   * @param options 可选项
+   */
+  void Open(int oflags, const ShmHandleOptions &options);
+
+  /**
+   * @brief 打开并映射 file_dir 中的文件
+   *
+   * @param oflags  打开文件的标志
+   * @param options 可选项
+   */
+  void OpenFile(int oflags, const ShmHandleOptions &options);
+
+  /**
+   * @brief 在 hugetlbfs 中打开并映射共享内存
+   *
+   * @param oflags  打开共享内存的标志
+   * @param options 可选项
+   * @return true 成功
+   * @return false 失败
+   */
+  bool OpenHugetlbfs(int oflags, const ShmHandleOptions &options);
+
+  /**
+   * @brief 以 MFD_HUGETLB 创建 memfd 并映射
+   *
+   * @param options 可选项
+   * @return true 成功
+   * @return false 失败
+   */
+  bool OpenMemfdHugetlb(const ShmHandleOptions &options);
+
+  /**
+   * @brief 映射成功后设置 NUMA 分配策略
+   *
+   * @param options 可选项
+   */
+  void ApplyNumaPolicy(const ShmHandleOptions &options);
+
+  /**
+   * @brief 映射成功后按照选项预取和锁定共享内存
+   *
+   * @param oflags  打开共享内存的标志
+   * @param options 可选项
+   */
+  void Prefault(int oflags, const ShmHandleOptions &options);
+
+  /**
+   * @brief 映射成功后按照选项启动文件映射的刷新
+   *
+   * @param options 可选项
+   */
+  void StartFlush(const ShmHandleOptions &options);
+
   int fd_ = -1; /**< ShmHandle 底层的文件描述符，由操作系统提供。 */
   size_t size_; /**< 共享内存空间的大小，单位（字节）。 */
+  size_t mapped_size_ = 0; /**< 实际映射的大小，单位（字节）。 */
   bool auto_unlink_; /**< 析构的时候是否同时 shm_unlink 删除这块共享内存。 */
   void *ptr_ = nullptr; /**< 共享内存的地址位置。 */
+  ShmPageSize page_size_ = SHM_PAGE_DEFAULT; /**< 实际使用的页大小。 */
+  std::string path_; /**< 使用 hugetlbfs 或文件映射时的文件路径，为空表示 POSIX 共享内存。 */
+  size_t resident_pages_ = 0; /**< 预取或锁定之后驻留在内存中的页数。 */
+  bool mem_locked_ = false; /**< 是否已经 mlock。 */
+  ShmNumaPolicy numa_policy_ = SHM_NUMA_DEFAULT; /**< 成功设置的 NUMA 分配策略。 */
+  ShmBacking backing_ = SHM_BACKING_POSIX; /**< 共享内存的来源。 */
+  int prot_ = PROT_READ | PROT_WRITE; /**< 本进程映射的权限。 */
+  bool created_ = false; /**< 共享内存是否由本对象创建。 */
+  ShmFlushPolicy flush_policy_ = SHM_FLUSH_NONE; /**< 文件映射的刷新策略。 */
+  bool map_sync_ = false; /**< 是否使用了 MAP_SYNC。 */
+  std::unique_ptr<ShmFlusher> flusher_; /**< SHM_FLUSH_PERIODIC 的后台刷新线程。 */
 };
 
 } // namespace shmlite
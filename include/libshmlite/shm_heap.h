@@ -0,0 +1,342 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common_utils.h"
+#include "shm_handle.h"
+#include "shm_mutex.h"
+
+namespace shmlite {
+
+constexpr uint64_t kShmNullOffset = 0;            /**< 表示空的偏移量，偏移量0处是堆的控制信息 */
+constexpr size_t kShmHeapChunkSize = 64 * 1024;   /**< 堆的基本分配单位（chunk）的大小 */
+constexpr size_t kShmHeapNumSizeClasses = 20;     /**< 小对象的规格数量 */
+constexpr size_t kShmHeapMaxSmallSize = 16 * 1024; /**< 小对象的最大大小，更大的按整个chunk分配 */
+
+/**
+ * @brief 堆的使用情况统计
+ *
+ */
+struct ShmHeapStats {
+  size_t capacity;      /**< 可分配的总字节数 */
+  size_t used_bytes;    /**< 已经从共享的空闲链表中分出去的字节数（包括进程本地缓存中的） */
+  size_t chunks_in_use; /**< 已经被使用的chunk数量 */
+  size_t chunk_count;   /**< chunk总数 */
+};
+
+/**
+ * @brief chunk 的元信息，紧跟在 ShmHeapArena 之后，每个 chunk 一项
+ *
+ * 小对象 chunk 中从未分出去过的块不在空闲链表中，而是从 carved 开始按顺序切分，
+ * 因此启用一个新的 chunk 只需要常数时间。
+ */
+struct ShmHeapChunk {
+  uint32_t kind;      /**< 空闲、大对象，或者小对象的规格 + 1 */
+  uint32_t used;      /**< 小对象 chunk 中已经分出去的块数 */
+  uint32_t free_head; /**< 空闲块链表头，为块相对于 chunk 起点的偏移量 + 1，0 表示空 */
+  uint32_t carved;    /**< 已经切分过的字节数 */
+  uint32_t prev;      /**< 同一规格未满 chunk 链表中的前一个，为下标 + 1，0 表示没有 */
+  uint32_t next;      /**< 同一规格未满 chunk 链表中的后一个，为下标 + 1，0 表示没有 */
+};
+
+/**
+ * @brief 位于共享内存开头的堆控制信息，所有进程共享
+ *
+ * 堆被划分为大小为 @ref kShmHeapChunkSize 的 chunk。不超过 @ref kShmHeapMaxSmallSize
+ * 的请求按规格（size class）取整，每个规格独占若干个 chunk 并切分成等大的块，每个 chunk
+ * 的空闲块通过块内存放的偏移量串成链表，还有空闲块的 chunk 按规格串成双向链表；
+ * 更大的请求直接分配连续的 chunk。
+ *
+ * 小对象 chunk 中的块全部释放之后，chunk 回到空闲状态，可以被其它规格或者大对象使用，
+ * 负载在不同规格之间转移时不会让内存碎片化。每个规格唯一的未满 chunk 即使为空也会保留，
+ * 避免在 chunk 边界上反复分配和释放时来回切换。ShmHeap 的进程本地缓存中的块算作已经分配，
+ * 它们所在的 chunk 在 FlushCache 之后才能归还。
+ *
+ * 所有的地址都用相对于本结构体（即共享内存首地址）的偏移量表示，因此可以在任意进程中使用。
+ * 本结构体中的接口都需要获取 @ref lock "lock"，不带进程本地缓存，带缓存的接口见 ShmHeap。
+ *
+ * 全零的字节表示还没有初始化，第一次调用 Init 时完成初始化。
+ */
+struct ShmHeapArena {
+  /**
+   * @brief 在持有锁的情况下初始化堆，如果已经初始化则直接返回
+   *
+   * @param total_size 共享内存的总大小
+   * @return true 堆可以使用
+   * @return false 共享内存太小
+   */
+  bool Init(size_t total_size);
+
+  /**
+   * @brief 分配内存
+   *
+   * @param size 需要的字节数
+   * @return uint64_t 分配得到的偏移量，失败时返回 kShmNullOffset
+   */
+  uint64_t Allocate(size_t size);
+
+  /**
+   * @brief 释放内存
+   *
+   * @param offset Allocate 返回的偏移量
+   */
+  void Deallocate(uint64_t offset);
+
+  /**
+   * @brief 从某个规格的空闲链表中批量取出块
+   *
+   * @param size_class 规格
+   * @param out 存放取出的偏移量
+   * @param n 需要的数量
+   * @return size_t 实际取出的数量
+   */
+  size_t AllocateBatch(size_t size_class, uint64_t *out, size_t n);
+
+  /**
+   * @brief 批量将同一规格的块归还到空闲链表
+   *
+   * @param size_class 规格
+   * @param offsets 需要归还的偏移量
+   * @param n 数量
+   */
+  void DeallocateBatch(size_t size_class, const uint64_t *offsets, size_t n);
+
+  /**
+   * @brief 获取偏移量对应的块可用的字节数
+   *
+   * @param offset Allocate 返回的偏移量
+   * @return size_t 可用的字节数，偏移量无效时返回0
+   */
+  size_t UsableSize(uint64_t offset) const;
+
+  /**
+   * @brief 获取偏移量所属的小对象规格
+   *
+   * @param offset Allocate 返回的偏移量
+   * @return size_t 规格，大对象或者偏移量无效时返回 kShmHeapNumSizeClasses
+   */
+  size_t SizeClassOf(uint64_t offset) const;
+
+  /**
+   * @brief 获取堆的使用情况
+   *
+   * @return ShmHeapStats 统计信息
+   */
+  ShmHeapStats Stats();
+
+  /**
+   * @brief 偏移量转换为本进程中的地址
+   *
+   * @param offset 偏移量
+   * @return void* 地址，偏移量为 kShmNullOffset 时返回 nullptr
+   */
+  inline void *ToPtr(uint64_t offset) {
+    return offset == kShmNullOffset ? nullptr : reinterpret_cast<char *>(this) + offset;
+  }
+
+  /**
+   * @brief 本进程中的地址转换为偏移量
+   *
+   * @param ptr 地址
+   * @return uint64_t 偏移量，ptr 为 nullptr 时返回 kShmNullOffset
+   */
+  inline uint64_t ToOffset(const void *ptr) const {
+    return ptr == nullptr ? kShmNullOffset
+                          : static_cast<uint64_t>(reinterpret_cast<const char *>(ptr) -
+                                                  reinterpret_cast<const char *>(this));
+  }
+
+  /**
+   * @brief 获取请求大小对应的小对象规格
+   *
+   * @param size 请求的字节数
+   * @return size_t 规格，超过 kShmHeapMaxSmallSize 时返回 kShmHeapNumSizeClasses
+   */
+  static size_t SizeClassFor(size_t size);
+
+  /**
+   * @brief 获取规格对应的块大小
+   *
+   * @param size_class 规格
+   * @return size_t 块大小
+   */
+  static size_t ClassSize(size_t size_class);
+
+  uint64_t magic;                                  /**< 初始化完成的标记 */
+  uint64_t total_size;                             /**< 共享内存的总大小 */
+  uint64_t chunk_count;                            /**< chunk 的数量 */
+  uint64_t data_offset;                            /**< 第一个 chunk 的偏移量 */
+  ShmMutex lock;                                   /**< 保护以下所有字段的锁 */
+  uint32_t partial_chunks[kShmHeapNumSizeClasses]; /**< 每个规格未满 chunk 链表的头，下标 + 1 */
+  uint64_t used_bytes;                             /**< 已经分出去的字节数 */
+  uint64_t chunks_in_use;                          /**< 已经被使用的chunk数量 */
+
+ private:
+  /**
+   * @brief 获取 chunk 的元信息数组，紧跟在本结构体后面
+   *
+   */
+  inline ShmHeapChunk *Chunks() { return reinterpret_cast<ShmHeapChunk *>(this + 1); }
+
+  inline const ShmHeapChunk *Chunks() const {
+    return reinterpret_cast<const ShmHeapChunk *>(this + 1);
+  }
+
+  /**
+   * @brief 找到 n 个连续的空闲 chunk 并标记为 kind，需要持有锁
+   *
+   * @return uint64_t 第一个 chunk 的下标，失败时返回 chunk_count
+   */
+  uint64_t TakeChunks(uint64_t n, uint32_t kind);
+
+  /**
+   * @brief 从某个规格的未满 chunk 中取出一个块，没有未满的 chunk 时启用新的chunk，需要持有锁
+   *
+   */
+  uint64_t PopBlock(size_t size_class);
+
+  /**
+   * @brief 将块放回所在 chunk 的空闲链表，chunk 变空时归还，需要持有锁
+   *
+   */
+  void PushBlock(size_t size_class, uint64_t offset);
+
+  /**
+   * @brief 将 chunk 加入某个规格的未满 chunk 链表的头部，需要持有锁
+   *
+   */
+  void LinkPartial(size_t size_class, uint64_t idx);
+
+  /**
+   * @brief 将 chunk 从某个规格的未满 chunk 链表中移除，需要持有锁
+   *
+   */
+  void UnlinkPartial(size_t size_class, uint64_t idx);
+
+  /**
+   * @brief 获取 chunk 的起始偏移量
+   *
+   */
+  inline uint64_t ChunkOffset(uint64_t idx) const { return data_offset + idx * kShmHeapChunkSize; }
+
+  /**
+   * @brief 获取偏移量所在的 chunk 下标
+   *
+   */
+  inline uint64_t ChunkIndex(uint64_t offset) const {
+    return (offset - data_offset) / kShmHeapChunkSize;
+  }
+};
+
+/**
+ * @brief 共享内存堆，在一块大的共享内存中分配变长对象
+ *
+ * 所有对象都位于同一个 ShmHandle 中，只占用一个文件描述符和一段映射，
+ * 分配结果是相对于共享内存首地址的偏移量，可以存放在共享内存中并在任意进程里使用。
+ *
+ * 每个 ShmHeap 对象为小对象维护一份进程本地的缓存，大部分分配和释放都不需要获取
+ * 共享的锁。因此一个 ShmHeap 对象不能被多个线程同时使用，每个线程应当各自构造一个。
+ * 析构时缓存会归还给共享的堆；进程异常退出时缓存中的块会泄漏。
+ */
+class ShmHeap {
+ public:
+  /**
+   * @brief 构造一个 ShmHeap 对象
+   *
+   * @param name 堆的名字
+   * @param size 共享内存的总大小，单位（字节）
+   */
+  ShmHeap(const std::string &name, size_t size);
+
+  /**
+   * @brief 析构 ShmHeap 对象，将本地缓存归还给共享的堆
+   *
+   */
+  ~ShmHeap();
+
+  LIBSHMLITE_NO_COPYABLE(ShmHeap)
+
+  /**
+   * @brief 分配内存
+   *
+   * @param size 需要的字节数
+   * @return uint64_t 分配得到的偏移量，失败时返回 kShmNullOffset
+   */
+  uint64_t Allocate(size_t size);
+
+  /**
+   * @brief 释放内存
+   *
+   * @param offset Allocate 返回的偏移量
+   */
+  void Deallocate(uint64_t offset);
+
+  /**
+   * @brief 将本地缓存全部归还给共享的堆
+   *
+   */
+  void FlushCache();
+
+  /**
+   * @brief 偏移量转换为本进程中的地址
+   *
+   * @param offset 偏移量
+   * @return void* 地址
+   */
+  inline void *ToPtr(uint64_t offset) const { return arena_->ToPtr(offset); }
+
+  /**
+   * @brief 偏移量转换为本进程中的指定类型的指针
+   *
+   * @tparam T 指针类型
+   * @param offset 偏移量
+   * @return T* 指针
+   */
+  template <typename T>
+  inline T *Ptr(uint64_t offset) const {
+    return static_cast<T *>(arena_->ToPtr(offset));
+  }
+
+  /**
+   * @brief 本进程中的地址转换为偏移量
+   *
+   * @param ptr 地址
+   * @return uint64_t 偏移量
+   */
+  inline uint64_t ToOffset(const void *ptr) const { return arena_->ToOffset(ptr); }
+
+  /**
+   * @brief 获取堆的使用情况
+   *
+   * @return ShmHeapStats 统计信息
+   */
+  ShmHeapStats Stats() const { return arena_->Stats(); }
+
+  /**
+   * @brief 获取共享的堆控制信息
+   *
+   * @return ShmHeapArena* 控制信息
+   */
+  inline ShmHeapArena *Arena() const { return arena_; }
+
+  /**
+   * @brief 检测堆是否有效
+   *
+   * @return true 有效
+   * @return false 无效
+   */
+  inline bool IsValid() const { return arena_ != nullptr; }
+
+ private:
+  static constexpr size_t kCacheBatch = 32; /**< 本地缓存每次与共享的堆交换的块数量 */
+
+  std::shared_ptr<ShmHandle> handle_;                  /**< 底层的 ShmHandle 对象指针 */
+  ShmHeapArena *arena_ = nullptr;                      /**< 共享的堆控制信息 */
+  std::vector<uint64_t> cache_[kShmHeapNumSizeClasses]; /**< 每个规格的进程本地缓存 */
+};
+
+}  // namespace shmlite
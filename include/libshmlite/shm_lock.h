@@ -2,8 +2,13 @@
 
 #include <fcntl.h>
 #include <semaphore.h>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
 
 #include "common_utils.h"
+#include "shm_handle.h"
 
 namespace shmlite {
 
@@ -11,10 +16,44 @@ namespace shmlite {
 constexpr const char *kShmLockNamePrefix =
     "/lsmll-"; /**< 命名信号量名字的前缀，必须以/开头。libshmlitelock 缩写为 lsmll */
 
+constexpr const char *kShmLockStatsSuffix = ".stats"; /**< 竞争统计所在共享内存的名字后缀 */
+
+/**
+ * @brief 锁的竞争统计，时间的单位为纳秒
+ *
+ */
+struct ShmLockStats {
+  uint64_t acquisitions = 0;  /**< 成功获取的次数 */
+  uint64_t contended = 0;     /**< 需要等待才获取到的次数 */
+  uint64_t timeouts = 0;      /**< TryWait 失败和 WaitFor 超时的次数 */
+  uint64_t total_wait_ns = 0; /**< 等待的总时间 */
+  uint64_t max_wait_ns = 0;   /**< 单次等待的最长时间 */
+  uint64_t total_hold_ns = 0; /**< 持有的总时间 */
+  uint64_t max_hold_ns = 0;   /**< 单次持有的最长时间 */
+};
+
+/**
+ * @brief 共享内存中的竞争统计，全零即为初始状态
+ *
+ */
+struct ShmLockCounters {
+  std::atomic<uint64_t> acquisitions;
+  std::atomic<uint64_t> contended;
+  std::atomic<uint64_t> timeouts;
+  std::atomic<uint64_t> total_wait_ns;
+  std::atomic<uint64_t> max_wait_ns;
+  std::atomic<uint64_t> total_hold_ns;
+  std::atomic<uint64_t> max_hold_ns;
+};
+
 /**
  * @brief 对POSIX下的命名信号量的封装
  *
- * 封装POSIX下的命名信号量的基础操作
+ * 封装POSIX下的命名信号量的基础操作。
+ *
+ * 开启竞争统计之后，统计数据保存在名为 name + ".stats" 的共享内存中，所有使用同一个锁的进程
+ * 共同累加，任何进程都可以通过 ReadStats 读取。持有时间从本对象获取成功开始、到本对象 Post 为止，
+ * 只在同一个对象上成对地 Wait/Post 时才有意义。
  */
 class ShmLock : public NamedClass {
  public:
@@ -27,6 +66,16 @@ class ShmLock : public NamedClass {
    */
   static bool UnLink(const std::string &name);
 
+  /**
+   * @brief 读取指定锁的竞争统计
+   *
+   * @param name 信号量的名字
+   * @param stats 读到的统计
+   * @return true 读取成功
+   * @return false 该锁没有开启竞争统计
+   */
+  static bool ReadStats(const std::string &name, ShmLockStats &stats);
+
   LIBSHMLITE_NO_COPYABLE(ShmLock)
 
   /**
@@ -34,9 +83,11 @@ class ShmLock : public NamedClass {
    *
    * @param name 命名信号量的名字
    * @param value 信号量的初始值
-   * @param auto_unlink 析构时是否自动删除信号量文件
+   * @param auto_unlink 析构时是否自动删除信号量文件（以及竞争统计）
+   * @param enable_stats 是否开启竞争统计
    */
-  explicit ShmLock(std::string name, unsigned int value = 1, bool auto_unlink = false);
+  explicit ShmLock(std::string name, unsigned int value = 1, bool auto_unlink = false,
+                   bool enable_stats = false);
 
   /**
    * @brief 析构函数
@@ -56,6 +107,48 @@ class ShmLock : public NamedClass {
    */
   void Wait();
 
+  /**
+   * @brief 尝试获取资源，不会阻塞
+   *
+   * @return true 获取成功
+   * @return false 资源已被占用
+   */
+  bool TryWait();
+
+  /**
+   * @brief 获取资源，最多等待 timeout
+   *
+   * 截止时间基于 CLOCK_MONOTONIC（sem_clockwait）计算，不受系统时间调整的影响；glibc 2.30
+   * 之前没有 sem_clockwait，只能退回 CLOCK_REALTIME 的 sem_timedwait，等待期间系统时间被调整时
+   * 实际的等待时间会相应地变长或者变短。
+   *
+   * @param timeout 相对超时时间
+   * @return true 获取成功
+   * @return false 超时
+   */
+  bool WaitFor(const struct timespec &timeout);
+
+  /**
+   * @brief 获取当前的竞争统计
+   *
+   * @return ShmLockStats 统计，没有开启竞争统计时全为 0
+   */
+  ShmLockStats GetStats() const;
+
+  /**
+   * @brief 清零竞争统计
+   *
+   */
+  void ResetStats();
+
+  /**
+   * @brief 是否开启了竞争统计
+   *
+   * @return true 已开启
+   * @return false 未开启
+   */
+  inline bool IsStatsEnabled() const { return stats_ != nullptr; }
+
   /**
    * @brief 获取信号量当前的值
    *
@@ -79,8 +172,18 @@ class ShmLock : public NamedClass {
   inline sem_t *SemPtr() const { return sem_ptr_; }
 
  private:
+  /**
+   * @brief 记录一次成功的获取
+   *
+   * @param wait_start_ns 开始等待的时间，为 0 表示没有等待
+   */
+  void RecordAcquire(uint64_t wait_start_ns);
+
   sem_t *sem_ptr_ = nullptr; /**< 信号量描述符 */
   bool auto_unlink_;         /**< 析构时是否自动删除信号量文件 */
+  std::unique_ptr<ShmHandle> stats_handle_; /**< 竞争统计所在的共享内存 */
+  ShmLockCounters *stats_ = nullptr;        /**< 竞争统计，未开启时为 nullptr */
+  uint64_t acquired_at_ns_ = 0;             /**< 本对象最近一次获取成功的时间 */
 };
 
 }  // namespace shmlite
\ No newline at end of file
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <atomic>
+#include <cstdint>
+
+#include "common_utils.h"
+#include "futex_utils.h"
+
+namespace shmlite {
+
+/**
+ * @brief 放置在共享内存中的进程间互斥锁
+ *
+ * 与 @ref ShmLock "ShmLock" 不同，ShmMutex 不依赖命名信号量文件，而是直接位于
+ * ShmHandle 映射出来的共享内存中。实现为一个原子字：无竞争时只需一次CAS，不会陷入内核；
+ * 有竞争时先进行自适应自旋，自旋失败再通过 FUTEX_WAIT/FUTEX_WAKE 睡眠和唤醒。
+ *
+ * 全零的字节即为未上锁状态，因此新创建的共享内存（ftruncate 得到的全零页）可以直接
+ * reinterpret_cast 为 ShmMutex 使用，已经存在的锁不能再次构造，否则会破坏其状态。
+ */
+class ShmMutex {
+ public:
+  ShmMutex() = default;
+
+  LIBSHMLITE_NO_COPYABLE(ShmMutex)
+
+  /**
+   * @brief 上锁，无竞争时不会进入内核
+   *
+   */
+  inline void Lock() {
+    uint32_t expected = kUnlocked;
+    if (!state_.compare_exchange_strong(expected, kLocked, std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+      LockSlow();
+    }
+  }
+
+  /**
+   * @brief 尝试上锁，不会阻塞
+   *
+   * @return true 上锁成功
+   * @return false 锁已经被占用
+   */
+  inline bool TryLock() {
+    uint32_t expected = kUnlocked;
+    return state_.compare_exchange_strong(expected, kLocked, std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief 解锁，只有存在等待者时才会调用 FUTEX_WAKE
+   *
+   */
+  inline void Unlock() {
+    if (state_.exchange(kUnlocked, std::memory_order_release) == kContended) {
+      FutexWake(&state_, 1);
+    }
+  }
+
+  /**
+   * @brief 检查锁是否被占用，仅用于调试
+   *
+   * @return true 已被占用
+   * @return false 未被占用
+   */
+  inline bool IsLocked() const { return state_.load(std::memory_order_relaxed) != kUnlocked; }
+
+ private:
+  /**
+   * @brief 上锁的慢路径：自适应自旋后进入futex等待
+   *
+   */
+  void LockSlow();
+
+  static constexpr uint32_t kUnlocked = 0;  /**< 未上锁 */
+  static constexpr uint32_t kLocked = 1;    /**< 已上锁，没有等待者 */
+  static constexpr uint32_t kContended = 2; /**< 已上锁，可能有等待者 */
+
+  std::atomic<uint32_t> state_{kUnlocked}; /**< 锁状态，同时作为futex字 */
+  std::atomic<uint32_t> spin_{0};          /**< 自适应自旋次数的估计值，由所有进程共享 */
+};
+
+static_assert(sizeof(ShmMutex) == 8, "ShmMutex layout must stay stable across processes");
+
+/**
+ * @brief ShmMutex 的RAII封装，构造时上锁，析构时解锁
+ *
+ */
+class ShmMutexGuard {
+ public:
+  explicit ShmMutexGuard(ShmMutex &mutex) : mutex_(mutex) { mutex_.Lock(); }
+
+  ~ShmMutexGuard() { mutex_.Unlock(); }
+
+  LIBSHMLITE_NO_COPYABLE(ShmMutexGuard)
+
+ private:
+  ShmMutex &mutex_;
+};
+
+/**
+ * @brief 放置在共享内存中的健壮（robust）进程间互斥锁
+ *
+ * 持有 ShmLock 或 ShmMutex 的进程崩溃后，锁永远不会被释放。ShmRobustMutex 基于
+ * PTHREAD_PROCESS_SHARED + PTHREAD_MUTEX_ROBUST 的 pthread 互斥锁：锁字中记录了持有者的
+ * TID，并挂在持有线程的 robust futex 链表上；持有者退出时由内核立即标记 FUTEX_OWNER_DIED
+ * 并唤醒一个等待者，无需看门狗超时。无竞争时的加解锁依然只是一次用户态的CAS。
+ *
+ * 下一个获取到锁的进程会得到 @ref LockStatus "OWNER_DIED"，此时它已经持有锁，
+ * 应当修复被保护的数据后调用 MarkConsistent()，再正常 Unlock()；
+ * 如果不调用 MarkConsistent() 就解锁，锁会变成永久不可用（NOT_RECOVERABLE）。
+ *
+ * 与 ShmMutex 一样，全零的字节即为可用状态，第一次使用时会自动完成初始化。初始化者的 PID
+ * 与初始化状态记录在同一个字中，初始化者中途退出时等待者会接管初始化；存活检查使用
+ * kill(pid, 0)，共享这把锁的进程必须位于同一个 PID 命名空间中。
+ */
+class ShmRobustMutex {
+ public:
+  /**
+   * @brief 上锁操作的结果
+   *
+   */
+  enum LockStatus {
+    OK = 0,          /**< 上锁成功 */
+    OWNER_DIED,      /**< 上锁成功，但上一个持有者已经死亡，被保护的数据可能不一致 */
+    BUSY,            /**< 锁已经被占用（仅 TryLock） */
+    NOT_RECOVERABLE, /**< 锁已经不可恢复 */
+    ERROR,           /**< 其它错误 */
+  };
+
+  ShmRobustMutex() = default;
+
+  LIBSHMLITE_NO_COPYABLE(ShmRobustMutex)
+
+  /**
+   * @brief 上锁
+   *
+   * @return 上锁结果，OK 或 OWNER_DIED 时表示已经持有锁
+   */
+  inline LockStatus Lock() {
+    EnsureInit();
+    return ToStatus(pthread_mutex_lock(&mutex_));
+  }
+
+  /**
+   * @brief 尝试上锁，不会阻塞
+   *
+   * @return 上锁结果，OK 或 OWNER_DIED 时表示已经持有锁
+   */
+  inline LockStatus TryLock() {
+    EnsureInit();
+    return ToStatus(pthread_mutex_trylock(&mutex_));
+  }
+
+  /**
+   * @brief 解锁
+   *
+   */
+  inline void Unlock() { pthread_mutex_unlock(&mutex_); }
+
+  /**
+   * @brief 在得到 OWNER_DIED 并修复数据之后，将锁标记为一致状态
+   *
+   * @return true 标记成功
+   * @return false 标记失败
+   */
+  bool MarkConsistent();
+
+  /**
+   * @brief 获取当前持有者的TID
+   *
+   * @return 持有者的TID，没有持有者时返回0
+   */
+  pid_t GetOwnerTid() const;
+
+ private:
+  /**
+   * @brief 保证底层 pthread 互斥锁已经初始化
+   *
+   */
+  inline void EnsureInit() {
+    if (init_state_.load(std::memory_order_acquire) != kInitialized) {
+      InitSlow();
+    }
+  }
+
+  /**
+   * @brief 初始化底层 pthread 互斥锁，多个进程同时调用时只会初始化一次，
+   * 初始化者退出时由一个等待者接管
+   *
+   */
+  void InitSlow();
+
+  /**
+   * @brief 将 pthread 的返回值转换为 LockStatus
+   *
+   * @param ret pthread_mutex_* 的返回值
+   * @return LockStatus
+   */
+  static LockStatus ToStatus(int ret);
+
+  static constexpr uint32_t kUninitialized = 0; /**< 未初始化 */
+  static constexpr uint32_t kInitializing = 1;  /**< 正在初始化，高位是初始化者的 PID */
+  static constexpr uint32_t kInitialized = 2;   /**< 已经初始化 */
+
+  std::atomic<uint32_t> init_state_{kUninitialized}; /**< 初始化状态，参考 kInitializing */
+  pthread_mutex_t mutex_;                            /**< 底层的 robust pthread 互斥锁 */
+};
+
+}  // namespace shmlite
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+namespace shmlite {
+
+/**
+ * @brief 与位置无关的指针，可以存放在共享内存中
+ *
+ * 同一块共享内存在不同进程中可能被映射到不同的地址，普通指针存放在共享内存中后，
+ * 在其它进程里就失效了。shm_offset_ptr 存放的是目标地址相对于自身地址的偏移量，
+ * 只要指针和目标位于同一块映射内，在任何进程中都能正确地解引用。
+ *
+ * 存放的值为 目标地址 - 自身地址 + 1，因此：
+ *  - 全零的字节就是空指针，新创建的共享内存中的 shm_offset_ptr 都是空指针；
+ *  - 指向自身的指针（例如循环链表的哨兵节点）也可以表示；
+ *  - 解引用只需要一次加法（一条 lea 指令），与普通指针一样快。
+ *
+ * 由于存放的是相对地址，shm_offset_ptr 的拷贝构造和赋值会根据新的位置重新计算偏移量。
+ *
+ * @tparam T 指向的类型
+ */
+template <typename T>
+class shm_offset_ptr {
+ public:
+  using element_type = T;
+  using value_type = typename std::remove_cv<T>::type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = T *;
+  using reference = typename std::add_lvalue_reference<T>::type;
+  using iterator_category = std::random_access_iterator_tag;
+
+  template <typename U>
+  using rebind = shm_offset_ptr<U>;
+
+  /**
+   * @brief 构造空指针
+   *
+   */
+  shm_offset_ptr() noexcept : offset_(kNull) {}
+
+  shm_offset_ptr(std::nullptr_t) noexcept : offset_(kNull) {}
+
+  /**
+   * @brief 从普通指针构造
+   *
+   * @param ptr 普通指针
+   */
+  shm_offset_ptr(T *ptr) noexcept : offset_(Encode(ptr)) {}
+
+  shm_offset_ptr(const shm_offset_ptr &other) noexcept : offset_(Encode(other.get())) {}
+
+  /**
+   * @brief 从可以隐式转换的其它类型的 shm_offset_ptr 构造
+   *
+   */
+  template <typename U, typename std::enable_if<std::is_convertible<U *, T *>::value, int>::type = 0>
+  shm_offset_ptr(const shm_offset_ptr<U> &other) noexcept
+      : offset_(Encode(static_cast<T *>(other.get()))) {}
+
+  /**
+   * @brief 从只能显式转换的其它类型的 shm_offset_ptr 构造，例如 void 转换为具体类型
+   *
+   */
+  template <typename U,
+            typename std::enable_if<!std::is_convertible<U *, T *>::value, int>::type = 0>
+  explicit shm_offset_ptr(const shm_offset_ptr<U> &other) noexcept
+      : offset_(Encode(static_cast<T *>(other.get()))) {}
+
+  shm_offset_ptr &operator=(const shm_offset_ptr &other) noexcept {
+    offset_ = Encode(other.get());
+    return *this;
+  }
+
+  shm_offset_ptr &operator=(T *ptr) noexcept {
+    offset_ = Encode(ptr);
+    return *this;
+  }
+
+  shm_offset_ptr &operator=(std::nullptr_t) noexcept {
+    offset_ = kNull;
+    return *this;
+  }
+
+  /**
+   * @brief 获取普通指针
+   *
+   * @return T* 普通指针，空指针时返回 nullptr
+   */
+  T *get() const noexcept { return offset_ == kNull ? nullptr : Decode(); }
+
+  /**
+   * @brief 解引用，不检查空指针，只需要一次加法
+   *
+   */
+  reference operator*() const noexcept { return *Decode(); }
+
+  T *operator->() const noexcept { return Decode(); }
+
+  template <typename U = T>
+  U &operator[](difference_type n) const noexcept {
+    return Decode()[n];
+  }
+
+  explicit operator bool() const noexcept { return offset_ != kNull; }
+
+  /**
+   * @brief 供 std::pointer_traits 使用，获取指向 r 的指针
+   *
+   */
+  template <typename U = T>
+  static shm_offset_ptr pointer_to(U &r) noexcept {
+    return shm_offset_ptr(&r);
+  }
+
+  shm_offset_ptr &operator+=(difference_type n) noexcept {
+    offset_ += n * static_cast<difference_type>(sizeof(T));
+    return *this;
+  }
+
+  shm_offset_ptr &operator-=(difference_type n) noexcept {
+    offset_ -= n * static_cast<difference_type>(sizeof(T));
+    return *this;
+  }
+
+  shm_offset_ptr &operator++() noexcept { return *this += 1; }
+
+  shm_offset_ptr &operator--() noexcept { return *this -= 1; }
+
+  shm_offset_ptr operator++(int) noexcept {
+    shm_offset_ptr tmp(*this);
+    ++*this;
+    return tmp;
+  }
+
+  shm_offset_ptr operator--(int) noexcept {
+    shm_offset_ptr tmp(*this);
+    --*this;
+    return tmp;
+  }
+
+  friend shm_offset_ptr operator+(const shm_offset_ptr &p, difference_type n) noexcept {
+    return shm_offset_ptr(p.get() + n);
+  }
+
+  friend shm_offset_ptr operator+(difference_type n, const shm_offset_ptr &p) noexcept {
+    return shm_offset_ptr(p.get() + n);
+  }
+
+  friend shm_offset_ptr operator-(const shm_offset_ptr &p, difference_type n) noexcept {
+    return shm_offset_ptr(p.get() - n);
+  }
+
+  friend difference_type operator-(const shm_offset_ptr &a, const shm_offset_ptr &b) noexcept {
+    return a.get() - b.get();
+  }
+
+  friend bool operator==(const shm_offset_ptr &a, const shm_offset_ptr &b) noexcept {
+    return a.get() == b.get();
+  }
+
+  friend bool operator!=(const shm_offset_ptr &a, const shm_offset_ptr &b) noexcept {
+    return a.get() != b.get();
+  }
+
+  friend bool operator<(const shm_offset_ptr &a, const shm_offset_ptr &b) noexcept {
+    return a.get() < b.get();
+  }
+
+  friend bool operator>(const shm_offset_ptr &a, const shm_offset_ptr &b) noexcept {
+    return a.get() > b.get();
+  }
+
+  friend bool operator<=(const shm_offset_ptr &a, const shm_offset_ptr &b) noexcept {
+    return a.get() <= b.get();
+  }
+
+  friend bool operator>=(const shm_offset_ptr &a, const shm_offset_ptr &b) noexcept {
+    return a.get() >= b.get();
+  }
+
+  friend bool operator==(const shm_offset_ptr &a, std::nullptr_t) noexcept { return !a; }
+
+  friend bool operator!=(const shm_offset_ptr &a, std::nullptr_t) noexcept {
+    return static_cast<bool>(a);
+  }
+
+ private:
+  static constexpr difference_type kNull = 0; /**< 空指针的编码 */
+
+  /**
+   * @brief 将目标地址编码为相对于自身的偏移量
+   *
+   */
+  difference_type Encode(const volatile void *ptr) const noexcept {
+    if (ptr == nullptr) {
+      return kNull;
+    }
+    return reinterpret_cast<intptr_t>(ptr) - reinterpret_cast<intptr_t>(this) + 1;
+  }
+
+  /**
+   * @brief 将偏移量解码为目标地址，不处理空指针
+   *
+   */
+  T *Decode() const noexcept {
+    return reinterpret_cast<T *>(reinterpret_cast<intptr_t>(this) + offset_ - 1);
+  }
+
+  difference_type offset_; /**< 目标地址 - 自身地址 + 1，0 表示空指针 */
+};
+
+}  // namespace shmlite
@@ -3,14 +3,69 @@
 #include <memory>
 #include <unordered_map>
 #include "common_utils.h"
+#include "container/shm_hash_map.hpp"
 #include "shm_handle.h"
+#include "shm_heap.h"
+#include "shm_segment.h"
+#include "shm_seq_var.hpp"
 
 namespace shmlite {
 using ShmHandleMap = std::unordered_map<std::string, std::shared_ptr<ShmHandle>>;
 
+constexpr size_t kShmVarNameMax = 63; /**< 聚合模式下变量名的最大长度 */
+
+/**
+ * @brief 聚合模式下目录中的变量名，定长以便存放在共享内存中
+ *
+ */
+struct ShmVarName {
+  char data[kShmVarNameMax + 1]; /**< 以'\0'结尾的变量名 */
+};
+
+/**
+ * @brief 聚合模式下目录中记录的变量位置
+ *
+ */
+struct ShmVarEntry {
+  uint64_t offset;    /**< 变量在共享内存堆中的偏移量 */
+  uint64_t size;      /**< 变量的大小，单位（字节） */
+  uint64_t type_hash; /**< 变量类型的指纹，参考 ShmTypeHash */
+};
+
+/**
+ * @brief 变量名的哈希函数（FNV-1a），所有进程的结果一致
+ *
+ */
+struct ShmVarNameHash {
+  size_t operator()(const ShmVarName &name) const {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const char *p = name.data; *p != '\0'; ++p) {
+      h = (h ^ static_cast<unsigned char>(*p)) * 0x100000001b3ULL;
+    }
+    return static_cast<size_t>(h);
+  }
+};
+
+/**
+ * @brief 变量名的比较函数
+ *
+ */
+struct ShmVarNameEqual {
+  bool operator()(const ShmVarName &a, const ShmVarName &b) const {
+    return strncmp(a.data, b.data, sizeof(a.data)) == 0;
+  }
+};
+
+using ShmPoolDirectory = ShmHashMap<ShmVarName, ShmVarEntry, ShmVarNameHash, ShmVarNameEqual>;
+using ShmArenaVarMap = std::unordered_map<std::string, std::pair<void *, uint64_t>>;
+
 /**
  * @brief 共享内存变量池，提供统一的访问接口
  *
+ * 默认情况下每个变量对应一个独立的共享内存对象，每个变量至少占用一个文件描述符、
+ * 一段映射和一个内存页。调用 UseArena() 之后切换为聚合模式：所有变量都从同一个
+ * ShmHeap 中分配，变量名到偏移量的映射保存在共享内存中的目录（ShmHashMap）里，
+ * 任何进程都可以通过变量名以 O(1) 的代价找到变量。
  */
 class ShmPool {
  public:
@@ -23,39 +78,39 @@ class ShmPool {
    */
   template <typename T>
   static T *Get(const std::string &name) {
-    if (s_pool_.find(name) == s_pool_.end()) {
-      auto handle_ptr = std::make_shared<ShmHandle>(name, sizeof(T), ShmHandle::CREAT_RDWR, false);
-      if (!handle_ptr->IsValid()) {
-        return nullptr;
-      }
-      T *val_ptr = static_cast<T *>(handle_ptr->Ptr());
-      s_pool_[name] = handle_ptr;
-      return val_ptr;
+    if (s_heap_ != nullptr) {
+      return GetFromArena<T>(name, nullptr);
     }
-    return static_cast<T *>(s_pool_[name]->Ptr());
+    return GetFromSegment<T>(name, nullptr);
   }
 
   /**
    * @brief 从共享内存中获取基础类型变量
    * @tparam              T 基础类型
    * @param name          共享内存变量名称
-   * @param default_value 指定该变量的初始值
+   * @param default_value 指定该变量的初始值，只在变量第一次创建时生效，不会覆盖已有的值
    * @return              共享内存的指针
    */
   template <typename T>
   static T *Get(const std::string &name, T default_value) {
-    T *val_ptr = nullptr;
-    if (s_pool_.find(name) == s_pool_.end()) { /* 先前还没有获取过这个变量 */
-      /* 去共享内存拿 */
-      auto handle_ptr = std::make_shared<ShmHandle>(name, &default_value, sizeof(T), false);
-      if (!handle_ptr->IsValid()) { /* 创建失败直接返回nullptr */
-        return nullptr;
-      }
-      val_ptr = static_cast<T *>(handle_ptr->Ptr());
-      s_pool_[name] = handle_ptr;
-      return val_ptr;
+    if (s_heap_ != nullptr) {
+      return GetFromArena<T>(name, &default_value);
     }
-    return static_cast<T *>(s_pool_[name]->Ptr());
+    return GetFromSegment<T>(name, &default_value);
+  }
+
+  /**
+   * @brief 从共享内存中获取由 seqlock 保护的变量，读者不会读到被写了一半的值
+   *
+   * 变量第一次创建时初始化为全零，版本为 0。
+   *
+   * @tparam T    变量的类型，必须可以平凡拷贝
+   * @param name  共享内存变量名称
+   * @return ShmSeqVar<T> 变量，获取失败时 IsValid() 为 false
+   */
+  template <typename T>
+  static ShmSeqVar<T> GetSeqVar(const std::string &name) {
+    return ShmSeqVar<T>(Get<ShmSeqCell<T>>(name));
   }
 
   /**
@@ -72,6 +127,38 @@ class ShmPool {
     return nullptr;
   }
 
+  /**
+   * @brief 切换为聚合模式，之后通过 Get 获取的变量都放在同一个共享内存堆中
+   *
+   * 使用同一组参数调用的所有进程共享同一批变量。切换之前已经获取的变量不受影响。
+   *
+   * @param arena_name  共享内存堆的名字，目录的名字为 arena_name + ".dir"
+   * @param arena_size  共享内存堆的大小，单位（字节）
+   * @param max_vars    最多能存放的变量数量
+   * @return true 切换成功
+   * @return false 切换失败，依然使用每个变量一个共享内存对象的模式
+   */
+  static bool UseArena(const std::string &arena_name, size_t arena_size, size_t max_vars) {
+    std::unique_ptr<ShmHeap> heap(new ShmHeap(arena_name, arena_size));
+    std::unique_ptr<ShmPoolDirectory> dir(new ShmPoolDirectory(arena_name + ".dir", max_vars));
+    if (!heap->IsValid() || !dir->IsValid()) {
+      SIMPLE_ERROR("Can not use shm pool arena " << arena_name);
+      return false;
+    }
+    s_arena_vars_.clear();
+    s_heap_ = std::move(heap);
+    s_dir_ = std::move(dir);
+    return true;
+  }
+
+  /**
+   * @brief 检查是否处于聚合模式
+   *
+   * @return true 聚合模式
+   * @return false 每个变量一个共享内存对象的模式
+   */
+  static bool IsArenaMode() { return s_heap_ != nullptr; }
+
   LIBSHMLITE_NO_COPYABLE(ShmPool)
 
  private:
@@ -81,11 +168,113 @@ class ShmPool {
    */
   ShmPool() = default;
 
+  /**
+   * @brief 获取独占一个共享内存对象的变量，变量位于段头部之后
+   *
+   * 第一次获取时校验段头部中记录的类型，之后从 s_pool_ 中取出时只比较类型指纹。
+   *
+   * @tparam T            基础类型
+   * @param name          共享内存变量名称
+   * @param default_value 变量第一次创建时的初始值，为 nullptr 时初始化为全零
+   * @return              共享内存的指针，失败或者类型不一致时返回 nullptr
+   */
+  template <typename T>
+  static T *GetFromSegment(const std::string &name, const T *default_value) {
+    auto it = s_pool_.find(name);
+    if (it != s_pool_.end()) { /* 先前已经获取过这个变量 */
+      ShmSegmentHeader *header = static_cast<ShmSegmentHeader *>(it->second->Ptr());
+      if (header->type_hash != ShmTypeHash<T>()) {
+        SIMPLE_ERROR("Shm pool variable " << name << " was got with another type");
+        return nullptr;
+      }
+      return SegmentData<T>(header);
+    }
+    auto handle_ptr =
+        std::make_shared<ShmHandle>(name, SegmentAllocSize<T>(1), ShmHandle::CREAT_RDWR, false);
+    if (!handle_ptr->IsValid()) { /* 创建失败直接返回nullptr */
+      return nullptr;
+    }
+    ShmSegmentHeader *header = static_cast<ShmSegmentHeader *>(handle_ptr->Ptr());
+    ShmSegmentInitializer init;
+    if (default_value != nullptr) {
+      init = [default_value](void *data) { memcpy(data, default_value, sizeof(T)); };
+    }
+    if (!IsSegmentUsable(AttachSegment(header, MakeSegmentLayout<T>(1), name, init))) {
+      return nullptr;
+    }
+    s_pool_[name] = handle_ptr;
+    return SegmentData<T>(header);
+  }
+
+  /**
+   * @brief 聚合模式下获取变量，变量不存在时在共享内存堆中分配
+   *
+   * 与独占段的模式一样，目录中记录了类型指纹，以另一种类型获取同名变量时失败。
+   *
+   * @tparam T            基础类型
+   * @param name          共享内存变量名称
+   * @param default_value 变量的初始值，为 nullptr 时初始化为全零
+   * @return              共享内存的指针，失败或者类型不一致时返回 nullptr
+   */
+  template <typename T>
+  static T *GetFromArena(const std::string &name, const T *default_value) {
+    auto it = s_arena_vars_.find(name);
+    if (it != s_arena_vars_.end()) {
+      if (it->second.second != ShmTypeHash<T>()) {
+        SIMPLE_ERROR("Shm pool variable " << name << " was got with another type");
+        return nullptr;
+      }
+      return static_cast<T *>(it->second.first);
+    }
+    if (name.size() > kShmVarNameMax) {
+      SIMPLE_ERROR("Shm pool variable name too long: " << name);
+      return nullptr;
+    }
+    ShmVarName key{};
+    memcpy(key.data, name.data(), name.size());
+    ShmVarEntry entry{};
+    /* 分配和登记在目录的写锁下完成，多个进程同时创建同一个变量时只会分配一次 */
+    bool ok = s_dir_->FindOrInsert(key,
+                                   [&](ShmVarEntry &out) {
+                                     out.offset = s_heap_->Allocate(sizeof(T));
+                                     out.size = sizeof(T);
+                                     out.type_hash = ShmTypeHash<T>();
+                                     if (out.offset == kShmNullOffset) {
+                                       return false;
+                                     }
+                                     if (default_value != nullptr) {
+                                       memcpy(s_heap_->ToPtr(out.offset), default_value, sizeof(T));
+                                     } else {
+                                       memset(s_heap_->ToPtr(out.offset), 0, sizeof(T));
+                                     }
+                                     return true;
+                                   },
+                                   entry);
+    if (!ok) {
+      SIMPLE_ERROR("Can not allocate shm pool variable " << name);
+      return nullptr;
+    }
+    if (entry.type_hash != ShmTypeHash<T>() || entry.size != sizeof(T)) {
+      SIMPLE_ERROR("Shm pool variable " << name << " holds another type (size " << entry.size
+                                        << ", requested " << sizeof(T) << ")");
+      return nullptr;
+    }
+    void *ptr = s_heap_->ToPtr(entry.offset);
+    s_arena_vars_[name] = std::make_pair(ptr, entry.type_hash);
+    return static_cast<T *>(ptr);
+  }
+
  private:
   static ShmHandleMap s_pool_; /**< 存放所有当前程序的共享内存ShmHandle对象键值对 */
+  static std::unique_ptr<ShmHeap> s_heap_;         /**< 聚合模式下的共享内存堆 */
+  static std::unique_ptr<ShmPoolDirectory> s_dir_; /**< 聚合模式下变量名到偏移量的目录 */
+  static ShmArenaVarMap s_arena_vars_; /**< 聚合模式下当前程序已经获取过的变量地址和类型指纹 */
 };
 
 ShmHandleMap ShmPool::s_pool_ = {};
+std::unique_ptr<ShmHeap> ShmPool::s_heap_;
+std::unique_ptr<ShmPoolDirectory> ShmPool::s_dir_;
+ShmArenaVarMap ShmPool::s_arena_vars_ = {};
 
 }  // namespace shmlite
 
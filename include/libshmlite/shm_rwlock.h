@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "common_utils.h"
+#include "shm_event.h"
+#include "shm_mutex.h"
+
+namespace shmlite {
+
+constexpr size_t kShmRwLockReaderSlots = 64; /**< 读者计数的槽数量，2的幂次 */
+
+/**
+ * @brief ShmRwLock 的偏好
+ *
+ */
+enum ShmRwLockPreference {
+  SHM_RWLOCK_PREFER_WRITER = 0, /**< 写者宣告之后新的读者等待，写者不会饿死 */
+  SHM_RWLOCK_PREFER_READER,     /**< 写者只有在没有读者时才能进入，读者吞吐更高但写者可能饿死 */
+};
+
+/**
+ * @brief 放置在共享内存中的读写锁
+ *
+ * 读者计数分散在 kShmRwLockReaderSlots 个独占缓存行的槽上（按当前 CPU 选择），
+ * 读者加解锁只修改自己的槽并读取写者标志，多个读者之间不会争抢同一个缓存行；
+ * 写者需要检查所有的槽，因此写锁的开销更大，适用于读多写少的场景。
+ *
+ * 写者之间通过 ShmMutex 互斥；读者和写者的等待都通过 ShmEvent 睡眠，没有等待者时解锁不会进入内核。
+ *
+ * 全零的字节即为未上锁、写者优先的状态，可以直接 reinterpret_cast 共享内存使用。
+ */
+class ShmRwLock {
+ public:
+  ShmRwLock() = default;
+
+  LIBSHMLITE_NO_COPYABLE(ShmRwLock)
+
+  /**
+   * @brief 设置偏好，应当在任何进程使用该锁之前设置
+   *
+   * @param preference 偏好
+   */
+  void SetPreference(ShmRwLockPreference preference) {
+    preference_.store(preference, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief 获取偏好
+   *
+   * @return ShmRwLockPreference 偏好
+   */
+  ShmRwLockPreference GetPreference() const {
+    return static_cast<ShmRwLockPreference>(preference_.load(std::memory_order_relaxed));
+  }
+
+  /**
+   * @brief 获取读锁
+   *
+   * @return size_t 读者使用的槽，解锁时传给 ReadUnlock
+   */
+  size_t ReadLock();
+
+  /**
+   * @brief 尝试获取读锁，有写者时立即返回
+   *
+   * @param slot 成功时为读者使用的槽，解锁时传给 ReadUnlock
+   * @return true 获取成功
+   * @return false 有写者持有或等待写锁
+   */
+  bool TryReadLock(size_t &slot);
+
+  /**
+   * @brief 释放读锁
+   *
+   * @param slot ReadLock 返回的槽
+   */
+  void ReadUnlock(size_t slot);
+
+  /**
+   * @brief 获取写锁
+   *
+   */
+  void WriteLock();
+
+  /**
+   * @brief 释放写锁
+   *
+   */
+  void WriteUnlock();
+
+  /**
+   * @brief 获取当前的读者数量，写者也用它判断已有的读者是否都已经退出
+   *
+   * @return uint32_t 读者数量
+   */
+  uint32_t Readers() const;
+
+ private:
+  /**
+   * @brief 读者计数的槽，独占一个缓存行
+   *
+   */
+  struct alignas(kCacheLineSize) ReaderSlot {
+    std::atomic<uint32_t> count; /**< 该槽上持有读锁的读者数量 */
+  };
+
+  /**
+   * @brief 尝试在 slot 上登记为读者，有写者时撤销登记
+   *
+   */
+  bool TryEnterRead(size_t slot);
+
+  alignas(kCacheLineSize) std::atomic<uint32_t> writer_{0}; /**< 非零表示写者持有或正在获取写锁 */
+  std::atomic<uint32_t> preference_{SHM_RWLOCK_PREFER_WRITER}; /**< 偏好 */
+  ShmMutex writer_mutex_;   /**< 写者之间的互斥 */
+  ShmEvent writer_event_;   /**< 写者等待读者退出 */
+  ShmEvent readers_event_;  /**< 读者等待写者退出 */
+  ReaderSlot slots_[kShmRwLockReaderSlots]; /**< 读者计数 */
+};
+
+static_assert(sizeof(ShmRwLock) == (kShmRwLockReaderSlots + 1) * kCacheLineSize,
+              "ShmRwLock layout must stay stable across processes");
+
+/**
+ * @brief ShmRwLock 读锁的RAII封装
+ *
+ */
+class ShmReadGuard {
+ public:
+  explicit ShmReadGuard(ShmRwLock &lock) : lock_(lock), slot_(lock_.ReadLock()) {}
+
+  ~ShmReadGuard() { lock_.ReadUnlock(slot_); }
+
+  LIBSHMLITE_NO_COPYABLE(ShmReadGuard)
+
+ private:
+  ShmRwLock &lock_;
+  size_t slot_;
+};
+
+/**
+ * @brief ShmRwLock 写锁的RAII封装
+ *
+ */
+class ShmWriteGuard {
+ public:
+  explicit ShmWriteGuard(ShmRwLock &lock) : lock_(lock) { lock_.WriteLock(); }
+
+  ~ShmWriteGuard() { lock_.WriteUnlock(); }
+
+  LIBSHMLITE_NO_COPYABLE(ShmWriteGuard)
+
+ private:
+  ShmRwLock &lock_;
+};
+
+}  // namespace shmlite
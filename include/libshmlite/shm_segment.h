@@ -0,0 +1,177 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "common_utils.h"
+
+namespace shmlite {
+
+constexpr uint32_t kShmSegmentMagic = 0x4c4d5348;  /**< "HSML"，libshmlite 段的魔数 */
+constexpr uint32_t kShmSegmentLayoutVersion = 1; /**< 段头部布局的版本，布局改变时加一 */
+
+/**
+ * @brief 段的初始化状态，取值特意避开小整数，旧格式或者损坏的段不会被误认为正在初始化
+ *
+ */
+enum ShmSegmentState : uint32_t {
+  SHM_SEGMENT_EMPTY = 0,                 /**< 新创建的全零段 */
+  SHM_SEGMENT_INITIALIZING = 0x54494e49, /**< 创建者正在写入头部和初始数据 */
+  SHM_SEGMENT_READY = 0x59444552,        /**< 头部和初始数据已经发布，可以校验 */
+  SHM_SEGMENT_ABANDONED = 0x4c494146,    /**< 初始化（例如从快照恢复）失败，段即将被删除 */
+};
+
+/**
+ * @brief 共享内存段的公共头部，位于段的开头，占用一个缓存行，之后是元素数据
+ *
+ * 第一个把 creator_pid 从 0 改为自己 PID 的进程负责写入头部和初始数据，完成后以
+ * release 语义发布 READY 并唤醒所有等待者；其它进程在 state 上 futex 等待，只在打开时
+ * 校验一次，之后的访问不再做任何检查。全零即为未初始化。
+ *
+ * 创建权由写入 PID 的那一次 CAS 决定，等待者从一开始就知道该检查哪个进程是否存活。存活检查
+ * 使用 kill(pid, 0)，只在同一个 PID 命名空间内有效：位于不同命名空间（例如不同容器）的进程
+ * 共享段时，PID 可能指向无关的进程，或者被误判为已经退出，这样的部署需要保证初始化不会与打开并发。
+ */
+struct alignas(kCacheLineSize) ShmSegmentHeader {
+  std::atomic<uint32_t> state;      /**< 初始化状态，参考 ShmSegmentState */
+  uint32_t magic;                   /**< 魔数 kShmSegmentMagic */
+  uint32_t version;                 /**< 布局版本 kShmSegmentLayoutVersion */
+  uint32_t header_size;             /**< 头部的大小，单位（字节） */
+  uint64_t type_hash;               /**< 元素类型的指纹，参考 ShmTypeHash */
+  uint64_t elem_size;               /**< 元素的大小，单位（字节） */
+  uint64_t elem_count;              /**< 元素个数 */
+  std::atomic<int32_t> creator_pid; /**< 负责初始化的进程，用于发现中途退出的创建者 */
+};
+
+static_assert(sizeof(ShmSegmentHeader) == kCacheLineSize, "ShmSegmentHeader must fill a cache line");
+
+/**
+ * @brief 期望的段布局，打开时与头部比较
+ *
+ */
+struct ShmSegmentLayout {
+  uint64_t type_hash;  /**< 元素类型的指纹 */
+  uint64_t elem_size;  /**< 元素的大小，单位（字节） */
+  uint64_t elem_count; /**< 元素个数 */
+};
+
+/**
+ * @brief 打开段的结果
+ *
+ */
+enum ShmSegmentStatus {
+  SHM_SEGMENT_CREATED = 0,   /**< 段是空的，由本次调用写入了头部 */
+  SHM_SEGMENT_ATTACHED,      /**< 段已经初始化，并且与期望的布局一致 */
+  SHM_SEGMENT_BAD_MAGIC,     /**< 不是 libshmlite 的段，或者已经损坏 */
+  SHM_SEGMENT_BAD_VERSION,   /**< 由不同布局版本的 libshmlite 创建 */
+  SHM_SEGMENT_TYPE_MISMATCH, /**< 元素类型不一致 */
+  SHM_SEGMENT_SIZE_MISMATCH, /**< 元素个数不一致 */
+  SHM_SEGMENT_INIT_FAILED,   /**< 创建者在初始化的过程中退出了，段需要删除后重建 */
+};
+
+/**
+ * @brief 段的初始化函数，参数为头部之后的数据，只会在创建段的进程中被调用一次，不能抛出异常
+ *
+ */
+using ShmSegmentInitializer = std::function<void(void *data)>;
+
+/**
+ * @brief FNV-1a 哈希，可以在编译期计算
+ *
+ * @param str 以'\0'结尾的字符串
+ * @param hash 初始值
+ * @return uint64_t 哈希值
+ */
+constexpr uint64_t ShmFnv1a(const char *str, uint64_t hash = 0xcbf29ce484222325ULL) {
+  return *str == '\0' ? hash
+                      : ShmFnv1a(str + 1, (hash ^ static_cast<unsigned char>(*str)) * 0x100000001b3ULL);
+}
+
+/**
+ * @brief 编译期计算的类型指纹，由类型名、大小和对齐得到
+ *
+ * 类型名取自 __PRETTY_FUNCTION__，不同的编译器拼写不同，共享同一个段的进程需要用同一种编译器构建。
+ *
+ * @tparam T 元素类型
+ * @return uint64_t 类型指纹
+ */
+template <typename T>
+constexpr uint64_t ShmTypeHash() {
+  return ShmFnv1a(__PRETTY_FUNCTION__) ^ (static_cast<uint64_t>(sizeof(T)) << 8) ^ alignof(T);
+}
+
+/**
+ * @brief 得到 count 个 T 类型元素的段布局
+ *
+ * @tparam T 元素类型
+ * @param count 元素个数
+ * @return ShmSegmentLayout 段布局
+ */
+template <typename T>
+constexpr ShmSegmentLayout MakeSegmentLayout(size_t count) {
+  return ShmSegmentLayout{ShmTypeHash<T>(), sizeof(T), count};
+}
+
+/**
+ * @brief 得到存放 count 个 T 类型元素的段的总大小，包括头部
+ *
+ * @tparam T 元素类型
+ * @param count 元素个数
+ * @return size_t 段的大小，单位（字节）
+ */
+template <typename T>
+constexpr size_t SegmentAllocSize(size_t count) {
+  return sizeof(ShmSegmentHeader) + sizeof(T) * count;
+}
+
+/**
+ * @brief 获取头部之后的元素数据
+ *
+ * @tparam T 元素类型
+ * @param header 段的头部
+ * @return T* 第一个元素的地址
+ */
+template <typename T>
+inline T *SegmentData(ShmSegmentHeader *header) {
+  return reinterpret_cast<T *>(header + 1);
+}
+
+/**
+ * @brief 把 creator_pid 从 0 改为当前进程的 PID，成功时由当前进程负责初始化段
+ *
+ * 成功之后 state 被置为 INITIALIZING，调用者写完头部和数据之后需要发布 READY 并唤醒等待者。
+ *
+ * @param header 段的头部
+ * @return true 当前进程获得了创建权
+ * @return false 段已经被其它进程声明
+ */
+bool ClaimSegment(ShmSegmentHeader *header);
+
+/**
+ * @brief 打开段：空段写入头部并调用 init 初始化数据，已经初始化的段校验头部
+ *
+ * 其它进程正在初始化时通过 futex 等待其完成，因此返回之后数据总是已经初始化好的；
+ * 多个进程同时打开时 init 只会执行一次。校验失败时打印具体的原因。
+ *
+ * @param header 段的头部
+ * @param layout 期望的布局
+ * @param name 段的名字，只用于日志
+ * @param init 初始化函数，为空时数据保持全零
+ * @return ShmSegmentStatus 结果，参考 IsSegmentUsable
+ */
+ShmSegmentStatus AttachSegment(ShmSegmentHeader *header, const ShmSegmentLayout &layout,
+                               const std::string &name, const ShmSegmentInitializer &init = nullptr);
+
+/**
+ * @brief 打开段的结果是否可以使用
+ *
+ * @param status AttachSegment 的结果
+ * @return true 可以使用
+ * @return false 布局不一致
+ */
+inline bool IsSegmentUsable(ShmSegmentStatus status) { return status <= SHM_SEGMENT_ATTACHED; }
+
+}  // namespace shmlite
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "common_utils.h"
+#include "futex_utils.h"
+#include "shm_handle.h"
+#include "shm_segment.h"
+
+namespace shmlite {
+
+/**
+ * @brief ShmSeqVar 在共享内存中的布局
+ *
+ * 按缓存行对齐并占满整数个缓存行，避免与相邻的变量伪共享。全零即为版本 0 的合法初始状态。
+ *
+ * @tparam T 变量的类型
+ */
+template <typename T>
+struct alignas(kCacheLineSize) ShmSeqCell {
+  std::atomic<uint64_t> seq; /**< 序号，奇数表示写者正在修改 */
+  T value;                   /**< 变量的值 */
+};
+
+/**
+ * @brief 由 seqlock 保护的共享变量
+ *
+ * 适用于大于一个机器字、被大量进程高频轮询的配置或状态快照。读者只读取序号和值，
+ * 不写任何共享的缓存行，也不会阻塞；读到的前后两次序号相同且为偶数时才认为读到的值一致，
+ * 否则重试，因此不会读到被写了一半的值。
+ *
+ * 同一时刻只能有一个写者，写者原地修改值。多个写者需要在外部互斥（例如 ShmMutex）。
+ *
+ * @tparam T 变量的类型，必须可以平凡拷贝
+ */
+template <typename T>
+class ShmSeqVar {
+  static_assert(std::is_trivially_copyable<T>::value, "ShmSeqVar requires trivially copyable T");
+
+ public:
+  /**
+   * @brief 打开或创建一个独立的共享内存来存放该变量，变量位于段头部之后
+   *
+   * 打开已经存在的变量时校验段头部，类型不一致时对象不可用。布局与 ShmPool::GetSeqVar
+   * 在独占段的模式下创建的变量相同。
+   *
+   * @param name 共享内存的名字
+   */
+  explicit ShmSeqVar(const std::string &name)
+      : handle_(std::make_shared<ShmHandle>(name, SegmentAllocSize<ShmSeqCell<T>>(1),
+                                            ShmHandle::CREAT_RDWR)) {
+    if (!handle_->IsValid()) {
+      return;
+    }
+    ShmSegmentHeader *header = static_cast<ShmSegmentHeader *>(handle_->Ptr());
+    if (IsSegmentUsable(AttachSegment(header, MakeSegmentLayout<ShmSeqCell<T>>(1), name))) {
+      cell_ = SegmentData<ShmSeqCell<T>>(header);
+    }
+  }
+
+  /**
+   * @brief 在已有的共享内存上构造，不拥有该内存，例如 ShmPool::GetSeqVar 分配的变量
+   *
+   * @param cell 变量在共享内存中的位置，必须初始化为全零或者是已有的变量
+   */
+  explicit ShmSeqVar(ShmSeqCell<T> *cell) : cell_(cell) {}
+
+  /**
+   * @brief 读出变量的一致快照，写者正在修改时自旋重试
+   *
+   * @return T 变量的值
+   */
+  T Load() const {
+    T value;
+    while (!TryLoad(value)) {
+      CpuRelax();
+    }
+    return value;
+  }
+
+  /**
+   * @brief 尝试读出变量的一致快照，只尝试一次
+   *
+   * @param value 读出的值，失败时内容不确定
+   * @return true 读取成功
+   * @return false 写者正在修改或者读取期间发生了修改
+   */
+  bool TryLoad(T &value) const {
+    uint64_t version;
+    return TryLoad(value, version);
+  }
+
+  /**
+   * @brief 只在变量的版本和上次读到的不同时读出新值，用于轮询
+   *
+   * @param value 读出的值，没有变化时不修改
+   * @param version 上次读到的版本，读到新值时更新为新的版本
+   * @return true 读到了新值
+   * @return false 没有变化
+   */
+  bool LoadIfChanged(T &value, uint64_t &version) const {
+    for (;;) {
+      uint64_t seq = cell_->seq.load(std::memory_order_acquire);
+      if (seq == version * 2) {
+        return false;
+      }
+      T tmp;
+      uint64_t new_version;
+      if (TryLoad(tmp, new_version)) {
+        value = tmp;
+        version = new_version;
+        return true;
+      }
+      CpuRelax();
+    }
+  }
+
+  /**
+   * @brief 写入新的值
+   *
+   * @param value 新的值
+   */
+  void Store(const T &value) {
+    Update([&value](T &current) { memcpy(&current, &value, sizeof(T)); });
+  }
+
+  /**
+   * @brief 原地修改变量，修改期间读者会重试
+   *
+   * @tparam F 修改函数，签名为 void(T&)，不能抛出异常
+   * @param fn 修改函数
+   */
+  template <typename F>
+  void Update(F fn) {
+    uint64_t seq = cell_->seq.load(std::memory_order_relaxed);
+    cell_->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    fn(cell_->value);
+    cell_->seq.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief 获取变量当前的版本，每次写入加一
+   *
+   * @return uint64_t 版本号
+   */
+  uint64_t Version() const { return cell_->seq.load(std::memory_order_acquire) / 2; }
+
+  /**
+   * @brief 检测变量是否可用
+   *
+   * @return true 可用
+   * @return false 不可用
+   */
+  bool IsValid() const { return cell_ != nullptr; }
+
+ private:
+  /**
+   * @brief 尝试读出变量的一致快照和对应的版本
+   *
+   */
+  bool TryLoad(T &value, uint64_t &version) const {
+    uint64_t seq1 = cell_->seq.load(std::memory_order_acquire);
+    if (seq1 & 1) {
+      return false;
+    }
+    memcpy(&value, &cell_->value, sizeof(T));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (cell_->seq.load(std::memory_order_relaxed) != seq1) {
+      return false;
+    }
+    version = seq1 / 2;
+    return true;
+  }
+
+  std::shared_ptr<ShmHandle> handle_; /**< 独立存放时底层的 ShmHandle，否则为空 */
+  ShmSeqCell<T> *cell_ = nullptr;     /**< 变量在共享内存中的位置 */
+};
+
+}  // namespace shmlite
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "shm_handle.h"
+#include "shm_segment.h"
+
+namespace shmlite {
+
+constexpr const char *kShmDirtySuffix = ".dirty"; /**< 脏页位图的名字后缀 */
+constexpr size_t kShmSnapshotAlign = 4096;        /**< 快照文件中数据的对齐，满足 O_DIRECT 的要求 */
+constexpr size_t kShmDirtyPageSize = 4096;        /**< 脏页位图默认的页大小，单位（字节） */
+
+/**
+ * @brief 保存快照和检查点的选项
+ *
+ */
+struct ShmSnapshotOptions {
+  /**
+   * @brief 是否使用 O_DIRECT 绕过页缓存，适合远大于页缓存的段，文件系统不支持时回退为普通读写
+   */
+  bool direct_io = false;
+  bool sync = true;               /**< 写完之后是否 fdatasync，保证掉电之后快照依然完整 */
+  size_t chunk_size = 8UL << 20;  /**< 每次读写的最大字节数，必须是 kShmSnapshotAlign 的整数倍 */
+  /**
+   * @brief 可选的 seqlock 序号（与 ShmSeqCell::seq 的协议相同，奇数表示写者正在修改）。
+   * 设置之后只有复制前后序号相同且为偶数时才认为快照一致，否则重试
+   */
+  const std::atomic<uint64_t> *seq = nullptr;
+  int max_retries = 8; /**< 序号变化时的最大重试次数 */
+};
+
+/**
+ * @brief 一次保存的统计
+ *
+ */
+struct ShmSnapshotStats {
+  uint64_t bytes_written = 0; /**< 写入文件的数据字节数，不包括文件头 */
+  uint64_t pages_written = 0; /**< 写入的脏页数，完整快照为 0 */
+  uint32_t retries = 0;       /**< 因为序号变化而重试的次数 */
+};
+
+/**
+ * @brief 快照文件的信息
+ *
+ */
+struct ShmSnapshotInfo {
+  uint64_t segment_size = 0;    /**< 段的大小，单位（字节） */
+  uint64_t checkpoints = 0;     /**< 完整快照之后提交的增量检查点的个数 */
+  bool journal_pending = false; /**< 最后一个检查点的日志还没有完整写回快照文件，恢复时会重放 */
+  bool segment_header = false;  /**< 段是否以 ShmSegmentHeader 开头（ShmArray、ShmPool 变量） */
+};
+
+/**
+ * @brief 记录共享内存段中被修改过的页，用于增量检查点
+ *
+ * 位图存放在名为 name + ".dirty" 的共享内存中，每页一位，所有进程共享。写者修改了段中的数据之后
+ * 调用 MarkDirty；CheckpointSnapshot 原子地取走并清零位图，只把被标记的页写入快照文件。
+ * 检查点进行期间再次被修改的页会被重新标记，由下一个检查点写入。
+ *
+ * 内核的 soft-dirty 位只记录本进程页表上的写入，无法覆盖多个进程写同一个段的场景，因此在用户态记录。
+ */
+class ShmDirtyTracker {
+ public:
+  /**
+   * @brief 删除系统中的脏页位图
+   *
+   * @param name 段的名字
+   * @return true 删除成功
+   * @return false 删除失败
+   */
+  static bool UnLink(const std::string &name) { return ShmHandle::UnLink(name + kShmDirtySuffix); }
+
+  /**
+   * @brief 打开或创建段 name 的脏页位图，新创建时所有页都是干净的
+   *
+   * @param name 段的名字
+   * @param segment_size 段的大小，单位（字节）
+   * @param page_size 页大小，单位（字节），向上取整到 kShmSnapshotAlign 的整数倍
+   */
+  ShmDirtyTracker(const std::string &name, size_t segment_size,
+                  size_t page_size = kShmDirtyPageSize);
+
+  LIBSHMLITE_NO_COPYABLE(ShmDirtyTracker)
+
+  /**
+   * @brief 标记段中 [offset, offset + len) 被修改过，应当在写入数据之后调用
+   *
+   * @param offset 相对于段开头的偏移量，单位（字节）
+   * @param len 长度，单位（字节）
+   */
+  void MarkDirty(size_t offset, size_t len) {
+    if (len == 0 || offset >= segment_size_) {
+      return;
+    }
+    size_t first = offset >> page_shift_;
+    size_t last = std::min(offset + len, segment_size_) - 1;
+    last >>= page_shift_;
+    for (size_t word = first / 64; word <= last / 64; ++word) {
+      size_t lo = word == first / 64 ? first % 64 : 0;
+      size_t hi = word == last / 64 ? last % 64 : 63;
+      uint64_t mask = (~0ULL >> (63 - hi)) & (~0ULL << lo);
+      /* 页已经被标记时只读不写，避免热点页上所有写者争抢同一个缓存行 */
+      if ((words_[word].load(std::memory_order_relaxed) & mask) != mask) {
+        words_[word].fetch_or(mask, std::memory_order_release);
+      }
+    }
+  }
+
+  /**
+   * @brief 对以 ShmSegmentHeader 开头的段（ShmArray、ShmPool 变量），标记从第 first 个元素开始的 n 个元素
+   *
+   * @tparam T 元素类型
+   * @param first 第一个元素的索引
+   * @param n 元素个数
+   */
+  template <typename T>
+  void MarkElements(size_t first, size_t n) {
+    MarkDirty(sizeof(ShmSegmentHeader) + first * sizeof(T), n * sizeof(T));
+  }
+
+  /**
+   * @brief 标记所有页，下一个检查点会写入整个段
+   *
+   */
+  void MarkAll() { MarkDirty(0, segment_size_); }
+
+  /**
+   * @brief 统计当前被标记的页数
+   *
+   * @return size_t 页数
+   */
+  size_t CountDirty() const;
+
+  /**
+   * @brief 取走第 idx 个字中的标记并清零，供 CheckpointSnapshot 使用
+   *
+   * @param idx 字的索引
+   * @return uint64_t 取走的标记
+   */
+  uint64_t TakeWord(size_t idx) { return words_[idx].exchange(0, std::memory_order_acquire); }
+
+  /**
+   * @brief 把没能写入文件的标记放回位图，供 CheckpointSnapshot 使用
+   *
+   * @param idx 字的索引
+   * @param bits 放回的标记
+   */
+  void RestoreWord(size_t idx, uint64_t bits) {
+    words_[idx].fetch_or(bits, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief 获取位图的字数
+   *
+   * @return size_t 字数
+   */
+  size_t Words() const { return word_count_; }
+
+  /**
+   * @brief 获取页大小
+   *
+   * @return size_t 页大小，单位（字节）
+   */
+  size_t PageSize() const { return 1UL << page_shift_; }
+
+  /**
+   * @brief 获取段的大小
+   *
+   * @return size_t 段的大小，单位（字节）
+   */
+  size_t SegmentSize() const { return segment_size_; }
+
+  /**
+   * @brief 检测位图是否有效
+   *
+   * @return true 有效
+   * @return false 无效
+   */
+  bool IsValid() const { return words_ != nullptr; }
+
+ private:
+  std::shared_ptr<ShmHandle> handle_;          /**< 位图所在的 ShmHandle */
+  std::atomic<uint64_t> *words_ = nullptr;     /**< 位图，每页一位 */
+  size_t word_count_ = 0;                      /**< 位图的字数 */
+  size_t segment_size_ = 0;                    /**< 段的大小 */
+  size_t page_shift_ = 12;                     /**< 页大小的对数 */
+};
+
+/**
+ * @brief 把共享内存段完整地写入快照文件
+ *
+ * 先写入 path + ".tmp"，完成之后 rename 为 path，任何时刻 path 要么是旧的快照要么是新的快照。
+ * 数据按 chunk_size 分块顺序写入。指定 tracker 时在复制之前清空位图，之后的增量检查点以本次快照为基础。
+ *
+ * @param handle 段的 ShmHandle
+ * @param path 快照文件的路径
+ * @param options 选项
+ * @param tracker 段的脏页位图，可以为 nullptr
+ * @param stats 统计，可以为 nullptr
+ * @return true 成功
+ * @return false 失败，原来的快照文件不受影响
+ */
+bool SaveSnapshot(const ShmHandle &handle, const std::string &path,
+                  const ShmSnapshotOptions &options = ShmSnapshotOptions(),
+                  ShmDirtyTracker *tracker = nullptr, ShmSnapshotStats *stats = nullptr);
+
+/**
+ * @brief 打开名为 name 的 POSIX 共享内存并完整地写入快照文件，参考上一个重载
+ *
+ */
+bool SaveSnapshot(const std::string &name, const std::string &path,
+                  const ShmSnapshotOptions &options = ShmSnapshotOptions(),
+                  ShmDirtyTracker *tracker = nullptr, ShmSnapshotStats *stats = nullptr);
+
+/**
+ * @brief 增量检查点：只把位图中被标记的页写入已有的快照文件
+ *
+ * 被标记的页先写入日志 path + ".journal.tmp"，落盘之后改名为 path + ".journal" 提交，然后才原地
+ * 写回快照文件。提交之前崩溃时快照文件保持上一个检查点的内容；写回的过程中崩溃时 RestoreSnapshot
+ * 和下一个检查点会重放日志，因此总能恢复出最后一个提交的检查点。日志保留到下一个检查点。
+ * 失败时取走的标记会被放回位图，下一个检查点会重新写入这些页。
+ * 快照文件不存在或者与段的大小不一致时退化为 SaveSnapshot。
+ *
+ * @param handle 段的 ShmHandle
+ * @param tracker 段的脏页位图
+ * @param path 快照文件的路径
+ * @param options 选项
+ * @param stats 统计，可以为 nullptr
+ * @return true 成功
+ * @return false 失败
+ */
+bool CheckpointSnapshot(const ShmHandle &handle, ShmDirtyTracker &tracker, const std::string &path,
+                        const ShmSnapshotOptions &options = ShmSnapshotOptions(),
+                        ShmSnapshotStats *stats = nullptr);
+
+/**
+ * @brief 打开名为 name 的 POSIX 共享内存并写入增量检查点，参考上一个重载
+ *
+ */
+bool CheckpointSnapshot(const std::string &name, ShmDirtyTracker &tracker, const std::string &path,
+                        const ShmSnapshotOptions &options = ShmSnapshotOptions(),
+                        ShmSnapshotStats *stats = nullptr);
+
+/**
+ * @brief 从快照文件创建名为 name 的 POSIX 共享内存，一次顺序读取完成
+ *
+ * 存在匹配的检查点日志时在读取快照之后重放日志。
+ * 段必须不存在，已经存在的段可能正在被使用，不会被覆盖。以 ShmSegmentHeader 开头的段在恢复期间
+ * 处于 INITIALIZING 状态，同时打开的 ShmArray、ShmPool 会等待恢复完成，而不会自行初始化。
+ *
+ * @param path 快照文件的路径
+ * @param name 共享内存的名字
+ * @param options 选项，使用其中的 direct_io 和 chunk_size
+ * @param handle_options 新建共享内存的选项，例如使用大页
+ * @return true 成功
+ * @return false 不是快照文件、段已经存在或者读取失败
+ */
+bool RestoreSnapshot(const std::string &path, const std::string &name,
+                     const ShmSnapshotOptions &options = ShmSnapshotOptions(),
+                     const ShmHandleOptions &handle_options = ShmHandleOptions());
+
+/**
+ * @brief 读取快照文件的信息
+ *
+ * @param path 快照文件的路径
+ * @param info 返回的信息
+ * @return true 成功
+ * @return false 文件不存在或者不是快照文件
+ */
+bool ReadSnapshotInfo(const std::string &path, ShmSnapshotInfo &info);
+
+}  // namespace shmlite
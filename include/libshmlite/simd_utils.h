@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace shmlite {
+
+/**
+ * @brief 批量操作使用的指令集级别，运行时根据 CPU 选择
+ *
+ */
+enum SimdLevel {
+  SIMD_SCALAR = 0, /**< 不使用向量指令 */
+  SIMD_SSE2,       /**< 128 位 SSE2，x86_64 上总是可用 */
+  SIMD_AVX2,       /**< 256 位 AVX2 */
+};
+
+constexpr size_t kMinNonTemporalThreshold = 4UL << 20; /**< 非临时存储阈值的下限，单位（字节） */
+
+/**
+ * @brief 检测 CPU 和操作系统支持的最高指令集级别
+ *
+ * @return SimdLevel 指令集级别
+ */
+SimdLevel DetectSimdLevel();
+
+/**
+ * @brief 获取当前批量操作使用的指令集级别，默认为 DetectSimdLevel() 的结果
+ *
+ * @return SimdLevel 指令集级别
+ */
+SimdLevel GetSimdLevel();
+
+/**
+ * @brief 指定批量操作使用的指令集级别，用于测试和性能对比
+ *
+ * @param level 期望的级别，超过 CPU 支持的级别时取 CPU 支持的最高级别
+ * @return SimdLevel 实际生效的级别
+ */
+SimdLevel SetSimdLevel(SimdLevel level);
+
+/**
+ * @brief 获取使用非临时存储的阈值
+ *
+ * 超过该大小的填充无论如何都放不进缓存，使用非临时存储绕过缓存，避免冲掉其它数据。
+ * 默认为最后一级缓存的大小，至少为 kMinNonTemporalThreshold。
+ *
+ * @return size_t 阈值，单位（字节）
+ */
+size_t GetNonTemporalThreshold();
+
+/**
+ * @brief 指定使用非临时存储的阈值，用于测试和调优
+ *
+ * @param threshold 阈值，单位（字节）
+ */
+void SetNonTemporalThreshold(size_t threshold);
+
+/**
+ * @brief 以 value 指向的元素填充 n 个元素
+ *
+ * 元素大小为 32 的因数时使用向量存储，总大小超过 GetNonTemporalThreshold() 时使用非临时存储。
+ *
+ * @param dst 开始填充的首地址
+ * @param value 填充的元素
+ * @param elem_size 元素的大小，单位（字节）
+ * @param n 元素个数
+ */
+void SimdFill(void *dst, const void *value, size_t elem_size, size_t n);
+
+/**
+ * @brief 查找第一个与 value 按字节相等的元素
+ *
+ * @param first 首地址
+ * @param n 元素个数
+ * @param value 查找的元素
+ * @param elem_size 元素的大小，只能是 1、2、4、8
+ * @return size_t 元素的下标，找不到时返回 n
+ */
+size_t SimdFind(const void *first, size_t n, const void *value, size_t elem_size);
+
+/**
+ * @brief 统计与 value 按字节相等的元素个数
+ *
+ * @param first 首地址
+ * @param n 元素个数
+ * @param value 统计的元素
+ * @param elem_size 元素的大小，只能是 1、2、4、8
+ * @return size_t 元素个数
+ */
+size_t SimdCount(const void *first, size_t n, const void *value, size_t elem_size);
+
+/**
+ * @name 归约
+ *
+ * 求和的结果使用更宽的类型累加，浮点数求和的顺序与逐个相加不同，结果可能有舍入误差；
+ * 浮点数中有 NaN 时最小值、最大值的结果未定义。n 必须大于 0。
+ * @{
+ */
+int64_t SimdSum(const int32_t *first, size_t n);
+int64_t SimdSum(const int64_t *first, size_t n);
+double SimdSum(const float *first, size_t n);
+double SimdSum(const double *first, size_t n);
+int32_t SimdMin(const int32_t *first, size_t n);
+int64_t SimdMin(const int64_t *first, size_t n);
+float SimdMin(const float *first, size_t n);
+double SimdMin(const double *first, size_t n);
+int32_t SimdMax(const int32_t *first, size_t n);
+int64_t SimdMax(const int64_t *first, size_t n);
+float SimdMax(const float *first, size_t n);
+double SimdMax(const double *first, size_t n);
+/** @} */
+
+}  // namespace shmlite
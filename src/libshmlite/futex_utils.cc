@@ -0,0 +1,21 @@
+#include "libshmlite/futex_utils.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace shmlite {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "std::atomic<uint32_t> must have the same layout as uint32_t to be used as futex");
+
+int FutexWait(std::atomic<uint32_t> *addr, uint32_t expected, const struct timespec *timeout) {
+  return static_cast<int>(
+      syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAIT, expected, timeout, nullptr, 0));
+}
+
+int FutexWake(std::atomic<uint32_t> *addr, int count) {
+  return static_cast<int>(
+      syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAKE, count, nullptr, nullptr, 0));
+}
+
+}  // namespace shmlite
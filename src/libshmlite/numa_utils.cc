@@ -0,0 +1,101 @@
+#include "libshmlite/numa_utils.h"
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+
+namespace shmlite {
+
+/**
+ * @brief 读取 /sys 中一个文件的第一行
+ *
+ * @param path 文件路径
+ * @return std::string 第一行内容，文件不存在时为空
+ */
+static std::string ReadFirstLine(const std::string &path) {
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+std::vector<int> ParseIdList(const std::string &list) {
+  std::vector<int> ids;
+  const char *p = list.c_str();
+  while (*p != '\0' && *p != '\n') {
+    char *end;
+    long first = std::strtol(p, &end, 10);
+    if (end == p) {
+      break;
+    }
+    long last = first;
+    if (*end == '-') {
+      p = end + 1;
+      last = std::strtol(p, &end, 10);
+    }
+    for (long id = first; id <= last; ++id) {
+      ids.push_back(static_cast<int>(id));
+    }
+    p = *end == ',' ? end + 1 : end;
+  }
+  return ids;
+}
+
+std::vector<int> NumaOnlineNodes() {
+  std::vector<int> nodes = ParseIdList(ReadFirstLine("/sys/devices/system/node/online"));
+  if (nodes.empty()) {
+    nodes.push_back(0);
+  }
+  return nodes;
+}
+
+std::vector<int> NumaNodeCpus(int node) {
+  return ParseIdList(
+      ReadFirstLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+}
+
+int CurrentNumaNode() {
+  unsigned cpu = 0, node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == -1) {
+    return 0;
+  }
+  return static_cast<int>(node);
+}
+
+int NumaBind(void *addr, size_t size, ShmNumaPolicy policy, int node) {
+  int mode = MPOL_DEFAULT;
+  /* 节点掩码，最多支持 1024 个节点 */
+  unsigned long mask[1024 / (8 * sizeof(unsigned long))] = {0};
+  const unsigned long bits_per_word = 8 * sizeof(unsigned long);
+  switch (policy) {
+    case SHM_NUMA_LOCAL:
+      /* MPOL_LOCAL 只是按照首次访问者分配，这里固定为调用者当前所在的节点 */
+      node = CurrentNumaNode();
+      /* fall through */
+    case SHM_NUMA_BIND:
+      if (node < 0 || static_cast<size_t>(node) >= sizeof(mask) * 8) {
+        errno = EINVAL;
+        return -1;
+      }
+      mode = MPOL_BIND;
+      mask[node / bits_per_word] |= 1UL << (node % bits_per_word);
+      break;
+    case SHM_NUMA_INTERLEAVE:
+      mode = MPOL_INTERLEAVE;
+      for (int n : NumaOnlineNodes()) {
+        if (static_cast<size_t>(n) < sizeof(mask) * 8) {
+          mask[n / bits_per_word] |= 1UL << (n % bits_per_word);
+        }
+      }
+      break;
+    default:
+      break;
+  }
+  bool with_mask = mode == MPOL_BIND || mode == MPOL_INTERLEAVE;
+  return static_cast<int>(syscall(SYS_mbind, addr, size, mode, with_mask ? mask : nullptr,
+                                  with_mask ? sizeof(mask) * 8 : 0, 0));
+}
+
+}  // namespace shmlite
@@ -0,0 +1,51 @@
+#include "libshmlite/shm_event.h"
+#include <unistd.h>
+#include <cerrno>
+
+namespace shmlite {
+
+constexpr long kNanosPerSecond = 1000000000L;
+constexpr int kShmEventSpinCount = 128; /**< 多核时进入futex等待前的自旋次数 */
+
+int ShmEvent::SpinLimit() {
+  static const int limit = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? kShmEventSpinCount : 0;
+  return limit;
+}
+
+struct timespec ShmEvent::DeadlineAfter(const struct timespec &timeout) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  now.tv_sec += timeout.tv_sec;
+  now.tv_nsec += timeout.tv_nsec;
+  if (now.tv_nsec >= kNanosPerSecond) {
+    now.tv_sec += now.tv_nsec / kNanosPerSecond;
+    now.tv_nsec %= kNanosPerSecond;
+  }
+  return now;
+}
+
+bool ShmEvent::Sleep(uint32_t seq, const struct timespec *deadline) {
+  if (deadline == nullptr) {
+    FutexWait(&word_, seq);
+    return true;
+  }
+  /* FUTEX_WAIT 使用相对时间，根据截止时间计算剩余的时间 */
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  struct timespec remaining;
+  remaining.tv_sec = deadline->tv_sec - now.tv_sec;
+  remaining.tv_nsec = deadline->tv_nsec - now.tv_nsec;
+  if (remaining.tv_nsec < 0) {
+    remaining.tv_sec -= 1;
+    remaining.tv_nsec += kNanosPerSecond;
+  }
+  if (remaining.tv_sec < 0) {
+    return false;
+  }
+  if (FutexWait(&word_, seq, &remaining) == -1 && errno == ETIMEDOUT) {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace shmlite
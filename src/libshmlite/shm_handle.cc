@@ -1,9 +1,79 @@
 #include "libshmlite/shm_handle.h"
+#include <linux/magic.h>
+#include <sys/socket.h>
+#include <sys/statfs.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <chrono>
 #include <climits>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#ifndef MFD_HUGE_SHIFT
+#define MFD_HUGE_SHIFT 26 /* glibc 只导出了 MFD_HUGETLB，页大小的编码方式见 linux/memfd.h */
+#endif
+#ifndef MAP_SYNC
+#define MAP_SHARED_VALIDATE 0x03 /* 较旧的 glibc 没有导出，取值见 linux/mman.h */
+#define MAP_SYNC 0x80000
+#endif
 
 namespace shmlite {
 
+/**
+ * @brief SHM_FLUSH_PERIODIC 的后台刷新线程
+ *
+ * 刷新在 mutex 的保护下进行，Remap 改变映射时持有同一个锁。线程不会被 fork 复制，fork 时
+ * 锁可能正被线程持有，条件变量上也还记录着线程，因此子进程中既不使用锁，也不析构这个对象。
+ */
+class ShmFlusher {
+ public:
+  ShmFlusher(ShmHandle *handle, int interval_ms)
+      : handle_(handle), interval_(interval_ms), owner_(getpid()), thread_([this] { Run(); }) {}
+
+  ~ShmFlusher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop_ = true;
+    }
+    cond_.notify_all();
+    thread_.join();
+  }
+
+  LIBSHMLITE_NO_COPYABLE(ShmFlusher)
+
+  /**
+   * @brief 是否位于创建线程的进程中，fork 出的子进程中没有刷新线程
+   *
+   */
+  bool Owned() const { return getpid() == owner_; }
+
+  std::mutex mutex; /**< 保护刷新和重新映射，只能在 Owned() 时使用 */
+
+ private:
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!cond_.wait_for(lock, interval_, [this] { return stop_; })) {
+      handle_->Flush(true);
+    }
+  }
+
+  ShmHandle *handle_;                 /**< 需要刷新的 ShmHandle */
+  std::chrono::milliseconds interval_; /**< 刷新间隔 */
+  pid_t owner_;                        /**< 创建线程的进程 */
+  bool stop_ = false;                  /**< 是否需要退出 */
+  std::condition_variable cond_;       /**< 用于提前唤醒线程退出 */
+  std::thread thread_;                 /**< 刷新线程，最后初始化 */
+};
+
+/**
+ * @brief 文件映射的目录是否是绝对路径，相对路径在工作目录不同的进程中指向不同的文件
+ *
+ */
+static inline bool IsAbsoluteDir(const std::string &dir) { return !dir.empty() && dir[0] == '/'; }
+
 /**
  * @brief shm_open打开错误处理
  *
@@ -17,27 +87,77 @@ namespace shmlite {
   } while (0)
 
 /**
- * @brief 调整文件大小到预定的大小
+ * @brief 新创建的（大小为 0 的）共享内存调整到预定的大小，已经存在的共享内存大小必须一致
+ *
+ * 已经存在的段可能正在被其它进程使用，截断会让它们访问到 SIGBUS 或者丢失数据，因此不会改变其大小。
  *
  * @param fd 文件描述符
- * @param target_size 预期的文件大小
+ * @param target_size 预期的文件大小，为 0 时取已经存在的共享内存的大小
+ * @param name 共享内存的名字，只用于日志
+ * @return true 大小符合预期
+ * @return false 调整失败或者大小不一致
  */
-#define SHM_ADJUST_FD(fd, target_size)                                                            \
-  do {                                                                                            \
-    struct stat fd_stat;                                                                          \
-    int ret = fstat(fd, &fd_stat);                                                                \
-    if (ret == -1) {                                                                              \
-      PRINT_ERRMSG("Can not read stat of " << fd, errno);                                         \
-      close(fd);                                                                                  \
-    }                                                                                             \
-    if (fd_stat.st_size != (long int)target_size) {                                               \
-      ret = ftruncate(fd, target_size);                                                           \
-      if (ret == -1) {                                                                            \
-        PRINT_ERRMSG("Can not ftruncate the size to " << target_size << " for fd=" << fd, errno); \
-        close(fd);                                                                                \
-      }                                                                                           \
-    }                                                                                             \
-  } while (0)
+static bool AdjustNewFd(int fd, size_t &target_size, const std::string &name) {
+  struct stat fd_stat;
+  if (fstat(fd, &fd_stat) == -1) {
+    PRINT_ERRMSG("Can not read stat of " << fd, errno);
+    return false;
+  }
+  size_t size = fd_stat.st_size;
+  if (target_size == 0) {
+    if (size == 0) {
+      SIMPLE_ERROR("Shared memory " << name << " is empty, its size must be given");
+      return false;
+    }
+    target_size = size;
+  }
+  if (size == target_size) {
+    return true;
+  }
+  if (size != 0) {
+    SIMPLE_ERROR("Shared memory " << name << " already exists with size " << size
+                                  << ", refuse to resize it to " << target_size);
+    return false;
+  }
+  if (ftruncate(fd, target_size) == -1) {
+    PRINT_ERRMSG("Can not ftruncate the size to " << target_size << " for fd=" << fd, errno);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief 以 O_EXCL 尝试创建，已经存在时再打开，从而知道共享内存是否由本次调用创建
+ *
+ * @param open_fn 打开函数，参数为打开标志，返回文件描述符
+ * @param oflags 打开标志
+ * @param created 返回是否由本次调用创建
+ * @return int 文件描述符，失败时返回 -1
+ */
+template <typename OpenFn>
+static int OpenOrCreate(OpenFn open_fn, int oflags, bool *created) {
+  *created = false;
+  if ((oflags & O_CREAT) == 0 || (oflags & O_EXCL) != 0) {
+    int fd = open_fn(oflags);
+    *created = fd != -1 && (oflags & O_EXCL) != 0;
+    return fd;
+  }
+  while (true) {
+    int fd = open_fn(oflags | O_EXCL);
+    if (fd != -1) {
+      *created = true;
+      return fd;
+    }
+    if (errno != EEXIST) {
+      return -1;
+    }
+    fd = open_fn(oflags & ~O_CREAT);
+    if (fd != -1 || errno != ENOENT) {
+      return fd;
+    }
+    /* 两次打开之间被其它进程删除了，重新创建 */
+  }
+}
 
 bool ShmHandle::CheckExists(const std::string &shm_name) {
   std::string real_shmname = ConcatStringLimited(kShmNamePrefix, shm_name, NAME_MAX);
@@ -57,19 +177,117 @@ bool ShmHandle::UnLink(const std::string &shm_name) {
   return shm_unlink(real_shmname.c_str()) == 0;
 }
 
+bool ShmHandle::UnLink(const std::string &shm_name, const ShmHandleOptions &options) {
+  std::string real_shmname = ConcatStringLimited(kShmNamePrefix, shm_name, NAME_MAX);
+  if (options.backing == SHM_BACKING_FILE) {
+    return IsAbsoluteDir(options.file_dir) &&
+           unlink((options.file_dir + real_shmname).c_str()) == 0;
+  }
+  if (options.page_size == SHM_PAGE_DEFAULT) {
+    return UnLink(shm_name);
+  }
+  /* 使用大页时可能回退到了普通共享内存，两处都需要删除 */
+  bool huge_removed = unlink((options.hugetlbfs_dir + real_shmname).c_str()) == 0;
+  bool shm_removed = UnLink(shm_name);
+  return huge_removed || shm_removed;
+}
+
+/**
+ * @brief 向上取整到 align 的整数倍
+ *
+ * @param n 需要取整的数
+ * @param align 对齐大小
+ * @return size_t 取整后的结果
+ */
+static inline size_t RoundUp(size_t n, size_t align) { return (n + align - 1) / align * align; }
+
+/**
+ * @brief 根据打开标志得到映射的权限
+ *
+ * @param oflags 打开标志
+ * @return int 映射的权限
+ */
+static inline int ProtOf(int oflags) {
+  return (oflags & O_ACCMODE) == O_RDONLY ? PROT_READ : PROT_READ | PROT_WRITE;
+}
+
+/**
+ * @brief 根据选项得到额外的 mmap 标志
+ *
+ * @param options 可选项
+ * @return int 额外的 mmap 标志
+ */
+static inline int MapFlagsOf(const ShmHandleOptions &options) {
+  /* 需要设置 NUMA 策略时不能在 mmap 时就分配页，改为设置策略之后再预取 */
+  return options.prefault == SHM_PREFAULT_POPULATE && options.numa_policy == SHM_NUMA_DEFAULT
+             ? MAP_POPULATE
+             : 0;
+}
+
+/**
+ * @brief 统计映射中驻留在内存中的页数
+ *
+ * @param ptr 映射的地址
+ * @param size 映射的大小
+ * @return size_t 驻留的页数，失败时返回 0
+ */
+static size_t CountResidentPages(void *ptr, size_t size) {
+  size_t page = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> vec((size + page - 1) / page);
+  if (mincore(ptr, size, vec.data()) == -1) {
+    PRINT_ERRMSG("Can not mincore for " << ptr, errno);
+    return 0;
+  }
+  size_t resident = 0;
+  for (unsigned char v : vec) {
+    resident += v & 1;
+  }
+  return resident;
+}
+
+/**
+ * @brief 以 align 对齐的起始地址映射共享内存，使透明大页能够覆盖整个映射
+ *
+ * 先预留 size + align 的地址空间，再在其中对齐的位置上 MAP_FIXED 映射，最后释放多余的部分。
+ *
+ * @return void* 映射的地址，失败时返回 MAP_FAILED
+ */
+static void *MmapAligned(size_t size, size_t align, int prot, int flags, int fd) {
+  size_t reserve_size = size + align;
+  void *reserve =
+      mmap(nullptr, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (reserve == MAP_FAILED) {
+    return MAP_FAILED;
+  }
+  uintptr_t start = reinterpret_cast<uintptr_t>(reserve);
+  uintptr_t aligned = RoundUp(start, align);
+  void *ptr =
+      mmap(reinterpret_cast<void *>(aligned), size, prot, MAP_SHARED | MAP_FIXED | flags, fd, 0);
+  if (ptr == MAP_FAILED) {
+    munmap(reserve, reserve_size);
+    return MAP_FAILED;
+  }
+  if (aligned > start) {
+    munmap(reserve, aligned - start);
+  }
+  uintptr_t map_end = aligned + RoundUp(size, sysconf(_SC_PAGESIZE));
+  if (start + reserve_size > map_end) {
+    munmap(reinterpret_cast<void *>(map_end), start + reserve_size - map_end);
+  }
+  return ptr;
+}
+
 ShmHandle::ShmHandle(std::string name, size_t size, OpenFlags flags, bool auto_unlink)
+    : ShmHandle(std::move(name), size, flags, ShmHandleOptions(), auto_unlink) {}
+
+ShmHandle::ShmHandle(std::string name, size_t size, OpenFlags flags,
+                     const ShmHandleOptions &options, bool auto_unlink)
     : NamedClass(std::move(name)), size_(size), auto_unlink_(auto_unlink) {
-  std::string real_shmname = ConcatStringLimited(kShmNamePrefix, name_, NAME_MAX);
-#ifdef DEV_DEBUG
-  SIMPLE_DEBUG("opening... " << real_shmname);
-#endif
-  fd_ = shm_open(real_shmname.c_str(), flags, 0640);
-  SHM_OPEN_HANDLE_FAIL(fd_);
-  SHM_ADJUST_FD(fd_, size_);
-  ptr_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
-  if (ptr_ == nullptr) {
-    PRINT_ERRMSG("Can not mmap for shared memory", errno);
-    size_ = 0;
+  Open(flags, options);
+  if (IsValid()) {
+    ApplyNumaPolicy(options);
+    Prefault(flags, options);
+    StartFlush(options);
   }
 #ifdef DEV_DEBUG
   SIMPLE_DEBUG("ShmHandle-" << name_ << "(fd = " << fd_ << ", ptr = " << ptr_ << ") constructed");
@@ -78,25 +296,546 @@ ShmHandle::ShmHandle(std::string name, size_t size, OpenFlags flags, bool auto_u
 
 ShmHandle::ShmHandle(std::string name, void *value, size_t size, bool auto_unlink)
     : NamedClass(std::move(name)), size_(size), auto_unlink_(auto_unlink) {
-  std::string real_shmname = ConcatStringLimited(kShmNamePrefix, name_, NAME_MAX);
 #ifdef DEV_DEBUG
-  SIMPLE_DEBUG("opening... " << real_shmname << " with given initial value");
+  SIMPLE_DEBUG("opening... " << name_ << " with given initial value");
 #endif
   /* 如果该共享内存不存在，就会创建，并且指定一个初始值 */
-  fd_ = shm_open(real_shmname.c_str(), O_CREAT | O_RDWR, 0640);
+  Open(O_CREAT | O_RDWR, ShmHandleOptions());
+  if (IsValid() && created_) {
+    /* 设置初始值，将整块value的内存搬过去；已经存在的共享内存可能正在被使用，不能覆盖 */
+    memcpy(ptr_, value, size);
+  }
+#ifdef DEV_DEBUG
+  SIMPLE_DEBUG("ShmHandle-" << name_ << "(fd = " << fd_ << ", ptr = " << ptr_ << ") constructed");
+#endif
+}
+
+ShmHandle::ShmHandle(int fd, std::string name, OpenFlags flags)
+    : NamedClass(std::move(name)), size_(0), auto_unlink_(false) {
+  if (fd == -1) {
+    return;
+  }
+  fd_ = fd;
+  backing_ = SHM_BACKING_MEMFD;
+  prot_ = ProtOf(flags);
+  struct stat fd_stat;
+  if (fstat(fd_, &fd_stat) == -1) {
+    PRINT_ERRMSG("Can not read stat of " << fd_, errno);
+    close(fd_);
+    fd_ = -1;
+    return;
+  }
+  /* 内容已经被封印时只能只读映射 */
+  int seals = GetSeals();
+  if (seals != -1 && (seals & F_SEAL_WRITE) != 0) {
+    prot_ = PROT_READ;
+  }
+  size_ = fd_stat.st_size;
+  mapped_size_ = size_;
+  ptr_ = mmap(nullptr, size_, prot_, MAP_SHARED, fd_, 0);
+  if (ptr_ == MAP_FAILED) {
+    PRINT_ERRMSG("Can not mmap fd " << fd_ << " for " << name_, errno);
+    close(fd_);
+    fd_ = -1;
+    ptr_ = nullptr;
+    size_ = 0;
+    mapped_size_ = 0;
+  }
+#ifdef DEV_DEBUG
+  SIMPLE_DEBUG("ShmHandle-" << name_ << "(fd = " << fd_ << ", ptr = " << ptr_ << ") constructed");
+#endif
+}
+
+/**
+ * @brief 不创建任何对象地检查 POSIX 共享内存是否存在
+ *
+ * 与 CheckExists 不同，这里不会短暂地创建同名对象，其它进程同时打开时看不到中间状态。
+ *
+ * @param name 共享内存的名字
+ * @return true 存在（包括没有权限打开的情况）
+ * @return false 不存在
+ */
+static bool PosixShmExists(const std::string &name) {
+  std::string real_shmname = ConcatStringLimited(kShmNamePrefix, name, NAME_MAX);
+  int fd = shm_open(real_shmname.c_str(), O_RDONLY, 0);
+  if (fd == -1) {
+    return errno != ENOENT;
+  }
+  close(fd);
+  return true;
+}
+
+void ShmHandle::Open(int oflags, const ShmHandleOptions &options) {
+  prot_ = ProtOf(oflags);
+  backing_ = options.backing;
+  if (backing_ == SHM_BACKING_FILE) {
+    OpenFile(oflags, options);
+    return;
+  }
+  if (options.page_size != SHM_PAGE_DEFAULT && backing_ == SHM_BACKING_POSIX &&
+      PosixShmExists(name_)) {
+    /* 之前的进程已经回退到了普通共享内存，跟随它，而不是在 hugetlbfs 中另建一块 */
+    if (!options.thp_fallback) {
+      SIMPLE_ERROR(name_ << " already exists without huge pages, can not open it on hugetlbfs");
+      size_ = 0;
+      return;
+    }
+  } else if (options.page_size != SHM_PAGE_DEFAULT) {
+    bool opened = backing_ == SHM_BACKING_MEMFD ? OpenMemfdHugetlb(options)
+                                                : OpenHugetlbfs(oflags, options);
+    if (opened) {
+      return;
+    }
+    if (!options.thp_fallback) {
+      size_ = 0;
+      return;
+    }
+    std::string huge_path =
+        options.hugetlbfs_dir + ConcatStringLimited(kShmNamePrefix, name_, NAME_MAX);
+    if (backing_ == SHM_BACKING_POSIX && access(huge_path.c_str(), F_OK) == 0) {
+      /* 其它进程在 hugetlbfs 中使用着同名的共享内存，回退会得到另一块内存 */
+      SIMPLE_ERROR("Can not open " << huge_path << ", refuse to fall back for " << name_);
+      size_ = 0;
+      return;
+    }
+    SIMPLE_WARN("Huge pages unavailable for " << name_ << ", fall back to transparent huge pages");
+  }
+  if (backing_ == SHM_BACKING_MEMFD) {
+    /* 名字只出现在 /proc/<pid>/fd 中，便于调试，不会与其它对象冲突 */
+    fd_ = memfd_create(name_.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    created_ = fd_ != -1;
+  } else {
+    std::string real_shmname = ConcatStringLimited(kShmNamePrefix, name_, NAME_MAX);
+#ifdef DEV_DEBUG
+    SIMPLE_DEBUG("opening... " << real_shmname);
+#endif
+    fd_ = OpenOrCreate([&](int flags) { return shm_open(real_shmname.c_str(), flags, 0640); },
+                       oflags, &created_);
+  }
   SHM_OPEN_HANDLE_FAIL(fd_);
-  SHM_ADJUST_FD(fd_, size_);
-  ptr_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
-  if (ptr_ == nullptr) {
-    PRINT_ERRMSG("Can not mmap for shared memory", errno);
+  if (fd_ != -1 && !AdjustNewFd(fd_, size_, name_)) {
+    close(fd_);
+    fd_ = -1;
     size_ = 0;
+    if (created_ && backing_ == SHM_BACKING_POSIX) {
+      UnLink(name_); /* 不留下由本次创建的空共享内存 */
+    }
+    return;
+  }
+  mapped_size_ = size_;
+  if (options.page_size != SHM_PAGE_DEFAULT) {
+    /* 透明大页只能覆盖按大页对齐的区域 */
+    ptr_ = MmapAligned(size_, 1UL << SHM_PAGE_HUGE_2M, prot_, MapFlagsOf(options), fd_);
+    if (ptr_ != MAP_FAILED && madvise(ptr_, size_, MADV_HUGEPAGE) == -1) {
+      PRINT_ERRMSG("Can not madvise(MADV_HUGEPAGE) for " << name_, errno);
+    }
   } else {
-    /* 设置初始值，将整块value的内存搬过去 */
-    memcpy(ptr_, value, size);
+    ptr_ = mmap(nullptr, size_, prot_, MAP_SHARED | MapFlagsOf(options), fd_, 0);
   }
+  if (ptr_ == MAP_FAILED) {
+    PRINT_ERRMSG("Can not mmap for shared memory", errno);
+    ptr_ = nullptr;
+    size_ = 0;
+    mapped_size_ = 0;
+  }
+}
+
+void ShmHandle::OpenFile(int oflags, const ShmHandleOptions &options) {
+  if (options.page_size != SHM_PAGE_DEFAULT) {
+    SIMPLE_WARN("Huge pages are not supported for file backed " << name_ << ", use default pages");
+  }
+  if (!IsAbsoluteDir(options.file_dir)) {
+    SIMPLE_ERROR("File backed " << name_ << " needs an absolute file_dir, got '" << options.file_dir
+                                << "'");
+    return;
+  }
+  std::string path = options.file_dir + ConcatStringLimited(kShmNamePrefix, name_, NAME_MAX);
 #ifdef DEV_DEBUG
-  SIMPLE_DEBUG("ShmHandle-" << name_ << "(fd = " << fd_ << ", ptr = " << ptr_ << ") constructed");
+  SIMPLE_DEBUG("opening... " << path);
 #endif
+  bool created = false;
+  int fd = OpenOrCreate([&](int flags) { return open(path.c_str(), flags | O_CLOEXEC, 0640); },
+                        oflags, &created);
+  if (fd == -1) {
+    PRINT_ERRMSG("Can not open " << path, errno);
+    return;
+  }
+  /* 新文件用 ftruncate 扩展，是稀疏的，只有写过的页才占用磁盘 */
+  if (!AdjustNewFd(fd, size_, path)) {
+    close(fd);
+    size_ = 0;
+    if (created) {
+      unlink(path.c_str());
+    }
+    return;
+  }
+  void *ptr = MAP_FAILED;
+  if (options.map_sync && (prot_ & PROT_WRITE) != 0) {
+    ptr = mmap(nullptr, size_, prot_, MAP_SHARED_VALIDATE | MAP_SYNC | MapFlagsOf(options), fd, 0);
+    if (ptr == MAP_FAILED) {
+      SIMPLE_WARN("MAP_SYNC unsupported for " << path << " (not on a DAX file system), use MAP_SHARED");
+    }
+    map_sync_ = ptr != MAP_FAILED;
+  }
+  if (ptr == MAP_FAILED) {
+    ptr = mmap(nullptr, size_, prot_, MAP_SHARED | MapFlagsOf(options), fd, 0);
+  }
+  if (ptr == MAP_FAILED) {
+    PRINT_ERRMSG("Can not mmap " << path, errno);
+    close(fd);
+    size_ = 0;
+    if (created) {
+      unlink(path.c_str());
+    }
+    return;
+  }
+  fd_ = fd;
+  ptr_ = ptr;
+  mapped_size_ = size_;
+  path_ = std::move(path);
+  created_ = created;
+}
+
+bool ShmHandle::OpenHugetlbfs(int oflags, const ShmHandleOptions &options) {
+  size_t page = 1UL << options.page_size;
+  struct statfs fs;
+  if (statfs(options.hugetlbfs_dir.c_str(), &fs) == -1) {
+    PRINT_ERRMSG("Can not statfs " << options.hugetlbfs_dir, errno);
+    return false;
+  }
+  if (fs.f_type != HUGETLBFS_MAGIC || static_cast<size_t>(fs.f_bsize) != page) {
+    SIMPLE_ERROR(options.hugetlbfs_dir << " is not a hugetlbfs mount with page size " << page);
+    return false;
+  }
+  std::string real_shmname = ConcatStringLimited(kShmNamePrefix, name_, NAME_MAX);
+  std::string path = options.hugetlbfs_dir + real_shmname;
+  bool created = false;
+  int fd = OpenOrCreate([&](int flags) { return open(path.c_str(), flags, 0640); }, oflags, &created);
+  if (fd == -1) {
+    PRINT_ERRMSG("Can not open " << path, errno);
+    return false;
+  }
+  /* hugetlbfs 中文件的大小必须是大页的整数倍 */
+  size_t mapped_size = RoundUp(size_, page);
+  if (!AdjustNewFd(fd, mapped_size, path)) {
+    close(fd);
+    if (created) {
+      unlink(path.c_str());
+    }
+    return false;
+  }
+  if (size_ == 0) {
+    size_ = mapped_size;
+  }
+  void *ptr = mmap(nullptr, mapped_size, ProtOf(oflags), MAP_SHARED | MapFlagsOf(options), fd, 0);
+  if (ptr == MAP_FAILED) {
+    int err = errno;
+    if (err == ENOMEM) {
+      SIMPLE_ERROR("Huge page reservation exhausted: can not reserve "
+                   << mapped_size / page << " pages of " << page << " bytes for " << path
+                   << ", check /proc/sys/vm/nr_hugepages");
+    } else {
+      PRINT_ERRMSG("Can not mmap " << path, err);
+    }
+    close(fd);
+    if (created) {
+      unlink(path.c_str()); /* 由本次创建的文件 */
+    }
+    return false;
+  }
+  fd_ = fd;
+  ptr_ = ptr;
+  mapped_size_ = mapped_size;
+  page_size_ = options.page_size;
+  path_ = std::move(path);
+  created_ = created;
+  return true;
+}
+
+bool ShmHandle::OpenMemfdHugetlb(const ShmHandleOptions &options) {
+  size_t page = 1UL << options.page_size;
+  unsigned int flags = MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_HUGETLB |
+                       (static_cast<unsigned int>(options.page_size) << MFD_HUGE_SHIFT);
+  int fd = memfd_create(name_.c_str(), flags);
+  if (fd == -1) {
+    PRINT_ERRMSG("Can not memfd_create(MFD_HUGETLB) for " << name_, errno);
+    return false;
+  }
+  size_t mapped_size = RoundUp(size_, page);
+  if (ftruncate(fd, mapped_size) == -1) {
+    PRINT_ERRMSG("Can not resize memfd " << name_ << " to " << mapped_size, errno);
+    close(fd);
+    return false;
+  }
+  void *ptr = mmap(nullptr, mapped_size, prot_, MAP_SHARED | MapFlagsOf(options), fd, 0);
+  if (ptr == MAP_FAILED) {
+    if (errno == ENOMEM) {
+      SIMPLE_ERROR("Huge page reservation exhausted: can not reserve "
+                   << mapped_size / page << " pages of " << page << " bytes for memfd " << name_
+                   << ", check /proc/sys/vm/nr_hugepages");
+    } else {
+      PRINT_ERRMSG("Can not mmap memfd " << name_, errno);
+    }
+    close(fd);
+    return false;
+  }
+  fd_ = fd;
+  ptr_ = ptr;
+  mapped_size_ = mapped_size;
+  page_size_ = options.page_size;
+  created_ = true;
+  return true;
+}
+
+void ShmHandle::ApplyNumaPolicy(const ShmHandleOptions &options) {
+  /* 策略保存在共享内存对象上，SHM_NUMA_LOCAL 只由创建者按照自己所在的节点设置 */
+  if (options.numa_policy == SHM_NUMA_DEFAULT ||
+      (options.numa_policy == SHM_NUMA_LOCAL && !created_)) {
+    return;
+  }
+  if (NumaBind(ptr_, mapped_size_, options.numa_policy, options.numa_node) == -1) {
+    PRINT_ERRMSG("Can not set NUMA policy " << options.numa_policy << " (node " << options.numa_node
+                                            << ") for " << name_,
+                 errno);
+    return;
+  }
+  numa_policy_ = options.numa_policy;
+}
+
+void ShmHandle::Prefault(int oflags, const ShmHandleOptions &options) {
+  bool populate_late =
+      options.prefault == SHM_PREFAULT_POPULATE && options.numa_policy != SHM_NUMA_DEFAULT;
+  if (options.prefault == SHM_PREFAULT_WILLNEED) {
+    if (madvise(ptr_, mapped_size_, MADV_WILLNEED) == -1) {
+      PRINT_ERRMSG("Can not madvise(MADV_WILLNEED) for " << name_, errno);
+    }
+  } else if (options.prefault == SHM_PREFAULT_POPULATE_WRITE || populate_late) {
+    /* 只读的映射只能以读的方式预取 */
+    int advice = (oflags & O_ACCMODE) == O_RDONLY ? MADV_POPULATE_READ : MADV_POPULATE_WRITE;
+    if (madvise(ptr_, mapped_size_, advice) == -1) {
+      if (errno == EINVAL) {
+        SIMPLE_WARN("MADV_POPULATE_(READ|WRITE) unsupported by the kernel, use MADV_WILLNEED for "
+                    << name_);
+        madvise(ptr_, mapped_size_, MADV_WILLNEED);
+      } else {
+        PRINT_ERRMSG("Can not prefault " << name_, errno);
+      }
+    }
+  }
+  int ret = 0;
+  if (options.mem_lock == SHM_MEMLOCK_ALL) {
+    ret = mlock(ptr_, mapped_size_);
+  } else if (options.mem_lock == SHM_MEMLOCK_ON_FAULT) {
+    ret = mlock2(ptr_, mapped_size_, MLOCK_ONFAULT);
+  }
+  if (ret == -1) {
+    PRINT_ERRMSG("Can not mlock " << name_ << ", check RLIMIT_MEMLOCK", errno);
+  } else {
+    mem_locked_ = options.mem_lock != SHM_MEMLOCK_NONE;
+  }
+  if (options.prefault != SHM_PREFAULT_NONE || options.mem_lock != SHM_MEMLOCK_NONE) {
+    resident_pages_ = CountResidentPages(ptr_, mapped_size_);
+  }
+}
+
+void ShmHandle::StartFlush(const ShmHandleOptions &options) {
+  if (backing_ != SHM_BACKING_FILE || (prot_ & PROT_WRITE) == 0) {
+    return;
+  }
+  flush_policy_ = options.flush_policy;
+  if (flush_policy_ == SHM_FLUSH_PERIODIC) {
+    flusher_.reset(new ShmFlusher(this, std::max(options.flush_interval_ms, 1)));
+  }
+}
+
+bool ShmHandle::FlushRange(size_t offset, size_t len, bool wait) {
+  if (!IsValid()) {
+    return false;
+  }
+  if (backing_ != SHM_BACKING_FILE || offset >= size_ || len == 0) {
+    return true;
+  }
+  len = std::min(len, size_ - offset);
+  /* msync 要求起始地址按页对齐 */
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t start = offset / page * page;
+  if (wait) {
+    if (msync(static_cast<char *>(ptr_) + start, offset + len - start, MS_SYNC) == -1) {
+      PRINT_ERRMSG("Can not msync " << path_, errno);
+      return false;
+    }
+    return true;
+  }
+  /* Linux 上 MS_ASYNC 什么都不做，直接对页缓存中的脏页发起回写 */
+  if (sync_file_range(fd_, start, offset + len - start, SYNC_FILE_RANGE_WRITE) == -1) {
+    PRINT_ERRMSG("Can not start writeback of " << path_, errno);
+    return false;
+  }
+  return true;
+}
+
+bool ShmHandle::Resize(size_t new_size) {
+  if (!IsValid() || new_size == 0) {
+    return false;
+  }
+  size_t file_size =
+      page_size_ == SHM_PAGE_DEFAULT ? new_size : RoundUp(new_size, 1UL << page_size_);
+  if (ftruncate(fd_, file_size) == -1) {
+    PRINT_ERRMSG("Can not ftruncate the size to " << file_size << " for " << name_, errno);
+    return false;
+  }
+  return Remap(new_size);
+}
+
+bool ShmHandle::Remap(size_t new_size) {
+  if (!IsValid() || new_size == 0) {
+    return false;
+  }
+  size_t new_mapped_size =
+      page_size_ == SHM_PAGE_DEFAULT ? new_size : RoundUp(new_size, 1UL << page_size_);
+  std::unique_lock<std::mutex> lock;
+  if (flusher_ && flusher_->Owned()) {
+    lock = std::unique_lock<std::mutex>(flusher_->mutex);
+  }
+  if (new_mapped_size != mapped_size_) {
+    /* mremap 会保留原映射的权限、NUMA 策略和 mlock 状态 */
+    void *ptr = mremap(ptr_, mapped_size_, new_mapped_size, MREMAP_MAYMOVE);
+    if (ptr == MAP_FAILED) {
+      PRINT_ERRMSG("Can not mremap " << name_ << " to " << new_mapped_size, errno);
+      return false;
+    }
+    ptr_ = ptr;
+    mapped_size_ = new_mapped_size;
+  }
+  size_ = new_size;
+  return true;
+}
+
+bool ShmHandle::Seal(int seals) {
+  if (!IsValid()) {
+    return false;
+  }
+  if ((seals & F_SEAL_WRITE) == 0 || (prot_ & PROT_WRITE) == 0) {
+    if (fcntl(fd_, F_ADD_SEALS, seals) == -1) {
+      PRINT_ERRMSG("Can not seal " << name_ << " with " << seals, errno);
+      return false;
+    }
+    return true;
+  }
+  /*
+   * 可读写打开的 fd 上的共享映射即使是只读的也可能被 mprotect 成可写，内核一律视为可写映射，
+   * 因此先解除映射，加上封印之后再只读映射回来；失败时恢复原来的映射
+   */
+  munmap(ptr_, mapped_size_);
+  bool sealed = fcntl(fd_, F_ADD_SEALS, seals) == 0;
+  if (!sealed) {
+    PRINT_ERRMSG("Can not seal " << name_ << " with " << seals
+                                 << (errno == EBUSY ? ", writable mappings still exist" : ""),
+                 errno);
+  } else {
+    prot_ = PROT_READ;
+  }
+  ptr_ = mmap(nullptr, mapped_size_, prot_, MAP_SHARED, fd_, 0);
+  if (ptr_ == MAP_FAILED) {
+    PRINT_ERRMSG("Can not remap " << name_ << " after sealing", errno);
+    ptr_ = nullptr;
+    close(fd_);
+    fd_ = -1;
+    size_ = 0;
+    mapped_size_ = 0;
+    return false;
+  }
+  if (mem_locked_ && mlock(ptr_, mapped_size_) == -1) {
+    mem_locked_ = false;
+  }
+  return sealed;
+}
+
+int ShmHandle::GetSeals() const { return fcntl(fd_, F_GET_SEALS); }
+
+bool ShmHandle::SendTo(int socket) const {
+  if (!IsValid()) {
+    return false;
+  }
+  char byte = 0;
+  struct iovec iov = {&byte, 1};
+  union {
+    struct cmsghdr header;
+    char buf[CMSG_SPACE(sizeof(int))];
+  } control;
+  memset(&control, 0, sizeof(control));
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &fd_, sizeof(int));
+  ssize_t ret;
+  do {
+    ret = sendmsg(socket, &msg, MSG_NOSIGNAL);
+  } while (ret == -1 && errno == EINTR);
+  if (ret != 1) {
+    PRINT_ERRMSG("Can not send fd of " << name_ << " over socket " << socket, errno);
+    return false;
+  }
+  return true;
+}
+
+int ShmHandle::ReceiveFd(int socket) {
+  char byte;
+  struct iovec iov = {&byte, 1};
+  /* 留出多个描述符的空间，对端多发的描述符也会被安装到本进程，需要逐个关闭 */
+  union {
+    struct cmsghdr header;
+    char buf[CMSG_SPACE(sizeof(int) * kShmMaxReceivedFds)];
+  } control;
+  memset(&control, 0, sizeof(control));
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  ssize_t ret;
+  do {
+    ret = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+  } while (ret == -1 && errno == EINTR);
+  if (ret != 1) {
+    if (ret == -1) {
+      PRINT_ERRMSG("Can not receive fd over socket " << socket, errno);
+    }
+    return -1;
+  }
+  int fd = -1;
+  size_t extra = 0;
+  for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+    size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    for (size_t i = 0; i < count; ++i) {
+      int received;
+      memcpy(&received, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+      if (fd == -1) {
+        fd = received;
+      } else {
+        close(received);
+        ++extra;
+      }
+    }
+  }
+  if (fd == -1) {
+    SIMPLE_ERROR("No fd received over socket " << socket);
+    return -1;
+  }
+  if (extra != 0 || (msg.msg_flags & MSG_CTRUNC) != 0) {
+    SIMPLE_WARN("Received more than one fd over socket " << socket << ", only the first is kept");
+  }
+  return fd;
 }
 
 ShmHandle::~ShmHandle() {
@@ -105,10 +844,21 @@ ShmHandle::~ShmHandle() {
   int fd_back = fd_;
 #endif
   if (IsValid()) {
-    int ret = munmap(ptr_, size_);
+    if (flusher_ && !flusher_->Owned()) {
+      /* fork 出的子进程中析构锁和条件变量可能永远阻塞，只能放弃这个对象 */
+      flusher_.release();
+    }
+    flusher_.reset();
+    if (flush_policy_ != SHM_FLUSH_NONE) {
+      Flush(flush_policy_ != SHM_FLUSH_ASYNC);
+    }
+    int ret = munmap(ptr_, mapped_size_);
     close(fd_);
     HANDLE_ERR(ret, "Can not munmap for " << ptr_);
-    if (auto_unlink_) {
+    if (auto_unlink_ && !path_.empty()) {
+      ret = unlink(path_.c_str());
+      HANDLE_ERR(ret, "Can not unlink " << path_);
+    } else if (auto_unlink_ && backing_ == SHM_BACKING_POSIX) {
       std::string real_shmname = ConcatStringLimited(kShmNamePrefix, name_, NAME_MAX);
       ret = shm_unlink(real_shmname.c_str());
       HANDLE_ERR(ret, "Can not shm_unlink " << real_shmname);
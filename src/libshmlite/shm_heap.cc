@@ -0,0 +1,342 @@
+#include "libshmlite/shm_heap.h"
+#include <algorithm>
+
+namespace shmlite {
+
+constexpr uint64_t kShmHeapMagicV1 = 0x5348'4d48'4541'5031ULL; /**< "SHMHEAP1"，旧布局 */
+constexpr uint64_t kShmHeapMagic = 0x5348'4d48'4541'5032ULL;   /**< "SHMHEAP2" */
+constexpr uint32_t kChunkFree = 0;                             /**< 空闲的 chunk */
+constexpr uint32_t kChunkLarge = 0xfffffff0;                   /**< 大对象的第一个 chunk */
+constexpr uint32_t kChunkLargeTail = 0xfffffff1;               /**< 大对象的后续 chunk */
+
+/**
+ * @brief 小对象的规格，每个规格是前一个的 1.5 或 2 倍
+ *
+ */
+constexpr size_t kSizeClasses[kShmHeapNumSizeClasses] = {
+    16,   32,   48,   64,   96,   128,  192,  256,  384,   512,
+    768,  1024, 1536, 2048, 3072, 4096, 6144, 8192, 12288, 16384,
+};
+
+static_assert(kSizeClasses[kShmHeapNumSizeClasses - 1] == kShmHeapMaxSmallSize,
+              "the last size class must be kShmHeapMaxSmallSize");
+
+/* 小对象 chunk 的元信息存放 规格 + 1，0 留给空闲 chunk */
+static inline uint32_t SmallKind(size_t size_class) { return static_cast<uint32_t>(size_class + 1); }
+
+static inline bool IsSmallKind(uint32_t kind) {
+  return kind != kChunkFree && kind <= kShmHeapNumSizeClasses;
+}
+
+size_t ShmHeapArena::SizeClassFor(size_t size) {
+  if (size > kShmHeapMaxSmallSize) {
+    return kShmHeapNumSizeClasses;
+  }
+  return std::lower_bound(kSizeClasses, kSizeClasses + kShmHeapNumSizeClasses, size) - kSizeClasses;
+}
+
+size_t ShmHeapArena::ClassSize(size_t size_class) { return kSizeClasses[size_class]; }
+
+bool ShmHeapArena::Init(size_t size) {
+  ShmMutexGuard guard(lock);
+  if (magic == kShmHeapMagic) {
+    if (total_size != size) {
+      SIMPLE_ERROR("ShmHeap size mismatch: existing " << total_size << ", requested " << size);
+      return false;
+    }
+    return true;
+  }
+  if (magic == kShmHeapMagicV1) {
+    SIMPLE_ERROR("ShmHeap was created with an older layout, unlink and recreate it");
+    return false;
+  }
+  /* chunk 元信息数组紧跟在控制信息之后，第一个 chunk 按照 chunk 大小对齐 */
+  uint64_t count = size / kShmHeapChunkSize;
+  uint64_t offset = 0;
+  for (; count > 0; --count) {
+    offset = sizeof(ShmHeapArena) + sizeof(ShmHeapChunk) * count;
+    offset = (offset + kShmHeapChunkSize - 1) / kShmHeapChunkSize * kShmHeapChunkSize;
+    if (offset + count * kShmHeapChunkSize <= size) {
+      break;
+    }
+  }
+  if (count == 0) {
+    SIMPLE_ERROR("ShmHeap size " << size << " is too small");
+    return false;
+  }
+  total_size = size;
+  chunk_count = count;
+  data_offset = offset;
+  std::fill(partial_chunks, partial_chunks + kShmHeapNumSizeClasses, 0);
+  std::fill(Chunks(), Chunks() + count, ShmHeapChunk{});
+  used_bytes = 0;
+  chunks_in_use = 0;
+  magic = kShmHeapMagic;
+  return true;
+}
+
+uint64_t ShmHeapArena::TakeChunks(uint64_t n, uint32_t kind) {
+  ShmHeapChunk *chunks = Chunks();
+  uint64_t run = 0;
+  for (uint64_t idx = 0; idx < chunk_count; ++idx) {
+    run = chunks[idx].kind == kChunkFree ? run + 1 : 0;
+    if (run == n) {
+      uint64_t first = idx + 1 - n;
+      chunks[first] = ShmHeapChunk{};
+      chunks[first].kind = kind;
+      for (uint64_t i = first + 1; i < first + n; ++i) {
+        chunks[i].kind = kChunkLargeTail;
+      }
+      chunks_in_use += n;
+      return first;
+    }
+  }
+  return chunk_count;
+}
+
+void ShmHeapArena::LinkPartial(size_t size_class, uint64_t idx) {
+  ShmHeapChunk *chunks = Chunks();
+  uint32_t head = partial_chunks[size_class];
+  chunks[idx].prev = 0;
+  chunks[idx].next = head;
+  if (head != 0) {
+    chunks[head - 1].prev = static_cast<uint32_t>(idx + 1);
+  }
+  partial_chunks[size_class] = static_cast<uint32_t>(idx + 1);
+}
+
+void ShmHeapArena::UnlinkPartial(size_t size_class, uint64_t idx) {
+  ShmHeapChunk *chunks = Chunks();
+  ShmHeapChunk &chunk = chunks[idx];
+  if (chunk.prev != 0) {
+    chunks[chunk.prev - 1].next = chunk.next;
+  } else {
+    partial_chunks[size_class] = chunk.next;
+  }
+  if (chunk.next != 0) {
+    chunks[chunk.next - 1].prev = chunk.prev;
+  }
+  chunk.prev = 0;
+  chunk.next = 0;
+}
+
+/* chunk 中既没有空闲块，也没有可以切分的空间 */
+static inline bool ChunkFull(const ShmHeapChunk &chunk, size_t block) {
+  return chunk.free_head == 0 && chunk.carved + block > kShmHeapChunkSize;
+}
+
+uint64_t ShmHeapArena::PopBlock(size_t size_class) {
+  uint32_t head = partial_chunks[size_class];
+  if (head == 0) {
+    /* 没有未满的 chunk，启用一个新的 */
+    uint64_t idx = TakeChunks(1, SmallKind(size_class));
+    if (idx == chunk_count) {
+      return kShmNullOffset;
+    }
+    LinkPartial(size_class, idx);
+    head = static_cast<uint32_t>(idx + 1);
+  }
+  uint64_t idx = head - 1;
+  ShmHeapChunk &chunk = Chunks()[idx];
+  size_t block = kSizeClasses[size_class];
+  uint64_t start = ChunkOffset(idx);
+  uint32_t in_chunk;
+  if (chunk.free_head != 0) {
+    in_chunk = chunk.free_head - 1;
+    chunk.free_head = *static_cast<uint32_t *>(ToPtr(start + in_chunk));
+  } else {
+    in_chunk = chunk.carved;
+    chunk.carved += block;
+  }
+  ++chunk.used;
+  if (ChunkFull(chunk, block)) {
+    UnlinkPartial(size_class, idx);
+  }
+  used_bytes += block;
+  return start + in_chunk;
+}
+
+void ShmHeapArena::PushBlock(size_t size_class, uint64_t offset) {
+  uint64_t idx = ChunkIndex(offset);
+  ShmHeapChunk &chunk = Chunks()[idx];
+  size_t block = kSizeClasses[size_class];
+  bool was_full = ChunkFull(chunk, block);
+  *static_cast<uint32_t *>(ToPtr(offset)) = chunk.free_head;
+  chunk.free_head = static_cast<uint32_t>(offset - ChunkOffset(idx)) + 1;
+  --chunk.used;
+  used_bytes -= block;
+  if (was_full) {
+    LinkPartial(size_class, idx);
+  }
+  bool only_partial = partial_chunks[size_class] == idx + 1 && chunk.next == 0;
+  if (chunk.used == 0 && !only_partial) {
+    /* 块全部释放了，chunk 归还给所有规格和大对象共用 */
+    UnlinkPartial(size_class, idx);
+    chunk.kind = kChunkFree;
+    --chunks_in_use;
+  }
+}
+
+uint64_t ShmHeapArena::Allocate(size_t size) {
+  if (size == 0) {
+    size = 1;
+  }
+  ShmMutexGuard guard(lock);
+  size_t size_class = SizeClassFor(size);
+  if (size_class < kShmHeapNumSizeClasses) {
+    return PopBlock(size_class);
+  }
+  uint64_t n = (size + kShmHeapChunkSize - 1) / kShmHeapChunkSize;
+  uint64_t idx = TakeChunks(n, kChunkLarge);
+  if (idx == chunk_count) {
+    return kShmNullOffset;
+  }
+  used_bytes += n * kShmHeapChunkSize;
+  return data_offset + idx * kShmHeapChunkSize;
+}
+
+void ShmHeapArena::Deallocate(uint64_t offset) {
+  if (offset == kShmNullOffset) {
+    return;
+  }
+  if (offset < data_offset || offset >= total_size) {
+    SIMPLE_ERROR("ShmHeap can not deallocate invalid offset " << offset);
+    return;
+  }
+  ShmMutexGuard guard(lock);
+  ShmHeapChunk *chunks = Chunks();
+  uint64_t idx = ChunkIndex(offset);
+  uint32_t kind = chunks[idx].kind;
+  if (IsSmallKind(kind)) {
+    PushBlock(kind - 1, offset);
+  } else if (kind == kChunkLarge && offset == ChunkOffset(idx)) {
+    uint64_t end = idx + 1;
+    while (end < chunk_count && chunks[end].kind == kChunkLargeTail) {
+      ++end;
+    }
+    for (uint64_t i = idx; i < end; ++i) {
+      chunks[i].kind = kChunkFree;
+    }
+    chunks_in_use -= end - idx;
+    used_bytes -= (end - idx) * kShmHeapChunkSize;
+  } else {
+    SIMPLE_ERROR("ShmHeap can not deallocate invalid offset " << offset);
+  }
+}
+
+size_t ShmHeapArena::AllocateBatch(size_t size_class, uint64_t *out, size_t n) {
+  ShmMutexGuard guard(lock);
+  size_t got = 0;
+  for (; got < n; ++got) {
+    out[got] = PopBlock(size_class);
+    if (out[got] == kShmNullOffset) {
+      break;
+    }
+  }
+  return got;
+}
+
+void ShmHeapArena::DeallocateBatch(size_t size_class, const uint64_t *offsets, size_t n) {
+  ShmMutexGuard guard(lock);
+  for (size_t i = 0; i < n; ++i) {
+    PushBlock(size_class, offsets[i]);
+  }
+}
+
+size_t ShmHeapArena::SizeClassOf(uint64_t offset) const {
+  if (offset < data_offset || offset >= total_size) {
+    return kShmHeapNumSizeClasses;
+  }
+  uint32_t kind = Chunks()[ChunkIndex(offset)].kind;
+  return IsSmallKind(kind) ? kind - 1 : kShmHeapNumSizeClasses;
+}
+
+size_t ShmHeapArena::UsableSize(uint64_t offset) const {
+  if (offset < data_offset || offset >= total_size) {
+    return 0;
+  }
+  const ShmHeapChunk *chunks = Chunks();
+  uint64_t idx = ChunkIndex(offset);
+  if (IsSmallKind(chunks[idx].kind)) {
+    return kSizeClasses[chunks[idx].kind - 1];
+  }
+  if (chunks[idx].kind != kChunkLarge) {
+    return 0;
+  }
+  uint64_t end = idx + 1;
+  while (end < chunk_count && chunks[end].kind == kChunkLargeTail) {
+    ++end;
+  }
+  return (end - idx) * kShmHeapChunkSize;
+}
+
+ShmHeapStats ShmHeapArena::Stats() {
+  ShmMutexGuard guard(lock);
+  return ShmHeapStats{chunk_count * kShmHeapChunkSize, used_bytes, chunks_in_use, chunk_count};
+}
+
+ShmHeap::ShmHeap(const std::string &name, size_t size) {
+  handle_ = std::make_shared<ShmHandle>(name, size, ShmHandle::CREAT_RDWR);
+  if (!handle_->IsValid()) {
+    SIMPLE_ERROR("Can not allocate shm heap of desired size " << size);
+    return;
+  }
+  auto *arena = reinterpret_cast<ShmHeapArena *>(handle_->Ptr());
+  if (arena->Init(size)) {
+    arena_ = arena;
+  }
+#ifdef DEV_DEBUG
+  SIMPLE_DEBUG("ShmHeap [" << name << "] size = " << size << ", valid = " << IsValid());
+#endif
+}
+
+ShmHeap::~ShmHeap() {
+  if (IsValid()) {
+    FlushCache();
+  }
+}
+
+uint64_t ShmHeap::Allocate(size_t size) {
+  size_t size_class = ShmHeapArena::SizeClassFor(size == 0 ? 1 : size);
+  if (size_class == kShmHeapNumSizeClasses) {
+    return arena_->Allocate(size);
+  }
+  std::vector<uint64_t> &cache = cache_[size_class];
+  if (cache.empty()) {
+    /* 本地缓存为空，一次从共享的堆中取一批 */
+    cache.resize(kCacheBatch);
+    cache.resize(arena_->AllocateBatch(size_class, cache.data(), kCacheBatch));
+    if (cache.empty()) {
+      return kShmNullOffset;
+    }
+  }
+  uint64_t offset = cache.back();
+  cache.pop_back();
+  return offset;
+}
+
+void ShmHeap::Deallocate(uint64_t offset) {
+  size_t size_class = arena_->SizeClassOf(offset);
+  if (size_class == kShmHeapNumSizeClasses) {
+    arena_->Deallocate(offset);
+    return;
+  }
+  std::vector<uint64_t> &cache = cache_[size_class];
+  cache.push_back(offset);
+  if (cache.size() >= 2 * kCacheBatch) {
+    /* 本地缓存过多，归还一半给共享的堆 */
+    arena_->DeallocateBatch(size_class, cache.data() + kCacheBatch, cache.size() - kCacheBatch);
+    cache.resize(kCacheBatch);
+  }
+}
+
+void ShmHeap::FlushCache() {
+  for (size_t i = 0; i < kShmHeapNumSizeClasses; ++i) {
+    if (!cache_[i].empty()) {
+      arena_->DeallocateBatch(i, cache_[i].data(), cache_[i].size());
+      cache_[i].clear();
+    }
+  }
+}
+
+}  // namespace shmlite
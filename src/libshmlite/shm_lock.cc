@@ -3,18 +3,90 @@
 
 namespace shmlite {
 
+namespace {
+
+/* sem_clockwait 从 glibc 2.30 开始提供，更早的版本只能使用 CLOCK_REALTIME 的 sem_timedwait */
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 30))
+#define LIBSHMLITE_HAS_SEM_CLOCKWAIT 1
+constexpr clockid_t kShmLockClock = CLOCK_MONOTONIC; /**< WaitFor 的截止时间使用的时钟 */
+#else
+#define LIBSHMLITE_HAS_SEM_CLOCKWAIT 0
+constexpr clockid_t kShmLockClock = CLOCK_REALTIME; /**< WaitFor 的截止时间使用的时钟 */
+#endif
+
+uint64_t MonotonicNs() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+}
+
+void StoreMax(std::atomic<uint64_t> &target, uint64_t value) {
+  uint64_t current = target.load(std::memory_order_relaxed);
+  while (value > current &&
+         !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+ShmLockStats LoadStats(const ShmLockCounters &counters) {
+  ShmLockStats stats;
+  stats.acquisitions = counters.acquisitions.load(std::memory_order_relaxed);
+  stats.contended = counters.contended.load(std::memory_order_relaxed);
+  stats.timeouts = counters.timeouts.load(std::memory_order_relaxed);
+  stats.total_wait_ns = counters.total_wait_ns.load(std::memory_order_relaxed);
+  stats.max_wait_ns = counters.max_wait_ns.load(std::memory_order_relaxed);
+  stats.total_hold_ns = counters.total_hold_ns.load(std::memory_order_relaxed);
+  stats.max_hold_ns = counters.max_hold_ns.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}  // namespace
+
 bool ShmLock::UnLink(const std::string &name) {
   std::string real_shmname = ConcatStringLimited(kShmLockNamePrefix, name, SHMLOCK_NAME_MAX);
   SIMPLE_DEBUG("real_shmname = " << real_shmname);
+  /* 没有开启竞争统计时统计不存在，删除失败（ENOENT）可以忽略 */
+  ShmHandle::UnLink(name + kShmLockStatsSuffix);
   return sem_unlink(real_shmname.c_str()) == 0;
 }
 
-ShmLock::ShmLock(std::string name, unsigned int value, bool auto_unlink)
+bool ShmLock::ReadStats(const std::string &name, ShmLockStats &stats) {
+  /* 直接以只读方式打开，不需要对 /dev/shm 的写权限，也不会与创建统计的进程竞争 */
+  std::string real_shmname =
+      ConcatStringLimited(kShmNamePrefix, name + kShmLockStatsSuffix, NAME_MAX);
+  int fd = shm_open(real_shmname.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd == -1) {
+    if (errno != ENOENT) {
+      PRINT_ERRMSG("Can not open lock stats " << real_shmname, errno);
+    }
+    return false;
+  }
+  ShmHandle handle(fd, name + kShmLockStatsSuffix, ShmHandle::READ_ONLY);
+  if (!handle.IsValid() || handle.GetSize() < sizeof(ShmLockCounters)) {
+    return false;
+  }
+  stats = LoadStats(*static_cast<const ShmLockCounters *>(handle.Ptr()));
+  return true;
+}
+
+ShmLock::ShmLock(std::string name, unsigned int value, bool auto_unlink, bool enable_stats)
     : NamedClass(std::move(name)), auto_unlink_(auto_unlink) {
   std::string real_semname = ConcatStringLimited(kShmLockNamePrefix, name_, SHMLOCK_NAME_MAX);
   sem_ptr_ = sem_open(real_semname.c_str(), O_CREAT, 0640, value);
   if (sem_ptr_ == SEM_FAILED) {
     PRINT_ERRMSG("Can not initialize sem_t " << name_, errno);
+    sem_ptr_ = nullptr;
+    return;
+  }
+  if (enable_stats) {
+    /* 新建的共享内存全为 0，正好是统计的初始状态 */
+    stats_handle_.reset(new ShmHandle(name_ + kShmLockStatsSuffix, sizeof(ShmLockCounters),
+                                      ShmHandle::CREAT_RDWR));
+    if (stats_handle_->IsValid()) {
+      stats_ = static_cast<ShmLockCounters *>(stats_handle_->Ptr());
+    } else {
+      SIMPLE_WARN("Can not open lock stats of " << name_ << ", stats disabled");
+      stats_handle_.reset();
+    }
   }
 #ifdef DEV_DEBUG
   SIMPLE_DEBUG("sem_t " << real_semname << " (" << sem_ptr_ << ") created");
@@ -22,8 +94,12 @@ ShmLock::ShmLock(std::string name, unsigned int value, bool auto_unlink)
 }
 
 ShmLock::~ShmLock() {
-  int ret = sem_close(sem_ptr_);
-  HANDLE_ERR(ret, "Can not sem_close " << name_);
+  if (sem_ptr_ != nullptr) {
+    int ret = sem_close(sem_ptr_);
+    HANDLE_ERR(ret, "Can not sem_close " << name_);
+  }
+  stats_ = nullptr;
+  stats_handle_.reset();
   if (auto_unlink_) {
     ShmLock::UnLink(name_);
   }
@@ -33,13 +109,118 @@ ShmLock::~ShmLock() {
 }
 
 void ShmLock::Post() {
+  if (stats_ != nullptr && acquired_at_ns_ != 0) {
+    uint64_t hold_ns = MonotonicNs() - acquired_at_ns_;
+    acquired_at_ns_ = 0;
+    stats_->total_hold_ns.fetch_add(hold_ns, std::memory_order_relaxed);
+    StoreMax(stats_->max_hold_ns, hold_ns);
+  }
   int ret = sem_post(sem_ptr_);
   HANDLE_ERR(ret, "Can not sem_post " << name_);
 }
 
 void ShmLock::Wait() {
-  int ret = sem_wait(sem_ptr_);
+  if (stats_ == nullptr) {
+    int ret = sem_wait(sem_ptr_);
+    HANDLE_ERR(ret, "Can not sem_wait " << name_);
+    return;
+  }
+  /* 先无阻塞地尝试一次，失败才算作一次竞争 */
+  if (sem_trywait(sem_ptr_) == 0) {
+    RecordAcquire(0);
+    return;
+  }
+  uint64_t wait_start_ns = MonotonicNs();
+  int ret;
+  do {
+    ret = sem_wait(sem_ptr_);
+  } while (ret == -1 && errno == EINTR);
   HANDLE_ERR(ret, "Can not sem_wait " << name_);
+  if (ret == 0) {
+    RecordAcquire(wait_start_ns);
+  }
+}
+
+bool ShmLock::TryWait() {
+  if (sem_trywait(sem_ptr_) == 0) {
+    RecordAcquire(0);
+    return true;
+  }
+  if (errno != EAGAIN) {
+    PRINT_ERRMSG("Can not sem_trywait " << name_, errno);
+  } else if (stats_ != nullptr) {
+    stats_->timeouts.fetch_add(1, std::memory_order_relaxed);
+  }
+  return false;
+}
+
+bool ShmLock::WaitFor(const struct timespec &timeout) {
+  if (sem_trywait(sem_ptr_) == 0) {
+    RecordAcquire(0);
+    return true;
+  }
+  uint64_t wait_start_ns = stats_ != nullptr ? MonotonicNs() : 0;
+  /* 用 CLOCK_MONOTONIC 的截止时间，等待时修改系统时间不会让超时提前或者推迟 */
+  struct timespec deadline = {};
+  clock_gettime(kShmLockClock, &deadline);
+  deadline.tv_sec += timeout.tv_sec;
+  deadline.tv_nsec += timeout.tv_nsec;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+  }
+  int ret;
+  do {
+#if LIBSHMLITE_HAS_SEM_CLOCKWAIT
+    ret = sem_clockwait(sem_ptr_, kShmLockClock, &deadline);
+#else
+    ret = sem_timedwait(sem_ptr_, &deadline);
+#endif
+  } while (ret == -1 && errno == EINTR);
+  if (ret == 0) {
+    RecordAcquire(wait_start_ns);
+    return true;
+  }
+  if (errno != ETIMEDOUT) {
+    PRINT_ERRMSG("Can not wait for " << name_, errno);
+  } else if (stats_ != nullptr) {
+    stats_->timeouts.fetch_add(1, std::memory_order_relaxed);
+  }
+  return false;
+}
+
+void ShmLock::RecordAcquire(uint64_t wait_start_ns) {
+  if (stats_ == nullptr) {
+    return;
+  }
+  acquired_at_ns_ = MonotonicNs();
+  stats_->acquisitions.fetch_add(1, std::memory_order_relaxed);
+  if (wait_start_ns != 0) {
+    uint64_t wait_ns = acquired_at_ns_ - wait_start_ns;
+    stats_->contended.fetch_add(1, std::memory_order_relaxed);
+    stats_->total_wait_ns.fetch_add(wait_ns, std::memory_order_relaxed);
+    StoreMax(stats_->max_wait_ns, wait_ns);
+  }
+}
+
+ShmLockStats ShmLock::GetStats() const {
+  if (stats_ == nullptr) {
+    return ShmLockStats();
+  }
+  return LoadStats(*stats_);
+}
+
+void ShmLock::ResetStats() {
+  if (stats_ == nullptr) {
+    return;
+  }
+  stats_->acquisitions.store(0, std::memory_order_relaxed);
+  stats_->contended.store(0, std::memory_order_relaxed);
+  stats_->timeouts.store(0, std::memory_order_relaxed);
+  stats_->total_wait_ns.store(0, std::memory_order_relaxed);
+  stats_->max_wait_ns.store(0, std::memory_order_relaxed);
+  stats_->total_hold_ns.store(0, std::memory_order_relaxed);
+  stats_->max_hold_ns.store(0, std::memory_order_relaxed);
 }
 
 int ShmLock::GetValue() const {
@@ -49,4 +230,4 @@ int ShmLock::GetValue() const {
   return value;
 }
 
-} // namespace shmlite
\ No newline at end of file
+} // namespace shmlite
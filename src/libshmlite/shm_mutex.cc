@@ -0,0 +1,115 @@
+#include "libshmlite/shm_mutex.h"
+#include <linux/futex.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+
+namespace shmlite {
+
+constexpr uint32_t kShmMutexMaxSpin = 100; /**< 自旋次数的上限 */
+constexpr long kShmRobustInitPollNs = 100 * 1000 * 1000; /**< 检查初始化者是否存活的间隔 */
+
+void ShmMutex::LockSlow() {
+  /* 自适应自旋：以最近成功自旋的次数为参考，类似 PTHREAD_MUTEX_ADAPTIVE_NP */
+  uint32_t spin = spin_.load(std::memory_order_relaxed);
+  uint32_t max_spin = std::min(kShmMutexMaxSpin, spin * 2 + 10);
+  for (uint32_t cnt = 0; cnt < max_spin; ++cnt) {
+    CpuRelax();
+    uint32_t expected = kUnlocked;
+    if (state_.load(std::memory_order_relaxed) == kUnlocked &&
+        state_.compare_exchange_weak(expected, kLocked, std::memory_order_acquire,
+                                     std::memory_order_relaxed)) {
+      /* 自旋成功，更新估计值 */
+      int32_t delta = static_cast<int32_t>(cnt) - static_cast<int32_t>(spin);
+      spin_.store(static_cast<uint32_t>(static_cast<int32_t>(spin) + delta / 8),
+                  std::memory_order_relaxed);
+      return;
+    }
+  }
+  spin_.store(std::min(kShmMutexMaxSpin, spin + 1), std::memory_order_relaxed);
+
+  /* 自旋失败，标记为有等待者并进入内核睡眠 */
+  uint32_t cur = state_.exchange(kContended, std::memory_order_acquire);
+  while (cur != kUnlocked) {
+    FutexWait(&state_, kContended);
+    cur = state_.exchange(kContended, std::memory_order_acquire);
+  }
+}
+
+void ShmRobustMutex::InitSlow() {
+  /* PID 和正在初始化的标记放在同一个字中，一次 CAS 同时发布，不会出现看不到初始化者的窗口 */
+  const uint32_t self = static_cast<uint32_t>(getpid()) << 1 | kInitializing;
+  const struct timespec poll = {0, kShmRobustInitPollNs};
+  uint32_t state = init_state_.load(std::memory_order_acquire);
+  for (;;) {
+    if (state == kInitialized) {
+      return;
+    }
+    if (state == kUninitialized) {
+      if (init_state_.compare_exchange_strong(state, self, std::memory_order_acquire)) {
+        break;
+      }
+      continue;
+    }
+    /* 其它进程正在初始化，等待其完成；超时之后检查它是否还活着，只有一个等待者能够接管 */
+    if (FutexWait(&init_state_, state, &poll) == -1 && errno == ETIMEDOUT) {
+      pid_t pid = static_cast<pid_t>(state >> 1);
+      if (kill(pid, 0) == -1 && errno == ESRCH &&
+          init_state_.compare_exchange_strong(state, self, std::memory_order_acquire)) {
+        SIMPLE_WARN("Initializer " << pid << " of robust mutex exited, take over");
+        break;
+      }
+    }
+    state = init_state_.load(std::memory_order_acquire);
+  }
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  int ret = pthread_mutex_init(&mutex_, &attr);
+  pthread_mutexattr_destroy(&attr);
+  if (ret != 0) {
+    PRINT_ERRMSG("Can not initialize robust mutex", ret);
+  }
+  init_state_.store(kInitialized, std::memory_order_release);
+  FutexWake(&init_state_, INT32_MAX);
+}
+
+bool ShmRobustMutex::MarkConsistent() {
+  int ret = pthread_mutex_consistent(&mutex_);
+  if (ret != 0) {
+    PRINT_ERRMSG("Can not mark robust mutex consistent", ret);
+  }
+  return ret == 0;
+}
+
+pid_t ShmRobustMutex::GetOwnerTid() const {
+  if (init_state_.load(std::memory_order_acquire) != kInitialized) {
+    return 0;
+  }
+#ifdef __GLIBC__
+  /* glibc 的锁字即内核 robust futex 使用的字：低位为持有者的TID，高位是 FUTEX_WAITERS/FUTEX_OWNER_DIED 标志 */
+  return static_cast<pid_t>(static_cast<uint32_t>(mutex_.__data.__lock) & FUTEX_TID_MASK);
+#else
+  return 0;
+#endif
+}
+
+ShmRobustMutex::LockStatus ShmRobustMutex::ToStatus(int ret) {
+  switch (ret) {
+    case 0:
+      return OK;
+    case EOWNERDEAD:
+      return OWNER_DIED;
+    case EBUSY:
+      return BUSY;
+    case ENOTRECOVERABLE:
+      return NOT_RECOVERABLE;
+    default:
+      PRINT_ERRMSG("Can not lock robust mutex", ret);
+      return ERROR;
+  }
+}
+
+}  // namespace shmlite
@@ -0,0 +1,89 @@
+#include "libshmlite/shm_rwlock.h"
+#include <sched.h>
+
+namespace shmlite {
+
+static_assert((kShmRwLockReaderSlots & (kShmRwLockReaderSlots - 1)) == 0,
+              "kShmRwLockReaderSlots must be a power of two");
+
+/**
+ * @brief 当前 CPU 对应的读者槽
+ *
+ */
+static inline size_t CurrentSlot() {
+  int cpu = sched_getcpu();
+  return cpu < 0 ? 0 : static_cast<size_t>(cpu) & (kShmRwLockReaderSlots - 1);
+}
+
+bool ShmRwLock::TryEnterRead(size_t slot) {
+  /* 与写者的 writer_ 写入和读者计数检查构成 Dekker 式的同步，需要 seq_cst */
+  slots_[slot].count.fetch_add(1, std::memory_order_seq_cst);
+  if (writer_.load(std::memory_order_seq_cst) == 0) {
+    return true;
+  }
+  slots_[slot].count.fetch_sub(1, std::memory_order_release);
+  writer_event_.NotifyOne();
+  return false;
+}
+
+size_t ShmRwLock::ReadLock() {
+  for (;;) {
+    size_t slot = CurrentSlot();
+    if (TryEnterRead(slot)) {
+      return slot;
+    }
+    readers_event_.Wait([this] { return writer_.load(std::memory_order_acquire) == 0; });
+  }
+}
+
+bool ShmRwLock::TryReadLock(size_t &slot) {
+  slot = CurrentSlot();
+  return writer_.load(std::memory_order_relaxed) == 0 && TryEnterRead(slot);
+}
+
+void ShmRwLock::ReadUnlock(size_t slot) {
+  slots_[slot].count.fetch_sub(1, std::memory_order_release);
+  /* 没有等待的写者时只是一次读取 */
+  writer_event_.NotifyOne();
+}
+
+uint32_t ShmRwLock::Readers() const {
+  /*
+   * 写者先写 writer_ 再统计读者，读者先增加计数再读 writer_：两边都必须是 seq_cst，
+   * 否则写者的读取可以越过之前的写入，与读者同时认为对方不存在
+   */
+  uint32_t sum = 0;
+  for (const ReaderSlot &slot : slots_) {
+    sum += slot.count.load(std::memory_order_seq_cst);
+  }
+  return sum;
+}
+
+void ShmRwLock::WriteLock() {
+  writer_mutex_.Lock();
+  auto no_readers = [this] { return Readers() == 0; };
+  if (GetPreference() == SHM_RWLOCK_PREFER_WRITER) {
+    /* 先宣告，新的读者会等待，已有的读者退出之后写者进入 */
+    writer_.store(1, std::memory_order_seq_cst);
+    writer_event_.Wait(no_readers);
+    return;
+  }
+  /* 读者优先：只在没有读者时尝试进入，失败就撤回让读者继续 */
+  for (;;) {
+    writer_event_.Wait(no_readers);
+    writer_.store(1, std::memory_order_seq_cst);
+    if (no_readers()) {
+      return;
+    }
+    writer_.store(0, std::memory_order_seq_cst);
+    readers_event_.NotifyAll();
+  }
+}
+
+void ShmRwLock::WriteUnlock() {
+  writer_.store(0, std::memory_order_seq_cst);
+  readers_event_.NotifyAll();
+  writer_mutex_.Unlock();
+}
+
+}  // namespace shmlite
@@ -0,0 +1,103 @@
+#include "libshmlite/shm_segment.h"
+#include <signal.h>
+#include <unistd.h>
+#include <climits>
+#include "libshmlite/futex_utils.h"
+
+namespace shmlite {
+
+constexpr long kInitPollNs = 100 * 1000 * 1000; /**< 等待初始化时检查创建者是否存活的间隔 */
+
+/**
+ * @brief 等待其它进程完成初始化
+ *
+ * 创建者在声明初始化的同一个原子操作中写入了自己的 PID，因此这里总能拿到它；
+ * state 在创建者写入 INITIALIZING 之前可能还是 EMPTY，两种状态都需要等待。PID 为 0 说明
+ * 段不是按照 ClaimSegment 的协议初始化的，也当作初始化失败处理。
+ *
+ * @param header 段的头部
+ * @param name 段的名字，只用于日志
+ * @return uint32_t 等待结束时的状态，创建者已经退出时返回 SHM_SEGMENT_INITIALIZING
+ */
+static uint32_t WaitInitialized(ShmSegmentHeader *header, const std::string &name) {
+  const struct timespec poll = {0, kInitPollNs};
+  uint32_t state = header->state.load(std::memory_order_acquire);
+  while (state == SHM_SEGMENT_EMPTY || state == SHM_SEGMENT_INITIALIZING) {
+    if (FutexWait(&header->state, state, &poll) == -1 && errno == ETIMEDOUT) {
+      pid_t pid = header->creator_pid.load(std::memory_order_relaxed);
+      if (pid <= 0 || (kill(pid, 0) == -1 && errno == ESRCH)) {
+        state = header->state.load(std::memory_order_acquire);
+        if (state == SHM_SEGMENT_READY) {
+          break;
+        }
+        SIMPLE_ERROR("Creator " << pid << " of segment " << name
+                                << " exited during initialization, unlink and recreate it");
+        return SHM_SEGMENT_INITIALIZING;
+      }
+    }
+    state = header->state.load(std::memory_order_acquire);
+  }
+  return state;
+}
+
+bool ClaimSegment(ShmSegmentHeader *header) {
+  int32_t expected = 0;
+  if (!header->creator_pid.compare_exchange_strong(expected, getpid(),
+                                                   std::memory_order_acquire)) {
+    return false;
+  }
+  header->state.store(SHM_SEGMENT_INITIALIZING, std::memory_order_relaxed);
+  return true;
+}
+
+ShmSegmentStatus AttachSegment(ShmSegmentHeader *header, const ShmSegmentLayout &layout,
+                               const std::string &name, const ShmSegmentInitializer &init) {
+  uint32_t state = header->state.load(std::memory_order_acquire);
+  if (state == SHM_SEGMENT_EMPTY && ClaimSegment(header)) {
+    header->magic = kShmSegmentMagic;
+    header->version = kShmSegmentLayoutVersion;
+    header->header_size = sizeof(ShmSegmentHeader);
+    header->type_hash = layout.type_hash;
+    header->elem_size = layout.elem_size;
+    header->elem_count = layout.elem_count;
+    if (init) {
+      init(header + 1);
+    }
+    /* 初始数据写完之后才发布，附加者看到 READY 时一定能看到初始数据 */
+    header->state.store(SHM_SEGMENT_READY, std::memory_order_release);
+    FutexWake(&header->state, INT_MAX);
+    return SHM_SEGMENT_CREATED;
+  }
+  if (state == SHM_SEGMENT_EMPTY || state == SHM_SEGMENT_INITIALIZING) {
+    state = WaitInitialized(header, name);
+    if (state == SHM_SEGMENT_INITIALIZING) {
+      return SHM_SEGMENT_INIT_FAILED;
+    }
+  }
+  if (state != SHM_SEGMENT_READY || header->magic != kShmSegmentMagic) {
+    SIMPLE_ERROR("Segment " << name << " is not a libshmlite segment or is corrupted");
+    return SHM_SEGMENT_BAD_MAGIC;
+  }
+  if (header->version != kShmSegmentLayoutVersion ||
+      header->header_size != sizeof(ShmSegmentHeader)) {
+    SIMPLE_ERROR("Segment " << name << " has layout version " << header->version
+                            << ", expected " << kShmSegmentLayoutVersion);
+    return SHM_SEGMENT_BAD_VERSION;
+  }
+  if (header->type_hash != layout.type_hash || header->elem_size != layout.elem_size) {
+    SIMPLE_ERROR("Segment " << name << " (layout version " << header->version
+                            << ") holds elements of another type: type hash 0x" << std::hex
+                            << header->type_hash << ", size " << std::dec << header->elem_size
+                            << ", requested type hash 0x" << std::hex << layout.type_hash
+                            << ", size " << std::dec << layout.elem_size);
+    return SHM_SEGMENT_TYPE_MISMATCH;
+  }
+  if (header->elem_count != layout.elem_count) {
+    SIMPLE_ERROR("Segment " << name << " holds " << header->elem_count << " elements, requested "
+                            << layout.elem_count);
+    return SHM_SEGMENT_SIZE_MISMATCH;
+  }
+  return SHM_SEGMENT_ATTACHED;
+}
+
+}  // namespace shmlite
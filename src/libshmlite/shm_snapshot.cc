@@ -0,0 +1,824 @@
+#include "libshmlite/shm_snapshot.h"
+#include <sched.h>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <vector>
+#include "libshmlite/futex_utils.h"
+
+namespace shmlite {
+
+constexpr uint64_t kShmSnapshotMagic = 0x50414e534c4d534cULL; /**< "LSMLSNAP"，快照文件的魔数 */
+constexpr uint64_t kShmJournalMagic = 0x4c4e524a4c4d534cULL;  /**< "LSMLJRNL"，检查点日志的魔数 */
+constexpr const char *kShmJournalSuffix = ".journal";          /**< 检查点日志的文件名后缀 */
+constexpr uint32_t kShmSnapshotVersion = 1;                     /**< 快照文件格式的版本 */
+
+/**
+ * @brief 快照文件头部的标志
+ *
+ */
+enum ShmSnapshotFlag : uint32_t {
+  SHM_SNAPSHOT_SEGMENT_HEADER = 1, /**< 段以已经初始化的 ShmSegmentHeader 开头 */
+};
+
+/**
+ * @brief 快照文件的头部，独占文件的第一个 kShmSnapshotAlign 字节，之后是段的数据，
+ * 数据补零到 kShmSnapshotAlign 的整数倍，所以文件中的每一页都可以用 O_DIRECT 读写
+ *
+ */
+struct ShmSnapshotFileHeader {
+  uint64_t magic;        /**< 魔数 kShmSnapshotMagic */
+  uint32_t version;      /**< 文件格式的版本 kShmSnapshotVersion */
+  uint32_t flags;        /**< 参考 ShmSnapshotFlag */
+  uint64_t segment_size; /**< 段的大小，单位（字节） */
+  uint64_t checkpoints;  /**< 完整快照之后已经写回的增量检查点个数 */
+  uint64_t generation;   /**< 每次完整快照时重新生成，检查点日志只对同一个完整快照有效 */
+};
+
+static_assert(sizeof(ShmSnapshotFileHeader) <= kShmSnapshotAlign, "snapshot header too large");
+
+/**
+ * @brief 按 kShmSnapshotAlign 对齐的缓冲区，O_DIRECT 要求用户缓冲区对齐
+ *
+ */
+class AlignedBuffer {
+ public:
+  explicit AlignedBuffer(size_t size) : size_(size) {
+    if (posix_memalign(&data_, kShmSnapshotAlign, size) != 0) {
+      data_ = nullptr;
+    } else {
+      memset(data_, 0, size);
+    }
+  }
+  ~AlignedBuffer() { free(data_); }
+
+  LIBSHMLITE_NO_COPYABLE(AlignedBuffer)
+
+  char *Data() const { return static_cast<char *>(data_); }
+  size_t Size() const { return size_; }
+
+ private:
+  void *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+static inline size_t AlignUp(size_t size) {
+  return (size + kShmSnapshotAlign - 1) / kShmSnapshotAlign * kShmSnapshotAlign;
+}
+
+static inline std::string JournalPath(const std::string &path) { return path + kShmJournalSuffix; }
+
+/**
+ * @brief 打开快照文件，文件系统不支持 O_DIRECT 时回退为普通读写
+ *
+ * @param path 路径
+ * @param oflags 打开标志
+ * @param direct_io 是否使用 O_DIRECT
+ * @return int 文件描述符，失败时返回 -1
+ */
+static int OpenSnapshotFile(const std::string &path, int oflags, bool direct_io) {
+  oflags |= O_CLOEXEC;
+  if (direct_io) {
+    int fd = open(path.c_str(), oflags | O_DIRECT, 0644);
+    if (fd != -1 || errno != EINVAL) {
+      return fd;
+    }
+    SIMPLE_WARN("File system of " << path << " does not support O_DIRECT, use buffered io");
+  }
+  return open(path.c_str(), oflags, 0644);
+}
+
+/**
+ * @brief 写入全部数据，处理信号中断和部分写入
+ *
+ * @return true 成功
+ * @return false 失败，errno 为错误码
+ */
+static bool PWriteAll(int fd, const char *buf, size_t len, off_t offset) {
+  while (len > 0) {
+    ssize_t n = pwrite(fd, buf, len, offset);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    buf += n;
+    len -= n;
+    offset += n;
+  }
+  return true;
+}
+
+/**
+ * @brief 读取全部数据，处理信号中断和部分读取
+ *
+ * @return true 成功
+ * @return false 失败或者文件提前结束，errno 为错误码
+ */
+static bool PReadAll(int fd, char *buf, size_t len, off_t offset) {
+  while (len > 0) {
+    ssize_t n = pread(fd, buf, len, offset);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (n == 0) {
+      errno = ENODATA;
+      return false;
+    }
+    buf += n;
+    len -= n;
+    offset += n;
+  }
+  return true;
+}
+
+/**
+ * @brief 分块写入数据，每块不超过 chunk_size
+ *
+ * @return true 成功
+ * @return false 失败，errno 为错误码
+ */
+static bool WriteChunks(int fd, const char *buf, size_t len, off_t offset, size_t chunk_size) {
+  while (len > 0) {
+    size_t n = std::min(len, chunk_size);
+    if (!PWriteAll(fd, buf, n, offset)) {
+      return false;
+    }
+    buf += n;
+    len -= n;
+    offset += n;
+  }
+  return true;
+}
+
+/**
+ * @brief 写入文件头部
+ *
+ * @return true 成功
+ * @return false 失败
+ */
+static bool WriteFileHeader(int fd, const ShmSnapshotFileHeader &header, const std::string &path) {
+  AlignedBuffer buf(kShmSnapshotAlign);
+  if (buf.Data() == nullptr) {
+    SIMPLE_ERROR("Can not allocate io buffer for snapshot " << path);
+    return false;
+  }
+  memcpy(buf.Data(), &header, sizeof(header));
+  if (!PWriteAll(fd, buf.Data(), buf.Size(), 0)) {
+    PRINT_ERRMSG("Can not write header of snapshot " << path, errno);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief 读取并校验文件头部
+ *
+ * @return true 是快照文件
+ * @return false 读取失败或者不是快照文件
+ */
+static bool ReadFileHeader(int fd, ShmSnapshotFileHeader &header, const std::string &path) {
+  AlignedBuffer buf(kShmSnapshotAlign);
+  if (buf.Data() == nullptr || !PReadAll(fd, buf.Data(), buf.Size(), 0)) {
+    return false;
+  }
+  memcpy(&header, buf.Data(), sizeof(header));
+  if (header.magic != kShmSnapshotMagic || header.version != kShmSnapshotVersion) {
+    SIMPLE_ERROR(path << " is not a libshmlite snapshot or has another format version");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief sync 为 true 时 fdatasync 文件
+ *
+ * @return true 成功或者不需要落盘
+ * @return false 失败
+ */
+static bool DataSync(int fd, const std::string &path, bool sync) {
+  if (sync && fdatasync(fd) == -1) {
+    PRINT_ERRMSG("Can not fdatasync snapshot " << path, errno);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief 落盘 path 所在的目录，使 rename 持久化
+ *
+ * @param path 文件路径
+ */
+static void SyncParentDir(const std::string &path) {
+  size_t pos = path.rfind('/');
+  std::string dir = pos == std::string::npos ? "." : (pos == 0 ? "/" : path.substr(0, pos));
+  int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd == -1 || fsync(fd) == -1) {
+    PRINT_ERRMSG("Can not fsync directory " << dir, errno);
+  }
+  if (fd != -1) {
+    close(fd);
+  }
+}
+
+/**
+ * @brief 在 seq 为偶数时开始一次复制，seq 为空时总是可以开始
+ *
+ * @param seq seqlock 序号
+ * @param start 返回开始时的序号
+ * @return true 可以开始
+ * @return false 写者正在修改
+ */
+static bool BeginCopy(const std::atomic<uint64_t> *seq, uint64_t &start) {
+  if (seq == nullptr) {
+    return true;
+  }
+  start = seq->load(std::memory_order_acquire);
+  return (start & 1) == 0;
+}
+
+/**
+ * @brief 复制结束之后检查序号是否变化
+ *
+ * @return true 复制期间没有写者修改过数据
+ * @return false 需要重试
+ */
+static bool EndCopy(const std::atomic<uint64_t> *seq, uint64_t start) {
+  if (seq == nullptr) {
+    return true;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return seq->load(std::memory_order_relaxed) == start;
+}
+
+/**
+ * @brief 段以已经初始化的 ShmSegmentHeader 开头时返回 SHM_SNAPSHOT_SEGMENT_HEADER，否则返回 0
+ *
+ */
+static uint32_t SegmentFlags(const void *data, size_t size) {
+  if (size < sizeof(ShmSegmentHeader)) {
+    return 0;
+  }
+  auto *header = static_cast<const ShmSegmentHeader *>(data);
+  bool ready = header->state.load(std::memory_order_acquire) == SHM_SEGMENT_READY &&
+               header->magic == kShmSegmentMagic && header->header_size == sizeof(ShmSegmentHeader);
+  return ready ? static_cast<uint32_t>(SHM_SNAPSHOT_SEGMENT_HEADER) : 0;
+}
+
+ShmDirtyTracker::ShmDirtyTracker(const std::string &name, size_t segment_size, size_t page_size)
+    : segment_size_(segment_size) {
+  while ((1UL << page_shift_) < page_size) {
+    ++page_shift_;
+  }
+  size_t pages = (segment_size + PageSize() - 1) >> page_shift_;
+  size_t words = std::max<size_t>((pages + 63) / 64, 1);
+  std::string bitmap_name = name + kShmDirtySuffix;
+  handle_ = std::make_shared<ShmHandle>(bitmap_name, SegmentAllocSize<uint64_t>(words),
+                                        ShmHandle::CREAT_RDWR);
+  if (!handle_->IsValid()) {
+    return;
+  }
+  auto *header = static_cast<ShmSegmentHeader *>(handle_->Ptr());
+  if (!IsSegmentUsable(AttachSegment(header, MakeSegmentLayout<uint64_t>(words), bitmap_name))) {
+    SIMPLE_ERROR("Dirty bitmap " << bitmap_name << " was created with another segment size or page size");
+    return;
+  }
+  words_ = reinterpret_cast<std::atomic<uint64_t> *>(SegmentData<uint64_t>(header));
+  word_count_ = words;
+}
+
+size_t ShmDirtyTracker::CountDirty() const {
+  size_t count = 0;
+  for (size_t i = 0; i < word_count_; ++i) {
+    count += __builtin_popcountll(words_[i].load(std::memory_order_relaxed));
+  }
+  return count;
+}
+
+/**
+ * @brief 检查位图是否属于这个段
+ *
+ */
+static bool CheckTracker(const ShmHandle &handle, const ShmDirtyTracker &tracker) {
+  if (!tracker.IsValid() || tracker.SegmentSize() != handle.GetSize()) {
+    SIMPLE_ERROR("Dirty bitmap does not match segment " << handle.GetName() << " of size "
+                                                        << handle.GetSize());
+    return false;
+  }
+  return true;
+}
+
+bool SaveSnapshot(const ShmHandle &handle, const std::string &path,
+                  const ShmSnapshotOptions &options, ShmDirtyTracker *tracker,
+                  ShmSnapshotStats *stats) {
+  if (!handle.IsValid()) {
+    SIMPLE_ERROR("Can not save snapshot of invalid segment " << handle.GetName());
+    return false;
+  }
+  if (tracker != nullptr && !CheckTracker(handle, *tracker)) {
+    return false;
+  }
+  std::string tmp_path = path + ".tmp";
+  int fd = OpenSnapshotFile(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, options.direct_io);
+  if (fd == -1) {
+    PRINT_ERRMSG("Can not create snapshot " << tmp_path, errno);
+    return false;
+  }
+  /* 先清空位图再复制，复制期间的修改会被重新标记，由下一个检查点写入 */
+  if (tracker != nullptr) {
+    for (size_t i = 0; i < tracker->Words(); ++i) {
+      tracker->TakeWord(i);
+    }
+  }
+  const char *data = static_cast<const char *>(handle.Ptr());
+  size_t size = handle.GetSize();
+  size_t chunk_size = AlignUp(std::max<size_t>(options.chunk_size, 1));
+  uint64_t generation = std::chrono::system_clock::now().time_since_epoch().count() ^
+                        (static_cast<uint64_t>(getpid()) << 40);
+  ShmSnapshotFileHeader header = {kShmSnapshotMagic, kShmSnapshotVersion, 0, size, 0, generation};
+  bool ok = false;
+  uint32_t retries = 0;
+  for (int attempt = 0; attempt <= options.max_retries && !ok; ++attempt) {
+    uint64_t start = 0;
+    if (!BeginCopy(options.seq, start)) {
+      ++retries;
+      sched_yield();
+      continue;
+    }
+    /* 映射总是整页的，所以补齐到 kShmSnapshotAlign 不会越过映射 */
+    if (!WriteChunks(fd, data, AlignUp(size), kShmSnapshotAlign, chunk_size)) {
+      PRINT_ERRMSG("Can not write snapshot " << tmp_path, errno);
+      break;
+    }
+    header.flags = SegmentFlags(data, size);
+    ok = EndCopy(options.seq, start);
+    retries += ok ? 0 : 1;
+  }
+  if (!ok && retries > static_cast<uint32_t>(options.max_retries)) {
+    SIMPLE_ERROR("Segment " << handle.GetName() << " kept changing during snapshot");
+  }
+  ok = ok && WriteFileHeader(fd, header, tmp_path) && DataSync(fd, tmp_path, options.sync);
+  close(fd);
+  if (ok && rename(tmp_path.c_str(), path.c_str()) == -1) {
+    PRINT_ERRMSG("Can not rename " << tmp_path << " to " << path, errno);
+    ok = false;
+  }
+  if (!ok) {
+    unlink(tmp_path.c_str());
+    if (tracker != nullptr) {
+      tracker->MarkAll(); /* 清空的标记已经丢失，下一个检查点需要写入整个段 */
+    }
+    return false;
+  }
+  unlink(JournalPath(path).c_str()); /* 旧的日志属于上一个完整快照，generation 不同，不会再被使用 */
+  if (options.sync) {
+    SyncParentDir(path);
+  }
+  if (stats != nullptr) {
+    stats->bytes_written = AlignUp(size);
+    stats->pages_written = 0;
+    stats->retries = retries;
+  }
+  return true;
+}
+
+bool SaveSnapshot(const std::string &name, const std::string &path,
+                  const ShmSnapshotOptions &options, ShmDirtyTracker *tracker,
+                  ShmSnapshotStats *stats) {
+  ShmHandle handle(name, 0, ShmHandle::READ_ONLY);
+  return SaveSnapshot(handle, path, options, tracker, stats);
+}
+
+/**
+ * @brief 位图中第 page 页是否被标记
+ *
+ */
+static inline bool TestPage(const std::vector<uint64_t> &bits, size_t page) {
+  return (bits[page / 64] & (1ULL << (page % 64))) != 0;
+}
+
+/**
+ * @brief 第 page 页在文件中的长度，最后一页补齐到 kShmSnapshotAlign
+ *
+ */
+static inline size_t PageLength(uint64_t page, size_t page_size, size_t size) {
+  return std::min((page + 1) * page_size, AlignUp(size)) - page * page_size;
+}
+
+/**
+ * @brief 把若干页从段中写入文件，连续的页合并为一次写入
+ *
+ * @param pages 升序排列的页号
+ * @param base 文件中第一页的偏移量
+ * @param packed 为 true 时第 i 个页写入 base 之后的第 i 个位置（日志），否则写入页号对应的位置（快照）
+ * @return true 成功
+ * @return false 失败，errno 为错误码
+ */
+static bool WritePages(int fd, const char *data, size_t size, size_t page_size,
+                       const std::vector<uint64_t> &pages, off_t base, bool packed,
+                       size_t chunk_size) {
+  size_t i = 0;
+  while (i < pages.size()) {
+    size_t j = i + 1;
+    while (j < pages.size() && pages[j] == pages[j - 1] + 1) {
+      ++j;
+    }
+    size_t offset = pages[i] * page_size;
+    size_t len = (pages[j - 1] - pages[i]) * page_size + PageLength(pages[j - 1], page_size, size);
+    off_t file_offset = base + (packed ? i : pages[i]) * page_size;
+    if (!WriteChunks(fd, data + offset, len, file_offset, chunk_size)) {
+      return false;
+    }
+    i = j;
+  }
+  return true;
+}
+
+/**
+ * @brief 检查点日志的头部，独占日志文件的第一个 kShmSnapshotAlign 字节，之后是补齐到
+ * kShmSnapshotAlign 的页号数组，再之后按页号的顺序存放各页的新内容，每页占 page_size 字节
+ *
+ */
+struct ShmSnapshotJournalHeader {
+  uint64_t magic;        /**< 魔数 kShmJournalMagic */
+  uint32_t version;      /**< 文件格式的版本 kShmSnapshotVersion */
+  uint32_t reserved;     /**< 保留，为 0 */
+  uint64_t generation;   /**< 所基于的完整快照的 generation */
+  uint64_t checkpoint;   /**< 写回之后快照的检查点个数 */
+  uint64_t segment_size; /**< 段的大小，单位（字节） */
+  uint64_t page_size;    /**< 页大小，单位（字节） */
+  uint64_t page_count;   /**< 日志中的页数 */
+};
+
+static inline off_t JournalDataOffset(size_t page_count) {
+  return kShmSnapshotAlign + AlignUp(page_count * sizeof(uint64_t));
+}
+
+/**
+ * @brief 写入检查点日志 path + ".journal.tmp"，由调用者落盘并改名
+ *
+ * @return true 成功
+ * @return false 失败，errno 为错误码
+ */
+static bool WriteJournal(int fd, const ShmSnapshotJournalHeader &header,
+                         const std::vector<uint64_t> &pages, const char *data, size_t chunk_size) {
+  AlignedBuffer buf(JournalDataOffset(pages.size()));
+  if (buf.Data() == nullptr) {
+    errno = ENOMEM;
+    return false;
+  }
+  memcpy(buf.Data(), &header, sizeof(header));
+  memcpy(buf.Data() + kShmSnapshotAlign, pages.data(), pages.size() * sizeof(uint64_t));
+  return PWriteAll(fd, buf.Data(), buf.Size(), 0) &&
+         WritePages(fd, data, header.segment_size, header.page_size, pages, buf.Size(), true,
+                    chunk_size);
+}
+
+/**
+ * @brief 打开与快照匹配的检查点日志
+ *
+ * 只有基于同一个完整快照（generation 相同），并且是快照当前的检查点或者下一个检查点的日志才匹配。
+ * 日志是先落盘再改名的，存在即完整。
+ *
+ * @param path 快照文件的路径
+ * @param header 快照文件的头部
+ * @param journal 返回日志的头部
+ * @param pages 返回日志中的页号
+ * @return int 日志的文件描述符，没有匹配的日志时返回 -1
+ */
+static int OpenJournal(const std::string &path, const ShmSnapshotFileHeader &header,
+                       ShmSnapshotJournalHeader &journal, std::vector<uint64_t> &pages) {
+  std::string journal_path = JournalPath(path);
+  int fd = open(journal_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return -1;
+  }
+  AlignedBuffer buf(kShmSnapshotAlign);
+  bool ok = buf.Data() != nullptr && PReadAll(fd, buf.Data(), buf.Size(), 0);
+  if (ok) {
+    memcpy(&journal, buf.Data(), sizeof(journal));
+    ok = journal.magic == kShmJournalMagic && journal.version == kShmSnapshotVersion &&
+         journal.generation == header.generation && journal.segment_size == header.segment_size &&
+         (journal.checkpoint == header.checkpoints || journal.checkpoint == header.checkpoints + 1) &&
+         journal.page_size >= kShmSnapshotAlign && journal.page_size % kShmSnapshotAlign == 0;
+  }
+  if (ok) {
+    size_t page_limit = (header.segment_size + journal.page_size - 1) / journal.page_size;
+    pages.resize(journal.page_count);
+    ok = journal.page_count <= page_limit &&
+         PReadAll(fd, reinterpret_cast<char *>(pages.data()), pages.size() * sizeof(uint64_t),
+                  kShmSnapshotAlign);
+    for (size_t i = 0; ok && i < pages.size(); ++i) {
+      ok = pages[i] < page_limit;
+    }
+  }
+  if (!ok) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * @brief 把上一次中途失败的检查点的日志写回快照文件，日志中总是完整的新内容，重复写回没有影响
+ *
+ * @param fd 快照文件
+ * @param header 快照文件的头部，写回之后更新检查点个数
+ * @return true 成功或者没有需要写回的日志
+ * @return false 写回失败
+ */
+static bool RecoverJournal(int fd, ShmSnapshotFileHeader &header, const std::string &path,
+                           const ShmSnapshotOptions &options) {
+  ShmSnapshotJournalHeader journal;
+  std::vector<uint64_t> pages;
+  int journal_fd = OpenJournal(path, header, journal, pages);
+  if (journal_fd == -1) {
+    return true;
+  }
+  bool ok = true;
+  if (journal.checkpoint == header.checkpoints + 1) {
+    AlignedBuffer buf(journal.page_size);
+    off_t base = JournalDataOffset(pages.size());
+    ok = buf.Data() != nullptr;
+    for (size_t i = 0; ok && i < pages.size(); ++i) {
+      size_t len = PageLength(pages[i], journal.page_size, header.segment_size);
+      ok = PReadAll(journal_fd, buf.Data(), len, base + i * journal.page_size) &&
+           PWriteAll(fd, buf.Data(), len, kShmSnapshotAlign + pages[i] * journal.page_size);
+    }
+    if (!ok) {
+      PRINT_ERRMSG("Can not replay journal of snapshot " << path, errno);
+    }
+    header.checkpoints = journal.checkpoint;
+    ok = ok && DataSync(fd, path, options.sync) && WriteFileHeader(fd, header, path) &&
+         DataSync(fd, path, options.sync);
+  }
+  close(journal_fd);
+  return ok;
+}
+
+bool CheckpointSnapshot(const ShmHandle &handle, ShmDirtyTracker &tracker, const std::string &path,
+                        const ShmSnapshotOptions &options, ShmSnapshotStats *stats) {
+  if (!handle.IsValid()) {
+    SIMPLE_ERROR("Can not checkpoint invalid segment " << handle.GetName());
+    return false;
+  }
+  if (!CheckTracker(handle, tracker)) {
+    return false;
+  }
+  int fd = OpenSnapshotFile(path, O_RDWR, options.direct_io);
+  ShmSnapshotFileHeader header;
+  if (fd == -1 || !ReadFileHeader(fd, header, path) || header.segment_size != handle.GetSize() ||
+      !RecoverJournal(fd, header, path, options)) {
+    /* 没有可以在其上增量写入的快照 */
+    if (fd != -1) {
+      close(fd);
+    }
+    return SaveSnapshot(handle, path, options, &tracker, stats);
+  }
+  std::vector<uint64_t> taken(tracker.Words());
+  for (size_t i = 0; i < taken.size(); ++i) {
+    taken[i] = tracker.TakeWord(i);
+  }
+  size_t size = handle.GetSize();
+  size_t page_size = tracker.PageSize();
+  std::vector<uint64_t> pages;
+  uint64_t bytes = 0;
+  for (size_t page = 0; page * page_size < size; ++page) {
+    if (TestPage(taken, page)) {
+      pages.push_back(page);
+      bytes += PageLength(page, page_size, size);
+    }
+  }
+  const char *data = static_cast<const char *>(handle.Ptr());
+  size_t chunk_size = AlignUp(std::max<size_t>(options.chunk_size, 1));
+  ShmSnapshotJournalHeader journal = {kShmJournalMagic, kShmSnapshotVersion, 0,
+                                      header.generation, header.checkpoints + 1, size,
+                                      page_size, pages.size()};
+  /* 先把新内容完整地写入日志并改名提交，之后才原地修改快照文件，任何时刻崩溃都能恢复出一个完整的检查点 */
+  std::string journal_path = JournalPath(path);
+  std::string tmp_path = journal_path + ".tmp";
+  int journal_fd = OpenSnapshotFile(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, options.direct_io);
+  if (journal_fd == -1) {
+    PRINT_ERRMSG("Can not create journal " << tmp_path, errno);
+  }
+  uint32_t retries = 0;
+  bool ok = false;
+  for (int attempt = 0; journal_fd != -1 && attempt <= options.max_retries && !ok; ++attempt) {
+    uint64_t start = 0;
+    if (!BeginCopy(options.seq, start)) {
+      ++retries;
+      sched_yield();
+      continue;
+    }
+    if (!WriteJournal(journal_fd, journal, pages, data, chunk_size)) {
+      PRINT_ERRMSG("Can not write journal " << tmp_path, errno);
+      break;
+    }
+    header.flags = SegmentFlags(data, size);
+    ok = EndCopy(options.seq, start);
+    retries += ok ? 0 : 1;
+  }
+  if (!ok && retries > static_cast<uint32_t>(options.max_retries)) {
+    SIMPLE_ERROR("Segment " << handle.GetName() << " kept changing during checkpoint");
+  }
+  if (journal_fd != -1) {
+    ok = ok && DataSync(journal_fd, tmp_path, options.sync);
+    close(journal_fd);
+  }
+  if (ok && rename(tmp_path.c_str(), journal_path.c_str()) == -1) {
+    PRINT_ERRMSG("Can not rename " << tmp_path << " to " << journal_path, errno);
+    ok = false;
+  }
+  if (!ok) {
+    unlink(tmp_path.c_str());
+  } else {
+    if (options.sync) {
+      SyncParentDir(path);
+    }
+    /* 日志已经提交，写回失败时恢复和下一个检查点都会重放日志 */
+    header.checkpoints = journal.checkpoint;
+    ok = WritePages(fd, data, size, page_size, pages, kShmSnapshotAlign, false, chunk_size) &&
+         DataSync(fd, path, options.sync) && WriteFileHeader(fd, header, path) &&
+         DataSync(fd, path, options.sync);
+  }
+  close(fd);
+  if (!ok) {
+    /* 这些页留给下一个检查点 */
+    for (size_t i = 0; i < taken.size(); ++i) {
+      tracker.RestoreWord(i, taken[i]);
+    }
+    return false;
+  }
+  if (stats != nullptr) {
+    stats->bytes_written = bytes;
+    stats->pages_written = pages.size();
+    stats->retries = retries;
+  }
+  return true;
+}
+
+bool CheckpointSnapshot(const std::string &name, ShmDirtyTracker &tracker, const std::string &path,
+                        const ShmSnapshotOptions &options, ShmSnapshotStats *stats) {
+  ShmHandle handle(name, 0, ShmHandle::READ_ONLY);
+  return CheckpointSnapshot(handle, tracker, path, options, stats);
+}
+
+/**
+ * @brief 把文件中的数据读入段，第一页经过 bounce 缓冲区以便跳过段头部，其余的页直接读入映射
+ *
+ * @param skip 开头不写入段的字节数
+ * @param first_page 返回文件中数据的第一页
+ * @return true 成功
+ * @return false 失败，errno 为错误码
+ */
+static bool ReadData(int fd, char *data, size_t size, size_t chunk_size, size_t skip,
+                     AlignedBuffer &first_page) {
+  size_t padded = AlignUp(size);
+  if (!PReadAll(fd, first_page.Data(), first_page.Size(), kShmSnapshotAlign)) {
+    return false;
+  }
+  memcpy(data + skip, first_page.Data() + skip, std::min(size, first_page.Size()) - skip);
+  for (size_t offset = first_page.Size(); offset < padded; offset += chunk_size) {
+    size_t n = std::min(chunk_size, padded - offset);
+    if (!PReadAll(fd, data + offset, n, kShmSnapshotAlign + offset)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief 把匹配的检查点日志重放到段中，覆盖快照文件中可能只写回了一部分的页
+ *
+ * @param skip 开头不写入段的字节数，这部分内容更新到 first_page 中
+ * @return true 成功或者没有匹配的日志
+ * @return false 读取失败，errno 为错误码
+ */
+static bool ReplayJournal(const std::string &path, const ShmSnapshotFileHeader &header, char *data,
+                          size_t skip, AlignedBuffer &first_page) {
+  ShmSnapshotJournalHeader journal;
+  std::vector<uint64_t> pages;
+  int fd = OpenJournal(path, header, journal, pages);
+  if (fd == -1) {
+    return true;
+  }
+  off_t base = JournalDataOffset(pages.size());
+  bool ok = true;
+  for (size_t i = 0; ok && i < pages.size(); ++i) {
+    size_t offset = pages[i] * journal.page_size;
+    size_t len = PageLength(pages[i], journal.page_size, header.segment_size);
+    off_t file_offset = base + i * journal.page_size;
+    if (offset == 0) {
+      /* 第一页中包含段头部，经过 first_page 中转，其余的部分直接读入映射 */
+      ok = PReadAll(fd, first_page.Data(), first_page.Size(), file_offset) &&
+           PReadAll(fd, data + first_page.Size(), len - first_page.Size(),
+                    file_offset + first_page.Size());
+      size_t n = std::min<size_t>(header.segment_size, first_page.Size());
+      if (ok) {
+        memcpy(data + skip, first_page.Data() + skip, n - skip);
+      }
+    } else {
+      ok = PReadAll(fd, data + offset, len, file_offset);
+    }
+  }
+  close(fd);
+  return ok;
+}
+
+bool RestoreSnapshot(const std::string &path, const std::string &name,
+                     const ShmSnapshotOptions &options, const ShmHandleOptions &handle_options) {
+  int fd = OpenSnapshotFile(path, O_RDONLY, options.direct_io);
+  if (fd == -1) {
+    PRINT_ERRMSG("Can not open snapshot " << path, errno);
+    return false;
+  }
+  ShmSnapshotFileHeader file_header;
+  if (!ReadFileHeader(fd, file_header, path)) {
+    close(fd);
+    return false;
+  }
+  if (file_header.segment_size == 0) {
+    SIMPLE_ERROR("Snapshot " << path << " is empty");
+    close(fd);
+    return false;
+  }
+  size_t size = file_header.segment_size;
+  ShmHandle handle(name, size, ShmHandle::CREAT_RDWR, handle_options);
+  if (!handle.IsValid() || !handle.IsCreator()) {
+    SIMPLE_ERROR("Can not restore " << path << " into " << name
+                                    << ", the segment already exists or can not be created");
+    close(fd);
+    return false;
+  }
+  char *data = static_cast<char *>(handle.Ptr());
+  auto *live = reinterpret_cast<ShmSegmentHeader *>(data);
+  bool segment_header = (file_header.flags & SHM_SNAPSHOT_SEGMENT_HEADER) != 0 &&
+                        size >= sizeof(ShmSegmentHeader);
+  if (segment_header) {
+    /* 与 AttachSegment 相同的协议，同时打开的进程等待恢复完成，而不是把它当作空段初始化 */
+    if (!ClaimSegment(live)) {
+      SIMPLE_ERROR("Segment " << name << " was initialized by another process before restore");
+      close(fd);
+      return false;
+    }
+  }
+  size_t chunk_size = AlignUp(std::max<size_t>(options.chunk_size, 1));
+  size_t skip = segment_header ? sizeof(ShmSegmentHeader) : 0;
+  AlignedBuffer first_page(kShmSnapshotAlign);
+  bool ok = first_page.Data() != nullptr && ReadData(fd, data, size, chunk_size, skip, first_page) &&
+            ReplayJournal(path, file_header, data, skip, first_page);
+  if (!ok) {
+    PRINT_ERRMSG("Can not read snapshot " << path, errno);
+  }
+  close(fd);
+  if (segment_header && ok) {
+    auto *saved = reinterpret_cast<const ShmSegmentHeader *>(first_page.Data());
+    live->magic = saved->magic;
+    live->version = saved->version;
+    live->header_size = saved->header_size;
+    live->type_hash = saved->type_hash;
+    live->elem_size = saved->elem_size;
+    live->elem_count = saved->elem_count;
+    live->state.store(SHM_SEGMENT_READY, std::memory_order_release);
+    FutexWake(&live->state, INT_MAX);
+  } else if (segment_header) {
+    /* 标记为放弃并唤醒，正在等待的进程会得到 SHM_SEGMENT_BAD_MAGIC，而不是一直等下去 */
+    live->state.store(SHM_SEGMENT_ABANDONED, std::memory_order_release);
+    FutexWake(&live->state, INT_MAX);
+  }
+  if (!ok) {
+    ShmHandle::UnLink(name); /* 不留下只恢复了一部分的段 */
+  }
+  return ok;
+}
+
+bool ReadSnapshotInfo(const std::string &path, ShmSnapshotInfo &info) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return false;
+  }
+  ShmSnapshotFileHeader header;
+  bool ok = ReadFileHeader(fd, header, path);
+  close(fd);
+  if (!ok) {
+    return false;
+  }
+  ShmSnapshotJournalHeader journal;
+  std::vector<uint64_t> pages;
+  int journal_fd = OpenJournal(path, header, journal, pages);
+  info.segment_size = header.segment_size;
+  info.checkpoints = header.checkpoints;
+  info.journal_pending = journal_fd != -1 && journal.checkpoint == header.checkpoints + 1;
+  info.segment_header = (header.flags & SHM_SNAPSHOT_SEGMENT_HEADER) != 0;
+  if (journal_fd != -1) {
+    close(journal_fd);
+    info.checkpoints = journal.checkpoint; /* 恢复时会重放日志 */
+  }
+  return true;
+}
+
+}  // namespace shmlite
@@ -0,0 +1,571 @@
+#include "libshmlite/simd_utils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LIBSHMLITE_SIMD_X86 1
+/* 支持 AVX2 的 CPU 都支持 POPCNT */
+#define LIBSHMLITE_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#endif
+
+namespace shmlite {
+
+static std::atomic<int> g_simd_level{-1}; /**< 当前使用的指令集级别，-1 表示尚未检测 */
+static std::atomic<size_t> g_nt_threshold{0}; /**< 使用非临时存储的阈值，0 表示尚未检测 */
+
+SimdLevel DetectSimdLevel() {
+#ifdef LIBSHMLITE_SIMD_X86
+  __builtin_cpu_init();
+  /* libgcc 同时检查了操作系统是否保存 YMM 寄存器 */
+  if (__builtin_cpu_supports("avx2")) {
+    return SIMD_AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SIMD_SSE2;
+  }
+#endif
+  return SIMD_SCALAR;
+}
+
+SimdLevel GetSimdLevel() {
+  int level = g_simd_level.load(std::memory_order_relaxed);
+  if (level < 0) {
+    level = DetectSimdLevel();
+    g_simd_level.store(level, std::memory_order_relaxed);
+  }
+  return static_cast<SimdLevel>(level);
+}
+
+SimdLevel SetSimdLevel(SimdLevel level) {
+  SimdLevel actual = std::min(level, DetectSimdLevel());
+  g_simd_level.store(actual, std::memory_order_relaxed);
+  return actual;
+}
+
+size_t GetNonTemporalThreshold() {
+  size_t threshold = g_nt_threshold.load(std::memory_order_relaxed);
+  if (threshold == 0) {
+    long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (llc <= 0) {
+      llc = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    }
+    threshold = std::max<size_t>(kMinNonTemporalThreshold, llc > 0 ? llc : 0);
+    g_nt_threshold.store(threshold, std::memory_order_relaxed);
+  }
+  return threshold;
+}
+
+void SetNonTemporalThreshold(size_t threshold) {
+  g_nt_threshold.store(threshold, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 将 value 重复写满 buf
+ *
+ * 元素大小为 buf_size 的因数时，从 buf + k 开始的任意一段都是从元素第 k 个字节开始的填充内容。
+ */
+static void BuildPattern(unsigned char *buf, size_t buf_size, const void *value, size_t elem_size) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(value);
+  for (size_t i = 0; i < buf_size; ++i) {
+    buf[i] = bytes[i % elem_size];
+  }
+}
+
+/**
+ * @brief 标量填充：写入第一个元素后成倍地复制已经写好的前缀，前缀保持在 L1 缓存中
+ *
+ */
+static void FillScalar(char *dst, const void *value, size_t elem_size, size_t n) {
+  size_t bytes = elem_size * n;
+  if (bytes == 0) {
+    return;
+  }
+  if (elem_size == 1) {
+    memset(dst, *static_cast<const unsigned char *>(value), n);
+    return;
+  }
+  memcpy(dst, value, elem_size);
+  size_t max_chunk = std::max<size_t>(elem_size, 16384 / elem_size * elem_size);
+  size_t filled = elem_size;
+  while (filled < bytes) {
+    size_t chunk = std::min(std::min(filled, max_chunk), bytes - filled);
+    memcpy(dst + filled, dst, chunk);
+    filled += chunk;
+  }
+}
+
+template <typename U>
+static size_t FindTyped(const char *first, size_t n, const void *value) {
+  U v;
+  memcpy(&v, value, sizeof(U));
+  for (size_t i = 0; i < n; ++i) {
+    U x;
+    memcpy(&x, first + i * sizeof(U), sizeof(U));
+    if (x == v) {
+      return i;
+    }
+  }
+  return n;
+}
+
+template <typename U>
+static size_t CountTyped(const char *first, size_t n, const void *value) {
+  U v;
+  memcpy(&v, value, sizeof(U));
+  size_t count = 0;
+  for (size_t i = 0; i < n; ++i) {
+    U x;
+    memcpy(&x, first + i * sizeof(U), sizeof(U));
+    count += x == v;
+  }
+  return count;
+}
+
+static size_t FindScalar(const char *first, size_t n, const void *value, size_t elem_size) {
+  switch (elem_size) {
+    case 1:
+      return FindTyped<uint8_t>(first, n, value);
+    case 2:
+      return FindTyped<uint16_t>(first, n, value);
+    case 4:
+      return FindTyped<uint32_t>(first, n, value);
+    default:
+      return FindTyped<uint64_t>(first, n, value);
+  }
+}
+
+static size_t CountScalar(const char *first, size_t n, const void *value, size_t elem_size) {
+  switch (elem_size) {
+    case 1:
+      return CountTyped<uint8_t>(first, n, value);
+    case 2:
+      return CountTyped<uint16_t>(first, n, value);
+    case 4:
+      return CountTyped<uint32_t>(first, n, value);
+    default:
+      return CountTyped<uint64_t>(first, n, value);
+  }
+}
+
+template <typename S, typename T>
+static S SumScalar(const T *first, size_t n) {
+  S sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    sum += first[i];
+  }
+  return sum;
+}
+
+template <typename T, bool kMax>
+static T MinMaxScalar(const T *first, size_t n) {
+  T result = first[0];
+  for (size_t i = 1; i < n; ++i) {
+    result = kMax ? std::max(result, first[i]) : std::min(result, first[i]);
+  }
+  return result;
+}
+
+#ifdef LIBSHMLITE_SIMD_X86
+
+/**
+ * @brief 把按字节比较的掩码变为按元素比较的掩码
+ *
+ * @param mask 每一位表示一个字节是否相等
+ * @param elem_size 元素的大小
+ * @return uint32_t 只在每个元素的第一个字节的位置上置位，表示整个元素相等
+ */
+static inline uint32_t ElementMask(uint32_t mask, size_t elem_size) {
+  switch (elem_size) {
+    case 1:
+      return mask;
+    case 2:
+      return mask & (mask >> 1) & 0x55555555u;
+    case 4:
+      mask &= mask >> 1;
+      mask &= mask >> 2;
+      return mask & 0x11111111u;
+    default:
+      mask &= mask >> 1;
+      mask &= mask >> 2;
+      mask &= mask >> 4;
+      return mask & 0x01010101u;
+  }
+}
+
+/**
+ * @brief 不依赖 POPCNT 指令的位计数，SSE2 级别下 __builtin_popcount 会调用 libgcc 中的函数
+ *
+ */
+static inline uint32_t PopCount16(uint32_t x) {
+  x = x - ((x >> 1) & 0x5555u);
+  x = (x & 0x3333u) + ((x >> 2) & 0x3333u);
+  x = (x + (x >> 4)) & 0x0f0fu;
+  return (x + (x >> 8)) & 0x1fu;
+}
+
+/**
+ * @brief 向量填充：先写到对齐的位置，再以对齐的整向量写入，最后写入剩余的部分
+ *
+ * @param pattern 至少 2 * 向量宽度 字节的重复填充内容
+ */
+static void FillSse2(char *dst, size_t bytes, const unsigned char *pattern, size_t elem_size) {
+  size_t head = std::min((16 - reinterpret_cast<uintptr_t>(dst) % 16) % 16, bytes);
+  memcpy(dst, pattern, head);
+  char *p = dst + head;
+  char *end = dst + bytes;
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern + head % elem_size));
+  if (bytes >= GetNonTemporalThreshold()) {
+    for (; p + 16 <= end; p += 16) {
+      _mm_stream_si128(reinterpret_cast<__m128i *>(p), v);
+    }
+    _mm_sfence();
+  } else {
+    for (; p + 16 <= end; p += 16) {
+      _mm_store_si128(reinterpret_cast<__m128i *>(p), v);
+    }
+  }
+  memcpy(p, pattern + head % elem_size, end - p);
+}
+
+LIBSHMLITE_TARGET_AVX2
+static void FillAvx2(char *dst, size_t bytes, const unsigned char *pattern, size_t elem_size) {
+  size_t head = std::min((32 - reinterpret_cast<uintptr_t>(dst) % 32) % 32, bytes);
+  memcpy(dst, pattern, head);
+  char *p = dst + head;
+  char *end = dst + bytes;
+  __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pattern + head % elem_size));
+  if (bytes >= GetNonTemporalThreshold()) {
+    for (; p + 32 <= end; p += 32) {
+      _mm256_stream_si256(reinterpret_cast<__m256i *>(p), v);
+    }
+    _mm_sfence();
+  } else {
+    for (; p + 128 <= end; p += 128) {
+      _mm256_store_si256(reinterpret_cast<__m256i *>(p), v);
+      _mm256_store_si256(reinterpret_cast<__m256i *>(p + 32), v);
+      _mm256_store_si256(reinterpret_cast<__m256i *>(p + 64), v);
+      _mm256_store_si256(reinterpret_cast<__m256i *>(p + 96), v);
+    }
+    for (; p + 32 <= end; p += 32) {
+      _mm256_store_si256(reinterpret_cast<__m256i *>(p), v);
+    }
+  }
+  memcpy(p, pattern + head % elem_size, end - p);
+}
+
+static size_t FindSse2(const char *first, size_t n, const unsigned char *pattern,
+                       size_t elem_size) {
+  size_t bytes = n * elem_size;
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern));
+  size_t off = 0;
+  for (; off + 16 <= bytes; off += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first + off));
+    uint32_t mask = ElementMask(_mm_movemask_epi8(_mm_cmpeq_epi8(x, v)), elem_size);
+    if (mask != 0) {
+      return (off + __builtin_ctz(mask)) / elem_size;
+    }
+  }
+  return off / elem_size + FindScalar(first + off, n - off / elem_size, pattern, elem_size);
+}
+
+LIBSHMLITE_TARGET_AVX2
+static size_t FindAvx2(const char *first, size_t n, const unsigned char *pattern,
+                       size_t elem_size) {
+  size_t bytes = n * elem_size;
+  __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pattern));
+  size_t off = 0;
+  for (; off + 32 <= bytes; off += 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + off));
+    uint32_t mask = ElementMask(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, v)), elem_size);
+    if (mask != 0) {
+      return (off + __builtin_ctz(mask)) / elem_size;
+    }
+  }
+  return off / elem_size + FindScalar(first + off, n - off / elem_size, pattern, elem_size);
+}
+
+static size_t CountSse2(const char *first, size_t n, const unsigned char *pattern,
+                        size_t elem_size) {
+  size_t bytes = n * elem_size;
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern));
+  size_t count = 0;
+  size_t off = 0;
+  for (; off + 16 <= bytes; off += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first + off));
+    count += PopCount16(ElementMask(_mm_movemask_epi8(_mm_cmpeq_epi8(x, v)), elem_size));
+  }
+  return count + CountScalar(first + off, n - off / elem_size, pattern, elem_size);
+}
+
+LIBSHMLITE_TARGET_AVX2
+static size_t CountAvx2(const char *first, size_t n, const unsigned char *pattern,
+                        size_t elem_size) {
+  size_t bytes = n * elem_size;
+  __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pattern));
+  size_t count = 0;
+  size_t off = 0;
+  for (; off + 32 <= bytes; off += 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + off));
+    count += __builtin_popcount(
+        ElementMask(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, v)), elem_size));
+  }
+  return count + CountScalar(first + off, n - off / elem_size, pattern, elem_size);
+}
+
+LIBSHMLITE_TARGET_AVX2
+static int64_t SumAvx2(const int32_t *first, size_t n) {
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + i));
+    acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+    acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+  }
+  int64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(acc0, acc1));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumScalar<int64_t>(first + i, n - i);
+}
+
+LIBSHMLITE_TARGET_AVX2
+static int64_t SumAvx2(const int64_t *first, size_t n) {
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_add_epi64(acc0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + i)));
+    acc1 = _mm256_add_epi64(acc1,
+                            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + i + 4)));
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(acc0, acc1));
+  /* 与标量一样按 2^64 取模回绕 */
+  uint64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumScalar<uint64_t>(first + i, n - i);
+  return static_cast<int64_t>(sum);
+}
+
+LIBSHMLITE_TARGET_AVX2
+static double SumAvx2(const float *first, size_t n) {
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm_loadu_ps(first + i)));
+    acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm_loadu_ps(first + i + 4)));
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumScalar<double>(first + i, n - i);
+}
+
+LIBSHMLITE_TARGET_AVX2
+static double SumAvx2(const double *first, size_t n) {
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(first + i));
+    acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(first + i + 4));
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumScalar<double>(first + i, n - i);
+}
+
+/**
+ * @name 最小值、最大值归约使用的 AVX2 操作
+ * @{
+ */
+template <typename T>
+struct Avx2Ops;
+
+template <>
+struct Avx2Ops<int32_t> {
+  using Type = int32_t;
+  using Vec = __m256i;
+  static constexpr size_t kLanes = 8;
+  LIBSHMLITE_TARGET_AVX2 static Vec Load(const Type *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+  LIBSHMLITE_TARGET_AVX2 static void Store(Type *p, Vec v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+  }
+  LIBSHMLITE_TARGET_AVX2 static Vec Min(Vec a, Vec b) { return _mm256_min_epi32(a, b); }
+  LIBSHMLITE_TARGET_AVX2 static Vec Max(Vec a, Vec b) { return _mm256_max_epi32(a, b); }
+};
+
+template <>
+struct Avx2Ops<int64_t> {
+  using Type = int64_t;
+  using Vec = __m256i;
+  static constexpr size_t kLanes = 4;
+  LIBSHMLITE_TARGET_AVX2 static Vec Load(const Type *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+  LIBSHMLITE_TARGET_AVX2 static void Store(Type *p, Vec v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+  }
+  /* AVX2 没有 64 位整数的 min/max，用比较和混合代替 */
+  LIBSHMLITE_TARGET_AVX2 static Vec Min(Vec a, Vec b) {
+    return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+  }
+  LIBSHMLITE_TARGET_AVX2 static Vec Max(Vec a, Vec b) {
+    return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+  }
+};
+
+template <>
+struct Avx2Ops<float> {
+  using Type = float;
+  using Vec = __m256;
+  static constexpr size_t kLanes = 8;
+  LIBSHMLITE_TARGET_AVX2 static Vec Load(const Type *p) { return _mm256_loadu_ps(p); }
+  LIBSHMLITE_TARGET_AVX2 static void Store(Type *p, Vec v) { _mm256_storeu_ps(p, v); }
+  LIBSHMLITE_TARGET_AVX2 static Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+  LIBSHMLITE_TARGET_AVX2 static Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+};
+
+template <>
+struct Avx2Ops<double> {
+  using Type = double;
+  using Vec = __m256d;
+  static constexpr size_t kLanes = 4;
+  LIBSHMLITE_TARGET_AVX2 static Vec Load(const Type *p) { return _mm256_loadu_pd(p); }
+  LIBSHMLITE_TARGET_AVX2 static void Store(Type *p, Vec v) { _mm256_storeu_pd(p, v); }
+  LIBSHMLITE_TARGET_AVX2 static Vec Min(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+  LIBSHMLITE_TARGET_AVX2 static Vec Max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+};
+/** @} */
+
+template <typename Ops, bool kMax>
+LIBSHMLITE_TARGET_AVX2 static typename Ops::Type MinMaxAvx2(const typename Ops::Type *first,
+                                                            size_t n) {
+  using T = typename Ops::Type;
+  if (n < Ops::kLanes) {
+    return MinMaxScalar<T, kMax>(first, n);
+  }
+  typename Ops::Vec acc = Ops::Load(first);
+  size_t i = Ops::kLanes;
+  for (; i + Ops::kLanes <= n; i += Ops::kLanes) {
+    typename Ops::Vec x = Ops::Load(first + i);
+    acc = kMax ? Ops::Max(acc, x) : Ops::Min(acc, x);
+  }
+  T lanes[Ops::kLanes];
+  Ops::Store(lanes, acc);
+  T result = MinMaxScalar<T, kMax>(lanes, Ops::kLanes);
+  for (; i < n; ++i) {
+    result = kMax ? std::max(result, first[i]) : std::min(result, first[i]);
+  }
+  return result;
+}
+
+#endif  // LIBSHMLITE_SIMD_X86
+
+void SimdFill(void *dst, const void *value, size_t elem_size, size_t n) {
+  char *p = static_cast<char *>(dst);
+  size_t bytes = elem_size * n;
+#ifdef LIBSHMLITE_SIMD_X86
+  SimdLevel level = GetSimdLevel();
+  /* 小于两个向量的填充不值得准备填充内容；memset 本身已经是向量化的 */
+  if (elem_size == 1 && bytes < GetNonTemporalThreshold()) {
+    level = SIMD_SCALAR;
+  }
+  if (level == SIMD_AVX2 && 32 % elem_size == 0 && bytes >= 64) {
+    unsigned char pattern[64];
+    BuildPattern(pattern, sizeof(pattern), value, elem_size);
+    FillAvx2(p, bytes, pattern, elem_size);
+    return;
+  }
+  if (level >= SIMD_SSE2 && 16 % elem_size == 0 && bytes >= 32) {
+    unsigned char pattern[32];
+    BuildPattern(pattern, sizeof(pattern), value, elem_size);
+    FillSse2(p, bytes, pattern, elem_size);
+    return;
+  }
+#endif
+  FillScalar(p, value, elem_size, n);
+}
+
+size_t SimdFind(const void *first, size_t n, const void *value, size_t elem_size) {
+  const char *p = static_cast<const char *>(first);
+#ifdef LIBSHMLITE_SIMD_X86
+  SimdLevel level = GetSimdLevel();
+  if (level != SIMD_SCALAR) {
+    unsigned char pattern[32];
+    BuildPattern(pattern, sizeof(pattern), value, elem_size);
+    return level == SIMD_AVX2 ? FindAvx2(p, n, pattern, elem_size)
+                              : FindSse2(p, n, pattern, elem_size);
+  }
+#endif
+  return FindScalar(p, n, value, elem_size);
+}
+
+size_t SimdCount(const void *first, size_t n, const void *value, size_t elem_size) {
+  const char *p = static_cast<const char *>(first);
+#ifdef LIBSHMLITE_SIMD_X86
+  SimdLevel level = GetSimdLevel();
+  if (level != SIMD_SCALAR) {
+    unsigned char pattern[32];
+    BuildPattern(pattern, sizeof(pattern), value, elem_size);
+    return level == SIMD_AVX2 ? CountAvx2(p, n, pattern, elem_size)
+                              : CountSse2(p, n, pattern, elem_size);
+  }
+#endif
+  return CountScalar(p, n, value, elem_size);
+}
+
+/**
+ * @brief 求和的分派，SSE2 级别下使用标量循环，由编译器自动向量化整数部分
+ *
+ * @tparam S 结果的类型
+ * @tparam A 标量累加使用的类型
+ */
+template <typename S, typename A, typename T>
+static S Sum(const T *first, size_t n) {
+#ifdef LIBSHMLITE_SIMD_X86
+  if (GetSimdLevel() == SIMD_AVX2) {
+    return SumAvx2(first, n);
+  }
+#endif
+  return static_cast<S>(SumScalar<A>(first, n));
+}
+
+template <typename T, bool kMax>
+static T MinMax(const T *first, size_t n) {
+#ifdef LIBSHMLITE_SIMD_X86
+  if (GetSimdLevel() == SIMD_AVX2) {
+    return MinMaxAvx2<Avx2Ops<T>, kMax>(first, n);
+  }
+#endif
+  return MinMaxScalar<T, kMax>(first, n);
+}
+
+int64_t SimdSum(const int32_t *first, size_t n) { return Sum<int64_t, int64_t>(first, n); }
+
+/* 用无符号数累加，溢出时按 2^64 取模回绕而不是未定义行为 */
+int64_t SimdSum(const int64_t *first, size_t n) { return Sum<int64_t, uint64_t>(first, n); }
+
+double SimdSum(const float *first, size_t n) { return Sum<double, double>(first, n); }
+
+double SimdSum(const double *first, size_t n) { return Sum<double, double>(first, n); }
+
+int32_t SimdMin(const int32_t *first, size_t n) { return MinMax<int32_t, false>(first, n); }
+
+int64_t SimdMin(const int64_t *first, size_t n) { return MinMax<int64_t, false>(first, n); }
+
+float SimdMin(const float *first, size_t n) { return MinMax<float, false>(first, n); }
+
+double SimdMin(const double *first, size_t n) { return MinMax<double, false>(first, n); }
+
+int32_t SimdMax(const int32_t *first, size_t n) { return MinMax<int32_t, true>(first, n); }
+
+int64_t SimdMax(const int64_t *first, size_t n) { return MinMax<int64_t, true>(first, n); }
+
+float SimdMax(const float *first, size_t n) { return MinMax<float, true>(first, n); }
+
+double SimdMax(const double *first, size_t n) { return MinMax<double, true>(first, n); }
+
+}  // namespace shmlite
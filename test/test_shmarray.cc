@@ -1,4 +1,9 @@
 #include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <numeric>
+#include <vector>
 #include "libshmlite/container/shm_array.hpp"
 #include "libshmlite/shm_handle.h"
 
@@ -23,10 +28,125 @@ TEST(ShmArrayTest, BasicTest) {
 }
 
 TEST(ShmArrayTest, BasicTestFillCstr) {
+  shmlite::ShmHandle::UnLink("arr5");
   { shmlite::ShmArray<char> arr5("arr5", 10, 'w'); }
-  shmlite::ShmArray<char> arr5(
-      "arr5", 5,
-      'z');  // 请求的大小比已经存在的要小，则原来已有的大小会被truncate掉，会导致原来的内容丢失
+  {
+    // 请求的大小与已经存在的不一致时打开失败，原来的内容不会被截断
+    shmlite::ShmArray<char> arr5("arr5", 5, 'z');
+    EXPECT_FALSE(arr5.IsValid());
+    EXPECT_EQ(arr5.Size(), 0);
+  }
+  shmlite::ShmArray<char> arr5("arr5", 10);
+  EXPECT_TRUE(arr5.IsValid());
+  EXPECT_EQ(arr5[9], 'w');
+}
+
+TEST(ShmArrayTest, InitOnceTest) {
+  const int kProcs = 4;
+  const size_t kSize = 1 << 20;
+  shmlite::ShmHandle::UnLink("arr_init");
+  shmlite::ShmHandle::UnLink("arr_init_calls");
+  shmlite::ShmHandle calls("arr_init_calls", sizeof(int), shmlite::ShmHandle::CREAT_RDWR, true);
+  auto *counter = static_cast<std::atomic<int> *>(calls.Ptr());
+  std::vector<pid_t> pids;
+  for (int i = 0; i < kProcs; ++i) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      // 所有进程同时打开，初始化函数只会执行一次，其它进程等待它完成
+      shmlite::ShmArray<int> arr("arr_init", kSize, [counter](int *first, size_t n) {
+        counter->fetch_add(1);
+        usleep(50 * 1000);
+        std::iota(first, first + n, 0);
+      });
+      bool ok = arr.IsValid() && arr[kSize - 1] == static_cast<int>(kSize - 1);
+      _exit(ok ? (arr.IsCreator() ? 10 : 0) : 1);
+    }
+    pids.push_back(pid);
+  }
+  int creators = 0;
+  for (pid_t pid : pids) {
+    int status = -1;
+    waitpid(pid, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_NE(WEXITSTATUS(status), 1);
+    creators += WEXITSTATUS(status) == 10;
+  }
+  EXPECT_EQ(creators, 1);
+  EXPECT_EQ(counter->load(), 1);
+  // 再次打开不会重新填充
+  shmlite::ShmArray<int> arr("arr_init", kSize, -1);
+  EXPECT_FALSE(arr.IsCreator());
+  EXPECT_EQ(arr[5], 5);
+  shmlite::ShmHandle::UnLink("arr_init");
+}
+
+TEST(ShmArrayTest, CreatorExitedTest) {
+  shmlite::ShmHandle::UnLink("arr_dead");
+  pid_t pid = fork();
+  if (pid == 0) {
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+  {
+    // 模拟创建者在初始化的过程中退出
+    shmlite::ShmHandle shm("arr_dead", shmlite::SegmentAllocSize<int>(4),
+                           shmlite::ShmHandle::CREAT_RDWR);
+    auto *header = static_cast<shmlite::ShmSegmentHeader *>(shm.Ptr());
+    header->creator_pid.store(pid);
+    header->state.store(shmlite::SHM_SEGMENT_INITIALIZING);
+  }
+  shmlite::ShmArray<int> arr("arr_dead", 4);
+  EXPECT_FALSE(arr.IsValid());
+  shmlite::ShmHandle::UnLink("arr_dead");
+  {
+    // 创建者写入 PID 之后、修改 state 之前退出
+    shmlite::ShmHandle shm("arr_dead", shmlite::SegmentAllocSize<int>(4),
+                           shmlite::ShmHandle::CREAT_RDWR);
+    auto *header = static_cast<shmlite::ShmSegmentHeader *>(shm.Ptr());
+    header->creator_pid.store(pid);
+  }
+  shmlite::ShmArray<int> claimed("arr_dead", 4);
+  EXPECT_FALSE(claimed.IsValid());
+  shmlite::ShmHandle::UnLink("arr_dead");
+}
+
+TEST(ShmArrayTest, SegmentHeaderTest) {
+  shmlite::ShmHandle::UnLink("arr_header");
+  shmlite::ShmArray<int> arr("arr_header", 2);
+  ASSERT_TRUE(arr.IsValid());
+  // 数据位于一个缓存行大小的头部之后
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(arr.Data()) % shmlite::kCacheLineSize, 0);
+  {
+    shmlite::ShmHandle shm("arr_header", shmlite::SegmentAllocSize<int>(2),
+                           shmlite::ShmHandle::READ_WRITE);
+    auto *header = static_cast<shmlite::ShmSegmentHeader *>(shm.Ptr());
+    EXPECT_EQ(header->magic, shmlite::kShmSegmentMagic);
+    EXPECT_EQ(header->version, shmlite::kShmSegmentLayoutVersion);
+    EXPECT_EQ(header->type_hash, shmlite::ShmTypeHash<int>());
+    EXPECT_EQ(header->elem_size, sizeof(int));
+    EXPECT_EQ(header->elem_count, 2);
+    EXPECT_EQ(shmlite::AttachSegment(header, shmlite::MakeSegmentLayout<int>(2), "arr_header"),
+              shmlite::SHM_SEGMENT_ATTACHED);
+    EXPECT_EQ(shmlite::AttachSegment(header, shmlite::MakeSegmentLayout<int>(3), "arr_header"),
+              shmlite::SHM_SEGMENT_SIZE_MISMATCH);
+  }
+  // 总大小相同但是元素类型不同
+  shmlite::ShmArray<long> arr_long("arr_header", 1);
+  EXPECT_FALSE(arr_long.IsValid());
+  shmlite::ShmArray<float> arr_float("arr_header", 2);
+  EXPECT_FALSE(arr_float.IsValid());
+  EXPECT_THROW(arr_float[0], std::out_of_range);
+  // 不是由 ShmArray 创建的段
+  shmlite::ShmHandle::UnLink("arr_raw");
+  {
+    shmlite::ShmHandle shm("arr_raw", shmlite::SegmentAllocSize<int>(2),
+                           shmlite::ShmHandle::CREAT_RDWR);
+    memset(shm.Ptr(), 0xff, shm.GetSize());
+  }
+  shmlite::ShmArray<int> arr_raw("arr_raw", 2);
+  EXPECT_FALSE(arr_raw.IsValid());
+  shmlite::ShmHandle::UnLink("arr_raw");
+  shmlite::ShmHandle::UnLink("arr_header");
 }
 
 TEST(ShmArrayTest, Operator_BracketTest) {
@@ -61,6 +181,194 @@ TEST(ShmArrayTest, StructTest) {
   ASSERT_DOUBLE_EQ(arr3[0].c, 3.14159);
 }
 
+/* 在 CPU 支持的每个指令集级别上分别运行 fn */
+template <typename Fn>
+void ForEachSimdLevel(Fn fn) {
+  shmlite::SimdLevel detected = shmlite::DetectSimdLevel();
+  for (int level = shmlite::SIMD_SCALAR; level <= detected; ++level) {
+    SCOPED_TRACE("simd level " + std::to_string(level));
+    ASSERT_EQ(shmlite::SetSimdLevel(static_cast<shmlite::SimdLevel>(level)), level);
+    fn();
+  }
+  shmlite::SetSimdLevel(detected);
+}
+
+TEST(ShmArrayTest, BulkFillTest) {
+  ForEachSimdLevel([] {
+    for (size_t n : {1, 7, 33, 1000, 4099}) {
+      shmlite::ShmHandle::UnLink("arr_fill");
+      shmlite::ShmArray<uint16_t> u16("arr_fill", n);
+      u16.Fill(0xabcd);
+      ASSERT_EQ(u16.Count(0xabcd), n);
+
+      shmlite::ShmHandle::UnLink("arr_fill");
+      shmlite::ShmArray<Foo> foo("arr_fill", n);
+      foo.Fill(Foo{7, 'x', 2.5});
+      for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(foo[i].a, 7);
+        ASSERT_EQ(foo[i].b, 'x');
+        ASSERT_DOUBLE_EQ(foo[i].c, 2.5);
+      }
+
+      shmlite::ShmHandle::UnLink("arr_fill");
+      shmlite::ShmArray<Bar> bar("arr_fill", n);
+      bar.Fill(Bar{9, 'y', 1.5});
+      for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(bar[i].a, 9);
+        ASSERT_EQ(bar[i].b, 'y');
+      }
+    }
+    /* 超过阈值时使用非临时存储 */
+    shmlite::ShmHandle::UnLink("arr_fill");
+    size_t threshold = shmlite::GetNonTemporalThreshold();
+    shmlite::SetNonTemporalThreshold(shmlite::kMinNonTemporalThreshold);
+    size_t big = shmlite::kMinNonTemporalThreshold / sizeof(uint64_t) + 3;
+    shmlite::ShmArray<uint64_t> u64("arr_fill", big);
+    u64.Fill(0x0102030405060708ULL);
+    ASSERT_EQ(u64.Count(0x0102030405060708ULL), big);
+    ASSERT_EQ(u64[big - 1], 0x0102030405060708ULL);
+    shmlite::SetNonTemporalThreshold(threshold);
+  });
+  shmlite::ShmHandle::UnLink("arr_fill");
+}
+
+TEST(ShmArrayTest, BulkCopyFindCountTest) {
+  shmlite::ShmHandle::UnLink("arr_find");
+  const size_t n = 1003;
+  shmlite::ShmArray<int64_t> arr("arr_find", n);
+  std::vector<int64_t> src(n);
+  for (size_t i = 0; i < n; ++i) {
+    src[i] = static_cast<int64_t>(i % 10);
+  }
+  arr.CopyFrom(src.data(), n);
+  std::vector<int64_t> dst(10);
+  arr.CopyTo(dst.data(), 10, 990);
+  ASSERT_EQ(dst[0], 0);
+  ASSERT_EQ(dst[9], 9);
+  EXPECT_THROW(arr.CopyTo(dst.data(), 10, 995), std::out_of_range);
+  EXPECT_THROW(arr.CopyFrom(src.data(), n, 1), std::out_of_range);
+
+  ForEachSimdLevel([&] {
+    EXPECT_EQ(arr.Find(3), 3u);
+    EXPECT_EQ(arr.Find(3, 4), 13u);
+    EXPECT_EQ(arr.Find(2, 1000), 1002u);
+    EXPECT_EQ(arr.Find(11), n);
+    EXPECT_EQ(arr.Find(0, n), n);
+    EXPECT_EQ(arr.Count(0), 101u);
+    EXPECT_EQ(arr.Count(9), 100u);
+    /* 只有高位字节不同的元素不能被当成相等 */
+    EXPECT_EQ(arr.Count(static_cast<int64_t>(1) << 40), 0u);
+  });
+
+  shmlite::ShmHandle::UnLink("arr_find");
+  shmlite::ShmArray<char> chars("arr_find", 100);
+  chars.Fill('a');
+  chars[77] = 'b';
+  ForEachSimdLevel([&] {
+    EXPECT_EQ(chars.Find('b'), 77u);
+    EXPECT_EQ(chars.Count('a'), 99u);
+  });
+  shmlite::ShmHandle::UnLink("arr_find");
+}
+
+template <typename T>
+void CheckReduce(const std::string &name, size_t n) {
+  shmlite::ShmHandle::UnLink(name);
+  shmlite::ShmArray<T> arr(name, n);
+  std::vector<T> ref(n);
+  for (size_t i = 0; i < n; ++i) {
+    ref[i] = static_cast<T>((static_cast<int64_t>(i * 7919) % 1001) - 500);
+  }
+  arr.CopyFrom(ref.data(), n);
+  ForEachSimdLevel([&] {
+    EXPECT_EQ(arr.Min(), *std::min_element(ref.begin(), ref.end()));
+    EXPECT_EQ(arr.Max(), *std::max_element(ref.begin(), ref.end()));
+    EXPECT_EQ(arr.Sum(), std::accumulate(ref.begin(), ref.end(), shmlite::ShmSumType<T>(0)));
+  });
+  shmlite::ShmHandle::UnLink(name);
+}
+
+TEST(ShmArrayTest, BulkReduceTest) {
+  for (size_t n : {1, 5, 8, 1001}) {
+    CheckReduce<int32_t>("arr_reduce", n);
+    CheckReduce<int64_t>("arr_reduce", n);
+    CheckReduce<float>("arr_reduce", n);
+    CheckReduce<double>("arr_reduce", n);
+    CheckReduce<int16_t>("arr_reduce", n);
+    CheckReduce<uint32_t>("arr_reduce", n);
+  }
+  shmlite::ShmArray<int32_t> big("arr_reduce", 100);
+  big.Fill(2000000000);
+  EXPECT_EQ(big.Sum(), 200000000000LL);
+  shmlite::ShmHandle::UnLink("arr_reduce");
+}
+
+TEST(ShmArrayTest, IteratorAndViewTest) {
+  shmlite::ShmHandle::UnLink("arr_iter");
+  shmlite::ShmArray<int> arr("arr_iter", 100);
+  std::iota(arr.begin(), arr.end(), 0);
+  EXPECT_EQ(arr.end() - arr.begin(), 100);
+  EXPECT_EQ(arr.Data(), &arr[0]);
+  EXPECT_EQ(arr.UncheckedAt(42), 42);
+
+  int sum = 0;
+  for (int v : arr) {
+    sum += v;
+  }
+  EXPECT_EQ(sum, 4950);
+
+  std::reverse(arr.begin(), arr.end());
+  EXPECT_EQ(arr[0], 99);
+  std::sort(arr.begin(), arr.end());
+  EXPECT_TRUE(std::is_sorted(arr.cbegin(), arr.cend()));
+  EXPECT_EQ(std::lower_bound(arr.begin(), arr.end(), 57) - arr.begin(), 57);
+
+  shmlite::ShmSpan<int> view = arr.View();
+  EXPECT_EQ(view.Size(), 100u);
+  EXPECT_EQ(view.Data(), arr.Data());
+  view[3] = -3;
+  EXPECT_EQ(arr[3], -3);
+
+  const shmlite::ShmArray<int> &carr = arr;
+  shmlite::ShmSpan<const int> cview = carr.View();
+  shmlite::ShmSpan<const int> sub = cview.Subspan(90);
+  EXPECT_EQ(sub.Size(), 10u);
+  EXPECT_EQ(sub[0], 90);
+  EXPECT_EQ(std::accumulate(sub.begin(), sub.end(), 0), 945);
+  EXPECT_TRUE(cview.Subspan(200, 5).Empty());
+  shmlite::ShmSpan<const int> converted = view.Subspan(10, 5);
+  EXPECT_EQ(converted.Size(), 5u);
+  EXPECT_EQ(converted[4], 14);
+  shmlite::ShmHandle::UnLink("arr_iter");
+}
+
+TEST(ShmArrayTest, FileBackedTest) {
+  const size_t kSize = 1 << 20;
+  shmlite::ShmHandleOptions options;
+  options.backing = shmlite::SHM_BACKING_FILE;
+  options.file_dir = "/tmp";
+  shmlite::ShmHandle::UnLink("arr_file", options);
+  {
+    shmlite::ShmArray<int> arr("arr_file", kSize,
+                               [](int *first, size_t n) { std::iota(first, first + n, 0); },
+                               options);
+    ASSERT_TRUE(arr.IsValid());
+    EXPECT_TRUE(arr.IsCreator());
+    arr[kSize - 1] = -1;
+    EXPECT_TRUE(arr.FlushRange(kSize - 1, 10));
+    EXPECT_TRUE(arr.Flush());
+  }
+  // 文件中的数组在所有映射关闭之后依然存在，再次打开时不会重新初始化
+  shmlite::ShmArray<int> arr("arr_file", kSize, options);
+  ASSERT_TRUE(arr.IsValid());
+  EXPECT_FALSE(arr.IsCreator());
+  EXPECT_EQ(arr[12345], 12345);
+  EXPECT_EQ(arr[kSize - 1], -1);
+  shmlite::ShmArray<int> wrong("arr_file", kSize / 2, options);
+  EXPECT_FALSE(wrong.IsValid());
+  shmlite::ShmHandle::UnLink("arr_file", options);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
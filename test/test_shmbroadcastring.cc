@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <string>
+#include "libshmlite/container/shm_broadcast_ring.hpp"
+
+using shmlite::ShmBroadcastMessage;
+using shmlite::ShmBroadcastReader;
+using shmlite::ShmBroadcastRing;
+
+TEST(ShmBroadcastRingTest, BasicTest) {
+  shmlite::ShmHandle::UnLink("bcast1");
+  ShmBroadcastRing ring("bcast1", 1000);
+  ASSERT_TRUE(ring.IsValid());
+  EXPECT_EQ(ring.Capacity(), 1024);
+  EXPECT_EQ(ring.MaxMessageSize(), 240);
+  char big[241] = {0};
+  EXPECT_FALSE(ring.Publish(big, sizeof(big)));
+
+  ShmBroadcastReader r1(ring), r2(ring);
+  ShmBroadcastMessage msg{};
+  EXPECT_EQ(r1.Poll(msg), ShmBroadcastReader::EMPTY);
+  // 变长消息，多次绕回数据区开头
+  for (int i = 0; i < 200; ++i) {
+    std::string s(i % 50 + 1, 'a' + i % 26);
+    ASSERT_TRUE(ring.Publish(s.data(), s.size()));
+    for (ShmBroadcastReader *r : {&r1, &r2}) {
+      ASSERT_EQ(r->Poll(msg), ShmBroadcastReader::OK);
+      EXPECT_EQ(msg.seq, static_cast<uint64_t>(i));
+      EXPECT_EQ(std::string(static_cast<const char *>(msg.data), msg.size), s);
+      EXPECT_TRUE(r->Validate(msg));
+    }
+  }
+  EXPECT_EQ(r1.Poll(msg), ShmBroadcastReader::EMPTY);
+  EXPECT_EQ(r1.Lost(), 0);
+  EXPECT_EQ(ring.Published(), 200);
+  // 数据区大小与已经存在的队列不一致时不能打开
+  ShmBroadcastRing other("bcast1", 2048);
+  EXPECT_FALSE(other.IsValid());
+  ShmBroadcastRing same("bcast1", 1024);
+  ASSERT_TRUE(same.IsValid());
+  EXPECT_EQ(same.Published(), 200);
+  shmlite::ShmHandle::UnLink("bcast1");
+}
+
+TEST(ShmBroadcastRingTest, ClaimCommitTest) {
+  shmlite::ShmHandle::UnLink("bcast2");
+  ShmBroadcastRing ring("bcast2", 4096);
+  ShmBroadcastReader reader(ring);
+  auto *p = static_cast<long *>(ring.Claim(sizeof(long) * 4));
+  ASSERT_NE(p, nullptr);
+  for (int i = 0; i < 4; ++i) {
+    p[i] = i * 10;
+  }
+  ShmBroadcastMessage msg{};
+  // 提交之前读者看不到
+  EXPECT_EQ(reader.Poll(msg), ShmBroadcastReader::EMPTY);
+  ring.Commit();
+  ASSERT_EQ(reader.Poll(msg), ShmBroadcastReader::OK);
+  EXPECT_EQ(msg.size, sizeof(long) * 4);
+  EXPECT_EQ(static_cast<const long *>(msg.data)[3], 30);
+  shmlite::ShmHandle::UnLink("bcast2");
+}
+
+TEST(ShmBroadcastRingTest, LappedTest) {
+  shmlite::ShmHandle::UnLink("bcast3");
+  ShmBroadcastRing ring("bcast3", 1024);
+  ShmBroadcastReader reader(ring);
+  long v = 0;
+  ring.Publish(&v, sizeof(v));
+  ShmBroadcastMessage msg{};
+  ASSERT_EQ(reader.Poll(msg), ShmBroadcastReader::OK);
+  ring.Publish(&++v, sizeof(v));
+  ASSERT_EQ(reader.Poll(msg), ShmBroadcastReader::OK);
+  // 读到的消息在使用期间被覆盖
+  for (int i = 0; i < 100; ++i) {
+    ring.Publish(&++v, sizeof(v));
+  }
+  EXPECT_FALSE(reader.Validate(msg));
+  EXPECT_EQ(reader.Poll(msg), ShmBroadcastReader::LAPPED);
+  EXPECT_EQ(reader.Poll(msg), ShmBroadcastReader::EMPTY);
+  EXPECT_EQ(reader.Lost(), 100);  // 追上写者时就计入被跳过的消息
+  ring.Publish(&++v, sizeof(v));
+  ASSERT_EQ(reader.Poll(msg), ShmBroadcastReader::OK);
+  EXPECT_EQ(*static_cast<const long *>(msg.data), v);
+  EXPECT_EQ(reader.Lost(), 100);
+  shmlite::ShmHandle::UnLink("bcast3");
+}
+
+TEST(ShmBroadcastRingTest, MultiProcessTest) {
+  shmlite::ShmHandle::UnLink("bcast4");
+  ShmBroadcastRing ring("bcast4", 1 << 16);
+  const long count = 100000;
+  const int readers = 3;
+  auto *ready = static_cast<std::atomic<int> *>(mmap(nullptr, sizeof(std::atomic<int>),
+                                                     PROT_READ | PROT_WRITE,
+                                                     MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+  ready->store(0);
+  for (int i = 0; i < readers; ++i) {
+    if (fork() == 0) {
+      ShmBroadcastRing child_ring("bcast4", 1 << 16);
+      ShmBroadcastReader reader(child_ring);
+      ready->fetch_add(1);
+      long received = 0, torn = 0, last = -1, first = -1;
+      bool ordered = true;
+      bool all_published = false;
+      for (;;) {
+        ShmBroadcastMessage msg{};
+        auto status = reader.Poll(msg);
+        if (status == ShmBroadcastReader::EMPTY) {
+          // 先看到所有消息都已经发布，之后再读到 EMPTY 才说明已经追上了写者
+          if (all_published) {
+            break;
+          }
+          all_published = child_ring.Published() == static_cast<uint64_t>(count);
+          continue;
+        }
+        if (status != ShmBroadcastReader::OK) {
+          continue;
+        }
+        long v = *static_cast<const long *>(msg.data);
+        first = first < 0 ? static_cast<long>(msg.seq) : first;
+        if (!reader.Validate(msg)) {
+          ++torn;  // 读取期间被覆盖，序号已经消耗，不计入丢失
+          continue;
+        }
+        ordered = ordered && v > last && v == static_cast<long>(msg.seq);
+        last = v;
+        ++received;
+      }
+      // 收到的、读取期间被覆盖的和丢失的消息加起来恰好等于读者开始之后发布的消息数
+      long total = received + torn + static_cast<long>(reader.Lost());
+      _exit(ordered && first >= 0 && total == count - first ? 0 : 1);
+    }
+  }
+  while (ready->load() != readers) {
+    usleep(100);
+  }
+  for (long v = 0; v < count; ++v) {
+    ring.Publish(&v, sizeof(v));
+    if (v % 64 == 0) {
+      usleep(1);
+    }
+  }
+  for (int i = 0; i < readers; ++i) {
+    int status = 0;
+    wait(&status);
+    EXPECT_EQ(status, 0);
+  }
+  munmap(ready, sizeof(std::atomic<int>));
+  shmlite::ShmHandle::UnLink("bcast4");
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
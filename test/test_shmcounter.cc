@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "libshmlite/shm_counter.hpp"
+
+TEST(ShmCounterTest, BasicTest) {
+  shmlite::ShmHandle::UnLink("counter1");
+  shmlite::ShmCounter<> counter("counter1");
+  ASSERT_TRUE(counter.IsValid());
+  EXPECT_EQ(counter.Mode(), shmlite::SHM_COUNTER_SHARDED);
+  EXPECT_GE(counter.SlotCount(), 1);
+  EXPECT_EQ(counter.SlotCount() & (counter.SlotCount() - 1), 0);
+  EXPECT_EQ(counter.Load(), 0);
+  counter.Increment();
+  counter.Add(10);
+  counter.Add(-3);
+  EXPECT_EQ(counter.Load(), 8);
+  counter.Reset();
+  EXPECT_EQ(counter.Load(), 0);
+  shmlite::ShmHandle::UnLink("counter1");
+}
+
+TEST(ShmCounterTest, MixedModeTest) {
+  shmlite::ShmHandle::UnLink("counter2");
+  shmlite::ShmCounter<uint32_t> sharded("counter2");
+  shmlite::ShmCounter<uint32_t> atomic("counter2", shmlite::SHM_COUNTER_ATOMIC);
+  sharded.Add(5);
+  atomic.Add(7);
+  // 两种模式看到的是同一个计数
+  EXPECT_EQ(sharded.Load(), 12);
+  EXPECT_EQ(atomic.Load(), 12);
+  shmlite::ShmHandle::UnLink("counter2");
+}
+
+TEST(ShmCounterTest, MultiProcessTest) {
+  shmlite::ShmHandle::UnLink("counter3");
+  const int procs = 4;
+  const long loops = 100000;
+  for (auto mode : {shmlite::SHM_COUNTER_SHARDED, shmlite::SHM_COUNTER_ATOMIC}) {
+    shmlite::ShmCounter<> counter("counter3", mode);
+    counter.Reset();
+    for (int i = 0; i < procs; ++i) {
+      if (fork() == 0) {
+        shmlite::ShmCounter<> child("counter3", mode);
+        for (long n = 0; n < loops; ++n) {
+          child.Increment();
+        }
+        _exit(0);
+      }
+    }
+    for (int i = 0; i < procs; ++i) {
+      int status = 0;
+      wait(&status);
+      EXPECT_EQ(status, 0);
+    }
+    EXPECT_EQ(counter.Load(), procs * loops);
+  }
+  shmlite::ShmHandle::UnLink("counter3");
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include "libshmlite/shm_event.h"
+#include "libshmlite/shm_handle.h"
+
+struct EventShared {
+  shmlite::ShmEvent event;
+  shmlite::ShmMutex mutex;
+  shmlite::ShmCondition cond;
+  std::atomic<int> value;
+  int items;
+};
+
+TEST(ShmEventTest, NotifyTest) {
+  shmlite::ShmHandle shm("event1", sizeof(EventShared), shmlite::ShmHandle::CREAT_RDWR, true);
+  auto *shared = static_cast<EventShared *>(shm.Ptr());
+  // 没有等待者时通知不会出错
+  shared->event.NotifyAll();
+  EXPECT_EQ(shared->event.Waiters(), 0);
+  const int children = 3;
+  for (int i = 0; i < children; ++i) {
+    if (fork() == 0) {
+      shared->event.Wait([&] { return shared->value.load() == 1; });
+      _exit(0);
+    }
+  }
+  // 等待所有子进程睡眠
+  while (shared->event.Waiters() != children) {
+    usleep(1000);
+  }
+  shared->value.store(1);
+  shared->event.NotifyAll();
+  for (int i = 0; i < children; ++i) {
+    int status = -1;
+    wait(&status);
+    EXPECT_EQ(status, 0);
+  }
+  EXPECT_EQ(shared->event.Waiters(), 0);
+}
+
+TEST(ShmEventTest, TimeoutTest) {
+  shmlite::ShmHandle shm("event2", sizeof(EventShared), shmlite::ShmHandle::CREAT_RDWR, true);
+  auto *shared = static_cast<EventShared *>(shm.Ptr());
+  struct timespec timeout = {0, 50 * 1000 * 1000};
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(shared->event.WaitFor([&] { return shared->value.load() == 1; }, &timeout));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_GE(elapsed, std::chrono::milliseconds(50));
+  EXPECT_LT(elapsed, std::chrono::seconds(2));
+  shared->value.store(1);
+  EXPECT_TRUE(shared->event.WaitFor([&] { return shared->value.load() == 1; }, &timeout));
+
+  shared->mutex.Lock();
+  EXPECT_FALSE(shared->cond.WaitFor(shared->mutex, [&] { return shared->items > 0; }, &timeout));
+  EXPECT_TRUE(shared->mutex.IsLocked());
+  shared->mutex.Unlock();
+}
+
+TEST(ShmConditionTest, ProducerConsumerTest) {
+  shmlite::ShmHandle shm("event3", sizeof(EventShared), shmlite::ShmHandle::CREAT_RDWR, true);
+  auto *shared = static_cast<EventShared *>(shm.Ptr());
+  const int count = 10000;
+  pid_t pid = fork();
+  if (pid == 0) {
+    // 消费者：每次取走一个
+    for (int i = 0; i < count; ++i) {
+      shared->mutex.Lock();
+      shared->cond.Wait(shared->mutex, [&] { return shared->items > 0; });
+      --shared->items;
+      shared->mutex.Unlock();
+      shared->cond.NotifyAll();
+    }
+    _exit(0);
+  }
+  // 生产者：最多积压 4 个
+  for (int i = 0; i < count; ++i) {
+    shared->mutex.Lock();
+    shared->cond.Wait(shared->mutex, [&] { return shared->items < 4; });
+    ++shared->items;
+    shared->mutex.Unlock();
+    shared->cond.NotifyAll();
+  }
+  int status = -1;
+  waitpid(pid, &status, 0);
+  EXPECT_EQ(status, 0);
+  EXPECT_EQ(shared->items, 0);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,4 +1,9 @@
 #include <gtest/gtest.h>
+#include <linux/mempolicy.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
 #include "libshmlite/shm_handle.h"
 
 struct Foo {
@@ -53,6 +58,36 @@ TEST_F(ShmHandleTest, BaseTest) {
   EXPECT_EQ(std::string(((Foo *)shm4.Ptr())->buf), std::string(msg));
 };
 
+TEST(ShmHandleUtilityTest, NoResizeTest) {
+  shmlite::ShmHandle::UnLink("shm_noresize");
+  shmlite::ShmHandle shm("shm_noresize", 64, shmlite::ShmHandle::CREAT_RDWR, true);
+  ASSERT_TRUE(shm.IsValid());
+  memset(shm.Ptr(), 0x5a, 64);
+  // 已经存在的共享内存不会被截断或者扩大
+  shmlite::ShmHandle smaller("shm_noresize", 32, shmlite::ShmHandle::CREAT_RDWR);
+  EXPECT_FALSE(smaller.IsValid());
+  shmlite::ShmHandle larger("shm_noresize", 128, shmlite::ShmHandle::CREAT_RDWR);
+  EXPECT_FALSE(larger.IsValid());
+  shmlite::ShmHandle same("shm_noresize", 64, shmlite::ShmHandle::READ_ONLY);
+  EXPECT_TRUE(same.IsValid());
+  EXPECT_EQ(((unsigned char *)same.Ptr())[63], 0x5a);
+}
+
+TEST(ShmHandleUtilityTest, InitialValueTest) {
+  shmlite::ShmHandle::UnLink("shm_value");
+  int value = 1;
+  shmlite::ShmHandle first("shm_value", &value, sizeof(int), true);
+  ASSERT_TRUE(first.IsValid());
+  EXPECT_TRUE(first.IsCreator());
+  *(int *)first.Ptr() = 42;
+  // 已经存在时不会用初始值覆盖正在使用的内容
+  value = 2;
+  shmlite::ShmHandle second("shm_value", &value, sizeof(int));
+  ASSERT_TRUE(second.IsValid());
+  EXPECT_FALSE(second.IsCreator());
+  EXPECT_EQ(*(int *)second.Ptr(), 42);
+}
+
 TEST(ShmHandleUtilityTest, StaticMethodTest) {
   EXPECT_TRUE(shmlite::ShmHandle::CheckExists("shm1"));
   EXPECT_FALSE(shmlite::ShmHandle::CheckExists("shm2"));
@@ -60,6 +95,460 @@ TEST(ShmHandleUtilityTest, StaticMethodTest) {
   EXPECT_FALSE(shmlite::ShmHandle::CheckExists("shm85"));
 }
 
+TEST(ShmHandleHugePageTest, FallbackTest) {
+  shmlite::ShmHandleOptions options;
+  options.page_size = shmlite::SHM_PAGE_HUGE_2M;
+  options.hugetlbfs_dir = "/nonexistent-hugetlbfs";
+  {
+    // hugetlbfs 不可用时回退为透明大页，映射按 2MiB 对齐
+    shmlite::ShmHandle shm("shm_huge", 3 << 20, shmlite::ShmHandle::CREAT_RDWR, options);
+    EXPECT_TRUE(shm.IsValid());
+    EXPECT_EQ(shm.GetSize(), 3 << 20);
+    EXPECT_EQ(shm.GetMappedSize(), 3 << 20);
+    EXPECT_EQ(shm.GetPageSize(), shmlite::SHM_PAGE_DEFAULT);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(shm.Ptr()) % (2 << 20), 0);
+    memset(shm.Ptr(), 0x5a, shm.GetSize());
+  }
+  // 回退后与普通共享内存是同一块
+  shmlite::ShmHandle shm("shm_huge", 3 << 20, shmlite::ShmHandle::CREAT_RDWR, true);
+  EXPECT_EQ(((unsigned char *)shm.Ptr())[(3 << 20) - 1], 0x5a);
+  EXPECT_TRUE(shmlite::ShmHandle::CheckExists("shm_huge"));
+}
+
+TEST(ShmHandleHugePageTest, NoFallbackTest) {
+  shmlite::ShmHandleOptions options;
+  options.page_size = shmlite::SHM_PAGE_HUGE_2M;
+  options.hugetlbfs_dir = "/nonexistent-hugetlbfs";
+  options.thp_fallback = false;
+  shmlite::ShmHandle shm("shm_huge_strict", 4096, shmlite::ShmHandle::CREAT_RDWR, options, true);
+  EXPECT_FALSE(shm.IsValid());
+  EXPECT_EQ(shm.Ptr(), nullptr);
+  EXPECT_FALSE(shmlite::ShmHandle::CheckExists("shm_huge_strict"));
+  EXPECT_FALSE(shmlite::ShmHandle::UnLink("shm_huge_strict", options));
+}
+
+TEST(ShmHandleHugePageTest, FollowBackingTest) {
+  shmlite::ShmHandle::UnLink("shm_huge_follow");
+  {
+    shmlite::ShmHandle shm("shm_huge_follow", 4096, shmlite::ShmHandle::CREAT_RDWR);
+    *(int *)shm.Ptr() = 42;
+  }
+  shmlite::ShmHandleOptions options;
+  options.page_size = shmlite::SHM_PAGE_HUGE_2M;
+  {
+    // 已经存在的普通共享内存（例如之前的回退）优先于 hugetlbfs
+    shmlite::ShmHandle shm("shm_huge_follow", 4096, shmlite::ShmHandle::CREAT_RDWR, options);
+    ASSERT_TRUE(shm.IsValid());
+    EXPECT_EQ(shm.GetPageSize(), shmlite::SHM_PAGE_DEFAULT);
+    EXPECT_EQ(*(int *)shm.Ptr(), 42);
+  }
+  options.thp_fallback = false;
+  shmlite::ShmHandle strict("shm_huge_follow", 4096, shmlite::ShmHandle::CREAT_RDWR, options);
+  EXPECT_FALSE(strict.IsValid());
+  shmlite::ShmHandle::UnLink("shm_huge_follow");
+
+  // hugetlbfs 中已有同名文件但无法使用时不会回退到另一块内存
+  std::string dir = "/tmp/lsml-fakehuge-" + std::to_string(getpid());
+  ASSERT_EQ(mkdir(dir.c_str(), 0700), 0);
+  std::string path = dir + shmlite::kShmNamePrefix + "shm_huge_follow";
+  int fd = open(path.c_str(), O_CREAT | O_RDWR, 0600);
+  ASSERT_NE(fd, -1);
+  close(fd);
+  options.thp_fallback = true;
+  options.hugetlbfs_dir = dir;
+  shmlite::ShmHandle split("shm_huge_follow", 4096, shmlite::ShmHandle::CREAT_RDWR, options);
+  EXPECT_FALSE(split.IsValid());
+  EXPECT_FALSE(shmlite::ShmHandle::CheckExists("shm_huge_follow"));
+  unlink(path.c_str());
+  rmdir(dir.c_str());
+}
+
+TEST(ShmHandleHugePageTest, ReadOnlyTest) {
+  {
+    shmlite::ShmHandle shm("shm_ro", sizeof(int), shmlite::ShmHandle::CREAT_RDWR);
+    *(int *)shm.Ptr() = 42;
+  }
+  shmlite::ShmHandle shm("shm_ro", sizeof(int), shmlite::ShmHandle::READ_ONLY, true);
+  EXPECT_TRUE(shm.IsValid());
+  EXPECT_EQ(*(int *)shm.Ptr(), 42);
+}
+
+static long MinorFaults() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_minflt;
+}
+
+TEST(ShmHandlePrefaultTest, PrefaultTest) {
+  const size_t page = sysconf(_SC_PAGESIZE);
+  const size_t size = 64 * page;
+  shmlite::ShmHandleOptions options;
+  {
+    // 不预取时没有统计
+    shmlite::ShmHandle shm("shm_prefault0", size, shmlite::ShmHandle::CREAT_RDWR, options, true);
+    EXPECT_TRUE(shm.IsValid());
+    EXPECT_EQ(shm.GetResidentPages(), 0);
+    EXPECT_FALSE(shm.IsMemLocked());
+  }
+  for (auto mode : {shmlite::SHM_PREFAULT_POPULATE, shmlite::SHM_PREFAULT_POPULATE_WRITE}) {
+    options.prefault = mode;
+    shmlite::ShmHandle shm("shm_prefault1", size, shmlite::ShmHandle::CREAT_RDWR, options, true);
+    EXPECT_TRUE(shm.IsValid());
+    EXPECT_EQ(shm.GetResidentPages(), 64);
+    ((char *)shm.Ptr())[size - 1] = 'x';
+  }
+  options.prefault = shmlite::SHM_PREFAULT_WILLNEED;
+  {
+    // MADV_WILLNEED 不会为新建的共享内存分配页
+    shmlite::ShmHandle shm("shm_prefault2", size, shmlite::ShmHandle::CREAT_RDWR, options, true);
+    EXPECT_TRUE(shm.IsValid());
+    EXPECT_EQ(shm.GetResidentPages(), 0);
+    memset(shm.Ptr(), 'x', size / 2);
+    // 其它进程写过的页已经驻留，但本进程首次访问时仍然需要建立页表
+    shmlite::ShmHandle other("shm_prefault2", size, shmlite::ShmHandle::READ_WRITE, options);
+    EXPECT_EQ(other.GetResidentPages(), 32);
+  }
+  for (auto mode : {shmlite::SHM_PREFAULT_NONE, shmlite::SHM_PREFAULT_POPULATE,
+                    shmlite::SHM_PREFAULT_POPULATE_WRITE}) {
+    // 预取之后首次写入整块共享内存不会再发生缺页，不预取时每页缺页一次
+    options.prefault = mode;
+    shmlite::ShmHandle shm("shm_prefault3", size, shmlite::ShmHandle::CREAT_RDWR, options, true);
+    ASSERT_TRUE(shm.IsValid());
+    long faults = MinorFaults();
+    for (size_t off = 0; off < size; off += page) {
+      static_cast<volatile char *>(shm.Ptr())[off] = 1;
+    }
+    faults = MinorFaults() - faults;
+    if (mode == shmlite::SHM_PREFAULT_NONE) {
+      EXPECT_GE(faults, 64);
+    } else {
+      EXPECT_LT(faults, 8);
+    }
+  }
+}
+
+TEST(ShmHandlePrefaultTest, MemLockTest) {
+  const size_t page = sysconf(_SC_PAGESIZE);
+  shmlite::ShmHandleOptions options;
+  options.mem_lock = shmlite::SHM_MEMLOCK_ALL;
+  {
+    shmlite::ShmHandle shm("shm_mlock", 16 * page, shmlite::ShmHandle::CREAT_RDWR, options, true);
+    EXPECT_TRUE(shm.IsValid());
+    EXPECT_TRUE(shm.IsMemLocked());
+    EXPECT_EQ(shm.GetResidentPages(), 16);
+  }
+  options.mem_lock = shmlite::SHM_MEMLOCK_ON_FAULT;
+  shmlite::ShmHandle shm("shm_mlock", 16 * page, shmlite::ShmHandle::CREAT_RDWR, options, true);
+  EXPECT_TRUE(shm.IsValid());
+  EXPECT_TRUE(shm.IsMemLocked());
+  ((char *)shm.Ptr())[0] = 'x';
+}
+
+TEST(ShmHandleNumaTest, PolicyTest) {
+  const size_t page = sysconf(_SC_PAGESIZE);
+  int node = shmlite::NumaOnlineNodes().front();
+  shmlite::ShmHandleOptions options;
+  options.prefault = shmlite::SHM_PREFAULT_POPULATE;
+  for (auto policy :
+       {shmlite::SHM_NUMA_BIND, shmlite::SHM_NUMA_INTERLEAVE, shmlite::SHM_NUMA_LOCAL}) {
+    options.numa_policy = policy;
+    options.numa_node = node;
+    shmlite::ShmHandle shm("shm_numa", 8 * page, shmlite::ShmHandle::CREAT_RDWR, options, true);
+    EXPECT_TRUE(shm.IsValid());
+    EXPECT_EQ(shm.GetNumaPolicy(), policy);
+    // 设置了策略之后仍然会预取
+    EXPECT_EQ(shm.GetResidentPages(), 8);
+  }
+  // SHM_NUMA_LOCAL 是绑定到创建者所在节点的 MPOL_BIND，其它进程打开时不会改变它
+  options.numa_policy = shmlite::SHM_NUMA_LOCAL;
+  {
+    shmlite::ShmHandle creator("shm_numa", 8 * page, shmlite::ShmHandle::CREAT_RDWR, options, true);
+    const size_t bits = 8 * sizeof(unsigned long);
+    unsigned long mask[1024 / bits] = {0};
+    int mode = -1;
+    ASSERT_EQ(syscall(SYS_get_mempolicy, &mode, mask, 1024, creator.Ptr(), MPOL_F_ADDR), 0);
+    EXPECT_EQ(mode, MPOL_BIND);
+    int local = shmlite::CurrentNumaNode();
+    EXPECT_NE(mask[local / bits] & (1UL << (local % bits)), 0);
+    shmlite::ShmHandle attacher("shm_numa", 8 * page, shmlite::ShmHandle::READ_WRITE, options);
+    EXPECT_TRUE(attacher.IsValid());
+    EXPECT_EQ(attacher.GetNumaPolicy(), shmlite::SHM_NUMA_DEFAULT);
+  }
+  // 绑定到不存在的节点失败，但共享内存仍然可用
+  options.numa_policy = shmlite::SHM_NUMA_BIND;
+  options.numa_node = 1000;
+  shmlite::ShmHandle shm("shm_numa", 8 * page, shmlite::ShmHandle::CREAT_RDWR, options, true);
+  EXPECT_TRUE(shm.IsValid());
+  EXPECT_EQ(shm.GetNumaPolicy(), shmlite::SHM_NUMA_DEFAULT);
+}
+
+TEST(ShmHandleUtilityTest, ZeroSizeAttachTest) {
+  shmlite::ShmHandle::UnLink("shm_zero");
+  // 大小为 0 时只能打开已经存在的共享内存，不会留下空的共享内存
+  shmlite::ShmHandle missing("shm_zero", 0, shmlite::ShmHandle::CREAT_RDWR);
+  EXPECT_FALSE(missing.IsValid());
+  EXPECT_FALSE(shmlite::ShmHandle::CheckExists("shm_zero"));
+  shmlite::ShmHandle created("shm_zero", 100, shmlite::ShmHandle::CREAT_RDWR, true);
+  shmlite::ShmHandle attached("shm_zero", 0, shmlite::ShmHandle::READ_ONLY);
+  ASSERT_TRUE(attached.IsValid());
+  EXPECT_EQ(attached.GetSize(), 100);
+}
+
+TEST(ShmHandleMemfdTest, BaseTest) {
+  shmlite::ShmHandleOptions options;
+  options.backing = shmlite::SHM_BACKING_MEMFD;
+  shmlite::ShmHandle shm("shm_memfd", 8192, shmlite::ShmHandle::CREAT_RDWR, options, true);
+  EXPECT_TRUE(shm.IsValid());
+  EXPECT_EQ(shm.GetBacking(), shmlite::SHM_BACKING_MEMFD);
+  EXPECT_FALSE(shm.IsReadOnly());
+  EXPECT_EQ(shm.GetSeals(), 0);
+  memset(shm.Ptr(), 0x5a, shm.GetSize());
+  // memfd 没有全局的名字
+  EXPECT_FALSE(shmlite::ShmHandle::CheckExists("shm_memfd"));
+  EXPECT_TRUE(shm.Resize(16384));
+  EXPECT_EQ(((unsigned char *)shm.Ptr())[8191], 0x5a);
+  EXPECT_EQ(((unsigned char *)shm.Ptr())[16383], 0);
+}
+
+TEST(ShmHandleMemfdTest, SealTest) {
+  shmlite::ShmHandleOptions options;
+  options.backing = shmlite::SHM_BACKING_MEMFD;
+  shmlite::ShmHandle shm("shm_memfd_seal", 4096, shmlite::ShmHandle::CREAT_RDWR, options);
+  *(int *)shm.Ptr() = 42;
+  EXPECT_TRUE(shm.Seal(shmlite::SHM_SEAL_GROW));
+  EXPECT_FALSE(shm.Resize(8192));
+  EXPECT_FALSE(shm.IsReadOnly());
+  // 加 SHM_SEAL_WRITE 时映射换成只读，内容不变
+  EXPECT_TRUE(shm.Seal(shmlite::SHM_SEAL_ALL));
+  EXPECT_TRUE(shm.IsReadOnly());
+  EXPECT_EQ(shm.GetSeals(), shmlite::SHM_SEAL_ALL);
+  EXPECT_EQ(*(int *)shm.Ptr(), 42);
+  EXPECT_EQ(shm.GetSize(), 4096);
+  EXPECT_FALSE(shm.Seal(shmlite::SHM_SEAL_SHRINK));
+  // 可写打开被封印的 memfd 也只能得到只读映射
+  shmlite::ShmHandle peer(dup(shm.GetFd()), "peer", shmlite::ShmHandle::READ_WRITE);
+  EXPECT_TRUE(peer.IsValid());
+  EXPECT_TRUE(peer.IsReadOnly());
+  EXPECT_EQ(*(int *)peer.Ptr(), 42);
+  // POSIX 共享内存不支持封印
+  shmlite::ShmHandle posix("shm_posix_seal", 4096, shmlite::ShmHandle::CREAT_RDWR, true);
+  EXPECT_EQ(posix.GetSeals(), shmlite::SHM_SEAL_SEAL);
+  EXPECT_FALSE(posix.Seal(shmlite::SHM_SEAL_GROW));
+}
+
+TEST(ShmHandleMemfdTest, SendFdTest) {
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  shmlite::ShmHandleOptions options;
+  options.backing = shmlite::SHM_BACKING_MEMFD;
+  shmlite::ShmHandle shm("shm_memfd_send", 4096, shmlite::ShmHandle::CREAT_RDWR, options);
+  strcpy((char *)shm.Ptr(), "hello from parent");
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(sv[0]);
+    shmlite::ShmHandle peer(shmlite::ShmHandle::ReceiveFd(sv[1]), "peer",
+                            shmlite::ShmHandle::READ_WRITE);
+    bool ok = peer.IsValid() && peer.GetSize() == 4096 &&
+              strcmp((char *)peer.Ptr(), "hello from parent") == 0;
+    if (ok) {
+      strcpy((char *)peer.Ptr(), "hello from child");
+    }
+    _exit(ok ? 0 : 1);
+  }
+  close(sv[1]);
+  EXPECT_TRUE(shm.SendTo(sv[0]));
+  int status = -1;
+  waitpid(pid, &status, 0);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  // 子进程写入的数据直接可见
+  EXPECT_STREQ((char *)shm.Ptr(), "hello from child");
+  // 对端关闭时收不到文件描述符
+  EXPECT_EQ(shmlite::ShmHandle::ReceiveFd(sv[0]), -1);
+  close(sv[0]);
+  shmlite::ShmHandle invalid(-1, "invalid", shmlite::ShmHandle::READ_ONLY);
+  EXPECT_FALSE(invalid.IsValid());
+}
+
+static size_t CountOpenFds() {
+  size_t count = 0;
+  for (int fd = 0; fd < 1024; ++fd) {
+    count += fcntl(fd, F_GETFD) != -1;
+  }
+  return count;
+}
+
+TEST(ShmHandleMemfdTest, ExtraFdTest) {
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  // 对端一次发送三个描述符，只保留第一个，其余的被关闭
+  int fds[3] = {memfd_create("extra0", 0), memfd_create("extra1", 0), memfd_create("extra2", 0)};
+  ASSERT_EQ(ftruncate(fds[0], 4096), 0);
+  char byte = 0;
+  struct iovec iov = {&byte, 1};
+  char buf[CMSG_SPACE(sizeof(fds))] = {};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = buf;
+  msg.msg_controllen = sizeof(buf);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  ASSERT_EQ(sendmsg(sv[0], &msg, 0), 1);
+  for (int fd : fds) {
+    close(fd);
+  }
+  size_t before = CountOpenFds();
+  int fd = shmlite::ShmHandle::ReceiveFd(sv[1]);
+  ASSERT_NE(fd, -1);
+  EXPECT_EQ(CountOpenFds(), before + 1);
+  {
+    shmlite::ShmHandle peer(fd, "extra", shmlite::ShmHandle::READ_WRITE);
+    EXPECT_TRUE(peer.IsValid());
+    EXPECT_EQ(peer.GetSize(), 4096);
+  }
+  EXPECT_EQ(CountOpenFds(), before);
+  // 映射失败时描述符被关闭，对象不可用
+  int pipe_fds[2];
+  ASSERT_EQ(pipe(pipe_fds), 0);
+  close(pipe_fds[1]);
+  shmlite::ShmHandle bad(pipe_fds[0], "pipe", shmlite::ShmHandle::READ_ONLY);
+  EXPECT_FALSE(bad.IsValid());
+  EXPECT_EQ(bad.GetFd(), -1);
+  EXPECT_EQ(fcntl(pipe_fds[0], F_GETFD), -1);
+  close(sv[0]);
+  close(sv[1]);
+}
+
+TEST(ShmHandleMemfdTest, HugePageTest) {
+  shmlite::ShmHandleOptions options;
+  options.backing = shmlite::SHM_BACKING_MEMFD;
+  options.page_size = shmlite::SHM_PAGE_HUGE_2M;
+  {
+    shmlite::ShmHandle shm("shm_memfd_huge", 3 << 20, shmlite::ShmHandle::CREAT_RDWR, options);
+    EXPECT_TRUE(shm.IsValid());
+    EXPECT_EQ(shm.GetBacking(), shmlite::SHM_BACKING_MEMFD);
+    if (shm.GetPageSize() == shmlite::SHM_PAGE_HUGE_2M) {
+      EXPECT_EQ(shm.GetMappedSize(), 4 << 20);
+    } else {
+      // 系统中没有预留大页时回退为透明大页
+      EXPECT_EQ(shm.GetMappedSize(), 3 << 20);
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(shm.Ptr()) % (2 << 20), 0);
+    }
+    memset(shm.Ptr(), 0x5a, shm.GetSize());
+  }
+  options.thp_fallback = false;
+  shmlite::ShmHandle shm("shm_memfd_huge", 3 << 20, shmlite::ShmHandle::CREAT_RDWR, options);
+  EXPECT_TRUE(!shm.IsValid() || shm.GetPageSize() == shmlite::SHM_PAGE_HUGE_2M);
+}
+
+TEST(ShmHandleFileTest, PersistTest) {
+  shmlite::ShmHandleOptions options;
+  options.backing = shmlite::SHM_BACKING_FILE;
+  options.file_dir = "/tmp";
+  options.flush_policy = shmlite::SHM_FLUSH_SYNC;
+  shmlite::ShmHandle::UnLink("shm_file", options);
+  {
+    shmlite::ShmHandle shm("shm_file", 3 * 4096 + 10, shmlite::ShmHandle::CREAT_RDWR, options);
+    ASSERT_TRUE(shm.IsValid());
+    EXPECT_TRUE(shm.IsCreator());
+    EXPECT_EQ(shm.GetBacking(), shmlite::SHM_BACKING_FILE);
+    EXPECT_EQ(shm.GetPath(), "/tmp/lsmlh-shm_file");
+    EXPECT_FALSE(shmlite::ShmHandle::CheckExists("shm_file"));  // 不在 /dev/shm 中
+    char *p = static_cast<char *>(shm.Ptr());
+    memcpy(p + 4096 + 100, "persist", 8);
+    EXPECT_TRUE(shm.FlushRange(4096 + 100, 8));
+    EXPECT_TRUE(shm.FlushRange(4096, 4096, false));
+  }
+  struct stat st;
+  ASSERT_EQ(stat("/tmp/lsmlh-shm_file", &st), 0);
+  EXPECT_EQ(st.st_size, 3 * 4096 + 10);
+  {
+    // 大小为 0 时使用文件当前的大小，已经存在的文件不会被改变大小
+    shmlite::ShmHandle shm("shm_file", 0, shmlite::ShmHandle::READ_ONLY, options);
+    ASSERT_TRUE(shm.IsValid());
+    EXPECT_FALSE(shm.IsCreator());
+    EXPECT_EQ(shm.GetSize(), 3 * 4096 + 10);
+    EXPECT_STREQ(static_cast<char *>(shm.Ptr()) + 4096 + 100, "persist");
+    EXPECT_EQ(shm.GetFlushPolicy(), shmlite::SHM_FLUSH_NONE);  // 只读映射不需要刷新
+    shmlite::ShmHandle other("shm_file", 4096, shmlite::ShmHandle::CREAT_RDWR, options);
+    EXPECT_FALSE(other.IsValid());
+  }
+  EXPECT_TRUE(shmlite::ShmHandle::UnLink("shm_file", options));
+  EXPECT_NE(access("/tmp/lsmlh-shm_file", F_OK), 0);
+  // 没有给出目录或者给出相对路径时不会映射工作目录中的文件
+  for (const char *dir : {"", "tmp", "./tmp"}) {
+    options.file_dir = dir;
+    shmlite::ShmHandle shm("shm_file", 4096, shmlite::ShmHandle::CREAT_RDWR, options, true);
+    EXPECT_FALSE(shm.IsValid());
+    EXPECT_FALSE(shmlite::ShmHandle::UnLink("shm_file", options));
+  }
+  EXPECT_NE(access("lsmlh-shm_file", F_OK), 0);
+}
+
+TEST(ShmHandleFileTest, PeriodicFlushTest) {
+  shmlite::ShmHandleOptions options;
+  options.backing = shmlite::SHM_BACKING_FILE;
+  options.file_dir = "/tmp";
+  options.flush_policy = shmlite::SHM_FLUSH_PERIODIC;
+  options.flush_interval_ms = 5;
+  options.map_sync = true;  // /tmp 不是 DAX 文件系统，回退为普通映射
+  shmlite::ShmHandle::UnLink("shm_file_periodic", options);
+  shmlite::ShmHandle shm("shm_file_periodic", 1 << 20, shmlite::ShmHandle::CREAT_RDWR, options,
+                         true);
+  ASSERT_TRUE(shm.IsValid());
+  EXPECT_EQ(shm.GetFlushPolicy(), shmlite::SHM_FLUSH_PERIODIC);
+  EXPECT_FALSE(shm.IsMapSync());
+  memset(shm.Ptr(), 1, 1 << 20);
+  usleep(30 * 1000);
+  // 后台线程刷新的同时重新映射
+  ASSERT_TRUE(shm.Resize(2 << 20));
+  memset(shm.Ptr(), 2, 2 << 20);
+  usleep(30 * 1000);
+  pid_t pid = fork();
+  if (pid == 0) {
+    // 子进程中打开的映射有自己的刷新线程
+    shmlite::ShmHandle child("shm_file_periodic", 0, shmlite::ShmHandle::READ_WRITE, options);
+    _exit(child.IsValid() && static_cast<char *>(child.Ptr())[(2 << 20) - 1] == 2 ? 0 : 1);
+  }
+  int status = -1;
+  waitpid(pid, &status, 0);
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  EXPECT_TRUE(shm.Flush());
+}
+
+TEST(ShmHandleFileTest, ForkTest) {
+  shmlite::ShmHandleOptions options;
+  options.backing = shmlite::SHM_BACKING_FILE;
+  options.file_dir = "/tmp";
+  options.flush_policy = shmlite::SHM_FLUSH_PERIODIC;
+  options.flush_interval_ms = 1;
+  shmlite::ShmHandle::UnLink("shm_file_fork", options);
+  auto *shm =
+      new shmlite::ShmHandle("shm_file_fork", 4 << 20, shmlite::ShmHandle::CREAT_RDWR, options);
+  ASSERT_TRUE(shm->IsValid());
+  for (int round = 0; round < 20; ++round) {
+    // 刷新线程正在刷新大量脏页时 fork，子进程继承的锁可能处于持有状态
+    memset(shm->Ptr(), round, 4 << 20);
+    pid_t pid = fork();
+    ASSERT_NE(pid, -1);
+    if (pid == 0) {
+      alarm(10);  // 死锁时由 SIGALRM 结束子进程
+      bool ok = shm->Resize(6 << 20) && static_cast<char *>(shm->Ptr())[0] == round;
+      delete shm;
+      _exit(ok ? 0 : 1);
+    }
+    int status = -1;
+    waitpid(pid, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+  delete shm;
+  EXPECT_TRUE(shmlite::ShmHandle::UnLink("shm_file_fork", options));
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
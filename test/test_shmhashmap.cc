@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "libshmlite/container/shm_hash_map.hpp"
+
+struct Pair {
+  long a;
+  long b;
+};
+
+TEST(ShmHashMapTest, BasicTest) {
+  shmlite::ShmHandle::UnLink("map1");
+  shmlite::ShmHashMap<int, double> map("map1", 100);
+  ASSERT_TRUE(map.IsValid());
+  ASSERT_EQ(map.Capacity(), 100);
+  ASSERT_GE(map.BucketCount(), 128);
+  double v = 0;
+  ASSERT_FALSE(map.Find(1, v));
+  ASSERT_TRUE(map.Put(1, 1.5));
+  ASSERT_TRUE(map.Put(2, 2.5));
+  ASSERT_TRUE(map.Find(1, v));
+  ASSERT_DOUBLE_EQ(v, 1.5);
+  ASSERT_TRUE(map.Put(1, 3.5));  // 更新已有的键
+  ASSERT_TRUE(map.Find(1, v));
+  ASSERT_DOUBLE_EQ(v, 3.5);
+  ASSERT_EQ(map.Size(), 2);
+  ASSERT_TRUE(map.Erase(1));
+  ASSERT_FALSE(map.Erase(1));
+  ASSERT_FALSE(map.Contains(1));
+  ASSERT_TRUE(map.Contains(2));
+  ASSERT_EQ(map.Size(), 1);
+  auto make = [](double &out) {
+    out = 9.0;
+    return true;
+  };
+  ASSERT_TRUE(map.FindOrInsert(2, make, v));
+  ASSERT_DOUBLE_EQ(v, 2.5);
+  ASSERT_TRUE(map.FindOrInsert(3, make, v));
+  ASSERT_DOUBLE_EQ(v, 9.0);
+  ASSERT_FALSE(map.FindOrInsert(4, [](double &) { return false; }, v));
+  ASSERT_FALSE(map.Contains(4));
+  // 打开时的容量必须与创建时一致，否则两个进程的桶数量或者容量上限会不同
+  shmlite::ShmHashMap<int, double> other_capacity("map1", 96);
+  EXPECT_FALSE(other_capacity.IsValid());
+  shmlite::ShmHashMap<int, long> other_type("map1", 100);
+  EXPECT_FALSE(other_type.IsValid());
+  shmlite::ShmHashMap<int, double> same("map1", 100);
+  ASSERT_TRUE(same.IsValid());
+  EXPECT_TRUE(same.Contains(3));
+  shmlite::ShmHandle::UnLink("map1");
+}
+
+// 达到容量上限之后不能再插入新的键，删除之后墓碑可以被复用
+TEST(ShmHashMapTest, CapacityTest) {
+  shmlite::ShmHandle::UnLink("map2");
+  shmlite::ShmHashMap<long, long> map("map2", 1000);
+  for (long i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(map.Put(i, i * 2));
+  }
+  ASSERT_FALSE(map.Put(1000, 0));
+  ASSERT_TRUE(map.Put(999, 0));  // 更新依然可以
+  for (long i = 0; i < 500; ++i) {
+    ASSERT_TRUE(map.Erase(i));
+  }
+  for (long i = 1000; i < 1500; ++i) {
+    ASSERT_TRUE(map.Put(i, i * 2));
+  }
+  long v = 0;
+  for (long i = 500; i < 1500; ++i) {
+    ASSERT_TRUE(map.Find(i, v));
+    ASSERT_EQ(v, i == 999 ? 0 : i * 2);
+  }
+  shmlite::ShmHandle::UnLink("map2");
+}
+
+// 长时间插入删除时墓碑被增量地清除，探测长度保持有界
+TEST(ShmHashMapTest, ChurnTest) {
+  constexpr long kLive = 700;
+  shmlite::ShmHandle::UnLink("map4");
+  shmlite::ShmHashMap<long, long> map("map4", 1000);
+  for (long i = 0; i < kLive; ++i) {
+    ASSERT_TRUE(map.Put(i, i));
+  }
+  for (long i = kLive; i < 200000; ++i) {
+    ASSERT_TRUE(map.Erase(i - kLive));
+    ASSERT_TRUE(map.Put(i, i));
+    ASSERT_LE(map.Tombstones(), map.BucketCount() / 8);
+  }
+  EXPECT_EQ(map.Size(), kLive);
+  EXPECT_LT(map.MaxProbeLength(), 128);
+  long v = 0;
+  for (long i = 200000 - kLive; i < 200000; ++i) {
+    ASSERT_TRUE(map.Find(i, v));
+    ASSERT_EQ(v, i);
+  }
+  EXPECT_FALSE(map.Find(0, v));
+  shmlite::ShmHandle::UnLink("map4");
+}
+
+// 一个写进程不断修改，多个读进程不加锁读取，不能读到撕裂的值
+TEST(ShmHashMapTest, ConcurrentReadTest) {
+  constexpr int kReaders = 3;
+  constexpr long kKeys = 64;
+  shmlite::ShmHandle::UnLink("map3");
+  shmlite::ShmHashMap<long, Pair> map("map3", kKeys);
+  for (long i = 0; i < kKeys; ++i) {
+    map.Put(i, Pair{0, 0});
+  }
+  pid_t writer = fork();
+  if (writer == 0) {
+    for (long round = 1; round <= 20000; ++round) {
+      map.Put(round % kKeys, Pair{round, -round});
+    }
+    _exit(0);
+  }
+  for (int i = 0; i < kReaders; ++i) {
+    if (fork() == 0) {
+      Pair p{};
+      for (long round = 0; round < 100000; ++round) {
+        if (!map.Find(round % kKeys, p) || p.a != -p.b) {
+          _exit(1);
+        }
+      }
+      _exit(0);
+    }
+  }
+  for (int i = 0; i < kReaders + 1; ++i) {
+    int status = 0;
+    wait(&status);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+  }
+  shmlite::ShmHandle::UnLink("map3");
+}
+
+// 写进程不断删除插入触发增量的墓碑整理，读进程始终能找到没有被删除的键
+TEST(ShmHashMapTest, ConcurrentChurnTest) {
+  constexpr int kReaders = 2;
+  constexpr long kStable = 32;
+  shmlite::ShmHandle::UnLink("map5");
+  shmlite::ShmHashMap<long, long> map("map5", 256);
+  for (long i = 0; i < kStable; ++i) {
+    map.Put(-i - 1, i);
+  }
+  pid_t writer = fork();
+  if (writer == 0) {
+    for (long i = 0; i < 100000; ++i) {
+      map.Put(i, i);
+      if (i >= 100) {
+        map.Erase(i - 100);
+      }
+    }
+    _exit(0);
+  }
+  for (int i = 0; i < kReaders; ++i) {
+    if (fork() == 0) {
+      long v = 0;
+      for (long round = 0; round < 200000; ++round) {
+        if (!map.Find(-(round % kStable) - 1, v) || v != round % kStable) {
+          _exit(1);
+        }
+      }
+      _exit(0);
+    }
+  }
+  for (int i = 0; i < kReaders + 1; ++i) {
+    int status = 0;
+    wait(&status);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+  }
+  shmlite::ShmHandle::UnLink("map5");
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <set>
+#include <vector>
+#include "libshmlite/shm_heap.h"
+
+TEST(ShmHeapTest, BasicTest) {
+  shmlite::ShmHandle::UnLink("heap1");
+  shmlite::ShmHeap heap("heap1", 4 * 1024 * 1024);
+  ASSERT_TRUE(heap.IsValid());
+  shmlite::ShmHeapStats stats = heap.Stats();
+  ASSERT_GT(stats.chunk_count, 0);
+  ASSERT_EQ(stats.used_bytes, 0);
+
+  uint64_t a = heap.Allocate(sizeof(int));
+  uint64_t b = heap.Allocate(100);
+  uint64_t c = heap.Allocate(200 * 1024);  // 大对象，按chunk分配
+  ASSERT_NE(a, shmlite::kShmNullOffset);
+  ASSERT_NE(b, shmlite::kShmNullOffset);
+  ASSERT_NE(c, shmlite::kShmNullOffset);
+  ASSERT_EQ(a % 16, 0);
+  ASSERT_EQ(heap.Arena()->UsableSize(b), 128);
+  ASSERT_EQ(heap.Arena()->UsableSize(c), 4 * shmlite::kShmHeapChunkSize);
+  *heap.Ptr<int>(a) = 42;
+  ASSERT_EQ(heap.ToOffset(heap.Ptr<int>(a)), a);
+  memset(heap.ToPtr(c), 0xab, 200 * 1024);
+  ASSERT_EQ(*heap.Ptr<int>(a), 42);
+
+  heap.Deallocate(c);
+  heap.Deallocate(b);
+  heap.Deallocate(a);
+  heap.FlushCache();
+  ASSERT_EQ(heap.Stats().used_bytes, 0);
+  shmlite::ShmHandle::UnLink("heap1");
+}
+
+// 分配的块之间不能重叠，耗尽之后返回空偏移量
+TEST(ShmHeapTest, ExhaustTest) {
+  shmlite::ShmHandle::UnLink("heap2");
+  shmlite::ShmHeap heap("heap2", 1024 * 1024);
+  std::set<uint64_t> offsets;
+  for (;;) {
+    uint64_t off = heap.Allocate(1000);
+    if (off == shmlite::kShmNullOffset) {
+      break;
+    }
+    ASSERT_TRUE(offsets.insert(off).second);
+  }
+  ASSERT_GT(offsets.size(), 500);
+  for (uint64_t off : offsets) {
+    heap.Deallocate(off);
+  }
+  heap.FlushCache();
+  ASSERT_EQ(heap.Stats().used_bytes, 0);
+  // 空的chunk归还给堆，只保留该规格的一个，其余的可以整体分配给大对象
+  shmlite::ShmHeapStats stats = heap.Stats();
+  ASSERT_LE(stats.chunks_in_use, 1);
+  uint64_t large = heap.Allocate((stats.chunk_count - 1) * shmlite::kShmHeapChunkSize);
+  ASSERT_NE(large, shmlite::kShmNullOffset);
+  heap.Deallocate(large);
+  ASSERT_NE(heap.Allocate(1000), shmlite::kShmNullOffset);
+  shmlite::ShmHandle::UnLink("heap2");
+}
+
+// 负载在不同规格之间转移时，释放的chunk可以被新的规格使用
+TEST(ShmHeapTest, ShiftSizeClassTest) {
+  shmlite::ShmHandle::UnLink("heap4");
+  shmlite::ShmHeap heap("heap4", 1024 * 1024);
+  std::vector<uint64_t> offsets;
+  size_t round = 0;
+  for (size_t size : {16, 100, 1000, 5000, 16384, 48, 3000}) {
+    for (;;) {
+      uint64_t off = heap.Allocate(size);
+      if (off == shmlite::kShmNullOffset) {
+        break;
+      }
+      *heap.Ptr<char>(off) = 1;
+      offsets.push_back(off);
+    }
+    // 之前的每个规格最多保留一个空的chunk，其余的都能被本轮的规格使用
+    ASSERT_FALSE(offsets.empty()) << size;
+    shmlite::ShmHeapStats stats = heap.Stats();
+    ASSERT_EQ(stats.chunks_in_use, stats.chunk_count);
+    size_t bytes = offsets.size() * heap.Arena()->UsableSize(offsets.front());
+    ASSERT_GT(bytes, (stats.chunk_count - round) * shmlite::kShmHeapChunkSize * 9 / 10) << size;
+    ++round;
+    for (uint64_t off : offsets) {
+      heap.Deallocate(off);
+    }
+    offsets.clear();
+    heap.FlushCache();
+    ASSERT_EQ(heap.Stats().used_bytes, 0);
+  }
+  shmlite::ShmHandle::UnLink("heap4");
+}
+
+// 子进程分配并写入，父进程通过偏移量读取
+TEST(ShmHeapTest, MultiProcessTest) {
+  shmlite::ShmHandle::UnLink("heap3");
+  shmlite::ShmHeap heap("heap3", 1024 * 1024);
+  uint64_t slot = heap.Allocate(sizeof(uint64_t));
+  *heap.Ptr<uint64_t>(slot) = shmlite::kShmNullOffset;
+  pid_t pid = fork();
+  if (pid == 0) {
+    shmlite::ShmHeap child_heap("heap3", 1024 * 1024);
+    uint64_t off = child_heap.Allocate(64);
+    strcpy(child_heap.Ptr<char>(off), "hello heap");
+    *child_heap.Ptr<uint64_t>(slot) = off;
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+  uint64_t off = *heap.Ptr<uint64_t>(slot);
+  ASSERT_NE(off, shmlite::kShmNullOffset);
+  ASSERT_STREQ(heap.Ptr<char>(off), "hello heap");
+  ASSERT_NE(heap.Allocate(64), off);
+  shmlite::ShmHandle::UnLink("heap3");
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
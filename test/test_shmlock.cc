@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "libshmlite/shm_handle.h"
 #include "libshmlite/shm_lock.h"
 
@@ -19,6 +21,104 @@ TEST(SHMLock, BaseTest2) {
   ASSERT_TRUE(shmlite::ShmLock::UnLink("lk3"));
 }
 
+TEST(SHMLock, TryWait) {
+  shmlite::ShmLock::UnLink("lk_try");
+  shmlite::ShmLock lk("lk_try", 1, true);
+  ASSERT_TRUE(lk.TryWait());
+  ASSERT_EQ(lk.GetValue(), 0);
+  ASSERT_FALSE(lk.TryWait());
+  lk.Post();
+  ASSERT_TRUE(lk.TryWait());
+  lk.Post();
+}
+
+TEST(SHMLock, WaitFor) {
+  shmlite::ShmLock::UnLink("lk_waitfor");
+  shmlite::ShmLock lk("lk_waitfor", 1, true);
+  struct timespec timeout = {0, 20 * 1000 * 1000};
+  ASSERT_TRUE(lk.WaitFor(timeout));
+
+  struct timespec begin, end;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  ASSERT_FALSE(lk.WaitFor(timeout));
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double elapsed = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) * 1e-9;
+  ASSERT_GE(elapsed, 0.015);
+
+  /* 另一个进程稍后释放，WaitFor 应在超时前拿到 */
+  pid_t pid = fork();
+  if (pid == 0) {
+    shmlite::ShmLock child("lk_waitfor");
+    usleep(20 * 1000);
+    child.Post();
+    _exit(0);
+  }
+  struct timespec long_timeout = {5, 0};
+  ASSERT_TRUE(lk.WaitFor(long_timeout));
+  waitpid(pid, nullptr, 0);
+  lk.Post();
+}
+
+TEST(SHMLock, Stats) {
+  shmlite::ShmLock::UnLink("lk_stats");
+  shmlite::ShmLockStats stats;
+  ASSERT_FALSE(shmlite::ShmLock::ReadStats("lk_stats", stats));
+  {
+    shmlite::ShmLock plain("lk_stats");
+    ASSERT_FALSE(plain.IsStatsEnabled());
+    plain.Wait();
+    plain.Post();
+    ASSERT_EQ(plain.GetStats().acquisitions, 0u);
+  }
+
+  shmlite::ShmLock lk("lk_stats", 1, true, true);
+  ASSERT_TRUE(lk.IsStatsEnabled());
+  lk.Wait();
+  usleep(10 * 1000);
+  lk.Post();
+  ASSERT_TRUE(lk.TryWait());
+  ASSERT_FALSE(lk.TryWait());
+  lk.Post();
+
+  stats = lk.GetStats();
+  ASSERT_EQ(stats.acquisitions, 2u);
+  ASSERT_EQ(stats.contended, 0u);
+  ASSERT_EQ(stats.timeouts, 1u);
+  ASSERT_GE(stats.max_hold_ns, 10u * 1000 * 1000);
+  ASSERT_GE(stats.total_hold_ns, stats.max_hold_ns);
+
+  /* 子进程持有锁，父进程的获取算作一次竞争；统计在两个进程间共享 */
+  lk.Wait();
+  pid_t pid = fork();
+  if (pid == 0) {
+    shmlite::ShmLock child("lk_stats", 1, false, true);
+    child.Wait();
+    child.Post();
+    _exit(0);
+  }
+  usleep(20 * 1000);
+  lk.Post();
+  waitpid(pid, nullptr, 0);
+
+  ASSERT_TRUE(shmlite::ShmLock::ReadStats("lk_stats", stats));
+  ASSERT_EQ(stats.acquisitions, 4u);
+  ASSERT_EQ(stats.contended, 1u);
+  ASSERT_GE(stats.max_wait_ns, 10u * 1000 * 1000);
+  ASSERT_GE(stats.total_wait_ns, stats.max_wait_ns);
+
+  lk.ResetStats();
+  ASSERT_EQ(lk.GetStats().acquisitions, 0u);
+  ASSERT_EQ(lk.GetStats().max_hold_ns, 0u);
+}
+
+TEST(SHMLock, UnLinkRemovesStats) {
+  shmlite::ShmLock::UnLink("lk_stats2");
+  { shmlite::ShmLock lk("lk_stats2", 1, false, true); }
+  ASSERT_TRUE(shmlite::ShmHandle::CheckExists("lk_stats2.stats"));
+  ASSERT_TRUE(shmlite::ShmLock::UnLink("lk_stats2"));
+  ASSERT_FALSE(shmlite::ShmHandle::CheckExists("lk_stats2.stats"));
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
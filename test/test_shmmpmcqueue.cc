@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "libshmlite/container/shm_mpmc_queue.hpp"
+
+TEST(ShmMpmcQueueTest, BasicTest) {
+  shmlite::ShmHandle::UnLink("mpmc1");
+  shmlite::ShmMpmcQueue<int> queue("mpmc1", 4);
+  ASSERT_TRUE(queue.IsValid());
+  ASSERT_EQ(queue.Capacity(), 4);
+  int v = 0;
+  ASSERT_FALSE(queue.TryPop(v));
+  // 多轮读写，保证槽位序号在回绕之后依然正确
+  for (int round = 0; round < 5; ++round) {
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_TRUE(queue.TryPush(round * 10 + i));
+    }
+    ASSERT_FALSE(queue.TryPush(-1));
+    ASSERT_EQ(queue.Size(), 4);
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_TRUE(queue.TryPop(v));
+      ASSERT_EQ(v, round * 10 + i);
+    }
+    ASSERT_FALSE(queue.TryPop(v));
+  }
+  // 段的大小相同，但元素类型与已经存在的队列不一致
+  shmlite::ShmMpmcQueue<uint64_t> other_type("mpmc1", 4);
+  EXPECT_FALSE(other_type.IsValid());
+  shmlite::ShmMpmcQueue<int> same("mpmc1", 3);
+  EXPECT_TRUE(same.IsValid());
+  shmlite::ShmHandle::UnLink("mpmc1");
+}
+
+// 多个生产者进程和多个消费者进程，使用阻塞版本的接口
+TEST(ShmMpmcQueueTest, MultiProcessTest) {
+  constexpr int kProducers = 3;
+  constexpr int kConsumers = 3;
+  constexpr long kPerProducer = 100000;
+  shmlite::ShmHandle::UnLink("mpmc2");
+  shmlite::ShmHandle::UnLink("mpmc2_sum");
+  shmlite::ShmMpmcQueue<long> queue("mpmc2", 64);
+  shmlite::ShmHandle sum_shm("mpmc2_sum", sizeof(std::atomic<long>) * 2,
+                             shmlite::ShmHandle::CREAT_RDWR, true);
+  auto *sum = reinterpret_cast<std::atomic<long> *>(sum_shm.Ptr());
+  auto *popped = sum + 1;
+  for (int i = 0; i < kProducers; ++i) {
+    if (fork() == 0) {
+      for (long j = 1; j <= kPerProducer; ++j) {
+        queue.Push(j);
+      }
+      _exit(0);
+    }
+  }
+  for (int i = 0; i < kConsumers; ++i) {
+    if (fork() == 0) {
+      long v = 0;
+      for (long j = 0; j < kPerProducer * kProducers / kConsumers; ++j) {
+        queue.Pop(v);
+        sum->fetch_add(v);
+        popped->fetch_add(1);
+      }
+      _exit(0);
+    }
+  }
+  for (int i = 0; i < kProducers + kConsumers; ++i) {
+    int status = 0;
+    wait(&status);
+    ASSERT_TRUE(WIFEXITED(status));
+  }
+  ASSERT_EQ(popped->load(), kPerProducer * kProducers);
+  ASSERT_EQ(sum->load(), kProducers * kPerProducer * (kPerProducer + 1) / 2);
+  ASSERT_EQ(queue.Size(), 0);
+  shmlite::ShmHandle::UnLink("mpmc2");
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
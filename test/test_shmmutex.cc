@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "libshmlite/shm_handle.h"
+#include "libshmlite/shm_mutex.h"
+
+struct Guarded {
+  shmlite::ShmMutex mtx;
+  long counter;
+};
+
+TEST(ShmMutexTest, BaseTest) {
+  shmlite::ShmHandle shm("mtx1", sizeof(Guarded), shmlite::ShmHandle::CREAT_RDWR, true);
+  ASSERT_TRUE(shm.IsValid());
+  // 全零的共享内存即为未上锁的状态
+  auto *g = reinterpret_cast<Guarded *>(shm.Ptr());
+  ASSERT_FALSE(g->mtx.IsLocked());
+  g->mtx.Lock();
+  ASSERT_TRUE(g->mtx.IsLocked());
+  ASSERT_FALSE(g->mtx.TryLock());
+  g->mtx.Unlock();
+  ASSERT_FALSE(g->mtx.IsLocked());
+  ASSERT_TRUE(g->mtx.TryLock());
+  g->mtx.Unlock();
+  {
+    shmlite::ShmMutexGuard guard(g->mtx);
+    ASSERT_TRUE(g->mtx.IsLocked());
+  }
+  ASSERT_FALSE(g->mtx.IsLocked());
+}
+
+// 多个进程同时对同一个计数器加一
+TEST(ShmMutexTest, MultiProcessTest) {
+  constexpr int kProcs = 4;
+  constexpr int kLoops = 20000;
+  shmlite::ShmHandle shm("mtx2", sizeof(Guarded), shmlite::ShmHandle::CREAT_RDWR, true);
+  ASSERT_TRUE(shm.IsValid());
+  auto *g = reinterpret_cast<Guarded *>(shm.Ptr());
+  g->counter = 0;
+  for (int i = 0; i < kProcs; ++i) {
+    pid_t pid = fork();
+    ASSERT_NE(pid, -1);
+    if (pid == 0) {
+      for (int j = 0; j < kLoops; ++j) {
+        shmlite::ShmMutexGuard guard(g->mtx);
+        g->counter++;
+      }
+      _exit(0);
+    }
+  }
+  for (int i = 0; i < kProcs; ++i) {
+    int status = 0;
+    wait(&status);
+    ASSERT_TRUE(WIFEXITED(status));
+  }
+  ASSERT_EQ(g->counter, kProcs * kLoops);
+  ASSERT_FALSE(g->mtx.IsLocked());
+}
+
+// 持有锁的进程崩溃后，下一个获取者会得到 OWNER_DIED
+TEST(ShmRobustMutexTest, OwnerDiedTest) {
+  shmlite::ShmHandle shm("mtx3", sizeof(shmlite::ShmRobustMutex), shmlite::ShmHandle::CREAT_RDWR,
+                         true);
+  ASSERT_TRUE(shm.IsValid());
+  auto *mtx = reinterpret_cast<shmlite::ShmRobustMutex *>(shm.Ptr());
+  ASSERT_EQ(mtx->Lock(), shmlite::ShmRobustMutex::OK);
+  ASSERT_EQ(mtx->GetOwnerTid(), getpid());
+  mtx->Unlock();
+  ASSERT_EQ(mtx->GetOwnerTid(), 0);
+
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    mtx->Lock();
+    _exit(0);  // 持有锁直接退出
+  }
+  waitpid(pid, nullptr, 0);
+  ASSERT_EQ(mtx->Lock(), shmlite::ShmRobustMutex::OWNER_DIED);
+  ASSERT_TRUE(mtx->MarkConsistent());
+  mtx->Unlock();
+  ASSERT_EQ(mtx->TryLock(), shmlite::ShmRobustMutex::OK);
+  mtx->Unlock();
+}
+
+// 得到 OWNER_DIED 后没有标记一致就解锁，锁将不可恢复
+TEST(ShmRobustMutexTest, NotRecoverableTest) {
+  shmlite::ShmHandle shm("mtx4", sizeof(shmlite::ShmRobustMutex), shmlite::ShmHandle::CREAT_RDWR,
+                         true);
+  ASSERT_TRUE(shm.IsValid());
+  auto *mtx = reinterpret_cast<shmlite::ShmRobustMutex *>(shm.Ptr());
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    mtx->Lock();
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+  ASSERT_EQ(mtx->TryLock(), shmlite::ShmRobustMutex::OWNER_DIED);
+  mtx->Unlock();
+  ASSERT_EQ(mtx->Lock(), shmlite::ShmRobustMutex::NOT_RECOVERABLE);
+}
+
+// 初始化者在初始化的过程中退出，等待者接管初始化而不是永远等待
+TEST(ShmRobustMutexTest, InitializerDiedTest) {
+  shmlite::ShmHandle shm("mtx5", sizeof(shmlite::ShmRobustMutex), shmlite::ShmHandle::CREAT_RDWR,
+                         true);
+  ASSERT_TRUE(shm.IsValid());
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+  // 模拟已经退出的子进程正在初始化：初始化状态位于锁的开头，高位为 PID，最低位为 1
+  auto *state = static_cast<std::atomic<uint32_t> *>(shm.Ptr());
+  state->store(static_cast<uint32_t>(pid) << 1 | 1);
+  auto *mtx = reinterpret_cast<shmlite::ShmRobustMutex *>(shm.Ptr());
+  ASSERT_EQ(mtx->Lock(), shmlite::ShmRobustMutex::OK);
+  ASSERT_EQ(mtx->GetOwnerTid(), getpid());
+  mtx->Unlock();
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <new>
+#include <vector>
+#include "libshmlite/shm_allocator.hpp"
+#include "libshmlite/shm_handle.h"
+#include "libshmlite/shm_offset_ptr.hpp"
+
+struct Node {
+  shmlite::shm_offset_ptr<Node> next;
+  int value;
+};
+
+TEST(ShmOffsetPtrTest, BasicTest) {
+  int arr[4] = {1, 2, 3, 4};
+  shmlite::shm_offset_ptr<int> p;
+  ASSERT_FALSE(p);
+  ASSERT_EQ(p.get(), nullptr);
+  ASSERT_TRUE(p == nullptr);
+  p = arr;
+  ASSERT_EQ(*p, 1);
+  ASSERT_EQ(p[2], 3);
+  shmlite::shm_offset_ptr<int> q = p + 3;
+  ASSERT_EQ(*q, 4);
+  ASSERT_EQ(q - p, 3);
+  ASSERT_TRUE(p < q);
+  ++p;
+  ASSERT_EQ(*p, 2);
+  // 拷贝到别的位置之后依然指向同一个目标
+  shmlite::shm_offset_ptr<int> *copy = new shmlite::shm_offset_ptr<int>(p);
+  ASSERT_EQ(copy->get(), &arr[1]);
+  delete copy;
+  // 与 void 指针之间互相转换
+  shmlite::shm_offset_ptr<void> vp = p;
+  ASSERT_EQ(static_cast<shmlite::shm_offset_ptr<int>>(vp).get(), &arr[1]);
+  // 指向自身
+  Node self;
+  self.next = &self;
+  ASSERT_EQ(self.next.get(), &self);
+}
+
+// 同一块共享内存映射两次，得到两个不同的地址，在其中一个映射中构造链表，在另一个映射中遍历
+TEST(ShmOffsetPtrTest, RemapTest) {
+  shmlite::ShmHandle::UnLink("optr1");
+  shmlite::ShmHandle shm1("optr1", sizeof(Node) * 16, shmlite::ShmHandle::CREAT_RDWR);
+  shmlite::ShmHandle shm2("optr1", sizeof(Node) * 16, shmlite::ShmHandle::CREAT_RDWR, true);
+  ASSERT_NE(shm1.Ptr(), shm2.Ptr());
+  auto *nodes1 = reinterpret_cast<Node *>(shm1.Ptr());
+  ASSERT_FALSE(nodes1[0].next);  // 全零即为空指针
+  // 倒序链接：15 -> 14 -> ... -> 0
+  for (int i = 0; i < 16; ++i) {
+    nodes1[i].value = i;
+    nodes1[i].next = i == 0 ? nullptr : &nodes1[i - 1];
+  }
+  auto *nodes2 = reinterpret_cast<Node *>(shm2.Ptr());
+  int expected = 15;
+  for (Node *n = &nodes2[15]; n != nullptr; n = n->next.get()) {
+    ASSERT_GE(reinterpret_cast<char *>(n), reinterpret_cast<char *>(nodes2));
+    ASSERT_EQ(n->value, expected--);
+  }
+  ASSERT_EQ(expected, -1);
+}
+
+// 放在共享内存堆里的 std::vector
+TEST(ShmAllocatorTest, VectorTest) {
+  using ShmIntVector = std::vector<int, shmlite::ShmAllocator<int>>;
+  shmlite::ShmHandle::UnLink("optr2");
+  shmlite::ShmHeap heap1("optr2", 1024 * 1024);
+  uint64_t off = heap1.Allocate(sizeof(ShmIntVector));
+  auto *vec = new (heap1.ToPtr(off)) ShmIntVector(shmlite::ShmAllocator<int>(heap1));
+  for (int i = 0; i < 1000; ++i) {
+    vec->push_back(i);
+  }
+  // 从另一个映射访问同一个 vector
+  shmlite::ShmHeap heap2("optr2", 1024 * 1024);
+  auto *vec2 = heap2.Ptr<ShmIntVector>(off);
+  ASSERT_NE(static_cast<void *>(vec2), static_cast<void *>(vec));
+  ASSERT_EQ(vec2->size(), 1000);
+  long sum = 0;
+  for (int v : *vec2) {
+    sum += v;
+  }
+  ASSERT_EQ(sum, 999 * 1000 / 2);
+  vec2->push_back(1000);
+  ASSERT_EQ(vec->back(), 1000);
+  vec->~ShmIntVector();
+  heap1.Deallocate(off);
+  shmlite::ShmHandle::UnLink("optr2");
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
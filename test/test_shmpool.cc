@@ -1,10 +1,13 @@
 #include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "libshmlite/shm_handle.h"
 #include "libshmlite/shm_pool.hpp"
 
 // get int
 TEST(ShmPoolTest, FuncTest_Get_type_int) {
+  shmlite::ShmHandle::UnLink("a");  // 初始值只在第一次创建时生效，删除上次运行留下的变量
   int *a = GET_INT_DEFAULT("a", 100);
   int *b = GET_INT_DEFAULT("a", 200);  // 创建获取同一个变量值
   ASSERT_EQ(*a, 100);
@@ -24,6 +27,8 @@ TEST(ShmPoolTest, FuncTest_Get_type_int) {
 
 // get float浮点
 TEST(ShmPoolTest, FuncTest_Get_type_float) {
+  shmlite::ShmHandle::UnLink("f1");
+  shmlite::ShmHandle::UnLink("f2");
   {
     float *f1 = GET_FLOAT_DEFAULT("f1", 1.5);
     float *f2 = GET_FLOAT_DEFAULT("f2", 2.6);  // 创建获取同一个变量值
@@ -44,6 +49,8 @@ TEST(ShmPoolTest, FuncTest_Get_type_float) {
 
 // get double
 TEST(ShmPoolTest, FuncTest_Get_type_double) {
+  shmlite::ShmHandle::UnLink("d1");
+  shmlite::ShmHandle::UnLink("d2");
   {
     double *d1 = GET_DOUBLE_DEFAULT("d1", 1.5);
     double *d2 = GET_DOUBLE_DEFAULT("d2", 2.6);  // 创建获取同一个变量值
@@ -64,6 +71,8 @@ TEST(ShmPoolTest, FuncTest_Get_type_double) {
 
 // get char
 TEST(ShmPoolTest, FuncTest_Get_type_char) {
+  shmlite::ShmHandle::UnLink("c1");
+  shmlite::ShmHandle::UnLink("c2");
   {
     char *c1 = GET_CHAR_DEFAULT("c1", 'a');
     char *c2 = GET_CHAR_DEFAULT("c2", 'c');  // 创建获取同一个变量值
@@ -82,33 +91,107 @@ TEST(ShmPoolTest, FuncTest_Get_type_char) {
   }
 }
 
-// 测试获取的类型和已经有的类型不一样时的行为
+// 测试获取的类型和已经有的类型不一样时的行为：段头部记录了类型，不一致时拒绝
 TEST(ShmPoolTest, FuncTest_Get_type_not_match) {
-  // 小类型用大类型去接收　ok
-  int *c1 = GET_INT("c1");
-  ASSERT_EQ(*c1, 't');
-  double *d1 = GET_DOUBLE("d1");
-  ASSERT_DOUBLE_EQ(*d1, 365.785);
-  // 本来是float，用int来接收
-  int *int_f1 = GET_INT("f1");  // f1 = 365.785 -> 0x43b6e47b
-  std::cout << std::hex << std::showbase << "int_f1 = " << *int_f1 << '\n';
-  float f1_value = 365.785;
-  ASSERT_EQ(*int_f1, *reinterpret_cast<int *>(&f1_value));  // 将float类型的内存位置强行用int去解析
+  // 本进程已经获取过的变量
+  ASSERT_EQ(GET_INT("c1"), nullptr);
+  ASSERT_EQ(GET_DOUBLE("f1"), nullptr);
+  ASSERT_EQ(GET_LONG("d2"), nullptr);
+  ASSERT_DOUBLE_EQ(*GET_DOUBLE("d1"), 365.785);
 
-  // 本来是double，用int接收
-  int *int_d2 = GET_INT("d2");  // d2 = 856.36
-  double d2_value = 856.36;
-  std::cout << std::hex << std::ios::showbase << "int_d2 = " << *int_d2 << '\n';
-  ASSERT_EQ(*int_d2,
-            *reinterpret_cast<int *>(
-                &d2_value));  // 将double型的内存位置强行用int去解析,会造成截断，仅保留了低位
+  // 由其它进程创建的变量，打开时校验段头部
+  shmlite::ShmHandle::UnLink("tm_f");
+  pid_t pid = fork();
+  if (pid == 0) {
+    float *f = GET_FLOAT_DEFAULT("tm_f", 365.785);
+    _exit(f != nullptr ? 0 : 1);
+  }
+  int status = -1;
+  waitpid(pid, &status, 0);
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+  ASSERT_EQ(GET_INT("tm_f"), nullptr);   // 大小相同但类型不同
+  ASSERT_EQ(GET_LONG("tm_f"), nullptr);  // 大小不同，不会截断已有的段
+  float *f = GET_FLOAT("tm_f");
+  ASSERT_NE(f, nullptr);
+  ASSERT_FLOAT_EQ(*f, 365.785);
+  shmlite::ShmHandle::UnLink("tm_f");
+}
 
-  long *long_d2 = GET_LONG("d2");  // d2 = 856.36
-  std::cout << std::hex << std::ios::showbase << "long_d2 = " << *long_d2 << '\n';
-  ASSERT_EQ(*long_d2,
-            *reinterpret_cast<long *>(&d2_value));  // 将double型的内存位置强行用long去解析
-  std::cout.unsetf(std::ios::showbase);
-  std::cout.unsetf(std::ios::hex);
+TEST(ShmPoolTest, FuncTest_GetSeqVar) {
+  struct Config {
+    long version;
+    double ratio;
+    char tag[32];
+  };
+  shmlite::ShmHandle::UnLink("seq_config");
+  auto writer = shmlite::ShmPool::GetSeqVar<Config>("seq_config");
+  ASSERT_TRUE(writer.IsValid());
+  Config c{};
+  c.version = 7;
+  c.ratio = 0.5;
+  strcpy(c.tag, "pool");
+  writer.Store(c);
+  // 再次获取得到的是同一个变量
+  auto reader = shmlite::ShmPool::GetSeqVar<Config>("seq_config");
+  Config out = reader.Load();
+  EXPECT_EQ(out.version, 7);
+  EXPECT_DOUBLE_EQ(out.ratio, 0.5);
+  EXPECT_STREQ(out.tag, "pool");
+  EXPECT_EQ(reader.Version(), 1);
+}
+
+// 已经存在的变量不会被其它进程的初始值覆盖
+TEST(ShmPoolTest, FuncTest_Get_default_once) {
+  shmlite::ShmHandle::UnLink("pool_once");
+  pid_t pid = fork();
+  if (pid == 0) {
+    int *v = GET_INT_DEFAULT("pool_once", 1);
+    *v = 42;
+    _exit(0);
+  }
+  int status = -1;
+  waitpid(pid, &status, 0);
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+  int *v = GET_INT_DEFAULT("pool_once", 7);
+  ASSERT_NE(v, nullptr);
+  ASSERT_EQ(*v, 42);
+  shmlite::ShmHandle::UnLink("pool_once");
+}
+
+// 聚合模式：所有变量放在同一个共享内存堆中（切换后不再回到原来的模式，因此放在最后）
+TEST(ShmPoolTest, FuncTest_ArenaMode) {
+  shmlite::ShmHandle::UnLink("pool_arena");
+  shmlite::ShmHandle::UnLink("pool_arena.dir");
+  ASSERT_FALSE(shmlite::ShmPool::IsArenaMode());
+  ASSERT_TRUE(shmlite::ShmPool::UseArena("pool_arena", 1024 * 1024, 128));
+  ASSERT_TRUE(shmlite::ShmPool::IsArenaMode());
+  int *a = GET_INT_DEFAULT("arena_a", 100);
+  int *b = GET_INT_DEFAULT("arena_a", 200);
+  ASSERT_EQ(a, b);
+  ASSERT_EQ(*a, 100);
+  double *d = GET_DOUBLE("arena_d");
+  ASSERT_DOUBLE_EQ(*d, 0.0);
+  ASSERT_EQ(GET_LONG("arena_a"), nullptr);   // 大小不一致
+  ASSERT_EQ(GET_FLOAT("arena_a"), nullptr);  // 大小相同但类型不同
+  // 其它进程通过名字找到同一个变量
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (!shmlite::ShmPool::UseArena("pool_arena", 1024 * 1024, 128)) {
+      _exit(1);
+    }
+    if (GET_FLOAT("arena_a") != nullptr) {  // 目录中记录的类型同样会被校验
+      _exit(3);
+    }
+    int *child_a = GET_INT_DEFAULT("arena_a", 300);
+    *child_a += 1;
+    *GET_DOUBLE("arena_d") = 2.5;
+    _exit(*child_a == 101 ? 0 : 2);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+  ASSERT_EQ(*a, 101);
+  ASSERT_DOUBLE_EQ(*d, 2.5);
 }
 
 int main(int argc, char *argv[]) {
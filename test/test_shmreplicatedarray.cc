@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "libshmlite/container/shm_replicated_array.hpp"
+
+TEST(NumaUtilsTest, ParseIdListTest) {
+  EXPECT_EQ(shmlite::ParseIdList("0"), std::vector<int>({0}));
+  EXPECT_EQ(shmlite::ParseIdList("0-3,8,10-11\n"), std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_TRUE(shmlite::ParseIdList("").empty());
+  EXPECT_FALSE(shmlite::NumaOnlineNodes().empty());
+  EXPECT_FALSE(shmlite::NumaNodeCpus(shmlite::CurrentNumaNode()).empty());
+}
+
+TEST(ShmReplicatedArrayTest, BasicTest) {
+  shmlite::ShmReplicatedArray<int>::UnLink("reparr");
+  shmlite::ShmReplicatedArray<int> arr("reparr", 1024);
+  ASSERT_TRUE(arr.IsValid());
+  EXPECT_EQ(arr.Size(), 1024);
+  EXPECT_EQ(arr.ReplicaCount(), shmlite::NumaOnlineNodes().size());
+  EXPECT_EQ(arr.LocalNode(), shmlite::CurrentNumaNode());
+
+  arr.Fill(7);
+  arr.Set(10, 42);
+  EXPECT_EQ(arr[0], 7);
+  EXPECT_EQ(arr.At(10), 42);
+  // 所有副本都被更新
+  for (size_t i = 0; i < arr.ReplicaCount(); ++i) {
+    EXPECT_EQ(arr.Replica(i)[10], 42);
+    EXPECT_EQ(arr.Replica(i)[1023], 7);
+  }
+  EXPECT_THROW(arr[1024], std::out_of_range);
+  EXPECT_TRUE(shmlite::ShmReplicatedArray<int>::UnLink("reparr"));
+}
+
+TEST(ShmReplicatedArrayTest, MultiProcessTest) {
+  shmlite::ShmReplicatedArray<long>::UnLink("reparr_mp");
+  shmlite::ShmReplicatedArray<long> arr("reparr_mp", 256);
+  arr.Fill(0);
+  pid_t pid = fork();
+  if (pid == 0) {
+    shmlite::ShmReplicatedArray<long> child("reparr_mp", 256);
+    for (size_t i = 0; i < child.Size(); ++i) {
+      child.Set(i, static_cast<long>(i * i));
+    }
+    _exit(0);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  EXPECT_EQ(status, 0);
+  for (size_t i = 0; i < arr.Size(); ++i) {
+    EXPECT_EQ(arr[i], static_cast<long>(i * i));
+  }
+  EXPECT_TRUE(shmlite::ShmReplicatedArray<long>::UnLink("reparr_mp"));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include "libshmlite/shm_handle.h"
+#include "libshmlite/shm_rwlock.h"
+
+struct RwShared {
+  shmlite::ShmRwLock lock;
+  long values[8];
+  std::atomic<int> stop;
+  std::atomic<long> reads;
+};
+
+TEST(ShmRwLockTest, BasicTest) {
+  shmlite::ShmHandle shm("rwlock1", sizeof(RwShared), shmlite::ShmHandle::CREAT_RDWR, true);
+  auto *shared = static_cast<RwShared *>(shm.Ptr());
+  shmlite::ShmRwLock &lock = shared->lock;
+  EXPECT_EQ(lock.GetPreference(), shmlite::SHM_RWLOCK_PREFER_WRITER);
+  // 多个读者可以同时持有
+  size_t s1 = lock.ReadLock();
+  size_t s2 = 0;
+  EXPECT_TRUE(lock.TryReadLock(s2));
+  EXPECT_EQ(lock.Readers(), 2);
+  lock.ReadUnlock(s1);
+  lock.ReadUnlock(s2);
+  EXPECT_EQ(lock.Readers(), 0);
+  {
+    shmlite::ShmWriteGuard guard(lock);
+    size_t slot;
+    EXPECT_FALSE(lock.TryReadLock(slot));
+    EXPECT_EQ(lock.Readers(), 0);
+  }
+  {
+    shmlite::ShmReadGuard guard(lock);
+    EXPECT_EQ(lock.Readers(), 1);
+  }
+  EXPECT_EQ(lock.Readers(), 0);
+}
+
+/**
+ * @brief 一个写者不断修改所有的值为同一个数，多个读者检查读到的值始终一致
+ */
+static void RunConsistency(shmlite::ShmRwLockPreference preference) {
+  shmlite::ShmHandle shm("rwlock2", sizeof(RwShared), shmlite::ShmHandle::CREAT_RDWR, true);
+  auto *shared = static_cast<RwShared *>(shm.Ptr());
+  memset(static_cast<void *>(shared), 0, sizeof(RwShared));
+  shared->lock.SetPreference(preference);
+  const int readers = 4;
+  const long writes = 2000;
+  for (int i = 0; i < readers; ++i) {
+    if (fork() == 0) {
+      bool consistent = true;
+      while (shared->stop.load() == 0) {
+        shmlite::ShmReadGuard guard(shared->lock);
+        for (long v : shared->values) {
+          consistent = consistent && v == shared->values[0];
+        }
+        shared->reads.fetch_add(1);
+      }
+      _exit(consistent ? 0 : 1);
+    }
+  }
+  for (long n = 1; n <= writes; ++n) {
+    shmlite::ShmWriteGuard guard(shared->lock);
+    for (long &v : shared->values) {
+      v = n;
+    }
+  }
+  shared->stop.store(1);
+  for (int i = 0; i < readers; ++i) {
+    int status = -1;
+    wait(&status);
+    EXPECT_EQ(status, 0);
+  }
+  EXPECT_EQ(shared->values[7], writes);
+  EXPECT_EQ(shared->lock.Readers(), 0);
+}
+
+TEST(ShmRwLockTest, WriterPreferenceTest) { RunConsistency(shmlite::SHM_RWLOCK_PREFER_WRITER); }
+
+TEST(ShmRwLockTest, ReaderPreferenceTest) { RunConsistency(shmlite::SHM_RWLOCK_PREFER_READER); }
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "libshmlite/shm_seq_var.hpp"
+
+struct Snapshot {
+  long values[16];
+};
+
+TEST(ShmSeqVarTest, BasicTest) {
+  shmlite::ShmHandle::UnLink("seqvar1");
+  shmlite::ShmSeqVar<Snapshot> var("seqvar1");
+  ASSERT_TRUE(var.IsValid());
+  EXPECT_EQ(var.Version(), 0);
+  for (long v : var.Load().values) {
+    EXPECT_EQ(v, 0);
+  }
+
+  Snapshot s;
+  for (int i = 0; i < 16; ++i) {
+    s.values[i] = i;
+  }
+  var.Store(s);
+  EXPECT_EQ(var.Version(), 1);
+  EXPECT_EQ(var.Load().values[15], 15);
+  var.Update([](Snapshot &cur) { cur.values[0] = 100; });
+  EXPECT_EQ(var.Version(), 2);
+
+  // 另一个对象打开的是同一个变量
+  shmlite::ShmSeqVar<Snapshot> other("seqvar1");
+  Snapshot out;
+  EXPECT_TRUE(other.TryLoad(out));
+  EXPECT_EQ(out.values[0], 100);
+  EXPECT_EQ(out.values[1], 1);
+  shmlite::ShmHandle::UnLink("seqvar1");
+}
+
+// 同名的变量以不同的类型打开时对象不可用，不带段头部的共享内存也不能当作变量打开
+TEST(ShmSeqVarTest, TypeMismatchTest) {
+  shmlite::ShmHandle::UnLink("seqvar4");
+  shmlite::ShmSeqVar<Snapshot> var("seqvar4");
+  ASSERT_TRUE(var.IsValid());
+  shmlite::ShmSeqVar<double> other("seqvar4");
+  EXPECT_FALSE(other.IsValid());
+  shmlite::ShmSeqVar<Snapshot> same("seqvar4");
+  EXPECT_TRUE(same.IsValid());
+  shmlite::ShmHandle::UnLink("seqvar4");
+
+  shmlite::ShmHandle::UnLink("seqvar5");
+  {
+    shmlite::ShmHandle raw("seqvar5", 4096, shmlite::ShmHandle::CREAT_RDWR);
+    ASSERT_TRUE(raw.IsValid());
+    memset(raw.Ptr(), 0xff, raw.GetSize());
+  }
+  shmlite::ShmSeqVar<Snapshot> foreign("seqvar5");
+  EXPECT_FALSE(foreign.IsValid());
+  shmlite::ShmHandle::UnLink("seqvar5");
+}
+
+TEST(ShmSeqVarTest, LoadIfChangedTest) {
+  shmlite::ShmHandle::UnLink("seqvar2");
+  shmlite::ShmSeqVar<Snapshot> var("seqvar2");
+  Snapshot out{};
+  uint64_t version = 0;
+  EXPECT_FALSE(var.LoadIfChanged(out, version));
+  Snapshot s{};
+  s.values[3] = 3;
+  var.Store(s);
+  EXPECT_TRUE(var.LoadIfChanged(out, version));
+  EXPECT_EQ(version, 1);
+  EXPECT_EQ(out.values[3], 3);
+  EXPECT_FALSE(var.LoadIfChanged(out, version));
+  shmlite::ShmHandle::UnLink("seqvar2");
+}
+
+TEST(ShmSeqVarTest, NoTornReadTest) {
+  shmlite::ShmHandle::UnLink("seqvar3");
+  shmlite::ShmSeqVar<Snapshot> var("seqvar3");
+  const long writes = 200000;
+  pid_t pid = fork();
+  if (pid == 0) {
+    shmlite::ShmSeqVar<Snapshot> writer("seqvar3");
+    for (long n = 1; n <= writes; ++n) {
+      writer.Update([n](Snapshot &cur) {
+        for (long &v : cur.values) {
+          v = n;
+        }
+      });
+    }
+    _exit(0);
+  }
+  // 读者看到的每个快照中所有的值都必须相同
+  long torn = 0, last = 0;
+  while (last < writes) {
+    Snapshot s = var.Load();
+    for (long v : s.values) {
+      torn += v != s.values[0];
+    }
+    EXPECT_GE(s.values[0], last);
+    last = s.values[0];
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  EXPECT_EQ(status, 0);
+  EXPECT_EQ(torn, 0);
+  EXPECT_EQ(var.Version(), static_cast<uint64_t>(writes));
+  shmlite::ShmHandle::UnLink("seqvar3");
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include "libshmlite/container/shm_array.hpp"
+#include "libshmlite/shm_handle.h"
+#include "libshmlite/shm_snapshot.h"
+
+static std::string SnapshotPath(const char *name) {
+  return std::string("/tmp/lsml-test-") + name + "-" + std::to_string(getpid()) + ".snap";
+}
+
+TEST(ShmSnapshotTest, RawRoundTripTest) {
+  const size_t kSize = 3 * 4096 + 100;  // 不是页大小的整数倍
+  std::string path = SnapshotPath("raw");
+  shmlite::ShmHandle::UnLink("snap_raw");
+  {
+    shmlite::ShmHandle shm("snap_raw", kSize, shmlite::ShmHandle::CREAT_RDWR, true);
+    ASSERT_TRUE(shm.IsValid());
+    auto *bytes = static_cast<unsigned char *>(shm.Ptr());
+    for (size_t i = 0; i < kSize; ++i) {
+      bytes[i] = static_cast<unsigned char>(i * 7);
+    }
+    shmlite::ShmSnapshotStats stats;
+    ASSERT_TRUE(shmlite::SaveSnapshot(shm, path, shmlite::ShmSnapshotOptions(), nullptr, &stats));
+    EXPECT_EQ(stats.bytes_written, 4 * 4096);
+  }
+  shmlite::ShmSnapshotInfo info;
+  ASSERT_TRUE(shmlite::ReadSnapshotInfo(path, info));
+  EXPECT_EQ(info.segment_size, kSize);
+  EXPECT_FALSE(info.journal_pending);
+  EXPECT_FALSE(info.segment_header);
+
+  shmlite::ShmSnapshotOptions options;
+  options.direct_io = true;
+  options.chunk_size = 4096;
+  ASSERT_TRUE(shmlite::RestoreSnapshot(path, "snap_raw", options));
+  // 大小为 0 时打开已经存在的共享内存
+  shmlite::ShmHandle shm("snap_raw", 0, shmlite::ShmHandle::READ_ONLY, true);
+  ASSERT_TRUE(shm.IsValid());
+  EXPECT_EQ(shm.GetSize(), kSize);
+  auto *bytes = static_cast<const unsigned char *>(shm.Ptr());
+  size_t mismatches = 0;
+  for (size_t i = 0; i < kSize; ++i) {
+    mismatches += bytes[i] != static_cast<unsigned char>(i * 7);
+  }
+  EXPECT_EQ(mismatches, 0);
+  // 已经存在的段不会被覆盖
+  EXPECT_FALSE(shmlite::RestoreSnapshot(path, "snap_raw"));
+  unlink(path.c_str());
+}
+
+TEST(ShmSnapshotTest, ArrayRoundTripTest) {
+  const size_t kSize = 100000;
+  std::string path = SnapshotPath("arr");
+  shmlite::ShmHandle::UnLink("snap_arr");
+  {
+    shmlite::ShmArray<int> arr("snap_arr", kSize,
+                               [](int *first, size_t n) { std::iota(first, first + n, 0); });
+    ASSERT_TRUE(arr.IsValid());
+    shmlite::ShmSnapshotOptions options;
+    options.direct_io = true;
+    ASSERT_TRUE(shmlite::SaveSnapshot("snap_arr", path, options));
+  }
+  shmlite::ShmHandle::UnLink("snap_arr");
+  shmlite::ShmSnapshotInfo info;
+  ASSERT_TRUE(shmlite::ReadSnapshotInfo(path, info));
+  EXPECT_TRUE(info.segment_header);
+
+  ASSERT_TRUE(shmlite::RestoreSnapshot(path, "snap_arr"));
+  // 恢复出来的段已经初始化，打开时不会再调用初始化函数
+  shmlite::ShmArray<int> arr("snap_arr", kSize, -1);
+  ASSERT_TRUE(arr.IsValid());
+  EXPECT_FALSE(arr.IsCreator());
+  EXPECT_EQ(arr[0], 0);
+  EXPECT_EQ(arr[kSize - 1], static_cast<int>(kSize - 1));
+  // 类型不一致依然能被发现
+  shmlite::ShmArray<float> wrong("snap_arr", kSize);
+  EXPECT_FALSE(wrong.IsValid());
+  shmlite::ShmHandle::UnLink("snap_arr");
+  unlink(path.c_str());
+}
+
+TEST(ShmSnapshotTest, CheckpointTest) {
+  const size_t kPage = shmlite::kShmDirtyPageSize;
+  const size_t kSize = 256 * kPage;
+  std::string path = SnapshotPath("ckpt");
+  shmlite::ShmHandle::UnLink("snap_ckpt");
+  shmlite::ShmDirtyTracker::UnLink("snap_ckpt");
+  shmlite::ShmHandle shm("snap_ckpt", kSize, shmlite::ShmHandle::CREAT_RDWR, true);
+  ASSERT_TRUE(shm.IsValid());
+  shmlite::ShmDirtyTracker tracker("snap_ckpt", kSize);
+  ASSERT_TRUE(tracker.IsValid());
+  EXPECT_EQ(tracker.CountDirty(), 0);
+  auto *bytes = static_cast<char *>(shm.Ptr());
+  memset(bytes, 'a', kSize);
+
+  // 没有快照文件时退化为完整快照
+  shmlite::ShmSnapshotStats stats;
+  ASSERT_TRUE(shmlite::CheckpointSnapshot(shm, tracker, path, shmlite::ShmSnapshotOptions(), &stats));
+  EXPECT_EQ(stats.bytes_written, kSize);
+
+  // 修改第 3 页、第 10~12 页（跨页的写入）和最后一页
+  memset(bytes + 3 * kPage + 5, 'b', 10);
+  tracker.MarkDirty(3 * kPage + 5, 10);
+  memset(bytes + 10 * kPage + 1, 'c', 2 * kPage);
+  tracker.MarkDirty(10 * kPage + 1, 2 * kPage);
+  bytes[kSize - 1] = 'd';
+  tracker.MarkDirty(kSize - 1, 1);
+  EXPECT_EQ(tracker.CountDirty(), 5);
+  // 另一个进程中打开的位图看到相同的标记
+  shmlite::ShmDirtyTracker other("snap_ckpt", kSize);
+  EXPECT_EQ(other.CountDirty(), 5);
+
+  ASSERT_TRUE(shmlite::CheckpointSnapshot(shm, tracker, path, shmlite::ShmSnapshotOptions(), &stats));
+  EXPECT_EQ(stats.pages_written, 5);
+  EXPECT_EQ(stats.bytes_written, 5 * kPage);
+  EXPECT_EQ(tracker.CountDirty(), 0);
+  shmlite::ShmSnapshotInfo info;
+  ASSERT_TRUE(shmlite::ReadSnapshotInfo(path, info));
+  EXPECT_EQ(info.checkpoints, 1);
+  EXPECT_FALSE(info.journal_pending);
+
+  shmlite::ShmHandle::UnLink("snap_ckpt_restored");
+  ASSERT_TRUE(shmlite::RestoreSnapshot(path, "snap_ckpt_restored"));
+  shmlite::ShmHandle restored("snap_ckpt_restored", 0, shmlite::ShmHandle::READ_ONLY, true);
+  ASSERT_TRUE(restored.IsValid());
+  EXPECT_EQ(memcmp(restored.Ptr(), bytes, kSize), 0);
+  shmlite::ShmDirtyTracker::UnLink("snap_ckpt");
+  unlink(path.c_str());
+  unlink((path + ".journal").c_str());
+}
+
+/**
+ * @brief 检查恢复出来的段第 page 页的内容都是 c
+ *
+ */
+static bool RestoredPageIs(const std::string &path, size_t page, char c) {
+  shmlite::ShmHandle::UnLink("snap_torn_restored");
+  if (!shmlite::RestoreSnapshot(path, "snap_torn_restored")) {
+    return false;
+  }
+  shmlite::ShmHandle restored("snap_torn_restored", 0, shmlite::ShmHandle::READ_ONLY, true);
+  const char *p = static_cast<const char *>(restored.Ptr()) + page * 4096;
+  return restored.IsValid() && std::count(p, p + 4096, c) == 4096;
+}
+
+TEST(ShmSnapshotTest, TornCheckpointTest) {
+  const size_t kPage = 4096;
+  const size_t kSize = 8 * kPage;
+  std::string path = SnapshotPath("torn");
+  shmlite::ShmHandle::UnLink("snap_torn");
+  shmlite::ShmDirtyTracker::UnLink("snap_torn");
+  shmlite::ShmHandle shm("snap_torn", kSize, shmlite::ShmHandle::CREAT_RDWR, true);
+  shmlite::ShmDirtyTracker tracker("snap_torn", kSize);
+  char *bytes = static_cast<char *>(shm.Ptr());
+  memset(bytes, 'a', kSize);
+  ASSERT_TRUE(shmlite::SaveSnapshot(shm, path, shmlite::ShmSnapshotOptions(), &tracker));
+
+  // 日志提交之前崩溃：只留下写了一半的临时日志，恢复出上一个快照
+  memset(bytes + 2 * kPage, 'b', kPage);
+  tracker.MarkDirty(2 * kPage, kPage);
+  int fd = open((path + ".journal.tmp").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(write(fd, bytes, 100), 100);
+  close(fd);
+  EXPECT_TRUE(RestoredPageIs(path, 2, 'a'));
+
+  // 日志提交之后、原地写回的过程中崩溃：快照文件中的页写了一半，头部还是上一个检查点
+  ASSERT_TRUE(shmlite::CheckpointSnapshot(shm, tracker, path));
+  fd = open(path.c_str(), O_RDWR);
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(pwrite(fd, "torn", 4, kPage + 2 * kPage + 100), 4);
+  uint64_t checkpoints = 0;
+  ASSERT_EQ(pwrite(fd, &checkpoints, sizeof(checkpoints), 24), sizeof(checkpoints));
+  close(fd);
+  shmlite::ShmSnapshotInfo info;
+  ASSERT_TRUE(shmlite::ReadSnapshotInfo(path, info));
+  EXPECT_TRUE(info.journal_pending);
+  EXPECT_EQ(info.checkpoints, 1);
+  // 重放日志之后得到提交的检查点
+  EXPECT_TRUE(RestoredPageIs(path, 2, 'b'));
+  EXPECT_TRUE(RestoredPageIs(path, 3, 'a'));
+
+  // 下一个检查点先把日志写回快照文件
+  memset(bytes + 5 * kPage, 'c', kPage);
+  tracker.MarkDirty(5 * kPage, kPage);
+  ASSERT_TRUE(shmlite::CheckpointSnapshot(shm, tracker, path));
+  ASSERT_TRUE(shmlite::ReadSnapshotInfo(path, info));
+  EXPECT_FALSE(info.journal_pending);
+  EXPECT_EQ(info.checkpoints, 2);
+  unlink((path + ".journal").c_str());  // 没有日志时快照文件本身也是完整的
+  EXPECT_TRUE(RestoredPageIs(path, 2, 'b'));
+  EXPECT_TRUE(RestoredPageIs(path, 5, 'c'));
+  shmlite::ShmHandle::UnLink("snap_torn_restored");
+  shmlite::ShmDirtyTracker::UnLink("snap_torn");
+  unlink(path.c_str());
+}
+
+TEST(ShmSnapshotTest, SeqTest) {
+  const size_t kSize = 4 * 4096;
+  std::string path = SnapshotPath("seq");
+  shmlite::ShmHandle::UnLink("snap_seq");
+  shmlite::ShmHandle shm("snap_seq", kSize, shmlite::ShmHandle::CREAT_RDWR, true);
+  std::atomic<uint64_t> seq(1);  // 写者一直没有完成
+  shmlite::ShmSnapshotOptions options;
+  options.seq = &seq;
+  options.max_retries = 2;
+  shmlite::ShmSnapshotStats stats;
+  EXPECT_FALSE(shmlite::SaveSnapshot(shm, path, options, nullptr, &stats));
+  EXPECT_NE(access(path.c_str(), F_OK), 0);
+  EXPECT_NE(access((path + ".tmp").c_str(), F_OK), 0);
+  seq = 2;
+  EXPECT_TRUE(shmlite::SaveSnapshot(shm, path, options, nullptr, &stats));
+  EXPECT_EQ(stats.retries, 0);
+  unlink(path.c_str());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
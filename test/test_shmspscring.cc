@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "libshmlite/container/shm_spsc_ring.hpp"
+
+TEST(ShmSpscRingTest, BasicTest) {
+  shmlite::ShmHandle::UnLink("ring1");
+  shmlite::ShmSpscRing<int> ring("ring1", 5);
+  ASSERT_TRUE(ring.IsValid());
+  ASSERT_EQ(ring.Capacity(), 8);  // 向上取整到2的幂次
+  ASSERT_EQ(ring.Size(), 0);
+  int v = 0;
+  ASSERT_FALSE(ring.TryPop(v));
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_TRUE(ring.TryPush(i));
+  }
+  ASSERT_FALSE(ring.TryPush(8));  // 队列已满
+  ASSERT_EQ(ring.Size(), 8);
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_TRUE(ring.TryPop(v));
+    ASSERT_EQ(v, i);
+  }
+  ASSERT_FALSE(ring.TryPop(v));
+  // 打开时容量或者元素类型与已经存在的队列不一致，即使段的大小恰好相同
+  shmlite::ShmSpscRing<uint64_t> half("ring1", 4);
+  EXPECT_FALSE(half.IsValid());
+  shmlite::ShmSpscRing<float> other_type("ring1", 8);
+  EXPECT_FALSE(other_type.IsValid());
+  shmlite::ShmSpscRing<int> same("ring1", 7);
+  ASSERT_TRUE(same.IsValid());
+  EXPECT_EQ(same.Capacity(), 8);
+  shmlite::ShmHandle::UnLink("ring1");
+}
+
+// 批量读写，并且跨越环形队列的末尾
+TEST(ShmSpscRingTest, BatchWrapTest) {
+  shmlite::ShmHandle::UnLink("ring2");
+  shmlite::ShmSpscRing<long> ring("ring2", 16);
+  long in[12], out[12];
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 12; ++i) {
+      in[i] = round * 100 + i;
+    }
+    ASSERT_EQ(ring.TryPush(in, 12), 12);
+    ASSERT_EQ(ring.TryPush(in, 12), 4);  // 只剩下4个空位
+    ASSERT_EQ(ring.TryPop(out, 12), 12);
+    for (int i = 0; i < 12; ++i) {
+      ASSERT_EQ(out[i], in[i]);
+    }
+    ASSERT_EQ(ring.TryPop(out, 12), 4);
+  }
+  shmlite::ShmHandle::UnLink("ring2");
+}
+
+// 缓存的读写位置过期的对象（例如 fork 之前就存在的对象）不会越过对端
+TEST(ShmSpscRingTest, StaleCacheTest) {
+  shmlite::ShmHandle::UnLink("ring4");
+  shmlite::ShmSpscRing<long> producer("ring4", 16);
+  shmlite::ShmSpscRing<long> consumer("ring4", 16);
+  {
+    shmlite::ShmSpscRing<long> active("ring4", 16);
+    long buf[16] = {};
+    for (int round = 0; round < 100; ++round) {
+      ASSERT_EQ(active.TryPush(buf, 16), 16);
+      ASSERT_EQ(active.TryPop(buf, 16), 16);
+    }
+  }
+  long out[4];
+  EXPECT_EQ(consumer.TryPop(out, 4), 0);  // 队列是空的
+  long in[16];
+  for (int i = 0; i < 16; ++i) {
+    in[i] = i;
+  }
+  EXPECT_EQ(producer.TryPush(in, 16), 16);
+  EXPECT_EQ(producer.TryPush(in, 1), 0);  // 队列已满
+  ASSERT_EQ(consumer.TryPop(out, 4), 4);
+  EXPECT_EQ(out[3], 3);
+  shmlite::ShmHandle::UnLink("ring4");
+}
+
+// 生产者和消费者位于不同的进程
+TEST(ShmSpscRingTest, MultiProcessTest) {
+  constexpr long kCount = 1000000;
+  shmlite::ShmHandle::UnLink("ring3");
+  shmlite::ShmSpscRing<long> ring("ring3", 1024);
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    shmlite::ShmSpscRing<long> producer("ring3", 1024);
+    for (long i = 0; i < kCount;) {
+      if (producer.TryPush(i)) {
+        ++i;
+      }
+    }
+    _exit(0);
+  }
+  long expected = 0, v = 0;
+  while (expected < kCount) {
+    if (ring.TryPop(v)) {
+      ASSERT_EQ(v, expected);
+      ++expected;
+    }
+  }
+  waitpid(pid, nullptr, 0);
+  shmlite::ShmHandle::UnLink("ring3");
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "libshmlite/container/shm_vector.hpp"
+
+TEST(ShmVectorTest, PushBackAndGrow) {
+  shmlite::ShmVector<uint64_t>::UnLink("vec1");
+  shmlite::ShmVector<uint64_t> vec("vec1");
+  ASSERT_TRUE(vec.IsValid());
+  EXPECT_EQ(vec.Size(), 0);
+  EXPECT_EQ(vec.Capacity(), 4096 / sizeof(uint64_t));
+  EXPECT_EQ(vec.Generation(), 0);
+  EXPECT_THROW(vec[0], std::out_of_range);
+
+  const size_t n = 100000;
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_TRUE(vec.PushBack(i * 3));
+  }
+  EXPECT_EQ(vec.Size(), n);
+  EXPECT_GE(vec.Capacity(), n);
+  EXPECT_LT(vec.Capacity(), 2 * n);
+  EXPECT_GT(vec.Generation(), 0);
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(vec[i], i * 3);
+  }
+  EXPECT_THROW(vec.At(n), std::out_of_range);
+
+  vec.Clear();
+  EXPECT_EQ(vec.Size(), 0);
+  EXPECT_GE(vec.Capacity(), n);
+  ASSERT_TRUE(shmlite::ShmVector<uint64_t>::UnLink("vec1"));
+}
+
+TEST(ShmVectorTest, ReserveAndAppend) {
+  shmlite::ShmVector<int>::UnLink("vec2");
+  shmlite::ShmVector<int> vec("vec2", 10000);
+  ASSERT_TRUE(vec.IsValid());
+  EXPECT_GE(vec.Capacity(), 10000);
+  uint64_t generation = vec.Generation();
+  int items[5000];
+  for (int i = 0; i < 5000; ++i) {
+    items[i] = i;
+  }
+  ASSERT_TRUE(vec.Append(items, 5000));
+  ASSERT_TRUE(vec.Append(items, 5000));
+  EXPECT_EQ(vec.Generation(), generation);
+  EXPECT_EQ(vec.Size(), 10000);
+  EXPECT_EQ(vec[7500], 2500);
+  ASSERT_TRUE(vec.Reserve(50000));
+  EXPECT_EQ(vec.Capacity(), 50000);
+  EXPECT_EQ(vec[9999], 4999);
+  shmlite::ShmVector<int>::UnLink("vec2");
+}
+
+TEST(ShmVectorTest, AttachKeepsContent) {
+  shmlite::ShmVector<int>::UnLink("vec3");
+  {
+    shmlite::ShmVector<int> vec("vec3");
+    for (int i = 0; i < 5000; ++i) {
+      vec.PushBack(i);
+    }
+  }
+  shmlite::ShmVector<int> vec("vec3", 10);
+  EXPECT_EQ(vec.Size(), 5000);
+  EXPECT_EQ(vec.MappedCapacity(), vec.Capacity());
+  EXPECT_EQ(vec[4999], 4999);
+  shmlite::ShmVector<int>::UnLink("vec3");
+}
+
+TEST(ShmVectorTest, CrossProcessRemap) {
+  shmlite::ShmVector<uint64_t>::UnLink("vec4");
+  shmlite::ShmVector<uint64_t> reader("vec4");
+  ASSERT_TRUE(reader.IsValid());
+  size_t mapped = reader.MappedCapacity();
+  const size_t n = 200000;
+  const int writers = 2;
+  for (int w = 0; w < writers; ++w) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      shmlite::ShmVector<uint64_t> writer("vec4");
+      for (size_t i = 0; i < n; ++i) {
+        writer.PushBack(w * n + i);
+      }
+      _exit(0);
+    }
+  }
+  for (int w = 0; w < writers; ++w) {
+    wait(nullptr);
+  }
+  /* 读者的映射在访问到新的位置时才更新 */
+  EXPECT_EQ(reader.MappedCapacity(), mapped);
+  ASSERT_EQ(reader.Size(), writers * n);
+  std::vector<int> seen(writers * n, 0);
+  for (size_t i = 0; i < writers * n; ++i) {
+    ++seen[reader[i]];
+  }
+  EXPECT_EQ(reader.MappedCapacity(), reader.Capacity());
+  for (size_t i = 0; i < writers * n; ++i) {
+    ASSERT_EQ(seen[i], 1);
+  }
+  shmlite::ShmVector<uint64_t>::UnLink("vec4");
+}
+
+TEST(ShmVectorTest, HandleResize) {
+  shmlite::ShmHandle::UnLink("vec5");
+  shmlite::ShmHandle handle("vec5", 4096, shmlite::ShmHandle::CREAT_RDWR, true);
+  ASSERT_TRUE(handle.IsValid());
+  static_cast<char *>(handle.Ptr())[4095] = 'x';
+  ASSERT_TRUE(handle.Resize(1 << 20));
+  EXPECT_EQ(handle.GetSize(), 1u << 20);
+  EXPECT_EQ(static_cast<char *>(handle.Ptr())[4095], 'x');
+  static_cast<char *>(handle.Ptr())[(1 << 20) - 1] = 'y';
+
+  shmlite::ShmHandle other("vec5", 1 << 20, shmlite::ShmHandle::READ_WRITE);
+  EXPECT_EQ(static_cast<char *>(other.Ptr())[(1 << 20) - 1], 'y');
+  ASSERT_TRUE(other.Remap(4096));
+  EXPECT_EQ(other.GetSize(), 4096u);
+  EXPECT_EQ(static_cast<char *>(other.Ptr())[4095], 'x');
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}